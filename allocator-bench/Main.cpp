@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <math.h>
+
+#include "../directx-sandbox/OffsetAllocator.h"
+
+/* Runs the geometry pool's allocator through a model streaming style workload, no GPU needed:
+ * allocations sized like meshes (log-uniform, a few dozen vertices up to a big chunk of the
+ * space) come and go in random order while the space is kept around a target fill. The same
+ * workload goes through a plain first-fit free list too, as the baseline it's replacing. */
+
+struct BenchOptions {
+	unsigned long long ops;
+	unsigned int space;
+	unsigned int maxAllocations;
+	int fillPercent;
+	unsigned int seed;
+	bool check;
+
+	BenchOptions() {
+		ops = 2000000;
+		space = 1 << 24;
+		maxAllocations = 64 * 1024;
+		fillPercent = 80;
+		seed = 1;
+		check = false;
+	}
+};
+
+// Decided up front so the timed loop is nothing but allocator calls
+struct Workload {
+	std::vector<unsigned int> sizes;
+	std::vector<unsigned int> picks;
+};
+
+struct BenchResult {
+	double ms;
+	unsigned long long allocations;
+	unsigned long long frees;
+	unsigned long long failures;  // allocations that didn't fit
+	unsigned long long fragmentedFailures; // ...even though there was that much free in total
+	unsigned int freeRanges;
+	unsigned int largestFree;
+	unsigned int totalFree;
+	bool ok;
+};
+
+// The obvious allocator: free ranges in an offset ordered map, the first that fits wins, and
+// freed ranges merge with their neighbours
+class FirstFitAllocator {
+public:
+	struct Handle {
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	// Any number of ranges fit in the map, so there's no allocation limit to set up
+	void Init(unsigned int space, unsigned int) {
+		this->freeRanges.clear();
+		this->freeRanges[0] = space;
+		this->totalFree = space;
+	}
+
+	bool Allocate(unsigned int size, Handle& handle) {
+		for (auto it = this->freeRanges.begin(); it != this->freeRanges.end(); ++it) {
+			if (it->second < size) continue;
+			handle.offset = it->first;
+			handle.size = size;
+			unsigned int rest = it->second - size;
+			this->freeRanges.erase(it);
+			if (rest > 0) this->freeRanges[handle.offset + size] = rest;
+			this->totalFree -= size;
+			return true;
+		}
+		return false;
+	}
+
+	void Free(Handle handle) {
+		unsigned int offset = handle.offset, size = handle.size;
+		auto next = this->freeRanges.lower_bound(offset);
+		if (next != this->freeRanges.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				offset = prev->first;
+				size += prev->second;
+				this->freeRanges.erase(prev);
+			}
+		}
+		if (next != this->freeRanges.end() && next->first == handle.offset + handle.size) {
+			size += next->second;
+			this->freeRanges.erase(next);
+		}
+		this->freeRanges[offset] = size;
+		this->totalFree += handle.size;
+	}
+
+	unsigned int GetOffset(const Handle& handle) {
+		return handle.offset;
+	}
+
+	unsigned int GetSize(const Handle& handle) {
+		return handle.size;
+	}
+
+	void GetStats(OffsetAllocator::Stats& stats) {
+		stats.totalFree = this->totalFree;
+		stats.freeRanges = (unsigned int)this->freeRanges.size();
+		stats.largestFree = 0;
+		for (auto it = this->freeRanges.begin(); it != this->freeRanges.end(); ++it) {
+			if (it->second > stats.largestFree) stats.largestFree = it->second;
+		}
+	}
+
+private:
+	std::map<unsigned int, unsigned int> freeRanges;
+	unsigned int totalFree;
+};
+
+// OffsetAllocator with the same face as the baseline
+class TlsfAllocator {
+public:
+	struct Handle {
+		OffsetAllocator::Allocation allocation;
+		unsigned int size;
+	};
+
+	void Init(unsigned int space, unsigned int maxAllocations) {
+		this->allocator.Init(space, maxAllocations);
+	}
+
+	bool Allocate(unsigned int size, Handle& handle) {
+		handle.allocation = this->allocator.Allocate(size);
+		handle.size = size;
+		return handle.allocation.offset != OffsetAllocator::NO_SPACE;
+	}
+
+	void Free(Handle handle) {
+		this->allocator.Free(handle.allocation);
+	}
+
+	unsigned int GetOffset(const Handle& handle) {
+		return handle.allocation.offset;
+	}
+
+	unsigned int GetSize(const Handle& handle) {
+		return handle.size;
+	}
+
+	void GetStats(OffsetAllocator::Stats& stats) {
+		this->allocator.GetStats(stats);
+	}
+
+private:
+	OffsetAllocator allocator;
+};
+
+void printUsage() {
+	printf("Usage: allocator-bench [options]\n");
+	printf("  --ops N          allocations and frees to run (default 2000000)\n");
+	printf("  --space N        elements in the space being handed out (default 16777216)\n");
+	printf("  --max-allocs N   live allocations at most (default 65536)\n");
+	printf("  --fill N         percent of the space to keep allocated (default 80)\n");
+	printf("  --seed N         for the random workload (default 1)\n");
+	printf("  --check          check every allocation against the live ones (slow, and counted in the times)\n");
+}
+
+int parseArgs(int argc, char* argv[], BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--ops" && i + 1 < argc) {
+			options.ops = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--space" && i + 1 < argc) {
+			options.space = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--max-allocs" && i + 1 < argc) {
+			options.maxAllocations = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--fill" && i + 1 < argc) {
+			options.fillPercent = atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			options.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--check") {
+			options.check = true;
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.ops == 0 || options.space < 1024 || options.maxAllocations == 0
+		|| options.fillPercent <= 0 || options.fillPercent >= 100)
+	{
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+void buildWorkload(const BenchOptions& options, Workload& workload) {
+	std::mt19937 random(options.seed);
+	// A 12 triangle box up to a 64th of the whole space
+	double minLog = log(36.0), maxLog = log(options.space / 64.0);
+	std::uniform_real_distribution<double> sizeLog(minLog, maxLog);
+	workload.sizes.resize((size_t)options.ops);
+	workload.picks.resize((size_t)options.ops);
+	for (size_t i = 0; i < workload.sizes.size(); i++) {
+		workload.sizes[i] = (unsigned int)exp(sizeLog(random));
+		workload.picks[i] = (unsigned int)random();
+	}
+}
+
+// Checks a new allocation is inside the space and overlaps nothing live. live maps offset to size.
+bool checkAllocation(std::map<unsigned int, unsigned int>& live, unsigned int offset, unsigned int size, unsigned int space) {
+	if (offset > space || size > space - offset) {
+		printf("ERROR: allocation %u + %u is outside the %u space\n", offset, size, space);
+		return false;
+	}
+	auto next = live.lower_bound(offset);
+	if (next != live.end() && next->first < offset + size) {
+		printf("ERROR: allocation %u + %u overlaps %u + %u\n", offset, size, next->first, next->second);
+		return false;
+	}
+	if (next != live.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second > offset) {
+			printf("ERROR: allocation %u + %u overlaps %u + %u\n", offset, size, prev->first, prev->second);
+			return false;
+		}
+	}
+	live[offset] = size;
+	return true;
+}
+
+// Allocates while under the target fill and frees a random live allocation once over it. An
+// allocation that doesn't fit also frees one, so the run keeps going either way.
+template <typename Allocator>
+BenchResult runWorkload(const BenchOptions& options, const Workload& workload) {
+	BenchResult result;
+	memset(&result, 0, sizeof(result));
+	result.ok = true;
+
+	Allocator allocator;
+	allocator.Init(options.space, options.maxAllocations);
+	std::vector<typename Allocator::Handle> handles;
+	handles.reserve(options.maxAllocations);
+	std::map<unsigned int, unsigned int> live;
+	unsigned long long used = 0;
+	unsigned long long target = (unsigned long long)options.space * options.fillPercent / 100;
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < workload.sizes.size(); i++) {
+		bool wantFree = used >= target || handles.size() >= options.maxAllocations;
+		if (!wantFree) {
+			typename Allocator::Handle handle;
+			if (allocator.Allocate(workload.sizes[i], handle)) {
+				result.allocations++;
+				used += workload.sizes[i];
+				handles.push_back(handle);
+				if (options.check && !checkAllocation(live, allocator.GetOffset(handle), workload.sizes[i], options.space)) {
+					result.ok = false;
+					break;
+				}
+				continue;
+			}
+			result.failures++;
+			if (options.space - used >= workload.sizes[i]) result.fragmentedFailures++;
+		}
+		if (handles.empty()) continue;
+
+		size_t pick = workload.picks[i] % handles.size();
+		typename Allocator::Handle handle = handles[pick];
+		handles[pick] = handles.back();
+		handles.pop_back();
+		used -= allocator.GetSize(handle);
+		if (options.check) live.erase(allocator.GetOffset(handle));
+		allocator.Free(handle);
+		result.frees++;
+	}
+	result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	OffsetAllocator::Stats stats;
+	allocator.GetStats(stats);
+	result.freeRanges = stats.freeRanges;
+	result.largestFree = stats.largestFree;
+	result.totalFree = stats.totalFree;
+
+	// With everything freed it should all have merged back into the one range
+	if (options.check && result.ok) {
+		for (size_t i = 0; i < handles.size(); i++) allocator.Free(handles[i]);
+		allocator.GetStats(stats);
+		if (stats.freeRanges != 1 || stats.largestFree != options.space || stats.totalFree != options.space) {
+			printf("ERROR: after freeing everything there are %u free ranges, largest %u of %u\n",
+				stats.freeRanges, stats.largestFree, options.space);
+			result.ok = false;
+		}
+	}
+	return result;
+}
+
+void printResult(const char* name, const BenchResult& result) {
+	unsigned long long ops = result.allocations + result.frees + result.failures;
+	OffsetAllocator::Stats stats = {};
+	stats.totalFree = result.totalFree;
+	stats.largestFree = result.largestFree;
+	printf("%-10s %9.1f ms %8.1f ns/op  %llu allocs, %llu failed (%llu with enough free space)\n",
+		name, result.ms, result.ms * 1e6 / (double)(ops ? ops : 1), result.allocations,
+		result.failures, result.fragmentedFailures);
+	printf("%-10s end state: %u free ranges, largest %u of %u free, fragmentation %.1f%%\n",
+		"", result.freeRanges, result.largestFree, result.totalFree, OffsetAllocator::GetFragmentation(stats) * 100.0f);
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	Workload workload;
+	buildWorkload(options, workload);
+	printf("%llu ops over a space of %u, %d%% full, at most %u live, seed %u%s\n",
+		options.ops, options.space, options.fillPercent, options.maxAllocations, options.seed,
+		options.check ? ", checking (times include the checks)" : "");
+
+	BenchResult tlsf = runWorkload<TlsfAllocator>(options, workload);
+	printResult("TLSF", tlsf);
+	BenchResult firstFit = runWorkload<FirstFitAllocator>(options, workload);
+	printResult("First fit", firstFit);
+	if (!tlsf.ok || !firstFit.ok) return -10;
+
+	if (tlsf.ms > 0.0) printf("TLSF is %.1fx the speed of first fit\n", firstFit.ms / tlsf.ms);
+	return 0;
+}
\ No newline at end of file
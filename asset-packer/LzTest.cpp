@@ -0,0 +1,145 @@
+#include "LzTest.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../directx-sandbox/LzCodec.h"
+
+// Same sequence every run, so a failure can be reproduced
+static unsigned int nextRandom(unsigned int& state) {
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// Compresses into a buffer of exactly GetCompressBound bytes and decompresses into one of
+// exactly the original size, the way the packer and AssetArchive size them
+static bool roundTrip(const char* name, const std::vector<unsigned char>& data, size_t* pPackedSize = nullptr) {
+	std::vector<unsigned char> packed(LzCodec::GetCompressBound(data.size()));
+	size_t packedSize = LzCodec::Compress(data.data(), data.size(), packed.data(), packed.size());
+	if (packedSize == 0) {
+		printf("ERROR: %s: didn't fit in the compress bound (%zu bytes)\n", name, data.size());
+		return false;
+	}
+	// One extra byte, so writing past the end shows up as a changed guard
+	std::vector<unsigned char> unpacked(data.size() + 1, 0xA5);
+	if (!LzCodec::Decompress(packed.data(), packedSize, unpacked.data(), data.size())) {
+		printf("ERROR: %s: decompressing failed (%zu -> %zu bytes)\n", name, data.size(), packedSize);
+		return false;
+	}
+	if (unpacked[data.size()] != 0xA5) {
+		printf("ERROR: %s: decompressing wrote past the end\n", name);
+		return false;
+	}
+	unpacked.resize(data.size());
+	if (unpacked != data) {
+		printf("ERROR: %s: contents differ after the round trip\n", name);
+		return false;
+	}
+	if (pPackedSize) *pPackedSize = packedSize;
+	printf("  %-36s %8zu -> %8zu\n", name, data.size(), packedSize);
+	return true;
+}
+
+int runLzTests() {
+	int failures = 0;
+	unsigned int state = 12345;
+	std::vector<unsigned char> data;
+
+	data.clear();
+	if (!roundTrip("empty", data)) failures++;
+	for (size_t size = 1; size <= 20; size++) {
+		// Around the sizes where matching starts at all
+		data.assign(size, 'x');
+		std::string name = "run of " + std::to_string(size);
+		if (!roundTrip(name.c_str(), data)) failures++;
+	}
+
+	// Incompressible data has to come out no bigger than the bound says, and everything as literals
+	size_t sizes[] = { 1, 15, 16, 270, 4096, 100000 };
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		data.resize(sizes[s]);
+		for (size_t i = 0; i < data.size(); i++) data[i] = (unsigned char)nextRandom(state);
+		std::string name = "random " + std::to_string(sizes[s]);
+		if (!roundTrip(name.c_str(), data)) failures++;
+	}
+
+	// Offsets shorter than the match, so the decoder copies bytes it's only just written
+	for (size_t period = 1; period <= 7; period++) {
+		data.resize(5000);
+		for (size_t i = 0; i < data.size(); i++) data[i] = (unsigned char)('a' + i % period);
+		std::string name = "overlapping, period " + std::to_string(period);
+		size_t packedSize = 0;
+		if (!roundTrip(name.c_str(), data, &packedSize)) failures++;
+		else if (packedSize > 100) {
+			printf("ERROR: %s: only compressed to %zu bytes\n", name.c_str(), packedSize);
+			failures++;
+		}
+	}
+
+	// A random block repeated at and just past the 64 KiB offset limit, with zeros in between
+	// (those go as one long overlapping match, so the block's positions stay in the hash table).
+	// At the limit it has to be found; past it, it has to go out as literals.
+	size_t distances[] = { 65535, 65536, 70000 };
+	for (size_t d = 0; d < sizeof(distances) / sizeof(distances[0]); d++) {
+		const size_t blockSize = 1000;
+		data.assign(distances[d] + blockSize + 100, 0);
+		for (size_t i = 0; i < blockSize; i++) data[i] = (unsigned char)nextRandom(state);
+		for (size_t i = 0; i < blockSize; i++) data[distances[d] + i] = data[i];
+		std::string name = "repeat at " + std::to_string(distances[d]);
+		size_t packedSize = 0;
+		if (!roundTrip(name.c_str(), data, &packedSize)) failures++;
+		else if ((distances[d] <= 65535) != (packedSize < 2 * blockSize - 100)) {
+			printf("ERROR: %s: compressed to %zu bytes\n", name.c_str(), packedSize);
+			failures++;
+		}
+	}
+
+	// Text-like data, mixing short literal runs and matches
+	data.clear();
+	const char* words[] = { "vertex ", "normal ", "texcoord ", "0.5 ", "-1.25 ", "face ", "\n" };
+	while (data.size() < 200000) {
+		const char* word = words[nextRandom(state) % (sizeof(words) / sizeof(words[0]))];
+		while (*word) data.push_back((unsigned char)*word++);
+	}
+	if (!roundTrip("text", data)) failures++;
+
+	// Too little room has to fail cleanly, not write past the end
+	std::vector<unsigned char> packed(LzCodec::GetCompressBound(data.size()) + 1);
+	size_t packedSize = LzCodec::Compress(data.data(), data.size(), packed.data(), packed.size() - 1);
+	packed[packedSize] = 0xA5;
+	if (LzCodec::Compress(data.data(), data.size(), packed.data(), packedSize - 1) != 0 || packed[packedSize] != 0xA5) {
+		printf("ERROR: compressing into a buffer one byte short didn't fail cleanly\n");
+		failures++;
+	}
+	packedSize = LzCodec::Compress(data.data(), data.size(), packed.data(), packed.size() - 1);
+
+	// Broken blocks and wrong sizes have to be refused
+	std::vector<unsigned char> unpacked(data.size() + 1);
+	if (LzCodec::Decompress(packed.data(), packedSize, unpacked.data(), data.size() - 1)) {
+		printf("ERROR: decompressing into a buffer one byte short succeeded\n");
+		failures++;
+	}
+	if (LzCodec::Decompress(packed.data(), packedSize, unpacked.data(), data.size() + 1)) {
+		printf("ERROR: decompressing into a buffer one byte long succeeded\n");
+		failures++;
+	}
+	if (LzCodec::Decompress(packed.data(), packedSize / 2, unpacked.data(), data.size())) {
+		printf("ERROR: decompressing a truncated block succeeded\n");
+		failures++;
+	}
+	// A match pointing before the start of the output
+	const unsigned char badOffset[] = { 0x10, 'a', 0x05, 0x00, 0x00 };
+	if (LzCodec::Decompress(badOffset, sizeof(badOffset), unpacked.data(), 5)) {
+		printf("ERROR: decompressing a match from before the start succeeded\n");
+		failures++;
+	}
+	const unsigned char zeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+	if (LzCodec::Decompress(zeroOffset, sizeof(zeroOffset), unpacked.data(), 5)) {
+		printf("ERROR: decompressing a match with offset 0 succeeded\n");
+		failures++;
+	}
+
+	printf("LZ: %d checks failed\n", failures);
+	return failures;
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#pragma once
+
+// Round trips LzCodec over the inputs that are easy to get wrong (nothing at all, data that
+// won't compress, matches that overlap their own output, offsets at the edge of the window)
+// and checks it refuses short output buffers and broken blocks. Returns how many checks failed.
+int runLzTests();
\ No newline at end of file
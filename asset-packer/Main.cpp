@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include "../directx-sandbox/ArchiveFile.h"
+#include "../directx-sandbox/AssetArchive.h"
+#include "../directx-sandbox/LzCodec.h"
+#include "LzTest.h"
+
+struct PackOptions {
+	std::string outputFilename;
+	std::vector<std::string> inputs;
+	bool compress;
+	int minSavingPercent;
+
+	PackOptions() {
+		compress = true;
+		minSavingPercent = 12;
+	}
+};
+
+struct PackFile {
+	std::string path; // as found on disk
+	std::string name; // normalized, what goes in the archive
+	ArchiveEntry entry;
+};
+
+void printUsage() {
+	printf("Usage: asset-packer <output.pak> <file or directory>... [options]\n");
+	printf("       asset-packer --list <archive.pak>\n");
+	printf("       asset-packer --verify <archive.pak>\n");
+	printf("       asset-packer --self-test\n");
+	printf("  --no-compress     store every file as-is\n");
+	printf("  --min-saving N    keep a file compressed only if that saves N%% or more (default 12)\n");
+	printf("Entries are named by the path they were given as, so pack from the directory the game\n");
+	printf("runs in (e.g. 'asset-packer data.pak data'). --verify checks every entry against the\n");
+	printf("loose file it came from, relative to the current directory. --self-test round trips the\n");
+	printf("compression and a small archive it packs in the current directory.\n");
+}
+
+int parseArgs(int argc, char* argv[], PackOptions& options) {
+	if (argc < 3) {
+		printf("ERROR: missing output filename or inputs\n");
+		return -1;
+	}
+	options.outputFilename = argv[1];
+
+	for (int i = 2; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--no-compress") {
+			options.compress = false;
+		}
+		else if (arg == "--min-saving" && i + 1 < argc) {
+			options.minSavingPercent = atoi(argv[++i]);
+		}
+		else if (arg.rfind("--", 0) == 0) {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+		else {
+			options.inputs.push_back(arg);
+		}
+	}
+	if (options.inputs.empty()) {
+		printf("ERROR: nothing to pack\n");
+		return -1;
+	}
+	return 0;
+}
+
+// Expands directories into every regular file under them. Sorted so the same inputs always
+// make the same archive.
+int collectFiles(const PackOptions& options, std::vector<PackFile>& files) {
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < options.inputs.size(); i++) {
+		std::error_code error;
+		std::filesystem::path input(options.inputs[i]);
+		if (std::filesystem::is_directory(input, error)) {
+			for (auto it = std::filesystem::recursive_directory_iterator(input, error);
+				!error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+			{
+				if (it->is_regular_file(error)) paths.push_back(it->path().generic_string());
+			}
+		}
+		else if (std::filesystem::is_regular_file(input, error)) {
+			paths.push_back(input.generic_string());
+		}
+		else {
+			printf("ERROR: '%s' isn't a file or directory\n", options.inputs[i].c_str());
+			return -1;
+		}
+		if (error) {
+			printf("ERROR: couldn't list '%s': %s\n", options.inputs[i].c_str(), error.message().c_str());
+			return -1;
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+
+	std::set<std::string> names;
+	for (size_t i = 0; i < paths.size(); i++) {
+		PackFile file;
+		file.path = paths[i];
+		file.name = NormalizeArchiveName(paths[i].c_str());
+		std::string lowerName = file.name;
+		for (size_t c = 0; c < lowerName.size(); c++) lowerName[c] = LowerArchiveChar(lowerName[c]);
+		if (!names.insert(lowerName).second) {
+			printf("ERROR: '%s' is in the inputs twice (names ignore case)\n", file.name.c_str());
+			return -1;
+		}
+		memset(&file.entry, 0, sizeof(file.entry));
+		file.entry.nameHash = HashArchiveName(file.name);
+		files.push_back(file);
+	}
+	return 0;
+}
+
+bool readFile(const std::string& filename, std::vector<unsigned char>& data) {
+	FILE* pFile = fopen(filename.c_str(), "rb");
+	if (!pFile) return false;
+	data.clear();
+	unsigned char chunk[64 * 1024];
+	size_t count;
+	while ((count = fread(chunk, 1, sizeof(chunk), pFile)) > 0) {
+		data.insert(data.end(), chunk, chunk + count);
+	}
+	bool ok = ferror(pFile) == 0;
+	fclose(pFile);
+	return ok;
+}
+
+// Textures in these formats get their levels used straight out of the mapping, which only
+// works if they're stored as-is
+bool mustStayStored(const std::string& name) {
+	auto endsWith = [&name](const char* extension) {
+		size_t length = strlen(extension);
+		return name.size() >= length && name.compare(name.size() - length, length, extension) == 0;
+	};
+	return endsWith(".ctex") || endsWith(".dds");
+}
+
+unsigned long long alignUp(unsigned long long value, unsigned long long alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool writePadding(FILE* pFile, unsigned long long& offset, unsigned long long target) {
+	static const unsigned char zeros[ARCHIVE_DATA_ALIGNMENT] = { };
+	while (offset < target) {
+		size_t count = (size_t)std::min<unsigned long long>(target - offset, sizeof(zeros));
+		if (fwrite(zeros, 1, count, pFile) != count) return false;
+		offset += count;
+	}
+	return true;
+}
+
+// The header, table of contents and names are all known before any data is written, so that
+// space is left blank, each file is read, compressed and written in turn (only one is ever in
+// memory), and then the front gets filled in.
+int writeArchive(const PackOptions& options, std::vector<PackFile>& files) {
+	std::string names;
+	for (size_t i = 0; i < files.size(); i++) {
+		files[i].entry.nameOffset = (unsigned int)names.size();
+		files[i].entry.nameLength = (unsigned int)files[i].name.size();
+		names += files[i].name;
+	}
+
+	ArchiveHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = ARCHIVE_MAGIC;
+	header.version = ARCHIVE_VERSION;
+	header.entryCount = (unsigned int)files.size();
+	header.tocOffset = sizeof(ArchiveHeader);
+	header.namesOffset = header.tocOffset + sizeof(ArchiveEntry) * files.size();
+	header.namesSize = names.size();
+
+	FILE* pFile = fopen(options.outputFilename.c_str(), "wb");
+	if (!pFile) {
+		printf("ERROR: could not open '%s' for writing\n", options.outputFilename.c_str());
+		return -1;
+	}
+
+	unsigned long long offset = 0;
+	bool ok = writePadding(pFile, offset, header.namesOffset + header.namesSize);
+	unsigned long long totalSize = 0, totalStored = 0;
+	int compressedCount = 0;
+	std::vector<unsigned char> data, packed;
+	for (size_t i = 0; ok && i < files.size(); i++) {
+		PackFile& file = files[i];
+		if (!readFile(file.path, data)) {
+			printf("ERROR: could not read '%s'\n", file.path.c_str());
+			fclose(pFile);
+			return -1;
+		}
+
+		const unsigned char* pStored = data.data();
+		size_t storedSize = data.size();
+		if (options.compress && !mustStayStored(file.name) && !data.empty()) {
+			packed.resize(LzCodec::GetCompressBound(data.size()));
+			size_t packedSize = LzCodec::Compress(data.data(), data.size(), packed.data(), packed.size());
+			if (packedSize > 0 && packedSize * 100 <= data.size() * (100 - (size_t)options.minSavingPercent)) {
+				pStored = packed.data();
+				storedSize = packedSize;
+				file.entry.flags |= ARCHIVE_ENTRY_COMPRESSED;
+				compressedCount++;
+			}
+		}
+
+		ok = writePadding(pFile, offset, alignUp(offset, ARCHIVE_DATA_ALIGNMENT));
+		file.entry.offset = offset;
+		file.entry.size = data.size();
+		file.entry.storedSize = storedSize;
+		ok = ok && fwrite(pStored, 1, storedSize, pFile) == storedSize;
+		offset += storedSize;
+		totalSize += data.size();
+		totalStored += storedSize;
+
+		printf("  %-40s %10llu -> %10llu%s\n", file.name.c_str(), (unsigned long long)data.size(),
+			(unsigned long long)storedSize, (file.entry.flags & ARCHIVE_ENTRY_COMPRESSED) ? "  lz" : "");
+	}
+
+	std::vector<ArchiveEntry> entries(files.size());
+	for (size_t i = 0; i < files.size(); i++) entries[i] = files[i].entry;
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const ArchiveEntry& a, const ArchiveEntry& b) { return a.nameHash < b.nameHash; });
+
+	ok = ok && fseek(pFile, 0, SEEK_SET) == 0;
+	ok = ok && fwrite(&header, sizeof(header), 1, pFile) == 1;
+	ok = ok && (entries.empty() || fwrite(entries.data(), sizeof(ArchiveEntry), entries.size(), pFile) == entries.size());
+	ok = ok && fwrite(names.data(), 1, names.size(), pFile) == names.size();
+	ok = ok && ferror(pFile) == 0;
+	ok = (fclose(pFile) == 0) && ok;
+	if (!ok) {
+		printf("ERROR: failed while writing '%s'\n", options.outputFilename.c_str());
+		return -1;
+	}
+
+	printf("Packed %d files (%d compressed): %llu -> %llu bytes of data (%.1f%%), %llu bytes on disk\n",
+		(int)files.size(), compressedCount, totalSize, totalStored,
+		totalSize ? 100.0 * totalStored / totalSize : 100.0, offset);
+	return 0;
+}
+
+int listArchive(const char* filename) {
+	AssetArchive archive;
+	if (!archive.Open(filename)) return -10;
+	for (int i = 0; i < archive.GetEntryCount(); i++) {
+		printf("  %-40s %10llu %10llu%s\n", archive.GetName(i).c_str(), archive.GetSize(i),
+			archive.GetStoredSize(i), archive.IsCompressed(i) ? "  lz" : "");
+	}
+	printf("%d files in '%s'\n", archive.GetEntryCount(), filename);
+	return 0;
+}
+
+// Reads every entry back through the same code the game uses and compares it with the file
+// it was made from
+int verifyArchive(const char* filename) {
+	AssetArchive archive;
+	if (!archive.Open(filename)) return -10;
+
+	int failures = 0;
+	std::vector<unsigned char> original, extracted;
+	for (int i = 0; i < archive.GetEntryCount(); i++) {
+		std::string name = archive.GetName(i);
+		bool ok = archive.Find(name.c_str()) == i;
+		if (!ok) printf("  %s: lookup by name doesn't find it\n", name.c_str());
+
+		extracted.resize((size_t)archive.GetSize(i) + 1);
+		if (ok && !archive.Extract(i, extracted.data())) {
+			printf("  %s: couldn't extract\n", name.c_str());
+			ok = false;
+		}
+		extracted.resize((size_t)archive.GetSize(i));
+		if (ok && !readFile(name, original)) {
+			printf("  %s: no loose file to compare with\n", name.c_str());
+			ok = false;
+		}
+		if (ok && original != extracted) {
+			printf("  %s: contents differ\n", name.c_str());
+			ok = false;
+		}
+		if (!ok) failures++;
+	}
+
+	printf("%d of %d entries verified\n", archive.GetEntryCount() - failures, archive.GetEntryCount());
+	return failures == 0 ? 0 : -15;
+}
+
+bool writeFile(const std::string& filename, const std::vector<unsigned char>& data) {
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (!pFile) return false;
+	bool ok = data.empty() || fwrite(data.data(), 1, data.size(), pFile) == data.size();
+	return (fclose(pFile) == 0) && ok;
+}
+
+// Packs a directory of files picked to hit each path through the packer (empty, won't
+// compress, compresses, compressible but has to stay stored, nested with mixed case names),
+// then verifies the archive and checks each entry was stored the way it should have been
+int runArchiveTest() {
+	const std::string directory = "asset-packer-test";
+	const std::string archiveName = directory + ".pak";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+	std::filesystem::create_directories(directory + "/Sub Dir", error);
+	if (error) {
+		printf("ERROR: couldn't make '%s': %s\n", directory.c_str(), error.message().c_str());
+		return 1;
+	}
+
+	struct TestFile {
+		const char* name;
+		bool compressed;
+	};
+	const TestFile testFiles[] = {
+		{ "empty.bin", false },
+		{ "random.bin", false },
+		{ "text.txt", true },
+		{ "levels.ctex", false },
+		{ "Sub Dir/Mixed Case.OBJ", true },
+	};
+	const int testFileCount = sizeof(testFiles) / sizeof(testFiles[0]);
+
+	unsigned int state = 6789;
+	std::vector<unsigned char> random(50000), text;
+	for (size_t i = 0; i < random.size(); i++) {
+		state = state * 1664525u + 1013904223u;
+		random[i] = (unsigned char)(state >> 24);
+	}
+	for (int i = 0; i < 3000; i++) {
+		std::string line = "v " + std::to_string(i % 17) + ".5 " + std::to_string(i % 5) + ".25 1.0\n";
+		text.insert(text.end(), line.begin(), line.end());
+	}
+
+	int failures = 0;
+	bool ok = writeFile(directory + "/empty.bin", std::vector<unsigned char>());
+	ok = ok && writeFile(directory + "/random.bin", random);
+	ok = ok && writeFile(directory + "/text.txt", text);
+	ok = ok && writeFile(directory + "/levels.ctex", text);
+	ok = ok && writeFile(directory + "/Sub Dir/Mixed Case.OBJ", text);
+	if (!ok) {
+		printf("ERROR: couldn't write the test files\n");
+		failures++;
+	}
+
+	PackOptions options;
+	options.outputFilename = archiveName;
+	options.inputs.push_back("./" + directory);
+	std::vector<PackFile> files;
+	if (ok && (collectFiles(options, files) < 0 || writeArchive(options, files) < 0)) {
+		printf("ERROR: packing '%s' failed\n", directory.c_str());
+		failures++;
+		ok = false;
+	}
+	if (ok && verifyArchive(archiveName.c_str()) != 0) failures++;
+
+	AssetArchive archive;
+	if (ok && archive.Open(archiveName.c_str())) {
+		if (archive.GetEntryCount() != testFileCount) {
+			printf("ERROR: %d entries in the archive, expected %d\n", archive.GetEntryCount(), testFileCount);
+			failures++;
+		}
+		for (int i = 0; i < testFileCount; i++) {
+			// Looked up the way the game would spell it, not the way it was packed
+			std::string lookup = ".\\" + directory + "\\" + testFiles[i].name;
+			for (size_t c = 0; c < lookup.size(); c++) {
+				if (lookup[c] == '/') lookup[c] = '\\';
+				else lookup[c] = LowerArchiveChar(lookup[c]);
+			}
+			int index = archive.Find(lookup.c_str());
+			if (index < 0) {
+				printf("ERROR: '%s' isn't found as '%s'\n", testFiles[i].name, lookup.c_str());
+				failures++;
+				continue;
+			}
+			if (archive.IsCompressed(index) != testFiles[i].compressed) {
+				printf("ERROR: '%s' is %s, expected it %s\n", testFiles[i].name,
+					archive.IsCompressed(index) ? "compressed" : "stored", testFiles[i].compressed ? "compressed" : "stored");
+				failures++;
+			}
+			// Stored data gets used in place, so it has to be page aligned in the mapping
+			const unsigned char* pStored = archive.IsCompressed(index) ? nullptr : archive.GetStoredData(index);
+			if (pStored && archive.GetSize(index) > 0 && (size_t)pStored % ARCHIVE_DATA_ALIGNMENT != 0) {
+				printf("ERROR: '%s' isn't aligned in the archive\n", testFiles[i].name);
+				failures++;
+			}
+		}
+		archive.Close();
+	}
+	else if (ok) {
+		failures++;
+	}
+
+	std::filesystem::remove_all(directory, error);
+	std::filesystem::remove(archiveName, error);
+	printf("Archive: %d checks failed\n", failures);
+	return failures;
+}
+
+int main(int argc, char* argv[]) {
+	printf("Asset packer started.  argc=%d\n", argc);
+
+	if (argc == 3 && strcmp(argv[1], "--list") == 0) return listArchive(argv[2]);
+	if (argc == 3 && strcmp(argv[1], "--verify") == 0) return verifyArchive(argv[2]);
+	if (argc == 2 && strcmp(argv[1], "--self-test") == 0) return runLzTests() + runArchiveTest() == 0 ? 0 : -10;
+
+	PackOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<PackFile> files;
+	if (collectFiles(options, files) < 0) return -10;
+	if (writeArchive(options, files) < 0) return -20;
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Output written to: %s (%.2f ms)\n", options.outputFilename.c_str(), ms);
+	return 0;
+}
\ No newline at end of file
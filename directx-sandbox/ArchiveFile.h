@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+
+/* On-disk layout of a packed asset archive (.pak), written by asset-packer and read by
+ * AssetArchive. The file is a header, the table of contents (one ArchiveEntry per file, sorted
+ * by name hash so a lookup is a binary search), the names the entries point into, then each
+ * file's data starting on a 4 KiB boundary. Entries stored as-is can be used straight out of a
+ * mapping of the archive; compressed ones are LzCodec blocks. */
+
+static const unsigned int ARCHIVE_MAGIC = 0x4B415041; // "APAK"
+static const unsigned int ARCHIVE_VERSION = 1;
+
+// Page sized, so a stored entry's data is page aligned in the mapping (and O_DIRECT friendly)
+static const unsigned int ARCHIVE_DATA_ALIGNMENT = 4096;
+
+// ArchiveEntry::flags
+static const unsigned int ARCHIVE_ENTRY_COMPRESSED = 0x1;
+
+struct ArchiveHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int entryCount;
+	unsigned int reserved;
+	unsigned long long tocOffset;
+	unsigned long long namesOffset;
+	unsigned long long namesSize;
+};
+
+struct ArchiveEntry {
+	unsigned long long nameHash;
+	unsigned long long offset;     // from the start of the file
+	unsigned long long storedSize; // bytes in the archive
+	unsigned long long size;       // bytes once decompressed
+	unsigned int nameOffset;       // into the names block, not zero terminated
+	unsigned int nameLength;
+	unsigned int flags;
+	unsigned int reserved;
+};
+
+// Archive names are relative paths with forward slashes and no leading "./". They keep their
+// case for listing, but lookups ignore it (like the Windows file system does), so
+// "./data\\Sphere.txt" and "data/sphere.txt" find the same entry
+inline std::string NormalizeArchiveName(const char* filename) {
+	while (filename[0] == '.' && (filename[1] == '/' || filename[1] == '\\')) filename += 2;
+	std::string name = filename;
+	for (size_t i = 0; i < name.size(); i++) {
+		if (name[i] == '\\') name[i] = '/';
+	}
+	return name;
+}
+
+inline char LowerArchiveChar(char c) {
+	return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// 64-bit FNV-1a of a normalized name, lower cased as it goes
+inline unsigned long long HashArchiveName(const std::string& name) {
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < name.size(); i++) {
+		hash ^= (unsigned char)LowerArchiveChar(name[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+inline bool ArchiveNamesMatch(const char* pName, size_t length, const std::string& name) {
+	if (length != name.size()) return false;
+	for (size_t i = 0; i < length; i++) {
+		if (LowerArchiveChar(pName[i]) != LowerArchiveChar(name[i])) return false;
+	}
+	return true;
+}
\ No newline at end of file
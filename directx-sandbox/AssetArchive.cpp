@@ -0,0 +1,157 @@
+#include "AssetArchive.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "LzCodec.h"
+
+static AssetArchive* pMounted = nullptr;
+
+AssetArchive::AssetArchive() {
+	this->pHeader = nullptr;
+	this->pEntries = nullptr;
+	this->pNames = nullptr;
+}
+
+AssetArchive::~AssetArchive() {
+	Close();
+}
+
+// Everything the lookups rely on gets bounds checked here once, so a damaged archive fails to
+// open rather than faulting halfway through a load
+bool AssetArchive::Open(const char* filename) {
+	Close();
+	if (!this->mapping.OpenLoose(filename)) return false;
+
+	const unsigned char* pFile = this->mapping.GetData();
+	unsigned long long fileSize = this->mapping.GetSize();
+	const ArchiveHeader* pHeader = (const ArchiveHeader*)pFile;
+	if (fileSize < sizeof(ArchiveHeader) || pHeader->magic != ARCHIVE_MAGIC) {
+		printf("ERROR: '%s' isn't an asset archive\n", filename);
+		Close();
+		return false;
+	}
+	if (pHeader->version != ARCHIVE_VERSION) {
+		printf("ERROR: '%s' is archive version %u, we read version %u\n", filename, pHeader->version, ARCHIVE_VERSION);
+		Close();
+		return false;
+	}
+	unsigned long long tocSize = (unsigned long long)pHeader->entryCount * sizeof(ArchiveEntry);
+	if (pHeader->tocOffset > fileSize || tocSize > fileSize - pHeader->tocOffset
+		|| pHeader->namesOffset > fileSize || pHeader->namesSize > fileSize - pHeader->namesOffset)
+	{
+		printf("ERROR: '%s' has a table of contents that runs past the end of the file\n", filename);
+		Close();
+		return false;
+	}
+
+	const ArchiveEntry* pEntries = (const ArchiveEntry*)(pFile + pHeader->tocOffset);
+	for (unsigned int i = 0; i < pHeader->entryCount; i++) {
+		const ArchiveEntry& entry = pEntries[i];
+		bool dataOk = entry.offset <= fileSize && entry.storedSize <= fileSize - entry.offset
+			&& ((entry.flags & ARCHIVE_ENTRY_COMPRESSED) || entry.storedSize == entry.size);
+		bool nameOk = (unsigned long long)entry.nameOffset + entry.nameLength <= pHeader->namesSize;
+		bool sorted = i == 0 || pEntries[i - 1].nameHash <= entry.nameHash;
+		if (!dataOk || !nameOk || !sorted) {
+			printf("ERROR: Entry %u of '%s' is damaged\n", i, filename);
+			Close();
+			return false;
+		}
+	}
+
+	this->pHeader = pHeader;
+	this->pEntries = pEntries;
+	this->pNames = (const char*)(pFile + pHeader->namesOffset);
+	return true;
+}
+
+void AssetArchive::Close() {
+	this->mapping.Close();
+	this->pHeader = nullptr;
+	this->pEntries = nullptr;
+	this->pNames = nullptr;
+}
+
+int AssetArchive::Find(const char* filename) {
+	if (!this->pHeader) return -1;
+	std::string name = NormalizeArchiveName(filename);
+	unsigned long long hash = HashArchiveName(name);
+
+	const ArchiveEntry* pEnd = this->pEntries + this->pHeader->entryCount;
+	const ArchiveEntry* pEntry = std::lower_bound(this->pEntries, pEnd, hash,
+		[](const ArchiveEntry& entry, unsigned long long hash) { return entry.nameHash < hash; });
+	// Different names can share a hash, so check the actual name of each one that does
+	for (; pEntry != pEnd && pEntry->nameHash == hash; ++pEntry) {
+		if (ArchiveNamesMatch(this->pNames + pEntry->nameOffset, pEntry->nameLength, name)) {
+			return (int)(pEntry - this->pEntries);
+		}
+	}
+	return -1;
+}
+
+int AssetArchive::GetEntryCount() {
+	return this->pHeader ? (int)this->pHeader->entryCount : 0;
+}
+
+std::string AssetArchive::GetName(int index) {
+	return std::string(this->pNames + this->pEntries[index].nameOffset, this->pEntries[index].nameLength);
+}
+
+unsigned long long AssetArchive::GetSize(int index) {
+	return this->pEntries[index].size;
+}
+
+unsigned long long AssetArchive::GetStoredSize(int index) {
+	return this->pEntries[index].storedSize;
+}
+
+bool AssetArchive::IsCompressed(int index) {
+	return (this->pEntries[index].flags & ARCHIVE_ENTRY_COMPRESSED) != 0;
+}
+
+const unsigned char* AssetArchive::GetStoredData(int index) {
+	if (IsCompressed(index)) return nullptr;
+	return this->mapping.GetData() + this->pEntries[index].offset;
+}
+
+bool AssetArchive::Extract(int index, unsigned char* pDest) {
+	const ArchiveEntry& entry = this->pEntries[index];
+	const unsigned char* pStored = this->mapping.GetData() + entry.offset;
+	if (!IsCompressed(index)) {
+		memcpy(pDest, pStored, (size_t)entry.size);
+		return true;
+	}
+	if (!LzCodec::Decompress(pStored, (size_t)entry.storedSize, pDest, (size_t)entry.size)) {
+		printf("ERROR: Archive entry '%s' didn't decompress\n", GetName(index).c_str());
+		return false;
+	}
+	return true;
+}
+
+// Quietly does nothing when there's no archive, running off loose files is perfectly normal
+bool AssetArchive::Mount(const char* filename) {
+	Unmount();
+	if (!MappedFile::Exists(filename)) return false;
+
+	AssetArchive* pArchive = new AssetArchive();
+	if (!pArchive->Open(filename)) {
+		delete pArchive;
+		return false;
+	}
+	pMounted = pArchive;
+	return true;
+}
+
+void AssetArchive::Unmount() {
+	delete pMounted;
+	pMounted = nullptr;
+}
+
+AssetArchive* AssetArchive::GetMounted() {
+	return pMounted;
+}
+
+bool AssetArchive::IsArchived(const char* filename) {
+	return pMounted && pMounted->Find(filename) >= 0;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include "ArchiveFile.h"
+#include "MappedFile.h"
+
+/* Read side of a packed asset archive. The whole archive is one memory mapping, so finding a
+ * file is a binary search over the table of contents and a stored entry's bytes are used right
+ * where they sit. Compressed entries get decompressed into the caller's memory.
+ *
+ * One archive can be mounted at a time. While it is, MappedFile (and through it the model,
+ * texture and AssetIO loaders) looks there first and only falls back to loose files for names
+ * the archive doesn't have. */
+class AssetArchive {
+public:
+	AssetArchive();
+	~AssetArchive();
+
+	bool Open(const char*);
+	void Close();
+
+	// Entry index for a filename (normalized the same way the packer does it), -1 if absent
+	int Find(const char*);
+	int GetEntryCount();
+	std::string GetName(int);
+	unsigned long long GetSize(int);
+	unsigned long long GetStoredSize(int);
+	bool IsCompressed(int);
+
+	// The entry's bytes straight out of the mapping. Only for entries that aren't compressed.
+	const unsigned char* GetStoredData(int);
+	// Copies or decompresses the entry into a buffer of at least GetSize bytes
+	bool Extract(int, unsigned char*);
+
+	// Mounting is meant to happen before loading starts and unmounting after everything that
+	// might still point into the archive is gone. Lookups in between are safe from any thread.
+	static bool Mount(const char*);
+	static void Unmount();
+	static AssetArchive* GetMounted();
+	// True when a mounted archive has this file, i.e. MappedFile::Open would get it from there
+	static bool IsArchived(const char*);
+
+private:
+	AssetArchive(const AssetArchive&);
+	AssetArchive& operator=(const AssetArchive&);
+
+	MappedFile mapping;
+	const ArchiveHeader* pHeader;
+	const ArchiveEntry* pEntries;
+	const char* pNames;
+};
\ No newline at end of file
@@ -0,0 +1,530 @@
+#include "AssetIO.h"
+#include "AssetArchive.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+static unsigned long long AlignUp(unsigned long long value, unsigned long long alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+AssetBuffer::AssetBuffer() {
+	this->pData = nullptr;
+	this->size = 0;
+	this->capacity = 0;
+}
+
+AssetBuffer::~AssetBuffer() {
+#ifdef _WIN32
+	_aligned_free(this->pData);
+#else
+	free(this->pData);
+#endif
+}
+
+// One extra byte for the terminator, rounded up so O_DIRECT can read whole blocks into it
+bool AssetBuffer::Allocate(unsigned long long size) {
+	this->capacity = AlignUp(size + 1, ASSET_IO_ALIGNMENT);
+#ifdef _WIN32
+	this->pData = (unsigned char*)_aligned_malloc((size_t)this->capacity, ASSET_IO_ALIGNMENT);
+#else
+	void* pMemory = nullptr;
+	if (posix_memalign(&pMemory, ASSET_IO_ALIGNMENT, (size_t)this->capacity) != 0) pMemory = nullptr;
+	this->pData = (unsigned char*)pMemory;
+#endif
+	if (!this->pData) {
+		printf("ERROR: Could not allocate %llu bytes for a file read\n", this->capacity);
+		return false;
+	}
+	this->size = size;
+	this->pData[size] = 0;
+	return true;
+}
+
+unsigned char* AssetBuffer::GetData() {
+	return this->pData;
+}
+
+unsigned long long AssetBuffer::GetSize() {
+	return this->size;
+}
+
+unsigned long long AssetBuffer::GetCapacity() {
+	return this->capacity;
+}
+
+AssetIO::AssetIO() {
+	this->backend = BACKEND_THREADS;
+	this->outstanding = 0;
+	this->stopping = false;
+	this->ringFd = -1;
+	this->queueDepth = 0;
+	this->inFlight = 0;
+	this->pSqRing = nullptr;
+	this->pCqRing = nullptr;
+	this->pSqes = nullptr;
+	this->pCqes = nullptr;
+	this->sqRingSize = this->cqRingSize = this->sqesSize = 0;
+	this->pSqHead = this->pSqTail = this->pSqMask = this->pSqArray = nullptr;
+	this->pCqHead = this->pCqTail = this->pCqMask = nullptr;
+	this->sqToSubmit = 0;
+}
+
+AssetIO::~AssetIO() {
+	Shutdown();
+}
+
+bool AssetIO::Init(int queueDepth, int threadCount) {
+	this->stopping = false;
+#ifdef __linux__
+	if (InitRing(queueDepth)) {
+		this->backend = BACKEND_IO_URING;
+		this->ringThread = std::thread(&AssetIO::RingMain, this);
+		return true;
+	}
+	printf("io_uring isn't available, reading assets on a thread pool instead\n");
+#endif
+	this->backend = BACKEND_THREADS;
+	return this->pool.Init(threadCount);
+}
+
+void AssetIO::Shutdown() {
+	Wait();
+	if (this->ringThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+		this->ringThread.join();
+	}
+	ShutdownRing();
+	this->pool.Shutdown();
+}
+
+void AssetIO::Read(const char* filename, Callback callback) {
+	Request* pRequest = new Request();
+	pRequest->filename = filename;
+	pRequest->callback = callback;
+	pRequest->pBuffer = nullptr;
+	pRequest->fd = -1;
+	pRequest->direct = false;
+	pRequest->failed = false;
+	pRequest->readEnd = 0;
+	pRequest->nextOffset = 0;
+	pRequest->chunksInFlight = 0;
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->outstanding++;
+	if (AssetArchive::IsArchived(filename)) {
+		// Already mapped, so there's nothing to queue. It completes right here.
+		lock.unlock();
+		pRequest->pBuffer = ReadArchived(pRequest->filename);
+		pRequest->failed = pRequest->pBuffer == nullptr;
+		Complete(pRequest);
+		return;
+	}
+	if (this->backend == BACKEND_IO_URING) {
+		// The ring thread takes everything that piled up here in one go, that's the batching
+		this->pending.push_back(pRequest);
+		this->wake.notify_one();
+		return;
+	}
+	lock.unlock();
+
+	this->pool.Submit([this, pRequest] {
+		pRequest->pBuffer = ReadWholeFile(pRequest->filename);
+		pRequest->failed = pRequest->pBuffer == nullptr;
+		Complete(pRequest);
+	});
+}
+
+void AssetIO::Wait() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->idle.wait(lock, [this] { return this->outstanding == 0; });
+}
+
+AssetIO::Backend AssetIO::GetBackend() {
+	return this->backend;
+}
+
+const char* AssetIO::GetBackendName() {
+	return this->backend == BACKEND_IO_URING ? "io_uring" : "threads";
+}
+
+// Hands the finished read to its callback and forgets about it
+void AssetIO::Complete(Request* pRequest) {
+	AssetBuffer* pBuffer = pRequest->pBuffer;
+	if (pRequest->failed) {
+		delete pBuffer;
+		pBuffer = nullptr;
+	}
+	else {
+		pBuffer->GetData()[pBuffer->GetSize()] = 0;
+	}
+	pRequest->callback(pBuffer);
+	delete pRequest;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (--this->outstanding == 0) this->idle.notify_all();
+}
+
+AssetBuffer* AssetIO::ReadArchived(const std::string& filename) {
+	MappedFile file;
+	AssetBuffer* pBuffer = new AssetBuffer();
+	if (!file.Open(filename.c_str()) || !pBuffer->Allocate(file.GetSize())) {
+		delete pBuffer;
+		return nullptr;
+	}
+	memcpy(pBuffer->GetData(), file.GetData(), (size_t)file.GetSize());
+	return pBuffer;
+}
+
+// The thread pool fallback: open, size, positioned reads until it's all in
+AssetBuffer* AssetIO::ReadWholeFile(const std::string& filename) {
+	AssetBuffer* pBuffer = new AssetBuffer();
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		printf("ERROR: Could not open '%s' for reading (error %lu)\n", filename.c_str(), GetLastError());
+		delete pBuffer;
+		return nullptr;
+	}
+	LARGE_INTEGER fileSize;
+	bool ok = GetFileSizeEx(hFile, &fileSize) && pBuffer->Allocate((unsigned long long)fileSize.QuadPart);
+	unsigned long long done = 0;
+	while (ok && done < pBuffer->GetSize()) {
+		unsigned long long left = pBuffer->GetSize() - done;
+		DWORD toRead = left < ASSET_IO_CHUNK_SIZE ? (DWORD)left : ASSET_IO_CHUNK_SIZE;
+		DWORD bytesRead = 0;
+		OVERLAPPED overlapped = { };
+		overlapped.Offset = (DWORD)done;
+		overlapped.OffsetHigh = (DWORD)(done >> 32);
+		ok = ReadFile(hFile, pBuffer->GetData() + done, toRead, &bytesRead, &overlapped) && bytesRead > 0;
+		done += bytesRead;
+	}
+	CloseHandle(hFile);
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		printf("ERROR: Could not open '%s' for reading (%s)\n", filename.c_str(), strerror(errno));
+		delete pBuffer;
+		return nullptr;
+	}
+	struct stat info;
+	bool ok = fstat(fd, &info) == 0 && pBuffer->Allocate((unsigned long long)info.st_size);
+	unsigned long long done = 0;
+	while (ok && done < pBuffer->GetSize()) {
+		unsigned long long left = pBuffer->GetSize() - done;
+		ssize_t bytesRead = pread(fd, pBuffer->GetData() + done,
+			left < ASSET_IO_CHUNK_SIZE ? (size_t)left : ASSET_IO_CHUNK_SIZE, (off_t)done);
+		if (bytesRead < 0 && errno == EINTR) continue;
+		ok = bytesRead > 0;
+		if (ok) done += (unsigned long long)bytesRead;
+	}
+	close(fd);
+#endif
+	if (!ok) {
+		printf("ERROR: Failed while reading '%s'\n", filename.c_str());
+		delete pBuffer;
+		return nullptr;
+	}
+	return pBuffer;
+}
+
+#ifdef __linux__
+
+// There's no liburing here, so this is the raw setup: make the ring, then map the submission
+// ring, completion ring and submission entries into our address space.
+bool AssetIO::InitRing(int queueDepth) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+	if (fd < 0) return false;
+
+	// IORING_OP_READ showed up in 5.6 and there's no cheap way to ask for it, but FAST_POLL
+	// came right after (5.7) so its presence means READ is there too
+	if (!(params.features & IORING_FEAT_FAST_POLL)) {
+		close(fd);
+		return false;
+	}
+
+	this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMap) {
+		if (this->cqRingSize > this->sqRingSize) this->sqRingSize = this->cqRingSize;
+		this->cqRingSize = this->sqRingSize;
+	}
+
+	this->ringFd = fd;
+	this->pSqRing = mmap(nullptr, (size_t)this->sqRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (this->pSqRing == MAP_FAILED) {
+		this->pSqRing = nullptr;
+		ShutdownRing();
+		return false;
+	}
+	if (singleMap) {
+		this->pCqRing = this->pSqRing;
+	}
+	else {
+		this->pCqRing = mmap(nullptr, (size_t)this->cqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (this->pCqRing == MAP_FAILED) {
+			this->pCqRing = nullptr;
+			ShutdownRing();
+			return false;
+		}
+	}
+	this->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	this->pSqes = mmap(nullptr, (size_t)this->sqesSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (this->pSqes == MAP_FAILED) {
+		this->pSqes = nullptr;
+		ShutdownRing();
+		return false;
+	}
+
+	unsigned char* pSq = (unsigned char*)this->pSqRing;
+	this->pSqHead = (unsigned int*)(pSq + params.sq_off.head);
+	this->pSqTail = (unsigned int*)(pSq + params.sq_off.tail);
+	this->pSqMask = (unsigned int*)(pSq + params.sq_off.ring_mask);
+	this->pSqArray = (unsigned int*)(pSq + params.sq_off.array);
+	unsigned char* pCq = (unsigned char*)this->pCqRing;
+	this->pCqHead = (unsigned int*)(pCq + params.cq_off.head);
+	this->pCqTail = (unsigned int*)(pCq + params.cq_off.tail);
+	this->pCqMask = (unsigned int*)(pCq + params.cq_off.ring_mask);
+	this->pCqes = pCq + params.cq_off.cqes;
+
+	// The completion ring is twice the size of the submission ring, so as long as we never
+	// have more than sq_entries reads out it can't overflow
+	this->queueDepth = (int)params.sq_entries;
+	this->inFlight = 0;
+	this->sqToSubmit = 0;
+	return true;
+}
+
+void AssetIO::ShutdownRing() {
+	if (this->pSqes) munmap(this->pSqes, (size_t)this->sqesSize);
+	if (this->pCqRing && this->pCqRing != this->pSqRing) munmap(this->pCqRing, (size_t)this->cqRingSize);
+	if (this->pSqRing) munmap(this->pSqRing, (size_t)this->sqRingSize);
+	this->pSqes = this->pCqRing = this->pSqRing = nullptr;
+	if (this->ringFd >= 0) {
+		close(this->ringFd);
+		this->ringFd = -1;
+	}
+}
+
+void AssetIO::RingMain() {
+	for (;;) {
+		// Pick up whatever was queued since last time. With nothing in flight there's nothing
+		// to reap either, so that's the only time we sleep on the queue rather than the ring.
+		std::deque<Request*> incoming;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			if (this->inFlight == 0 && this->retries.empty() && this->active.empty()) {
+				this->wake.wait(lock, [this] { return this->stopping || !this->pending.empty(); });
+				if (this->pending.empty()) return; // only empty here when we're stopping
+			}
+			incoming.swap(this->pending);
+		}
+
+		for (size_t i = 0; i < incoming.size(); i++) {
+			Request* pRequest = incoming[i];
+			if (!OpenRequest(pRequest)) {
+				pRequest->failed = true;
+				Complete(pRequest);
+			}
+			else if (pRequest->readEnd == 0) {
+				close(pRequest->fd);
+				Complete(pRequest);
+			}
+			else {
+				this->active.push_back(pRequest);
+			}
+		}
+
+		// Fill the queue: anything that needs another go first, then the next chunks of the
+		// files in the order they were asked for
+		while (this->inFlight < this->queueDepth) {
+			Chunk* pChunk = nullptr;
+			if (!this->retries.empty()) {
+				pChunk = this->retries.front();
+				this->retries.pop_front();
+			}
+			else {
+				if (this->active.empty()) break;
+
+				Request* pRequest = this->active.front();
+				unsigned long long left = pRequest->readEnd - pRequest->nextOffset;
+				pChunk = new Chunk();
+				pChunk->pRequest = pRequest;
+				pChunk->offset = pRequest->nextOffset;
+				pChunk->length = left < ASSET_IO_CHUNK_SIZE ? (unsigned int)left : ASSET_IO_CHUNK_SIZE;
+				pRequest->nextOffset += pChunk->length;
+				pRequest->chunksInFlight++;
+				// With its last chunk queued the request belongs to its chunks, and the completion
+				// of the last of them deletes it, so it can't be left here to be looked at again
+				if (pRequest->nextOffset >= pRequest->readEnd) this->active.erase(this->active.begin());
+			}
+			QueueChunk(pChunk);
+		}
+		if (this->inFlight == 0) continue;
+
+		// Submit the whole batch and wait for at least one of them to come back
+		int submitted = (int)syscall(__NR_io_uring_enter, this->ringFd, this->sqToSubmit, 1,
+			IORING_ENTER_GETEVENTS, nullptr, 0);
+		if (submitted < 0) {
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				printf("ERROR: io_uring_enter failed (%s)\n", strerror(errno));
+				std::this_thread::yield();
+			}
+		}
+		else {
+			this->sqToSubmit -= (unsigned int)submitted;
+		}
+
+		unsigned int head = *this->pCqHead;
+		unsigned int tail = __atomic_load_n(this->pCqTail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			struct io_uring_cqe* pCqe = &((struct io_uring_cqe*)this->pCqes)[head & *this->pCqMask];
+			Chunk* pChunk = (Chunk*)(uintptr_t)pCqe->user_data;
+			int result = pCqe->res;
+			head++;
+			this->inFlight--;
+			HandleCompletion(pChunk, result);
+		}
+		__atomic_store_n(this->pCqHead, head, __ATOMIC_RELEASE);
+	}
+}
+
+// Direct I/O wants aligned everything, and not every filesystem supports it (tmpfs doesn't),
+// so if the open fails we just go through the page cache like everyone else
+bool AssetIO::OpenRequest(Request* pRequest) {
+	pRequest->direct = true;
+	pRequest->fd = open(pRequest->filename.c_str(), O_RDONLY | O_DIRECT);
+	if (pRequest->fd < 0) {
+		pRequest->direct = false;
+		pRequest->fd = open(pRequest->filename.c_str(), O_RDONLY);
+	}
+	if (pRequest->fd < 0) {
+		printf("ERROR: Could not open '%s' for reading (%s)\n", pRequest->filename.c_str(), strerror(errno));
+		return false;
+	}
+
+	struct stat info;
+	pRequest->pBuffer = new AssetBuffer();
+	if (fstat(pRequest->fd, &info) != 0 || !pRequest->pBuffer->Allocate((unsigned long long)info.st_size)) {
+		printf("ERROR: Could not size '%s' for reading\n", pRequest->filename.c_str());
+		close(pRequest->fd);
+		return false;
+	}
+	pRequest->readEnd = AlignUp(pRequest->pBuffer->GetSize(), ASSET_IO_ALIGNMENT);
+	return true;
+}
+
+bool AssetIO::QueueChunk(Chunk* pChunk) {
+	Request* pRequest = pChunk->pRequest;
+	unsigned int tail = *this->pSqTail;
+	unsigned int index = tail & *this->pSqMask;
+	struct io_uring_sqe* pSqe = &((struct io_uring_sqe*)this->pSqes)[index];
+	memset(pSqe, 0, sizeof(*pSqe));
+	pSqe->opcode = IORING_OP_READ;
+	pSqe->fd = pRequest->fd;
+	pSqe->addr = (unsigned long long)(uintptr_t)(pRequest->pBuffer->GetData() + pChunk->offset);
+	pSqe->len = pChunk->length;
+	pSqe->off = pChunk->offset;
+	pSqe->user_data = (unsigned long long)(uintptr_t)pChunk;
+	this->pSqArray[index] = index;
+	__atomic_store_n(this->pSqTail, tail + 1, __ATOMIC_RELEASE);
+
+	this->sqToSubmit++;
+	this->inFlight++;
+	return true;
+}
+
+void AssetIO::HandleCompletion(Chunk* pChunk, int result) {
+	Request* pRequest = pChunk->pRequest;
+	unsigned long long size = pRequest->pBuffer->GetSize();
+	unsigned long long wanted = pChunk->offset < size ? size - pChunk->offset : 0;
+	if (wanted > pChunk->length) wanted = pChunk->length;
+
+	if (result == -EINTR || result == -EAGAIN) {
+		this->retries.push_back(pChunk);
+		return;
+	}
+	if (result == -EINVAL && pRequest->direct) {
+		// The filesystem let us open with O_DIRECT but won't do this read that way (or a short
+		// read left us at an unaligned offset). Carry on through the page cache. Reads already
+		// in flight hold their own reference to the old file, so closing it here is fine.
+		int fd = open(pRequest->filename.c_str(), O_RDONLY);
+		if (fd >= 0) {
+			close(pRequest->fd);
+			pRequest->fd = fd;
+			pRequest->direct = false;
+			this->retries.push_back(pChunk);
+			return;
+		}
+	}
+
+	if (result < 0) {
+		printf("ERROR: Reading '%s' failed (%s)\n", pRequest->filename.c_str(), strerror(-result));
+		pRequest->failed = true;
+	}
+	else if ((unsigned long long)result < wanted) {
+		if (result == 0) {
+			printf("ERROR: '%s' got shorter while we were reading it\n", pRequest->filename.c_str());
+			pRequest->failed = true;
+		}
+		else {
+			pChunk->offset += (unsigned int)result;
+			pChunk->length -= (unsigned int)result;
+			this->retries.push_back(pChunk);
+			return;
+		}
+	}
+	if (pRequest->failed && pRequest->nextOffset < pRequest->readEnd) {
+		// Don't start any more of it. It still has chunks to queue, so it's still active.
+		pRequest->nextOffset = pRequest->readEnd;
+		this->active.erase(std::find(this->active.begin(), this->active.end(), pRequest));
+	}
+
+	delete pChunk;
+	if (--pRequest->chunksInFlight == 0 && pRequest->nextOffset >= pRequest->readEnd) {
+		close(pRequest->fd);
+		Complete(pRequest);
+	}
+}
+
+#else
+
+bool AssetIO::InitRing(int) { return false; }
+void AssetIO::ShutdownRing() { }
+void AssetIO::RingMain() { }
+bool AssetIO::OpenRequest(Request*) { return false; }
+bool AssetIO::QueueChunk(Chunk*) { return false; }
+void AssetIO::HandleCompletion(Chunk*, int) { }
+
+#endif
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "WorkerPool.h"
+
+// Buffers (and, for O_DIRECT, file offsets and read sizes) are aligned to this. 4 KiB covers
+// the logical block size of every disk we care about.
+const unsigned int ASSET_IO_ALIGNMENT = 4096;
+
+// Big files are read as several requests of this size so one file can keep the queue busy too
+const unsigned int ASSET_IO_CHUNK_SIZE = 1024 * 1024;
+
+// Most reads we keep in flight at once. NVMe wants a deep queue to get anywhere near its
+// rated throughput, one request at a time leaves most of it idle.
+const int ASSET_IO_QUEUE_DEPTH = 64;
+
+/* A whole file as AssetIO read it. The data is ASSET_IO_ALIGNMENT aligned and followed by a
+ * zero byte, so text formats can be parsed straight out of it. */
+class AssetBuffer {
+public:
+	AssetBuffer();
+	~AssetBuffer();
+
+	bool Allocate(unsigned long long);
+	unsigned char* GetData();
+	unsigned long long GetSize();
+	unsigned long long GetCapacity();
+
+private:
+	AssetBuffer(const AssetBuffer&);
+	AssetBuffer& operator=(const AssetBuffer&);
+
+	unsigned char* pData;
+	unsigned long long size, capacity;
+};
+
+/* Reads whole files in the background with lots of them in flight at once. On Linux the reads
+ * go through io_uring: requests queued with Read are picked up by one I/O thread and handed
+ * to the kernel in batches, using O_DIRECT (so nothing is copied through the page cache) where
+ * the filesystem allows it. Anywhere io_uring isn't available (Windows, old kernels, sandboxes
+ * that block it) a pool of threads doing plain positioned reads takes over.
+ *
+ * Files in a mounted AssetArchive are copied out of it on the spot instead.
+ *
+ * The callback gets the buffer (and owns it from then on) or nullptr if the read failed. It
+ * runs on an I/O thread, so it should just hand the bytes on to the decode stage rather than
+ * do the decoding itself. */
+class AssetIO {
+public:
+	enum Backend {
+		BACKEND_IO_URING,
+		BACKEND_THREADS,
+	};
+
+	typedef std::function<void(AssetBuffer*)> Callback;
+
+	AssetIO();
+	~AssetIO();
+
+	// Queue depth for io_uring, thread count (0 for one per core) for the fallback
+	bool Init(int, int);
+	void Shutdown();
+
+	void Read(const char*, Callback);
+	// Blocks until every read so far has finished and its callback has returned
+	void Wait();
+
+	Backend GetBackend();
+	const char* GetBackendName();
+
+private:
+	struct Request {
+		std::string filename;
+		Callback callback;
+		AssetBuffer* pBuffer;
+		int fd;
+		bool direct;
+		bool failed;
+		unsigned long long readEnd;    // size rounded up to the alignment, what we actually read
+		unsigned long long nextOffset; // start of the next chunk that hasn't been queued yet
+		int chunksInFlight;
+	};
+
+	struct Chunk {
+		Request* pRequest;
+		unsigned long long offset;
+		unsigned int length;
+	};
+
+	static AssetBuffer* ReadWholeFile(const std::string&);
+	static AssetBuffer* ReadArchived(const std::string&);
+	void Complete(Request*);
+
+	bool InitRing(int);
+	void ShutdownRing();
+	void RingMain();
+	bool OpenRequest(Request*);
+	bool QueueChunk(Chunk*);
+	void HandleCompletion(Chunk*, int);
+
+	Backend backend;
+	WorkerPool pool;
+
+	std::mutex mutex;
+	std::condition_variable wake, idle;
+	std::deque<Request*> pending;
+	int outstanding;
+	bool stopping;
+
+	// io_uring state, all of it only touched by the ring thread once it's running
+	std::thread ringThread;
+	int ringFd;
+	int queueDepth;
+	int inFlight;
+	void* pSqRing;
+	void* pCqRing;
+	void* pSqes;
+	unsigned long long sqRingSize, cqRingSize, sqesSize;
+	unsigned int *pSqHead, *pSqTail, *pSqMask, *pSqArray;
+	unsigned int *pCqHead, *pCqTail, *pCqMask;
+	void* pCqes;
+	unsigned int sqToSubmit;
+	std::vector<Request*> active;
+	std::deque<Chunk*> retries;
+};
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+/* On-disk layout of a cooked texture (.ctex), written by texture-cooker and read by Texture.
+ * The file is a header, then one CookedMipEntry per mip level (largest first), then the pixel
+ * data for each level at the offset its entry gives. Every level is stored exactly the way
+ * D3D11_SUBRESOURCE_DATA wants it, so the loader can point straight at it. */
+
+static const unsigned int COOKED_TEXTURE_MAGIC = 0x58455443; // "CTEX"
+static const unsigned int COOKED_TEXTURE_VERSION = 1;
+
+// Level data offsets are aligned to this so SIMD readers (and the mapped loader) are happy
+static const unsigned int COOKED_TEXTURE_DATA_ALIGNMENT = 16;
+
+// These are the DXGI_FORMAT values so the loader can cast them straight through. Kept as plain
+// numbers here so the tools don't need the d3d11 headers.
+static const unsigned int COOKED_FORMAT_R8G8B8A8_UNORM = 28;
+static const unsigned int COOKED_FORMAT_BC1_UNORM = 71;
+static const unsigned int COOKED_FORMAT_BC3_UNORM = 77;
+static const unsigned int COOKED_FORMAT_BC7_UNORM = 98;
+
+// Set when the mips were filtered in linear space from sRGB-encoded source texels
+static const unsigned int COOKED_FLAG_SRGB_FILTERED = 0x1;
+
+struct CookedTextureHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int width;
+	unsigned int height;
+	unsigned int mipCount;
+	unsigned int format;
+	unsigned int flags;
+	unsigned int reserved;
+};
+
+struct CookedMipEntry {
+	unsigned int width;
+	unsigned int height;
+	unsigned int rowPitch;     // bytes between rows (or rows of blocks for compressed formats)
+	unsigned int dataSize;     // bytes for the whole level
+	unsigned long long offset; // from the start of the file
+};
\ No newline at end of file
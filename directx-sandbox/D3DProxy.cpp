@@ -7,6 +7,7 @@ D3DProxy::D3DProxy() {
 	this->pRenderTargetView = nullptr;
 	this->pDepthStencilBuffer = nullptr;
 	this->pDepthStencilState = nullptr;
+	this->pDepthEqualState = nullptr;
 	this->pDepthStencilView = nullptr;
 	this->pRasterState = nullptr;
 }
@@ -217,6 +218,14 @@ bool D3DProxy::Init(int screenW, int screenH, bool vsync, HWND hWnd,
 
 	this->pDeviceContext->OMSetDepthStencilState(this->pDepthStencilState, 1);
 
+	// Same again for the shading pass after a depth pre-pass: the depth is already there, so
+	// it passes on equal and leaves the buffer alone
+	depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	result = this->pDevice->CreateDepthStencilState(
+		&depthStencilDesc, &(this->pDepthEqualState));
+	if (FAILED(result)) return false;
+
 	// Create the view of the depth stencil buffer so Direct3D knows to use the 
 	// depth buffer as a depth stencil texture.
 	ZeroMemory(&depthStencilViewDesc, sizeof(depthStencilViewDesc));
@@ -307,6 +316,12 @@ void D3DProxy::Shutdown()
 		this->pDepthStencilState = nullptr;
 	}
 
+	if (this->pDepthEqualState)
+	{
+		this->pDepthEqualState->Release();
+		this->pDepthEqualState = nullptr;
+	}
+
 	if (this->pDepthStencilBuffer)
 	{
 		this->pDepthStencilBuffer->Release();
@@ -351,6 +366,21 @@ void D3DProxy::BeginScene(float red, float green, float blue, float alpha) {
 	this->pDeviceContext->ClearRenderTargetView(this->pRenderTargetView, color); // back buffer
 	this->pDeviceContext->ClearDepthStencilView(
 		this->pDepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0); // depth buffer
+
+	// Back to the normal depth test in case last frame ended in a shading pass
+	this->pDeviceContext->OMSetRenderTargets(1, &(this->pRenderTargetView), this->pDepthStencilView);
+	this->pDeviceContext->OMSetDepthStencilState(this->pDepthStencilState, 1);
+}
+
+// No render target bound means no color writes at all, whatever the pixel shader is
+void D3DProxy::BeginDepthPrepass() {
+	this->pDeviceContext->OMSetRenderTargets(0, nullptr, this->pDepthStencilView);
+	this->pDeviceContext->OMSetDepthStencilState(this->pDepthStencilState, 1);
+}
+
+void D3DProxy::BeginShadingPass() {
+	this->pDeviceContext->OMSetRenderTargets(1, &(this->pRenderTargetView), this->pDepthStencilView);
+	this->pDeviceContext->OMSetDepthStencilState(this->pDepthEqualState, 1);
 }
 
 // Display the back buffer once drawing is complete
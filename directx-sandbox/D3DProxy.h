@@ -18,6 +18,13 @@ public:
 	void BeginScene(float, float, float, float);
 	void EndScene();
 
+	// For a depth pre-pass. BeginDepthPrepass takes the render target off so drawing only
+	// lays down depth, BeginShadingPass puts it back and tests LESS_EQUAL against that depth
+	// without writing it, so only the nearest surface gets shaded. BeginScene goes back to the
+	// usual LESS with writes.
+	void BeginDepthPrepass();
+	void BeginShadingPass();
+
 	ID3D11Device* GetDevice();
 	ID3D11DeviceContext* GetDeviceContext();
 
@@ -37,6 +44,7 @@ private:
 	ID3D11RenderTargetView* pRenderTargetView;
 	ID3D11Texture2D* pDepthStencilBuffer;
 	ID3D11DepthStencilState* pDepthStencilState;
+	ID3D11DepthStencilState* pDepthEqualState;
 	ID3D11DepthStencilView* pDepthStencilView;
 	ID3D11RasterizerState* pRasterState;
 	DirectX::XMMATRIX pProjectionMatrix;
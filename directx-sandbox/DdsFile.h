@@ -0,0 +1,61 @@
+#pragma once
+
+/* On-disk layout of a .dds file: the magic number, DdsHeader, an optional DdsHeaderDx10 when
+ * the pixel format's fourCC is "DX10", then every subresource back to back (all mips of array
+ * slice 0, then all mips of slice 1, ...). That's the same order D3D11 wants them in. */
+
+static const unsigned int DDS_MAGIC = 0x20534444; // "DDS "
+
+// DdsPixelFormat::flags
+static const unsigned int DDS_PF_ALPHAPIXELS = 0x1;
+static const unsigned int DDS_PF_FOURCC = 0x4;
+static const unsigned int DDS_PF_RGB = 0x40;
+
+// DdsHeader::flags and caps2
+static const unsigned int DDS_FLAG_MIPMAPCOUNT = 0x20000;
+static const unsigned int DDS_CAPS2_CUBEMAP = 0x200;
+static const unsigned int DDS_CAPS2_CUBEMAP_ALLFACES = 0xFC00;
+static const unsigned int DDS_CAPS2_VOLUME = 0x200000;
+
+// DdsHeaderDx10 fields
+static const unsigned int DDS_DIMENSION_TEXTURE2D = 3;
+static const unsigned int DDS_MISC_TEXTURECUBE = 0x4;
+
+#define DDS_FOURCC(a, b, c, d) \
+	((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+
+struct DdsPixelFormat {
+	unsigned int size;
+	unsigned int flags;
+	unsigned int fourCC;
+	unsigned int rgbBitCount;
+	unsigned int rBitMask;
+	unsigned int gBitMask;
+	unsigned int bBitMask;
+	unsigned int aBitMask;
+};
+
+struct DdsHeader {
+	unsigned int size; // always 124
+	unsigned int flags;
+	unsigned int height;
+	unsigned int width;
+	unsigned int pitchOrLinearSize;
+	unsigned int depth;
+	unsigned int mipMapCount;
+	unsigned int reserved1[11];
+	DdsPixelFormat pixelFormat;
+	unsigned int caps;
+	unsigned int caps2;
+	unsigned int caps3;
+	unsigned int caps4;
+	unsigned int reserved2;
+};
+
+struct DdsHeaderDx10 {
+	unsigned int dxgiFormat;
+	unsigned int resourceDimension;
+	unsigned int miscFlag;
+	unsigned int arraySize;
+	unsigned int miscFlags2;
+};
\ No newline at end of file
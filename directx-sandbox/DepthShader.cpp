@@ -0,0 +1,132 @@
+#include "DepthShader.h"
+
+DepthShader::DepthShader() {
+	this->pVertexShader = nullptr;
+	this->pLayout = nullptr;
+	this->pMxBuf = nullptr;
+	this->pVertexShaderBuf = nullptr;
+	this->pVsErrorMsg = nullptr;
+}
+
+bool DepthShader::Init(ID3D11Device* pDevice, HWND hWnd) {
+	CompileVertexShader();
+	return CreateShader(pDevice, hWnd);
+}
+
+bool DepthShader::CompileVertexShader() {
+	HRESULT result = D3DCompileFromFile(DEPTH_VS_FILENAME, nullptr, nullptr, "DepthVertexShader",
+		"vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &this->pVertexShaderBuf, &this->pVsErrorMsg);
+	if (FAILED(result)) return false;
+	printf("Compiled depth vertex shader.\n");
+	return true;
+}
+
+bool DepthShader::CreateShader(ID3D11Device* pDevice, HWND hWnd) {
+	ID3D10Blob* pVertexShaderBuf = this->pVertexShaderBuf;
+	this->pVertexShaderBuf = nullptr;
+	if (!pVertexShaderBuf) {
+		if (this->pVsErrorMsg)
+			this->OutputShaderErrorMessage(this->pVsErrorMsg, hWnd, DEPTH_VS_FILENAME);
+		else
+			MessageBox(hWnd, DEPTH_VS_FILENAME, L"Missing shader file?", MB_OK);
+		this->pVsErrorMsg = nullptr;
+		return false;
+	}
+	if (this->pVsErrorMsg) this->pVsErrorMsg->Release();
+	this->pVsErrorMsg = nullptr;
+
+	HRESULT result = pDevice->CreateVertexShader(
+		pVertexShaderBuf->GetBufferPointer(), pVertexShaderBuf->GetBufferSize(),
+		NULL, &(this->pVertexShader));
+	if (FAILED(result)) {
+		printf("ERROR: Failed to create depth vertex shader from buffer.\n");
+		pVertexShaderBuf->Release();
+		return false;
+	}
+
+	// Just the position, at the start of the first stream whether or not the streams are split
+	D3D11_INPUT_ELEMENT_DESC polygonLayout[1];
+	polygonLayout[0].SemanticName = "POSITION";
+	polygonLayout[0].SemanticIndex = 0;
+	polygonLayout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	polygonLayout[0].InputSlot = 0;
+	polygonLayout[0].AlignedByteOffset = 0;
+	polygonLayout[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	polygonLayout[0].InstanceDataStepRate = 0;
+
+	result = pDevice->CreateInputLayout(polygonLayout, 1,
+		pVertexShaderBuf->GetBufferPointer(), pVertexShaderBuf->GetBufferSize(),
+		&(this->pLayout));
+	pVertexShaderBuf->Release();
+	if (FAILED(result)) return false;
+
+	D3D11_BUFFER_DESC matrixBufDesc;
+	matrixBufDesc.Usage = D3D11_USAGE_DYNAMIC;
+	matrixBufDesc.ByteWidth = sizeof(MatrixBuffer);
+	matrixBufDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	matrixBufDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	matrixBufDesc.MiscFlags = 0;
+	matrixBufDesc.StructureByteStride = 0;
+
+	result = pDevice->CreateBuffer(&matrixBufDesc, nullptr, &(this->pMxBuf));
+	return !FAILED(result);
+}
+
+void DepthShader::Shutdown() {
+	if (this->pMxBuf) {
+		this->pMxBuf->Release();
+		this->pMxBuf = nullptr;
+	}
+
+	if (this->pLayout) {
+		this->pLayout->Release();
+		this->pLayout = nullptr;
+	}
+
+	if (this->pVertexShader) {
+		this->pVertexShader->Release();
+		this->pVertexShader = nullptr;
+	}
+}
+
+// Sets the matrices and binds the shader with no pixel shader, so only depth gets written
+bool DepthShader::Begin(ID3D11DeviceContext* pDvCtx,
+	DirectX::XMMATRIX worldMx, DirectX::XMMATRIX viewMx, DirectX::XMMATRIX projMx)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT result = pDvCtx->Map(pMxBuf, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if (FAILED(result)) {
+		printf("ERROR: Locking depth matrix cbuffer failed.\n");
+		return false;
+	}
+	MatrixBuffer* pMxBufData = (MatrixBuffer*)mappedResource.pData;
+	pMxBufData->world = DirectX::XMMatrixTranspose(worldMx);
+	pMxBufData->view = DirectX::XMMatrixTranspose(viewMx);
+	pMxBufData->projection = DirectX::XMMatrixTranspose(projMx);
+	pDvCtx->Unmap(pMxBuf, 0);
+	pDvCtx->VSSetConstantBuffers(0, 1, &pMxBuf);
+
+	pDvCtx->IASetInputLayout(this->pLayout);
+	pDvCtx->VSSetShader(this->pVertexShader, nullptr, 0);
+	pDvCtx->PSSetShader(nullptr, nullptr, 0);
+	return true;
+}
+
+void DepthShader::DrawRange(ID3D11DeviceContext* pDvCtx, int startIndex, int indexCount, int baseVertex) {
+	pDvCtx->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void DepthShader::OutputShaderErrorMessage(
+	ID3D10Blob* errorMessage, HWND hwnd, const wchar_t* shaderFilename)
+{
+	char* compileErrors = (char*)(errorMessage->GetBufferPointer());
+	unsigned long long bufferSize = errorMessage->GetBufferSize();
+	std::ofstream fout;
+	fout.open("shader-error.txt");
+	for (unsigned long long i = 0; i < bufferSize; i++) fout << compileErrors[i];
+	fout.close();
+	errorMessage->Release();
+
+	MessageBox(hwnd, L"Error compiling shader.  Check shader-error.txt for message.",
+		shaderFilename, MB_OK);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3dcompiler.h>
+#include <DirectXMath.h>
+#include <fstream>
+
+static const wchar_t* DEPTH_VS_FILENAME = L"./DepthVs.hlsl";
+
+/* Draws models into the depth buffer and nothing else: a vertex shader that only transforms
+ * positions and no pixel shader at all. Its input layout reads just the position from the
+ * first vertex stream, so with Model's streams split it binds (and fetches) only the positions.
+ * Used the same way as LightShader, Begin once per model and DrawRange per submesh. */
+class DepthShader {
+private:
+	// Must match the cbuffer in the vertex shader
+	struct MatrixBuffer {
+		DirectX::XMMATRIX world;
+		DirectX::XMMATRIX view;
+		DirectX::XMMATRIX projection;
+	};
+
+	void OutputShaderErrorMessage(ID3D10Blob*, HWND, const wchar_t*);
+
+	ID3D11VertexShader* pVertexShader;
+	ID3D11InputLayout* pLayout;
+	ID3D11Buffer* pMxBuf;
+
+	// Compiled bytecode (or compiler errors) waiting for CreateShader
+	ID3D10Blob* pVertexShaderBuf;
+	ID3D10Blob* pVsErrorMsg;
+
+public:
+	DepthShader();
+
+	bool Init(ID3D11Device*, HWND);
+
+	// Init in steps for the startup load graph, like LightShader's. The compile can run on any
+	// thread, CreateShader makes the D3D objects once it's done.
+	bool CompileVertexShader();
+	bool CreateShader(ID3D11Device*, HWND);
+	void Shutdown();
+
+	bool Begin(ID3D11DeviceContext*, DirectX::XMMATRIX, DirectX::XMMATRIX, DirectX::XMMATRIX);
+	void DrawRange(ID3D11DeviceContext*, int, int, int);
+};
\ No newline at end of file
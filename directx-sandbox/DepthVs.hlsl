@@ -0,0 +1,25 @@
+cbuffer MatrixBuffer
+{
+    matrix worldMatrix;
+    matrix viewMatrix;
+    matrix projectionMatrix;
+};
+
+// Only the position, so the input layout only needs the first vertex stream
+struct VertexInput
+{
+    float4 position : Position;
+};
+
+// The shading pass tests against this depth with LESS_EQUAL, so it has to come out bit for bit
+// the same as LightVs's. precise stops the compiler reordering or fusing the multiplies
+// differently in the two shaders, and both go world, view, projection in the same steps.
+float4 DepthVertexShader(VertexInput vertexInput) : SV_Position
+{
+    vertexInput.position.w = 1.0f;
+
+    precise float4 position = mul(vertexInput.position, worldMatrix);
+    position = mul(position, viewMatrix);
+    position = mul(position, projectionMatrix);
+    return position;
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "EntityStore.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const EntityStore::Entity EntityStore::NO_ENTITY = { 0xFFFFFFFF, 0 };
+
+EntityStore::EntityStore() {
+	for (int i = 0; i < MAX_COMPONENT_TYPES; i++) this->componentSizes[i] = 0;
+	this->componentTypeCount = 0;
+	this->entityCount = 0;
+}
+
+EntityStore::~EntityStore() {
+	Shutdown();
+}
+
+bool EntityStore::Init(const unsigned int* pComponentSizes, int typeCount) {
+	if (typeCount < 0 || typeCount > MAX_COMPONENT_TYPES) {
+		printf("ERROR: %d component types, there can be at most %d\n", typeCount, MAX_COMPONENT_TYPES);
+		return false;
+	}
+	this->componentTypeCount = typeCount;
+	for (int i = 0; i < typeCount; i++) this->componentSizes[i] = pComponentSizes[i];
+	return true;
+}
+
+// Every entity goes, handles to them included: the generations start over
+void EntityStore::Shutdown() {
+	for (size_t i = 0; i < this->archetypes.size(); i++) delete this->archetypes[i];
+	this->archetypes.clear();
+	this->archetypeOfSignature.clear();
+	this->records.clear();
+	this->freeIndices.clear();
+	this->entityCount = 0;
+}
+
+EntityStore::Entity EntityStore::Create(unsigned int signature) {
+	Entity entity;
+	if (!this->freeIndices.empty()) {
+		entity.index = this->freeIndices.back();
+		this->freeIndices.pop_back();
+	}
+	else {
+		entity.index = (unsigned int)this->records.size();
+		EntityRecord record = { -1, 0, 0 };
+		this->records.push_back(record);
+	}
+
+	// Bumped on the way out too, so it's never what any old handle to this index has
+	EntityRecord& record = this->records[entity.index];
+	record.generation++;
+	entity.generation = record.generation;
+	record.archetype = GetArchetype(signature);
+	record.row = AddRow(record.archetype, entity);
+	this->entityCount++;
+	return entity;
+}
+
+void EntityStore::Destroy(Entity entity) {
+	if (!IsAlive(entity)) return;
+	EntityRecord& record = this->records[entity.index];
+	RemoveRow(record.archetype, record.row);
+	record.archetype = -1;
+	record.generation++;
+	this->freeIndices.push_back(entity.index);
+	this->entityCount--;
+}
+
+bool EntityStore::IsAlive(Entity entity) {
+	return entity.index < this->records.size() && entity.generation != 0
+		&& this->records[entity.index].generation == entity.generation
+		&& this->records[entity.index].archetype >= 0;
+}
+
+int EntityStore::GetEntityCount() {
+	return this->entityCount;
+}
+
+void EntityStore::AddComponents(Entity entity, unsigned int components) {
+	if (!IsAlive(entity)) return;
+	unsigned int signature = this->archetypes[this->records[entity.index].archetype]->signature;
+	if ((signature | components) == signature) return;
+
+	// Copy over everything the two archetypes have in common, then the old row goes
+	EntityRecord& record = this->records[entity.index];
+	int from = record.archetype, fromRow = record.row;
+	int to = GetArchetype(signature | components);
+	int toRow = AddRow(to, entity);
+	for (int type = 0; type < this->componentTypeCount; type++) {
+		if (!(signature & (1u << type))) continue;
+		unsigned int size = this->componentSizes[type];
+		memcpy(&this->archetypes[to]->columns[type][(size_t)toRow * size],
+			&this->archetypes[from]->columns[type][(size_t)fromRow * size], size);
+	}
+	RemoveRow(from, fromRow);
+	record.archetype = to;
+	record.row = toRow;
+}
+
+void EntityStore::RemoveComponents(Entity entity, unsigned int components) {
+	if (!IsAlive(entity)) return;
+	unsigned int signature = this->archetypes[this->records[entity.index].archetype]->signature;
+	if (!(signature & components)) return;
+
+	EntityRecord& record = this->records[entity.index];
+	int from = record.archetype, fromRow = record.row;
+	unsigned int kept = signature & ~components;
+	int to = GetArchetype(kept);
+	int toRow = AddRow(to, entity);
+	for (int type = 0; type < this->componentTypeCount; type++) {
+		if (!(kept & (1u << type))) continue;
+		unsigned int size = this->componentSizes[type];
+		memcpy(&this->archetypes[to]->columns[type][(size_t)toRow * size],
+			&this->archetypes[from]->columns[type][(size_t)fromRow * size], size);
+	}
+	RemoveRow(from, fromRow);
+	record.archetype = to;
+	record.row = toRow;
+}
+
+unsigned int EntityStore::GetSignature(Entity entity) {
+	if (!IsAlive(entity)) return 0;
+	return this->archetypes[this->records[entity.index].archetype]->signature;
+}
+
+void* EntityStore::GetComponent(Entity entity, int type) {
+	if (!IsAlive(entity)) return nullptr;
+	const EntityRecord& record = this->records[entity.index];
+	Archetype* pArchetype = this->archetypes[record.archetype];
+	if (!(pArchetype->signature & (1u << type))) return nullptr;
+	return &pArchetype->columns[type][(size_t)record.row * this->componentSizes[type]];
+}
+
+void EntityStore::Query(unsigned int signature, std::vector<int>& matches) {
+	matches.clear();
+	for (size_t i = 0; i < this->archetypes.size(); i++) {
+		if ((this->archetypes[i]->signature & signature) == signature) matches.push_back((int)i);
+	}
+}
+
+int EntityStore::GetRowCount(int archetype) {
+	return (int)this->archetypes[archetype]->entities.size();
+}
+
+const EntityStore::Entity* EntityStore::GetEntities(int archetype) {
+	return this->archetypes[archetype]->entities.data();
+}
+
+void* EntityStore::GetColumn(int archetype, int type) {
+	Archetype* pArchetype = this->archetypes[archetype];
+	if (!(pArchetype->signature & (1u << type))) return nullptr;
+	return pArchetype->columns[type].data();
+}
+
+// Archetypes are made the first time their signature turns up and kept from then on, even
+// when they're empty, so there are only ever as many as there have been combinations
+int EntityStore::GetArchetype(unsigned int signature) {
+	auto found = this->archetypeOfSignature.find(signature);
+	if (found != this->archetypeOfSignature.end()) return found->second;
+
+	Archetype* pArchetype = new Archetype();
+	pArchetype->signature = signature;
+	this->archetypes.push_back(pArchetype);
+	int index = (int)this->archetypes.size() - 1;
+	this->archetypeOfSignature[signature] = index;
+	return index;
+}
+
+// A zeroed row on the end of every column
+int EntityStore::AddRow(int archetype, Entity entity) {
+	Archetype* pArchetype = this->archetypes[archetype];
+	int row = (int)pArchetype->entities.size();
+	pArchetype->entities.push_back(entity);
+	for (int type = 0; type < this->componentTypeCount; type++) {
+		if (!(pArchetype->signature & (1u << type))) continue;
+		pArchetype->columns[type].resize(pArchetype->columns[type].size() + this->componentSizes[type], 0);
+	}
+	return row;
+}
+
+// The last row moves into the hole, and whoever owns it is told where it went
+void EntityStore::RemoveRow(int archetype, int row) {
+	Archetype* pArchetype = this->archetypes[archetype];
+	int last = (int)pArchetype->entities.size() - 1;
+	if (row != last) {
+		for (int type = 0; type < this->componentTypeCount; type++) {
+			if (!(pArchetype->signature & (1u << type))) continue;
+			unsigned int size = this->componentSizes[type];
+			memcpy(&pArchetype->columns[type][(size_t)row * size], &pArchetype->columns[type][(size_t)last * size], size);
+		}
+		Entity moved = pArchetype->entities[last];
+		pArchetype->entities[row] = moved;
+		this->records[moved.index].row = row;
+	}
+	pArchetype->entities.pop_back();
+	for (int type = 0; type < this->componentTypeCount; type++) {
+		if (!(pArchetype->signature & (1u << type))) continue;
+		pArchetype->columns[type].resize(pArchetype->columns[type].size() - this->componentSizes[type]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+// Component types are bits in a signature, so there can be this many of them
+const int MAX_COMPONENT_TYPES = 32;
+
+/* Entities and their components, stored by archetype: every entity with exactly the same set of
+ * components lives in the same archetype, which keeps one tightly packed array per component.
+ * Going over everything with some set of components is then a walk down a few arrays per
+ * matching archetype, no pointers to chase.
+ *
+ * Components are plain data (they get moved around with memcpy) and are identified by type
+ * number, the sizes of each type are given to Init. Adding or removing a component moves the
+ * entity to the archetype for its new set, and the last entity of its old one fills the gap.
+ *
+ * Entities are handles with a generation, so one that's been destroyed (and had its slot
+ * reused) just stops being alive instead of pointing at someone else. Destroying or changing
+ * entities moves rows around, so don't do it while walking an archetype's columns. */
+class EntityStore {
+public:
+	struct Entity {
+		unsigned int index;
+		unsigned int generation; // 0 is never alive
+	};
+
+	static const Entity NO_ENTITY;
+
+	EntityStore();
+	~EntityStore();
+
+	// The size in bytes of each component type, in type order
+	bool Init(const unsigned int*, int);
+	void Shutdown();
+
+	// With the components in the signature, all zeroed
+	Entity Create(unsigned int);
+	void Destroy(Entity);
+	bool IsAlive(Entity);
+	int GetEntityCount();
+
+	// Both keep whatever components the entity already had and stays with, new ones are zeroed
+	void AddComponents(Entity, unsigned int);
+	void RemoveComponents(Entity, unsigned int);
+	unsigned int GetSignature(Entity);
+
+	// nullptr when the entity isn't alive or doesn't have one
+	void* GetComponent(Entity, int);
+	template <typename T> T* Get(Entity entity) {
+		return (T*)GetComponent(entity, T::TYPE);
+	}
+
+	// Fills in every archetype that has at least the components in the signature. Each is
+	// GetRowCount entities long, with a column per component and the entities themselves.
+	void Query(unsigned int, std::vector<int>&);
+	int GetRowCount(int);
+	const Entity* GetEntities(int);
+	void* GetColumn(int, int);
+	template <typename T> T* GetColumn(int archetype) {
+		return (T*)GetColumn(archetype, T::TYPE);
+	}
+
+private:
+	struct Archetype {
+		unsigned int signature;
+		std::vector<unsigned char> columns[MAX_COMPONENT_TYPES];
+		std::vector<Entity> entities;
+	};
+
+	struct EntityRecord {
+		int archetype; // -1 while the index is free
+		int row;
+		unsigned int generation;
+	};
+
+	int GetArchetype(unsigned int);
+	int AddRow(int, Entity);
+	void RemoveRow(int, int);
+
+	unsigned int componentSizes[MAX_COMPONENT_TYPES];
+	int componentTypeCount;
+	std::vector<Archetype*> archetypes;
+	std::unordered_map<unsigned int, int> archetypeOfSignature;
+	std::vector<EntityRecord> records;
+	std::vector<unsigned int> freeIndices;
+	int entityCount;
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "FramePipeline.h"
+
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+
+static double msBetween(Clock::time_point start, Clock::time_point end) {
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+FramePipeline::FramePipeline() {
+	this->published = 0;
+	this->taken = 0;
+	this->running = false;
+	this->stats = Stats();
+}
+
+FramePipeline::~FramePipeline() {
+	Stop();
+}
+
+bool FramePipeline::Start(SimulateFunction simulate, SubmitFunction submit) {
+	this->simulate = simulate;
+	this->submit = submit;
+	this->published = 0;
+	this->taken = 0;
+	this->running = true;
+	this->stats = Stats();
+	this->simulateThread = std::thread(&FramePipeline::SimulateMain, this);
+	this->submitThread = std::thread(&FramePipeline::SubmitMain, this);
+	return true;
+}
+
+void FramePipeline::Stop() {
+	RequestStop();
+	if (this->simulateThread.joinable()) this->simulateThread.join();
+	if (this->submitThread.joinable()) this->submitThread.join();
+}
+
+bool FramePipeline::IsRunning() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->running;
+}
+
+void FramePipeline::GetStats(Stats& stats) {
+	stats = this->stats;
+}
+
+void FramePipeline::RequestStop() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->running = false;
+	}
+	this->changed.notify_all();
+}
+
+void FramePipeline::SimulateMain() {
+	unsigned long long frame = 0;
+	for (;;) {
+		FrameState& state = this->states.GetWriteBuffer();
+		state.frame = ++frame;
+		Clock::time_point start = Clock::now();
+		bool result = this->simulate(state);
+		this->stats.simulateMs += msBetween(start, Clock::now());
+		if (!result) {
+			RequestStop();
+			return;
+		}
+		this->states.Publish();
+		this->stats.simulated++;
+
+		// Frame N+1 only starts once N has been taken, so it runs alongside N's submission
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->published = frame;
+		this->changed.notify_all();
+		this->changed.wait(lock, [&] { return this->taken >= frame || !this->running; });
+		if (!this->running) return;
+	}
+}
+
+void FramePipeline::SubmitMain() {
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->changed.wait(lock, [&] { return this->published > this->taken || !this->running; });
+			if (!this->running) return;
+		}
+		this->states.Acquire();
+		const FrameState& state = this->states.GetReadBuffer();
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->taken = state.frame;
+		}
+		this->changed.notify_all();
+
+		Clock::time_point start = Clock::now();
+		bool result = this->submit(state);
+		this->stats.submitMs += msBetween(start, Clock::now());
+		this->stats.submitted++;
+		if (!result) {
+			RequestStop();
+			return;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "TripleBuffer.h"
+#include "FrameState.h"
+
+/* Runs each frame in two stages on two threads of its own: simulation works out a FrameState,
+ * submission draws it. States go from one to the other through a TripleBuffer, so while frame
+ * N is being submitted frame N+1 is already being simulated. The simulation waits for each
+ * frame to be taken before it starts on the one after that, so it's never more than a frame
+ * ahead and nothing it makes is thrown away.
+ *
+ * Nothing in here knows about windows or D3D, the stages are just functions, so the whole
+ * exchange runs headless too (frame-bench does). The thread that calls Start is left free,
+ * for the window's messages. */
+class FramePipeline {
+public:
+	// Each returns false to stop the pipeline
+	typedef std::function<bool(FrameState&)> SimulateFunction;
+	typedef std::function<bool(const FrameState&)> SubmitFunction;
+
+	// Totals, only settled once it's stopped
+	struct Stats {
+		unsigned long long simulated;
+		unsigned long long submitted;
+		double simulateMs;
+		double submitMs;
+	};
+
+	FramePipeline();
+	~FramePipeline();
+
+	bool Start(SimulateFunction, SubmitFunction);
+	// Lets whichever frame each stage is on finish, then joins them
+	void Stop();
+	// False once Stop was called or either stage asked to stop
+	bool IsRunning();
+	void GetStats(Stats&);
+
+private:
+	FramePipeline(const FramePipeline&);
+	FramePipeline& operator=(const FramePipeline&);
+
+	void SimulateMain();
+	void SubmitMain();
+	void RequestStop();
+
+	SimulateFunction simulate;
+	SubmitFunction submit;
+	TripleBuffer<FrameState> states;
+	std::thread simulateThread;
+	std::thread submitThread;
+
+	// Only for pacing and sleeping, the states themselves never go near the lock
+	std::mutex mutex;
+	std::condition_variable changed;
+	unsigned long long published; // newest frame in the triple buffer
+	unsigned long long taken;     // newest frame the submit thread has acquired
+	bool running;
+
+	Stats stats;
+};
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+
+#include "SceneComponents.h"
+#include "Input.h"
+
+/* Everything the render thread needs to draw one frame, worked out by the simulation thread
+ * and handed over whole through a TripleBuffer. Once it's published nothing changes it, the
+ * render thread only reads it, so the simulation can get on with the next frame meanwhile.
+ * Models are only pointed at: they're made before the frame that first uses them and live
+ * until shutdown. */
+
+// One model to draw, with its world matrix and how many pixels across it is on screen, which
+// the render thread passes on to texture streaming
+struct DrawItem {
+	Model* pModel;
+	DirectX::XMFLOAT4X4 world;
+	MaterialComponent material;
+	float screenPixels;
+};
+
+struct FrameState {
+	unsigned long long frame; // counts up from 1, one per simulated frame
+	InputSnapshot input;      // what the simulation went on, sampled as it started the frame
+	bool depthPrepass;
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT3 cameraPosition;
+	LightComponent light;
+	std::vector<DrawItem> drawItems;
+};
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "GeometryPool.h"
+
+#include <stdio.h>
+#include <system_error>
+
+GeometryPool::GeometryPool() {
+	this->pDevice = nullptr;
+	this->pDeviceContext = nullptr;
+	for (int i = 0; i < GEOMETRY_MAX_STREAMS; i++) this->vertexStrides[i] = 0;
+	this->streamCount = 0;
+	this->boundPage = -1;
+	this->boundStreams = 0;
+	this->binds = 0;
+	this->bindsSkipped = 0;
+}
+
+bool GeometryPool::Init(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext,
+	const unsigned int* pVertexStrides, int streamCount)
+{
+	if (streamCount < 1 || streamCount > GEOMETRY_MAX_STREAMS) {
+		printf("ERROR: The geometry pool takes 1 to %d vertex streams, not %d\n", GEOMETRY_MAX_STREAMS, streamCount);
+		return false;
+	}
+	this->pDevice = pDevice;
+	this->pDeviceContext = pDeviceContext;
+	this->streamCount = streamCount;
+	for (int i = 0; i < streamCount; i++) this->vertexStrides[i] = pVertexStrides[i];
+	return AddPage(GEOMETRY_PAGE_VERTICES, GEOMETRY_PAGE_INDICES);
+}
+
+void GeometryPool::Shutdown() {
+	for (size_t i = 0; i < this->pages.size(); i++) {
+		Page* pPage = this->pages[i];
+		for (int stream = 0; stream < this->streamCount; stream++) {
+			if (pPage->pVertexBuffers[stream]) pPage->pVertexBuffers[stream]->Release();
+		}
+		if (pPage->pIndexBuffer) pPage->pIndexBuffer->Release();
+		delete pPage;
+	}
+	this->pages.clear();
+	this->boundPage = -1;
+	this->boundStreams = 0;
+}
+
+bool GeometryPool::Allocate(const void* const* ppVertices, unsigned int vertexCount,
+	const unsigned long* pIndices, unsigned int indexCount, Range& range)
+{
+	for (size_t i = 0; i < this->pages.size(); i++) {
+		if (AllocateInPage((int)i, ppVertices, vertexCount, pIndices, indexCount, range)) return true;
+	}
+
+	// Nothing had room, so a new page, big enough for this one if it's huge
+	unsigned int pageVertices = vertexCount > GEOMETRY_PAGE_VERTICES ? vertexCount : GEOMETRY_PAGE_VERTICES;
+	unsigned int pageIndices = indexCount > GEOMETRY_PAGE_INDICES ? indexCount : GEOMETRY_PAGE_INDICES;
+	if (!AddPage(pageVertices, pageIndices)) return false;
+	return AllocateInPage((int)this->pages.size() - 1, ppVertices, vertexCount, pIndices, indexCount, range);
+}
+
+void GeometryPool::Free(Range& range) {
+	if (range.page < 0 || range.page >= (int)this->pages.size()) return;
+	Page* pPage = this->pages[range.page];
+	pPage->vertices.Free(range.vertexAllocation);
+	pPage->indices.Free(range.indexAllocation);
+	range = Range();
+}
+
+// Having more of the page's streams bound than asked for is fine, the input layout just
+// doesn't read the extra ones
+void GeometryPool::Bind(ID3D11DeviceContext* pDeviceContext, int page, int streams) {
+	if (streams > this->streamCount) streams = this->streamCount;
+	if (page == this->boundPage && streams <= this->boundStreams) {
+		this->bindsSkipped++;
+		return;
+	}
+	Page* pPage = this->pages[page];
+	unsigned int offsets[GEOMETRY_MAX_STREAMS] = {};
+	pDeviceContext->IASetVertexBuffers(0, streams, pPage->pVertexBuffers, this->vertexStrides, offsets);
+	pDeviceContext->IASetIndexBuffer(pPage->pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	this->boundPage = page;
+	this->boundStreams = streams;
+	this->binds++;
+}
+
+void GeometryPool::Invalidate() {
+	this->boundPage = -1;
+	this->boundStreams = 0;
+}
+
+void GeometryPool::PrintStats() {
+	for (size_t i = 0; i < this->pages.size(); i++) {
+		Page* pPage = this->pages[i];
+		OffsetAllocator::Stats vertexStats, indexStats;
+		pPage->vertices.GetStats(vertexStats);
+		pPage->indices.GetStats(indexStats);
+		unsigned int vertexSize = pPage->vertices.GetSize(), indexSize = pPage->indices.GetSize();
+		printf("Geometry page %d: %u models, vertices %u/%u used (%u free ranges, %.0f%% fragmented), "
+			"indices %u/%u used (%u free ranges, %.0f%% fragmented)\n",
+			(int)i, vertexStats.allocations,
+			vertexSize - vertexStats.totalFree, vertexSize, vertexStats.freeRanges, OffsetAllocator::GetFragmentation(vertexStats) * 100.0f,
+			indexSize - indexStats.totalFree, indexSize, indexStats.freeRanges, OffsetAllocator::GetFragmentation(indexStats) * 100.0f);
+	}
+	printf("Geometry binds: %llu, %llu skipped because the page was already bound\n", this->binds, this->bindsSkipped);
+}
+
+bool GeometryPool::AddPage(unsigned int vertexCount, unsigned int indexCount) {
+	Page* pPage = new Page();
+	for (int stream = 0; stream < GEOMETRY_MAX_STREAMS; stream++) pPage->pVertexBuffers[stream] = nullptr;
+	pPage->pIndexBuffer = nullptr;
+
+	// Default usage, the ranges are filled in with UpdateSubresource as models arrive
+	D3D11_BUFFER_DESC desc;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	HRESULT result = S_OK;
+	unsigned int vertexBytes = 0;
+	for (int stream = 0; stream < this->streamCount && SUCCEEDED(result); stream++) {
+		desc.ByteWidth = vertexCount * this->vertexStrides[stream];
+		vertexBytes += desc.ByteWidth;
+		result = this->pDevice->CreateBuffer(&desc, nullptr, &pPage->pVertexBuffers[stream]);
+	}
+	if (SUCCEEDED(result)) {
+		desc.ByteWidth = indexCount * sizeof(unsigned long);
+		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		result = this->pDevice->CreateBuffer(&desc, nullptr, &pPage->pIndexBuffer);
+	}
+	if (FAILED(result)) {
+		printf("ERROR: Failed to create a geometry page (%u vertices, %u indices): %s\n",
+			vertexCount, indexCount, std::system_category().message(result).c_str());
+		for (int stream = 0; stream < this->streamCount; stream++) {
+			if (pPage->pVertexBuffers[stream]) pPage->pVertexBuffers[stream]->Release();
+		}
+		delete pPage;
+		return false;
+	}
+
+	pPage->vertices.Init(vertexCount, GEOMETRY_PAGE_ALLOCATIONS);
+	pPage->indices.Init(indexCount, GEOMETRY_PAGE_ALLOCATIONS);
+	this->pages.push_back(pPage);
+	printf("Geometry page %d created: %.1f MB of vertices, %.1f MB of indices\n", (int)this->pages.size() - 1,
+		vertexBytes / (1024.0 * 1024.0), indexCount * (double)sizeof(unsigned long) / (1024.0 * 1024.0));
+	return true;
+}
+
+// Needs both ranges from the same page, since a draw only has the one pair of buffers bound
+bool GeometryPool::AllocateInPage(int page, const void* const* ppVertices, unsigned int vertexCount,
+	const unsigned long* pIndices, unsigned int indexCount, Range& range)
+{
+	Page* pPage = this->pages[page];
+	OffsetAllocator::Allocation vertexAllocation = pPage->vertices.Allocate(vertexCount);
+	if (vertexAllocation.offset == OffsetAllocator::NO_SPACE) return false;
+	OffsetAllocator::Allocation indexAllocation = pPage->indices.Allocate(indexCount);
+	if (indexAllocation.offset == OffsetAllocator::NO_SPACE) {
+		pPage->vertices.Free(vertexAllocation);
+		return false;
+	}
+
+	for (int stream = 0; stream < this->streamCount; stream++) {
+		unsigned int stride = this->vertexStrides[stream];
+		Upload(pPage->pVertexBuffers[stream], vertexAllocation.offset * stride, ppVertices[stream], vertexCount * stride);
+	}
+	Upload(pPage->pIndexBuffer, indexAllocation.offset * sizeof(unsigned long), pIndices, indexCount * sizeof(unsigned long));
+
+	range.page = page;
+	range.baseVertex = vertexAllocation.offset;
+	range.vertexCount = vertexCount;
+	range.firstIndex = indexAllocation.offset;
+	range.indexCount = indexCount;
+	range.vertexAllocation = vertexAllocation;
+	range.indexAllocation = indexAllocation;
+	return true;
+}
+
+void GeometryPool::Upload(ID3D11Buffer* pBuffer, unsigned int offset, const void* pData, unsigned int size) {
+	if (size == 0) return;
+	D3D11_BOX box;
+	box.left = offset;
+	box.right = offset + size;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	this->pDeviceContext->UpdateSubresource(pBuffer, 0, &box, pData, 0, 0);
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <d3d11.h>
+
+#include "OffsetAllocator.h"
+
+// Each page is one vertex buffer and one index buffer that models get ranges of. Big enough
+// that a scene's worth of models share a page, small enough not to waste much on a tiny one.
+const unsigned int GEOMETRY_PAGE_VERTICES = 1024 * 1024;
+const unsigned int GEOMETRY_PAGE_INDICES = 3 * 1024 * 1024;
+const unsigned int GEOMETRY_PAGE_ALLOCATIONS = 16 * 1024;
+
+// Vertex buffers per page. A model's vertices can be split over a couple of streams (positions
+// in one, everything else in another), each stream gets its own buffer but they share offsets.
+const int GEOMETRY_MAX_STREAMS = 2;
+
+/* All the models' vertices and indices, in a few big buffers instead of a pair per model. A
+ * model gets a range of each (its base vertex and first index) from OffsetAllocators, so
+ * drawing it is a DrawIndexed with those offsets, and drawing a run of models that live in the
+ * same page needs the buffers bound once. A model that doesn't fit any page gets a new one,
+ * sized up if it's bigger than a normal page by itself.
+ *
+ * With more than one vertex stream, a model's range is the same vertices in each stream's
+ * buffer, so one base vertex works for all of them and a pass that only reads the first stream
+ * can bind just that.
+ *
+ * Everything here has to be called from the thread that owns the device context. */
+class GeometryPool {
+public:
+	struct Range {
+		int page; // -1 when it holds nothing
+		unsigned int baseVertex, vertexCount;
+		unsigned int firstIndex, indexCount;
+		OffsetAllocator::Allocation vertexAllocation;
+		OffsetAllocator::Allocation indexAllocation;
+
+		Range() {
+			page = -1;
+			baseVertex = vertexCount = firstIndex = indexCount = 0;
+			vertexAllocation.offset = indexAllocation.offset = OffsetAllocator::NO_SPACE;
+			vertexAllocation.node = indexAllocation.node = OffsetAllocator::NO_SPACE;
+		}
+	};
+
+	GeometryPool();
+
+	// The vertex size of each stream, and how many streams there are
+	bool Init(ID3D11Device*, ID3D11DeviceContext*, const unsigned int*, int);
+	void Shutdown();
+
+	// Copies the vertices (one array per stream) and 32-bit indices into a new range. Indices
+	// stay relative to the model's first vertex, the draw's base vertex takes care of the rest.
+	bool Allocate(const void* const*, unsigned int, const unsigned long*, unsigned int, Range&);
+	void Free(Range&);
+
+	// Sets the page's first few streams and its index buffer on the input assembler, unless
+	// they're already set. Call Invalidate if anything else could have set its own buffers since.
+	void Bind(ID3D11DeviceContext*, int, int);
+	void Invalidate();
+
+	void PrintStats();
+
+private:
+	struct Page {
+		ID3D11Buffer* pVertexBuffers[GEOMETRY_MAX_STREAMS];
+		ID3D11Buffer* pIndexBuffer;
+		OffsetAllocator vertices;
+		OffsetAllocator indices;
+	};
+
+	bool AddPage(unsigned int, unsigned int);
+	bool AllocateInPage(int, const void* const*, unsigned int, const unsigned long*, unsigned int, Range&);
+	void Upload(ID3D11Buffer*, unsigned int, const void*, unsigned int);
+
+	ID3D11Device* pDevice;
+	ID3D11DeviceContext* pDeviceContext;
+	unsigned int vertexStrides[GEOMETRY_MAX_STREAMS];
+	int streamCount;
+	std::vector<Page*> pages;
+	int boundPage;
+	int boundStreams;
+	unsigned long long binds;
+	unsigned long long bindsSkipped;
+};
\ No newline at end of file
@@ -3,15 +3,30 @@
 Graphics::Graphics() {
 	this->pDirect3D = nullptr;
 	this->pCamera = nullptr;
-	this->pModel = nullptr;
 	//this->pColorShader = nullptr;
 	//this->pTextureShader = nullptr;
 	this->pLightShader = nullptr;
-	this->pLight = nullptr;
+	this->pDepthShader = nullptr;
+	this->pTextureResidency = nullptr;
+	this->pTextureAllocator = nullptr;
+	this->lastEvictionCount = 0;
+	this->screenHeight = 0;
+	this->pGeometryPool = nullptr;
+	this->pJobs = nullptr;
+	this->pModelLoader = nullptr;
+	this->pPlaceholder = nullptr;
+	this->pTransforms = nullptr;
+	this->pEntities = nullptr;
+	this->rotation = 0.0f;
+	this->depthPrepassWanted = DEPTH_PREPASS;
+	this->depthPrepass = DEPTH_PREPASS;
+	this->pPipelineCounters = nullptr;
 }
 
 
 bool Graphics::Init(int screenW, int screenH, HWND hWnd) {
+	this->screenHeight = screenH;
+
 	// Create the Direct3D object.
 	this->pDirect3D = new D3DProxy();
 
@@ -24,35 +39,148 @@ bool Graphics::Init(int screenW, int screenH, HWND hWnd) {
 		return false;
 	}
 
-	this->pCamera = new Camera();
-	this->pCamera->SetPosition(0.0f, 0.0f, -25.0f);
-	this->pCamera->SetRotation(0.0f, 0.0f, 0.0f);
-
-	this->pModel = new Model();
-	result = this->pModel->Init(pDirect3D->GetDevice(), pDirect3D->GetDeviceContext(),
-		//"./data/stone01.tga", "./data/sq_cubes.txt");
-		"./data/aluminum.tga", "./data/sq_cubes.txt");
-		//"./data/danger.tga", "./data/sphere.txt");
-	if (!result) {
-		MessageBox(hWnd, L"Could not initialize model object.", L"Model Init Error", MB_OK);
+	char cardName[128];
+	int cardMemoryMB;
+	this->pDirect3D->GetVideoCardInfo(cardName, cardMemoryMB);
+	unsigned long long budgetMB = TEXTURE_BUDGET_MB > 0
+		? TEXTURE_BUDGET_MB : (unsigned long long)(cardMemoryMB * TEXTURE_BUDGET_FRACTION);
+	this->pTextureAllocator = new TextureResidencyAllocator();
+	this->pTextureResidency = new TextureResidency();
+	this->pTextureResidency->Init(budgetMB * 1024 * 1024, this->pTextureAllocator);
+	printf("Texture budget %llu MB (%s, %d MB dedicated)\n", budgetMB, cardName, cardMemoryMB);
+
+	if (AssetArchive::Mount(ASSET_ARCHIVE_FILENAME)) {
+		printf("Mounted '%s' (%d files)\n", ASSET_ARCHIVE_FILENAME, AssetArchive::GetMounted()->GetEntryCount());
+	}
+
+	// The camera, the lights and what's drawn where, all in one read
+	Scene scene;
+	if (!scene.Load(SCENE_FILENAME)) {
+		MessageBox(hWnd, L"Could not load the scene file.", L"Load Error", MB_OK);
 		return false;
 	}
+	printf("Scene '%s': %d instances of %d assets, %d lights\n", SCENE_FILENAME,
+		scene.GetInstanceCount(), scene.GetAssetCount(), scene.GetLightCount());
+
+	const SceneCamera& camera = scene.GetCamera();
+	this->pCamera = new Camera();
+	this->pCamera->SetPosition(camera.position[0], camera.position[1], camera.position[2]);
+	this->pCamera->SetRotation(camera.rotation[0], camera.rotation[1], camera.rotation[2]);
 
+	// Everything below is loaded through a task graph: file reads, decoding/parsing and shader
+	// compiles run as jobs, and the device calls that turn them into D3D objects run
+	// here on the main thread as soon as their inputs are ready.
 	this->pLightShader = new LightShader();
-	result = pLightShader->Init(pDirect3D->GetDevice(), hWnd);
+	this->pDepthShader = new DepthShader();
+	ID3D11Device* pDevice = this->pDirect3D->GetDevice();
+	ID3D11DeviceContext* pDeviceContext = this->pDirect3D->GetDeviceContext();
+
+	unsigned int vertexStrides[GEOMETRY_MAX_STREAMS];
+	int vertexStreams = Model::GetVertexStreams(vertexStrides);
+	this->pGeometryPool = new GeometryPool();
+	if (!this->pGeometryPool->Init(pDevice, pDeviceContext, vertexStrides, vertexStreams)) {
+		MessageBox(hWnd, L"Could not create the geometry pool.", L"D3D Init Error", MB_OK);
+		return false;
+	}
+	LightShader* pLightShader = this->pLightShader;
+	DepthShader* pDepthShader = this->pDepthShader;
+	TextureResidency* pResidency = this->pTextureResidency;
+
+	// File reads go through AssetIO so they're all in flight together, and each one that
+	// completes lets its decode go off as a job
+	AssetIO io;
+	io.Init(ASSET_IO_QUEUE_DEPTH, LOAD_THREADS);
+	AssetIO* pIO = &io;
+
+	// A model for each of the scene's assets that isn't streamed. The filenames point into the
+	// scene, which is around until the graph's done.
+	LoadGraph graph;
+	std::vector<Model*> assetModels(scene.GetAssetCount(), nullptr);
+	for (int i = 0; i < scene.GetAssetCount(); i++) {
+		const SceneAsset& asset = scene.GetAssets()[i];
+		if (asset.flags & SCENE_ASSET_STREAMED) continue;
+
+		Model* pModel = new Model();
+		pModel->UseGeometryPool(this->pGeometryPool);
+		this->models.push_back(pModel);
+		assetModels[i] = pModel;
+
+		const char* textureFilename = asset.pTextureFilename;
+		const char* modelFilename = asset.pModelFilename;
+		int textureRead = graph.AddAsync(textureFilename, LoadGraph::STAGE_READ,
+			[=](LoadGraph::Done done) { pModel->ReadTextureFile(pIO, textureFilename, done); }, {});
+		int textureLoaded = graph.Add(textureFilename, LoadGraph::STAGE_DECODE,
+			[=] { return pModel->LoadTextureData(textureFilename); }, { textureRead });
+		int textureCreated = graph.Add(textureFilename, LoadGraph::STAGE_CREATE,
+			[=] { return pModel->CreateTexture(pDevice, pDeviceContext); }, { textureLoaded });
+		int modelRead = graph.AddAsync(modelFilename, LoadGraph::STAGE_READ,
+			[=](LoadGraph::Done done) { pModel->ReadModelFile(pIO, modelFilename, done); }, {});
+		int modelParsed = graph.Add(modelFilename, LoadGraph::STAGE_DECODE,
+			[=] { return pModel->ParseModel(); }, { modelRead });
+		int modelCreated = graph.Add(modelFilename, LoadGraph::STAGE_CREATE,
+			[=] { return pModel->CreateBuffers(pDevice); }, { modelParsed });
+		int materialsCreated = graph.Add(modelFilename, LoadGraph::STAGE_CREATE,
+			[=] { return pModel->CreateMaterialTextures(pDevice, pDeviceContext); }, { modelParsed });
+		graph.Add(modelFilename, LoadGraph::STAGE_CREATE,
+			[=] { pModel->AttachResidency(pResidency); return true; }, { textureCreated, modelCreated, materialsCreated });
+	}
+
+	// The compile results are checked in CreateShader so it can show the errors, so the
+	// compiles themselves never fail the graph
+	int vsCompiled = graph.Add("LightVs.hlsl", LoadGraph::STAGE_DECODE,
+		[=] { pLightShader->CompileVertexShader(); return true; }, {});
+	int psCompiled = graph.Add("LightPs.hlsl", LoadGraph::STAGE_DECODE,
+		[=] { pLightShader->CompilePixelShader(); return true; }, {});
+	graph.Add("LightShader", LoadGraph::STAGE_CREATE,
+		[=] { return pLightShader->CreateShader(pDevice, hWnd); }, { vsCompiled, psCompiled });
+	int depthVsCompiled = graph.Add("DepthVs.hlsl", LoadGraph::STAGE_DECODE,
+		[=] { pDepthShader->CompileVertexShader(); return true; }, {});
+	graph.Add("DepthShader", LoadGraph::STAGE_CREATE,
+		[=] { return pDepthShader->CreateShader(pDevice, hWnd); }, { depthVsCompiled });
+
+	this->pJobs = new JobSystem();
+	this->pJobs->Init(JOB_THREADS);
+	result = graph.Run(this->pJobs);
+	io.Shutdown();
+	printf("Asset reads went through %s\n", io.GetBackendName());
+	graph.PrintTimeline();
 	if (!result) {
-		MessageBox(hWnd, L"Could not initialize TextureShader object.", 
-			L"TextureShader Init Error", MB_OK);
+		MessageBox(hWnd, L"Could not load the scene, see the startup timeline for what failed.",
+			L"Load Error", MB_OK);
+		return false;
+	}
+
+	// Streamed assets aren't needed to show the first frame, so they load while we render and
+	// show up whenever they're done
+	this->pPlaceholder = new Model();
+	this->pPlaceholder->UseGeometryPool(this->pGeometryPool);
+	if (!this->pPlaceholder->InitBox(pDevice, 96, 96, 96)) {
+		MessageBox(hWnd, L"Could not create the placeholder box.", L"Load Error", MB_OK);
 		return false;
 	}
+	this->pModelLoader = new ModelLoader();
+	this->pModelLoader->Init(MODEL_LOAD_THREADS, this->pTextureResidency, this->pGeometryPool);
+	std::vector<int> assetLoads(scene.GetAssetCount(), -1);
+	for (int i = 0; i < scene.GetAssetCount(); i++) {
+		const SceneAsset& asset = scene.GetAssets()[i];
+		if (asset.flags & SCENE_ASSET_STREAMED) {
+			assetLoads[i] = this->pModelLoader->LoadAsync(asset.pTextureFilename, asset.pModelFilename);
+		}
+	}
 
-	this->pLight = new Light();
-	pLight->SetDiffuseColor(0.7f, 0.7f, 0.7f, 1.0f);
-	pLight->SetAmbientColor(0.15f, 0.15f, 0.15f, 1.0f);
-	pLight->SetSpecularColor(0.8f, 0.8f, 0.8f, 1.0f);
-	pLight->SetSpecularExp(50.0f);
-	//pLight->SetDirection(1.0f, -1.0f, 1.0f);
-	pLight->SetDirection(0.0f, 0.0f, 1.0f);
+	this->pTransforms = new TransformSystem();
+	this->pEntities = new EntityStore();
+	if (!this->pEntities->Init(SCENE_COMPONENT_SIZES, SCENE_COMPONENT_TYPES)) {
+		MessageBox(hWnd, L"Could not set up the entity store.", L"Init Error", MB_OK);
+		return false;
+	}
+	CreateSceneEntities(scene, assetModels, assetLoads);
+
+	this->pPipelineCounters = new PipelineCounters();
+	if (!this->pPipelineCounters->Init(pDevice)) {
+		MessageBox(hWnd, L"Could not create the pipeline statistics queries.", L"D3D Init Error", MB_OK);
+		return false;
+	}
 
 	return true;
 }
@@ -64,15 +192,73 @@ void Graphics::Shutdown() {
 		pLightShader = nullptr;
 	}
 
-	if (this->pLight) {
-		delete pLight;
-		pLight = nullptr;
+	if (this->pDepthShader) {
+		pDepthShader->Shutdown();
+		delete pDepthShader;
+		pDepthShader = nullptr;
+	}
+
+	if (this->pPipelineCounters) {
+		PrintPipelineStats();
+		pPipelineCounters->Shutdown();
+		delete pPipelineCounters;
+		pPipelineCounters = nullptr;
+	}
+
+	// Entities only point at models, so they go first and the models after
+	if (this->pEntities) {
+		pEntities->Shutdown();
+		delete pEntities;
+		pEntities = nullptr;
 	}
 
-	if (this->pModel) {
-		pModel->Shutdown();
-		delete pModel;
-		pModel = nullptr;
+	if (this->pTransforms) {
+		delete pTransforms;
+		pTransforms = nullptr;
+	}
+
+	for (size_t i = 0; i < this->models.size(); i++) {
+		this->models[i]->Shutdown();
+		delete this->models[i];
+	}
+	this->models.clear();
+
+	if (this->pModelLoader) {
+		pModelLoader->Shutdown();
+		delete pModelLoader;
+		pModelLoader = nullptr;
+	}
+
+	if (this->pPlaceholder) {
+		pPlaceholder->Shutdown();
+		delete pPlaceholder;
+		pPlaceholder = nullptr;
+	}
+
+	if (this->pJobs) {
+		pJobs->Shutdown();
+		delete pJobs;
+		pJobs = nullptr;
+	}
+
+	// After every model, they give their ranges back to it on the way out
+	if (this->pGeometryPool) {
+		pGeometryPool->PrintStats();
+		pGeometryPool->Shutdown();
+		delete pGeometryPool;
+		pGeometryPool = nullptr;
+	}
+
+	if (this->pTextureResidency) {
+		pTextureResidency->PrintStats();
+		pTextureResidency->Shutdown();
+		delete pTextureResidency;
+		pTextureResidency = nullptr;
+	}
+
+	if (this->pTextureAllocator) {
+		delete pTextureAllocator;
+		pTextureAllocator = nullptr;
 	}
 
 	if (this->pCamera) {
@@ -85,21 +271,17 @@ void Graphics::Shutdown() {
 		delete pDirect3D;
 		pDirect3D = nullptr;
 	}
-}
 
-// Returning 'true' will exit the program
-bool Graphics::Frame() {
-	static float rotation = 0.0f; // is this the right place to declare this?
-
-	rotation += DirectX::XM_PI * 0.002f;
-	if (rotation > 360.0f) rotation = 0;
-
-	return Render(rotation);
+	// Last, textures can point into it right up until they're released
+	AssetArchive::Unmount();
 }
 
-bool Graphics::Render(float rotation) {
-	//pDirect3D->BeginScene(1.0f, 1.0f, 0.85f, 1.0f); // background
-	pDirect3D->BeginScene(0.07f, 0.0f, 0.34f, 1.0f);
+bool Graphics::Simulate(FrameState& state) {
+	if (state.input.WasPressed('P')) this->depthPrepassWanted = !this->depthPrepassWanted;
+	state.depthPrepass = this->depthPrepassWanted;
+
+	this->rotation += DirectX::XM_PI * 0.002f;
+	if (this->rotation > 360.0f) this->rotation = 0;
 
 	// Generate the view matrix based on camera's current position
 	pCamera->Render();
@@ -108,20 +290,310 @@ bool Graphics::Render(float rotation) {
 	pDirect3D->GetWorldMatrix(worldMatrix);
 	pCamera->GetViewMatrix(viewMatrix);
 	pDirect3D->GetProjectionMatrix(projectionMatrix);
+	DirectX::XMStoreFloat4x4(&state.view, viewMatrix);
+	state.cameraPosition = pCamera->GetPosition();
 
-	// Put the vertex/index buffers in the graphics pipeline to prepare for rendering
-	pModel->Render(this->pDirect3D->GetDeviceContext()); 
+	UpdateSpin(this->rotation);
+	UpdatePendingModels();
 
-	bool result = this->pLightShader->Render(
-		pDirect3D->GetDeviceContext(), pModel->GetIndexCount(), pModel->GetTexture(),
-		worldMatrix * DirectX::XMMatrixRotationY(rotation)
-		* DirectX::XMMatrixRotationX(rotation), viewMatrix, projectionMatrix,
-		pLight->GetDirection(), pLight->GetDiffuseColor(), pLight->GetAmbientColor(),
-		pLight->GetSpecularColor(), pLight->GetSpecularExp(), pCamera->GetPosition()
-	);
+	// Only what moved gets recomputed. For most scenes that's a handful of transforms and it
+	// all happens right here, big levels get spread over the job system's threads.
+	this->pTransforms->Update(this->pJobs);
+
+	GatherDrawItems(state, worldMatrix, projectionMatrix);
+
+	// With no light in the scene everything's lit flat, by ambient alone
+	LightComponent light = { DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f),
+		DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) };
+	this->pEntities->Query(HAS_LIGHT, this->queryArchetypes);
+	for (size_t i = 0; i < this->queryArchetypes.size(); i++) {
+		if (this->pEntities->GetRowCount(this->queryArchetypes[i]) > 0) {
+			light = this->pEntities->GetColumn<LightComponent>(this->queryArchetypes[i])[0];
+			break;
+		}
+	}
+	state.light = light;
+	return true;
+}
+
+bool Graphics::Submit(const FrameState& state) {
+	// Switched with P. What's been counted so far is printed under the mode it was counted
+	// in, then counting starts over in the other one.
+	if (state.depthPrepass != this->depthPrepass) {
+		PrintPipelineStats();
+		this->pPipelineCounters->Reset();
+		this->depthPrepass = state.depthPrepass;
+		printf("Depth pre-pass %s\n", this->depthPrepass ? "on" : "off");
+	}
+
+	// Finish off any background loads. The simulation picks them up from the next frame it
+	// starts, so they're drawn a frame or two after this.
+	this->pModelLoader->Poll(pDirect3D->GetDevice(), pDirect3D->GetDeviceContext());
+
+	// Let each model's texture stream toward however big it was on screen
+	ID3D11Device* pDevice = pDirect3D->GetDevice();
+	for (size_t i = 0; i < state.drawItems.size(); i++) {
+		state.drawItems[i].pModel->UpdateTexture(pDevice, state.drawItems[i].screenPixels);
+	}
+
+	bool result = Render(state);
+	if (!result) printf("ERROR: Drawing frame %llu failed\n", state.frame);
+
+	// Results come back a few frames late, whichever have landed get added in
+	this->pPipelineCounters->Collect(pDirect3D->GetDeviceContext());
+	if (this->pPipelineCounters->GetFrameCount() >= PIPELINE_STATS_FRAMES) {
+		PrintPipelineStats();
+		this->pPipelineCounters->Reset();
+	}
+
+	// Settle this frame's texture requests against the budget, they take effect next frame
+	this->pTextureResidency->Update();
+	if (this->pTextureResidency->GetEvictionCount() != this->lastEvictionCount) {
+		this->lastEvictionCount = this->pTextureResidency->GetEvictionCount();
+		this->pTextureResidency->PrintStats();
+	}
+
+	return result;
+}
+
+void Graphics::PrintPipelineStats() {
+	this->pPipelineCounters->PrintStats(this->depthPrepass ? "Depth pre-pass on" : "Depth pre-pass off");
+}
+
+bool Graphics::Render(const FrameState& state) {
+	//pDirect3D->BeginScene(1.0f, 1.0f, 0.85f, 1.0f); // background
+	pDirect3D->BeginScene(0.07f, 0.0f, 0.34f, 1.0f);
+	ID3D11DeviceContext* pDeviceContext = pDirect3D->GetDeviceContext();
+	this->pPipelineCounters->Begin(pDeviceContext);
+
+	// Whatever was bound last frame isn't necessarily still there, so the first model binds
+	this->pGeometryPool->Invalidate();
+
+	DirectX::XMMATRIX viewMatrix = DirectX::XMLoadFloat4x4(&state.view);
+	DirectX::XMMATRIX projectionMatrix;
+	pDirect3D->GetProjectionMatrix(projectionMatrix);
+
+	// Everything's opaque, so all of it goes into the pre-pass
+	bool result = true;
+	if (this->depthPrepass) {
+		pDirect3D->BeginDepthPrepass();
+		for (size_t i = 0; i < state.drawItems.size() && result; i++) {
+			result = RenderModelDepth(state.drawItems[i], viewMatrix, projectionMatrix);
+		}
+		pDirect3D->BeginShadingPass();
+	}
+	for (size_t i = 0; i < state.drawItems.size() && result; i++) {
+		result = RenderModel(state.drawItems[i], state, viewMatrix, projectionMatrix);
+	}
+	this->pPipelineCounters->End(pDeviceContext);
 	if (!result) return false;
 
 	pDirect3D->EndScene();
 
-	return false;
+	return true;
+}
+
+// An entity per instance and light. Instances are in parent-first order, so each parent's
+// transform is already there when its children are made.
+void Graphics::CreateSceneEntities(Scene& scene, const std::vector<Model*>& assetModels, const std::vector<int>& assetLoads) {
+	const SceneInstance* pInstances = scene.GetInstances();
+	std::vector<int> instanceTransforms(scene.GetInstanceCount());
+	this->pTransforms->Reserve(scene.GetInstanceCount());
+	for (int i = 0; i < scene.GetInstanceCount(); i++) {
+		const SceneInstance& instance = pInstances[i];
+		int parent = instance.parent == SCENE_NO_PARENT ? TransformSystem::NO_PARENT : instanceTransforms[instance.parent];
+		int transform = this->pTransforms->Create(parent);
+		DirectX::XMFLOAT3 translation(instance.translation);
+		DirectX::XMFLOAT4 rotation(instance.rotation);
+		DirectX::XMFLOAT3 scale(instance.scale);
+		this->pTransforms->SetLocal(transform, translation, rotation, scale);
+		instanceTransforms[i] = transform;
+
+		EntityStore::Entity entity;
+		if (assetModels[instance.asset]) {
+			entity = CreateModelEntity(assetModels[instance.asset], transform);
+		}
+		else {
+			entity = this->pEntities->Create(HAS_TRANSFORM | HAS_PENDING_MODEL);
+			this->pEntities->Get<TransformComponent>(entity)->transform = transform;
+			PendingModelComponent pending;
+			pending.load = assetLoads[instance.asset];
+			pending.placeholder = CreateModelEntity(this->pPlaceholder, this->pTransforms->Create(transform));
+			*this->pEntities->Get<PendingModelComponent>(entity) = pending;
+		}
+
+		if (instance.spin[0] != 0.0f || instance.spin[1] != 0.0f || instance.spin[2] != 0.0f) {
+			this->pEntities->AddComponents(entity, HAS_SPIN);
+			SpinComponent* pSpin = this->pEntities->Get<SpinComponent>(entity);
+			pSpin->rotation = rotation;
+			pSpin->spin = DirectX::XMFLOAT3(instance.spin);
+		}
+	}
+
+	for (int i = 0; i < scene.GetLightCount(); i++) {
+		const SceneLight& sceneLight = scene.GetLights()[i];
+		EntityStore::Entity entity = this->pEntities->Create(HAS_LIGHT);
+		LightComponent* pLight = this->pEntities->Get<LightComponent>(entity);
+		pLight->direction = DirectX::XMFLOAT3(sceneLight.direction);
+		pLight->diffuseColor = DirectX::XMFLOAT4(sceneLight.diffuseColor);
+		pLight->ambientColor = DirectX::XMFLOAT4(sceneLight.ambientColor);
+	}
+}
+
+// A drawable entity for the model, placed by a transform that's already been made
+EntityStore::Entity Graphics::CreateModelEntity(Model* pModel, int transform) {
+	EntityStore::Entity entity = this->pEntities->Create(HAS_TRANSFORM | HAS_MODEL | HAS_BOUNDS);
+	this->pEntities->Get<TransformComponent>(entity)->transform = transform;
+	SetModel(entity, pModel);
+	return entity;
+}
+
+// Gives the entity the model and its bounds, adding the components if it didn't have them
+void Graphics::SetModel(EntityStore::Entity entity, Model* pModel) {
+	this->pEntities->AddComponents(entity, HAS_MODEL | HAS_BOUNDS);
+	this->pEntities->Get<ModelComponent>(entity)->pModel = pModel;
+	BoundsComponent* pBounds = this->pEntities->Get<BoundsComponent>(entity);
+	pModel->GetBoundingSphere(pBounds->center, pBounds->radius);
+}
+
+// Each spinning transform gets its resting rotation followed by the spin, about y, x then z
+void Graphics::UpdateSpin(float rotation) {
+	DirectX::XMVECTOR xAxis = DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+	DirectX::XMVECTOR yAxis = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	DirectX::XMVECTOR zAxis = DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+	this->pEntities->Query(HAS_TRANSFORM | HAS_SPIN, this->queryArchetypes);
+	for (size_t a = 0; a < this->queryArchetypes.size(); a++) {
+		int archetype = this->queryArchetypes[a];
+		int rows = this->pEntities->GetRowCount(archetype);
+		const TransformComponent* pTransformColumn = this->pEntities->GetColumn<TransformComponent>(archetype);
+		const SpinComponent* pSpinColumn = this->pEntities->GetColumn<SpinComponent>(archetype);
+		for (int row = 0; row < rows; row++) {
+			const SpinComponent& spin = pSpinColumn[row];
+			DirectX::XMVECTOR turn = DirectX::XMQuaternionMultiply(DirectX::XMQuaternionMultiply(
+				DirectX::XMQuaternionRotationNormal(yAxis, spin.spin.y * rotation),
+				DirectX::XMQuaternionRotationNormal(xAxis, spin.spin.x * rotation)),
+				DirectX::XMQuaternionRotationNormal(zAxis, spin.spin.z * rotation));
+			DirectX::XMFLOAT4 spun;
+			DirectX::XMStoreFloat4(&spun, DirectX::XMQuaternionMultiply(DirectX::XMLoadFloat4(&spin.rotation), turn));
+			this->pTransforms->SetRotation(pTransformColumn[row].transform, spun);
+		}
+	}
+}
+
+// Until a streamed model is loaded its placeholder box is drawn instead, stretched over the
+// model's bounds once the parse has told us what they are. When it lands (or fails) the
+// placeholder goes and the model is drawn in its own right. The entities are gathered first
+// since changing their components moves them between archetypes.
+void Graphics::UpdatePendingModels() {
+	this->pendingEntities.clear();
+	this->pEntities->Query(HAS_PENDING_MODEL, this->queryArchetypes);
+	for (size_t a = 0; a < this->queryArchetypes.size(); a++) {
+		int archetype = this->queryArchetypes[a];
+		const EntityStore::Entity* pEntityColumn = this->pEntities->GetEntities(archetype);
+		this->pendingEntities.insert(this->pendingEntities.end(), pEntityColumn, pEntityColumn + this->pEntities->GetRowCount(archetype));
+	}
+
+	for (size_t i = 0; i < this->pendingEntities.size(); i++) {
+		EntityStore::Entity entity = this->pendingEntities[i];
+		PendingModelComponent pending = *this->pEntities->Get<PendingModelComponent>(entity);
+		Model* pModel = this->pModelLoader->GetModel(pending.load);
+		if (pModel) {
+			this->pEntities->Destroy(pending.placeholder);
+			this->pEntities->RemoveComponents(entity, HAS_PENDING_MODEL);
+			SetModel(entity, pModel);
+		}
+		else if (this->pModelLoader->GetState(pending.load) == ModelLoader::STATE_FAILED) {
+			this->pEntities->Destroy(pending.placeholder);
+			this->pEntities->RemoveComponents(entity, HAS_PENDING_MODEL);
+		}
+		else {
+			DirectX::XMFLOAT3 center(0.0f, 0.0f, 0.0f), extents(1.0f, 1.0f, 1.0f);
+			this->pModelLoader->GetBoundingBox(pending.load, center, extents);
+			int placeholderTransform = this->pEntities->Get<TransformComponent>(pending.placeholder)->transform;
+			this->pTransforms->SetTranslation(placeholderTransform, center);
+			this->pTransforms->SetScale(placeholderTransform, extents);
+		}
+	}
+}
+
+// Walks every entity with a model, a transform and bounds, column by column, and works out on
+// the way how much of each is actually visible, which Submit streams its texture toward. The
+// projected diameter of the bounding sphere is 2r/d in view space, and the projection's [1][1]
+// (1/tan(fov/2)) times half the screen height turns that into pixels. The state's vector is
+// reused from the last time this slot was filled, so it's only allocated once.
+void Graphics::GatherDrawItems(FrameState& state, DirectX::XMMATRIX worldMatrix, DirectX::XMMATRIX projectionMatrix) {
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMStoreFloat4x4(&projection, projectionMatrix);
+	DirectX::XMVECTOR camera = DirectX::XMLoadFloat3(&state.cameraPosition);
+
+	state.drawItems.clear();
+	this->pEntities->Query(HAS_TRANSFORM | HAS_MODEL | HAS_BOUNDS, this->queryArchetypes);
+	for (size_t a = 0; a < this->queryArchetypes.size(); a++) {
+		int archetype = this->queryArchetypes[a];
+		int rows = this->pEntities->GetRowCount(archetype);
+		const TransformComponent* pTransformColumn = this->pEntities->GetColumn<TransformComponent>(archetype);
+		const ModelComponent* pModelColumn = this->pEntities->GetColumn<ModelComponent>(archetype);
+		const BoundsComponent* pBoundsColumn = this->pEntities->GetColumn<BoundsComponent>(archetype);
+		const MaterialComponent* pMaterialColumn = this->pEntities->GetColumn<MaterialComponent>(archetype);
+		for (int row = 0; row < rows; row++) {
+			DrawItem item;
+			item.pModel = pModelColumn[row].pModel;
+			item.material = pMaterialColumn ? pMaterialColumn[row] : DEFAULT_MATERIAL;
+			DirectX::XMMATRIX world = worldMatrix * this->pTransforms->GetWorld(pTransformColumn[row].transform);
+			DirectX::XMStoreFloat4x4(&item.world, world);
+
+			const BoundsComponent& bounds = pBoundsColumn[row];
+			DirectX::XMVECTOR worldCenter = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&bounds.center), world);
+			float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(worldCenter, camera)));
+			item.screenPixels = distance > bounds.radius
+				? bounds.radius / distance * projection._22 * this->screenHeight
+				: (float)this->screenHeight;
+
+			state.drawItems.push_back(item);
+		}
+	}
+}
+
+// Positions only into the depth buffer, the model's first vertex stream and nothing else
+bool Graphics::RenderModelDepth(const DrawItem& item, DirectX::XMMATRIX viewMatrix, DirectX::XMMATRIX projectionMatrix) {
+	ID3D11DeviceContext* pDeviceContext = this->pDirect3D->GetDeviceContext();
+	Model* pModel = item.pModel;
+	pModel->RenderPositions(pDeviceContext);
+
+	bool result = this->pDepthShader->Begin(pDeviceContext, DirectX::XMLoadFloat4x4(&item.world), viewMatrix, projectionMatrix);
+	if (!result) return false;
+
+	for (int i = 0; i < pModel->GetSubmeshCount(); i++) {
+		int startIndex, indexCount, baseVertex;
+		ID3D11ShaderResourceView* pTexture;
+		pModel->GetSubmesh(i, startIndex, indexCount, baseVertex, pTexture);
+		this->pDepthShader->DrawRange(pDeviceContext, startIndex, indexCount, baseVertex);
+	}
+	return true;
+}
+
+bool Graphics::RenderModel(const DrawItem& item, const FrameState& state,
+	DirectX::XMMATRIX viewMatrix, DirectX::XMMATRIX projectionMatrix)
+{
+	const LightComponent& light = state.light;
+	// Put the vertex/index buffers in the graphics pipeline to prepare for rendering. They stay
+	// bound for every submesh, only the texture changes between draws.
+	ID3D11DeviceContext* pDeviceContext = this->pDirect3D->GetDeviceContext();
+	Model* pModel = item.pModel;
+	pModel->Render(pDeviceContext); 
+
+	bool result = this->pLightShader->Begin(pDeviceContext,
+		DirectX::XMLoadFloat4x4(&item.world), viewMatrix, projectionMatrix,
+		light.direction, light.diffuseColor, light.ambientColor,
+		item.material.specularColor, item.material.specularExp, state.cameraPosition
+	);
+	if (!result) return false;
+
+	for (int i = 0; i < pModel->GetSubmeshCount(); i++) {
+		int startIndex, indexCount, baseVertex;
+		ID3D11ShaderResourceView* pTexture;
+		pModel->GetSubmesh(i, startIndex, indexCount, baseVertex, pTexture);
+		this->pLightShader->DrawRange(pDeviceContext, startIndex, indexCount, baseVertex, pTexture);
+	}
+	return true;
 }
\ No newline at end of file
@@ -4,29 +4,114 @@
 #include "Model.h"
 #include "Camera.h"
 #include "LightShader.h"
-#include "Light.h"
+#include "DepthShader.h"
+#include "PipelineCounters.h"
+#include "TextureResidency.h"
+#include "JobSystem.h"
+#include "LoadGraph.h"
+#include "ModelLoader.h"
+#include "GeometryPool.h"
+#include "TransformSystem.h"
+#include "EntityStore.h"
+#include "SceneComponents.h"
+#include "Scene.h"
+#include "FrameState.h"
+#include "AssetArchive.h"
 
 const bool FULL_SCREEN = true;
 const bool VSYNC_ENABLED = true;
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.1f;
 
+// Texture memory budget. TEXTURE_BUDGET_MB wins when it's set, otherwise we take a fraction
+// of the card's dedicated memory and leave the rest for render targets and everyone else.
+const int TEXTURE_BUDGET_MB = 0;
+const float TEXTURE_BUDGET_FRACTION = 0.5f;
+
+// What's drawn, compiled by scene-compiler from the text version next to it
+const char* const SCENE_FILENAME = "./data/default.scene";
+
+// Packed assets from asset-packer. When this file is there everything it holds is read out of
+// it, anything it doesn't have (or everything, when there's no archive) comes from loose files.
+const char* const ASSET_ARCHIVE_FILENAME = "./data.pak";
+
+// Threads for AssetIO's blocking reads when it has to fall back to them, 0 for one per core
+// (minus the main thread)
+const int LOAD_THREADS = 0;
+
+// Threads in the job system, the main thread included, 0 for one per hardware thread. Startup
+// loading runs on it with the main thread helping, then every frame's transform update, which
+// the simulation thread hands to the others.
+const int JOB_THREADS = 0;
+
+// Draws the opaque models depth-only first, so the lit pass only shades the surface that ends
+// up in front instead of everything that passes the depth test on the way. P switches it at
+// runtime. The pipeline counters are printed every PIPELINE_STATS_FRAMES frames (and when it's
+// switched) to compare the two on whatever's in view.
+const bool DEPTH_PREPASS = true;
+const int PIPELINE_STATS_FRAMES = 600;
+
 class Graphics {
 public:
 	Graphics();
 
 	bool Init(int, int, HWND);
 	void Shutdown();
-	bool Frame();
+
+	// The two halves of a frame, for FramePipeline. Simulate moves the scene on and fills in
+	// what to draw, and is the only thing touching the entities and transforms once frames are
+	// running. It expects the state's input to be sampled already. Submit does everything that
+	// calls the device, on a thread of its own.
+	bool Simulate(FrameState&);
+	bool Submit(const FrameState&);
 
 private:
 	D3DProxy* pDirect3D;
 	Camera* pCamera;
-	Model* pModel;
 	//ColorShader* pColorShader;
 	//TextureShader* pTextureShader;
 	LightShader* pLightShader;
-	Light* pLight;
+	DepthShader* pDepthShader;
+	TextureResidency* pTextureResidency;
+	TextureResidencyAllocator* pTextureAllocator;
+	unsigned long long lastEvictionCount;
+	int screenHeight;
+
+	// Every model's vertices and indices, so drawing one after another rarely rebinds buffers
+	GeometryPool* pGeometryPool;
+
+	JobSystem* pJobs;
+
+	// The scene's models that load before the first frame
+	std::vector<Model*> models;
+
+	// Streamed models load in the background after startup, drawn as a box until they're ready
+	ModelLoader* pModelLoader;
+	Model* pPlaceholder;
+
+	// Every instance and light in the scene is an entity, and every instance's transform is
+	// in pTransforms. Placeholder boxes hang off their instance's transform, so they're
+	// wherever the model will be, stretched over the model's bounds.
+	TransformSystem* pTransforms;
+	EntityStore* pEntities;
+
+	float rotation;
+	std::vector<int> queryArchetypes;
+	std::vector<EntityStore::Entity> pendingEntities;
+
+	// What the simulation last asked for, and what Submit is drawing (and counting) with
+	bool depthPrepassWanted;
+	bool depthPrepass;
+	PipelineCounters* pPipelineCounters;
 
-	bool Render(float);
+	bool Render(const FrameState&);
+	void CreateSceneEntities(Scene&, const std::vector<Model*>&, const std::vector<int>&);
+	EntityStore::Entity CreateModelEntity(Model*, int);
+	void SetModel(EntityStore::Entity, Model*);
+	void UpdateSpin(float);
+	void UpdatePendingModels();
+	void GatherDrawItems(FrameState&, DirectX::XMMATRIX, DirectX::XMMATRIX);
+	bool RenderModel(const DrawItem&, const FrameState&, DirectX::XMMATRIX, DirectX::XMMATRIX);
+	bool RenderModelDepth(const DrawItem&, DirectX::XMMATRIX, DirectX::XMMATRIX);
+	void PrintPipelineStats();
 };
\ No newline at end of file
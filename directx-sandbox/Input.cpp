@@ -1,34 +1,61 @@
 #include "Input.h"
 
-Input::Input() {
-}
+#include <string.h>
 
-Input::Input(const Input& other) {
-}
-
-Input::~Input() {
+Input::Input() {
+	this->dropped = 0;
+	memset(this->keys, 0, sizeof(this->keys));
 }
 
 void Input::Init() {
 	// Init all keys to cleared state
-	for (int i = 0; i < 256; i++)
-	{
-		this->Keys[i] = false;
-	}
+	memset(this->keys, 0, sizeof(this->keys));
+	this->dropped = 0;
 }
 
-
-void Input::KeyDown(unsigned int input) {
-	this->Keys[input] = true;
+void Input::KeyDown(unsigned int key, bool repeat) {
+	Queue(InputEvent::KEY_DOWN, key, repeat);
 }
 
+void Input::KeyUp(unsigned int key) {
+	Queue(InputEvent::KEY_UP, key, false);
+}
 
-void Input::KeyUp(unsigned int input) {
-	this->Keys[input] = false;
-	this->Keys[input] = false;
+// Stamped here rather than with GetMessageTime, which only counts in whole ticks of the
+// system timer (10-16 ms), too coarse to measure anything by
+void Input::Queue(InputEvent::Type type, unsigned int key, bool repeat) {
+	if (key >= INPUT_KEY_COUNT) return;
+	InputEvent event;
+	event.type = type;
+	event.key = key;
+	event.repeat = repeat;
+	event.time = std::chrono::steady_clock::now();
+	if (!this->queue.Push(event)) this->dropped.fetch_add(1, std::memory_order_relaxed);
 }
 
+// Plays every queued event onto the key state in order, so a press and release inside one
+// frame leaves the key up but marked both pressed and released
+void Input::Sample(InputSnapshot& snapshot) {
+	snapshot.time = std::chrono::steady_clock::now();
+	snapshot.events.clear();
+	memset(snapshot.pressed, 0, sizeof(snapshot.pressed));
+	memset(snapshot.released, 0, sizeof(snapshot.released));
+
+	InputEvent event;
+	while (this->queue.Pop(event)) {
+		snapshot.events.push_back(event);
+		if (event.type == InputEvent::KEY_DOWN) {
+			if (!event.repeat && !this->keys[event.key]) snapshot.pressed[event.key] = true;
+			this->keys[event.key] = true;
+		}
+		else {
+			if (this->keys[event.key]) snapshot.released[event.key] = true;
+			this->keys[event.key] = false;
+		}
+	}
+	memcpy(snapshot.down, this->keys, sizeof(this->keys));
+}
 
-bool Input::IsKeyDown(unsigned int key) {
-	return this->Keys[key];
+unsigned long long Input::GetDroppedCount() {
+	return this->dropped.load(std::memory_order_relaxed);
 }
\ No newline at end of file
@@ -1,18 +1,51 @@
 #pragma once
 
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "InputQueue.h"
+
+const int INPUT_KEY_COUNT = 256;
+
+// What the keyboard did over one frame, as the simulation sees it. A key pressed and let go
+// again between two samples still shows as pressed (and released), it just isn't down.
+struct InputSnapshot {
+	std::chrono::steady_clock::time_point time; // when it was sampled
+	std::vector<InputEvent> events; // everything since the last sample, oldest first
+	bool down[INPUT_KEY_COUNT];
+	bool pressed[INPUT_KEY_COUNT];  // went down since the last sample, repeats don't count
+	bool released[INPUT_KEY_COUNT];
+
+	bool IsKeyDown(unsigned int key) const { return key < INPUT_KEY_COUNT && this->down[key]; }
+	bool WasPressed(unsigned int key) const { return key < INPUT_KEY_COUNT && this->pressed[key]; }
+	bool WasReleased(unsigned int key) const { return key < INPUT_KEY_COUNT && this->released[key]; }
+};
+
+/* Keyboard input, passed from the window thread to the simulation thread. The message handler
+ * queues each key event with the time it came in, and once a frame the simulation drains the
+ * queue into a snapshot. Nothing is shared but the lock-free queue, and nothing is lost
+ * between frames, however short the press. */
 class Input {
 public:
 	Input();
-	Input(const Input&);
-	~Input();
 
 	void Init();
 
-	void KeyDown(unsigned int);
+	// Window thread
+	void KeyDown(unsigned int, bool);
 	void KeyUp(unsigned int);
 
-	bool IsKeyDown(unsigned int);
+	// Simulation thread, once a frame. The snapshot's events vector is reused.
+	void Sample(InputSnapshot&);
+
+	// Events thrown away because the queue was full
+	unsigned long long GetDroppedCount();
 
 private:
-	bool Keys[256];
+	void Queue(InputEvent::Type, unsigned int, bool);
+
+	InputQueue queue;
+	std::atomic<unsigned long long> dropped;
+	bool keys[INPUT_KEY_COUNT]; // as of the last Sample, only the simulation thread's
 };
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "InputQueue.h"
+
+InputQueue::InputQueue() {
+	this->head.store(0);
+	this->tail.store(0);
+}
+
+// The release store of tail publishes the event it's written, and the acquire load of head
+// makes sure the consumer is done with the slot before it's written over
+bool InputQueue::Push(const InputEvent& event) {
+	unsigned int tail = this->tail.load(std::memory_order_relaxed);
+	if (tail - this->head.load(std::memory_order_acquire) >= (unsigned int)INPUT_QUEUE_SIZE) return false;
+	this->events[tail & (INPUT_QUEUE_SIZE - 1)] = event;
+	this->tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool InputQueue::Pop(InputEvent& event) {
+	unsigned int head = this->head.load(std::memory_order_relaxed);
+	if (head == this->tail.load(std::memory_order_acquire)) return false;
+	event = this->events[head & (INPUT_QUEUE_SIZE - 1)];
+	this->head.store(head + 1, std::memory_order_release);
+	return true;
+}
\ No newline at end of file
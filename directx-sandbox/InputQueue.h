@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// Events the queue holds before the window thread has to start dropping them, a power of two.
+// A frame's worth is usually a handful, this covers the simulation stalling for a good while.
+const int INPUT_QUEUE_SIZE = 1024;
+
+struct InputEvent {
+	enum Type {
+		KEY_DOWN,
+		KEY_UP,
+	};
+
+	Type type;
+	unsigned int key;   // virtual key code
+	bool repeat;        // a KEY_DOWN from holding the key, not a new press
+	std::chrono::steady_clock::time_point time; // when the window thread got it
+};
+
+/* Single producer, single consumer ring of input events: the window thread pushes as messages
+ * come in, the simulation thread pops once a frame. Each side only writes its own index, so
+ * neither ever waits on a lock or on the other. */
+class InputQueue {
+public:
+	InputQueue();
+
+	// Producer side, false (and nothing queued) when it's full
+	bool Push(const InputEvent&);
+	// Consumer side, false when there's nothing left
+	bool Pop(InputEvent&);
+
+private:
+	InputQueue(const InputQueue&);
+	InputQueue& operator=(const InputQueue&);
+
+	// Free-running counts, wrapped into the ring on use. Each on its own cache line, since the
+	// two threads hammer one each.
+	std::atomic<unsigned int> head; // next to pop, written by the consumer
+	char headPadding[64];
+	std::atomic<unsigned int> tail; // next to push, written by the producer
+	char tailPadding[64];
+	InputEvent events[INPUT_QUEUE_SIZE];
+};
\ No newline at end of file
@@ -0,0 +1,417 @@
+#include "JobSystem.h"
+
+#include <stdio.h>
+
+static thread_local JobSystem* pCurrentSystem = nullptr;
+static thread_local int currentWorker = -1;
+
+// Only ever bumped by the thread that owns it, so there's no need for a locked add
+static void bump(std::atomic<unsigned long long>& counter) {
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+JobSystem::Counter::Counter() {
+	this->count.store(0);
+	this->finishing.store(0);
+}
+
+// Zero isn't enough on its own: whoever took it there may still be handing its waiting jobs
+// out, and the counter has to outlive that
+bool JobSystem::Counter::IsDone() {
+	return this->count.load() == 0 && this->finishing.load() == 0;
+}
+
+JobSystem::JobSystem() {
+	this->pWorkers = nullptr;
+	this->threadCount = 0;
+	this->injectedCount.store(0);
+	this->sleepers.store(0);
+	this->wakeEpoch = 0;
+	this->stopping.store(false);
+}
+
+JobSystem::~JobSystem() {
+	Shutdown();
+}
+
+bool JobSystem::Init(int threadCount) {
+	if (threadCount <= 0) {
+		threadCount = (int)std::thread::hardware_concurrency();
+		if (threadCount < 1) threadCount = 1;
+	}
+
+	this->threadCount = threadCount;
+	this->pWorkers = new Worker[threadCount];
+	for (int i = 0; i < threadCount; i++) {
+		Worker& worker = this->pWorkers[i];
+		worker.top.store(0);
+		worker.bottom.store(0);
+		for (int j = 0; j < JOB_QUEUE_SIZE; j++) {
+			worker.queue[j].store(nullptr);
+			worker.jobs[j].inUse.store(false);
+			worker.jobs[j].allocated = false;
+		}
+		worker.nextJob = 0;
+		worker.random = 2654435761u * (unsigned int)(i + 1);
+		worker.executed.store(0);
+		worker.stolen.store(0);
+		worker.stealAttempts.store(0);
+		worker.splits.store(0);
+	}
+
+	pCurrentSystem = this;
+	currentWorker = 0;
+	this->stopping.store(false);
+	for (int i = 1; i < threadCount; i++) {
+		this->threads.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+	}
+	return true;
+}
+
+void JobSystem::Shutdown() {
+	if (!this->pWorkers) return;
+
+	this->stopping.store(true);
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->wakeEpoch++;
+	}
+	this->wake.notify_all();
+	for (size_t i = 0; i < this->threads.size(); i++) {
+		this->threads[i].join();
+	}
+	this->threads.clear();
+
+	// With the workers gone this thread can stand in for any of them
+	Job* pJob;
+	while ((pJob = FindJob(0)) != nullptr) Execute(0, pJob);
+
+	if (pCurrentSystem == this) {
+		pCurrentSystem = nullptr;
+		currentWorker = -1;
+	}
+	delete[] this->pWorkers;
+	this->pWorkers = nullptr;
+	this->threadCount = 0;
+}
+
+void JobSystem::Run(std::function<void()> function, Counter* pCounter, Counter* pDependency) {
+	int index = GetCallerIndex();
+	Job* pJob = Allocate(index);
+	pJob->function = std::move(function);
+	pJob->pCounter = pCounter;
+	if (pCounter) pCounter->count.fetch_add(1);
+
+	// Whoever takes the dependency to zero hands out its waiting jobs under the same lock, so
+	// either it sees this one or this sees zero
+	if (pDependency) {
+		std::lock_guard<std::mutex> lock(pDependency->mutex);
+		if (pDependency->count.load() > 0) {
+			pDependency->waiting.push_back(pJob);
+			return;
+		}
+	}
+	Submit(index, pJob);
+}
+
+void JobSystem::Wait(Counter* pCounter) {
+	int index = GetCallerIndex();
+	while (!pCounter->IsDone()) {
+		Job* pJob = FindJob(index);
+		if (pJob) Execute(index, pJob);
+		else std::this_thread::yield();
+	}
+}
+
+bool JobSystem::RunOne() {
+	int index = GetCallerIndex();
+	Job* pJob = FindJob(index);
+	if (!pJob) return false;
+	Execute(index, pJob);
+	return true;
+}
+
+void JobSystem::ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& function) {
+	if (end <= begin) return;
+	if (grain <= 0) {
+		grain = (end - begin) / (this->threadCount * PARALLEL_FOR_PIECES_PER_THREAD);
+		if (grain < 1) grain = 1;
+	}
+	int index = GetCallerIndex();
+	if (this->threadCount <= 1 || end - begin <= grain) {
+		function(begin, end);
+		return;
+	}
+
+	// The whole range starts here, and splits off halves for the others as it goes. A thread
+	// outside the system can't split (it has no deque), so it hands the range to the workers
+	// instead and leaves it to them, if it picked it back up it'd run the whole thing alone.
+	Counter counter;
+	Job* pJob = Allocate(index);
+	pJob->pRangeFunction = &function;
+	pJob->begin = begin;
+	pJob->end = end;
+	pJob->grain = grain;
+	pJob->pCounter = &counter;
+	counter.count.fetch_add(1);
+	if (index >= 0) {
+		Execute(index, pJob);
+		Wait(&counter);
+		return;
+	}
+	Submit(index, pJob);
+	while (!counter.IsDone()) std::this_thread::yield();
+}
+
+int JobSystem::GetThreadCount() {
+	return this->threadCount;
+}
+
+void JobSystem::GetStats(int index, Stats& stats) {
+	const Worker& worker = this->pWorkers[index];
+	stats.executed = worker.executed.load(std::memory_order_relaxed);
+	stats.stolen = worker.stolen.load(std::memory_order_relaxed);
+	stats.stealAttempts = worker.stealAttempts.load(std::memory_order_relaxed);
+	stats.splits = worker.splits.load(std::memory_order_relaxed);
+}
+
+// Only meant for when nothing's running
+void JobSystem::ResetStats() {
+	for (int i = 0; i < this->threadCount; i++) {
+		this->pWorkers[i].executed.store(0, std::memory_order_relaxed);
+		this->pWorkers[i].stolen.store(0, std::memory_order_relaxed);
+		this->pWorkers[i].stealAttempts.store(0, std::memory_order_relaxed);
+		this->pWorkers[i].splits.store(0, std::memory_order_relaxed);
+	}
+}
+
+int JobSystem::GetCurrentWorker() {
+	return currentWorker;
+}
+
+int JobSystem::GetCallerIndex() {
+	return pCurrentSystem == this ? currentWorker : -1;
+}
+
+// Jobs come round the owner's pool in order. One that's still queued or running somewhere gets
+// skipped, and the owner runs a job of its own before looking at the next, so a full pool
+// drains itself instead of waiting.
+JobSystem::Job* JobSystem::Allocate(int index) {
+	Job* pJob;
+	if (index < 0) {
+		pJob = new Job();
+		pJob->allocated = true;
+	}
+	else {
+		Worker& worker = this->pWorkers[index];
+		for (;;) {
+			pJob = &worker.jobs[worker.nextJob++ & (JOB_QUEUE_SIZE - 1)];
+			if (!pJob->inUse.load(std::memory_order_acquire)) break;
+			Job* pOther = FindJob(index);
+			if (pOther) Execute(index, pOther);
+			else std::this_thread::yield();
+		}
+	}
+	pJob->inUse.store(true, std::memory_order_relaxed);
+	pJob->pRangeFunction = nullptr;
+	pJob->pCounter = nullptr;
+	return pJob;
+}
+
+void JobSystem::Submit(int index, Job* pJob) {
+	if (index >= 0) {
+		Push(index, pJob);
+	}
+	else {
+		std::lock_guard<std::mutex> lock(this->injectedMutex);
+		this->injected.push_back(pJob);
+		this->injectedCount.fetch_add(1);
+	}
+	WakeOne();
+}
+
+// The Chase-Lev deque, after Le et al's C11 version. The owner works the bottom end and only
+// has to race the thieves for the very last job. A full deque just runs the job right away.
+void JobSystem::Push(int index, Job* pJob) {
+	Worker& worker = this->pWorkers[index];
+	long long bottom = worker.bottom.load(std::memory_order_relaxed);
+	long long top = worker.top.load(std::memory_order_acquire);
+	if (bottom - top >= JOB_QUEUE_SIZE) {
+		Execute(index, pJob);
+		return;
+	}
+	worker.queue[bottom & (JOB_QUEUE_SIZE - 1)].store(pJob, std::memory_order_relaxed);
+	worker.bottom.store(bottom + 1, std::memory_order_release);
+}
+
+JobSystem::Job* JobSystem::Pop(int index) {
+	Worker& worker = this->pWorkers[index];
+	long long bottom = worker.bottom.load(std::memory_order_relaxed) - 1;
+	worker.bottom.store(bottom);
+	long long top = worker.top.load();
+	if (top > bottom) {
+		worker.bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* pJob = worker.queue[bottom & (JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (top == bottom) {
+		if (!worker.top.compare_exchange_strong(top, top + 1)) pJob = nullptr;
+		worker.bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return pJob;
+}
+
+JobSystem::Job* JobSystem::Steal(int victim) {
+	Worker& worker = this->pWorkers[victim];
+	long long top = worker.top.load();
+	long long bottom = worker.bottom.load();
+	if (top >= bottom) return nullptr;
+
+	Job* pJob = worker.queue[top & (JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (!worker.top.compare_exchange_strong(top, top + 1)) return nullptr;
+	return pJob;
+}
+
+// Own deque first, then whatever came in from outside, then everyone else's starting from a
+// random one so thieves spread out. Threads outside the system only look at the shared queue.
+JobSystem::Job* JobSystem::FindJob(int index) {
+	Job* pJob = index >= 0 ? Pop(index) : nullptr;
+	if (pJob) return pJob;
+
+	if (this->injectedCount.load(std::memory_order_relaxed) > 0) {
+		std::lock_guard<std::mutex> lock(this->injectedMutex);
+		if (!this->injected.empty()) {
+			pJob = this->injected.front();
+			this->injected.pop_front();
+			this->injectedCount.fetch_sub(1);
+			return pJob;
+		}
+	}
+	if (index < 0) return nullptr;
+
+	Worker& worker = this->pWorkers[index];
+	worker.random ^= worker.random << 13;
+	worker.random ^= worker.random >> 17;
+	worker.random ^= worker.random << 5;
+	int start = (int)(worker.random % (unsigned int)this->threadCount);
+	for (int i = 0; i < this->threadCount; i++) {
+		int victim = (start + i) % this->threadCount;
+		if (victim == index) continue;
+		bump(worker.stealAttempts);
+		pJob = Steal(victim);
+		if (pJob) {
+			bump(worker.stolen);
+			return pJob;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::Execute(int index, Job* pJob) {
+	if (pJob->pRangeFunction) RunRange(index, pJob);
+	else pJob->function();
+	if (index >= 0) bump(this->pWorkers[index].executed);
+
+	// Once it's handed back the job can be reused straight away, so the counter's read first
+	Counter* pCounter = pJob->pCounter;
+	pJob->function = nullptr;
+	if (pJob->allocated) delete pJob;
+	else pJob->inUse.store(false, std::memory_order_release);
+	if (pCounter) Finish(pCounter);
+}
+
+// Lazy splitting: the range is worked through grain at a time, and whenever this thread's
+// deque is empty (nobody's waiting on it to get to something, the last half it pushed has
+// been stolen) the rest is cut in half and the back half pushed for someone else. Busy
+// threads barely split at all, hungry ones get fed.
+void JobSystem::RunRange(int index, Job* pJob) {
+	const std::function<void(int, int)>& function = *pJob->pRangeFunction;
+	int begin = pJob->begin, end = pJob->end, grain = pJob->grain;
+	while (begin < end) {
+		if (index >= 0 && end - begin >= 2 * grain) {
+			Worker& worker = this->pWorkers[index];
+			if (worker.bottom.load(std::memory_order_relaxed) <= worker.top.load(std::memory_order_relaxed)) {
+				int middle = begin + (end - begin) / 2;
+				Job* pHalf = Allocate(index);
+				pHalf->pRangeFunction = pJob->pRangeFunction;
+				pHalf->begin = middle;
+				pHalf->end = end;
+				pHalf->grain = grain;
+				pHalf->pCounter = pJob->pCounter;
+				pHalf->pCounter->count.fetch_add(1);
+				Submit(index, pHalf);
+				bump(worker.splits);
+				end = middle;
+				continue;
+			}
+		}
+		int pieceEnd = end - begin > grain ? begin + grain : end;
+		function(begin, pieceEnd);
+		begin = pieceEnd;
+	}
+}
+
+void JobSystem::Finish(Counter* pCounter) {
+	pCounter->finishing.fetch_add(1);
+	if (pCounter->count.fetch_sub(1) == 1) {
+		std::vector<Job*> released;
+		{
+			std::lock_guard<std::mutex> lock(pCounter->mutex);
+			released.swap(pCounter->waiting);
+		}
+		int index = GetCallerIndex();
+		for (size_t i = 0; i < released.size(); i++) Submit(index, released[i]);
+	}
+	pCounter->finishing.fetch_sub(1);
+}
+
+bool JobSystem::HasWork() {
+	if (this->injectedCount.load() > 0) return true;
+	for (int i = 0; i < this->threadCount; i++) {
+		if (this->pWorkers[i].bottom.load() > this->pWorkers[i].top.load()) return true;
+	}
+	return false;
+}
+
+// Pairs with the sleepers check in WorkerMain: either the pusher sees the sleeper, or the
+// sleeper's HasWork sees the job
+void JobSystem::WakeOne() {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (this->sleepers.load(std::memory_order_relaxed) == 0) return;
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->wakeEpoch++;
+	}
+	this->wake.notify_one();
+}
+
+// Runs jobs until there are none to be found, spins on it for a bit, then sleeps until
+// someone pushes more. Stops once it's told to and there's nothing left.
+void JobSystem::WorkerMain(int index) {
+	pCurrentSystem = this;
+	currentWorker = index;
+	int idle = 0;
+	for (;;) {
+		Job* pJob = FindJob(index);
+		if (pJob) {
+			Execute(index, pJob);
+			idle = 0;
+			continue;
+		}
+		if (this->stopping.load()) return;
+		if (++idle < 64) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this->sleepMutex);
+		this->sleepers.fetch_add(1);
+		if (!this->stopping.load() && !HasWork()) {
+			unsigned int epoch = this->wakeEpoch;
+			this->wake.wait(lock, [this, epoch] { return this->wakeEpoch != epoch; });
+		}
+		this->sleepers.fetch_sub(1);
+		idle = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Jobs each thread can have queued (and the size of its job pool). A thread that runs out of
+// room runs other jobs until some of its own have finished.
+const int JOB_QUEUE_SIZE = 4096;
+
+// ParallelFor's default grain aims for this many pieces per thread, so there's something left
+// to steal when the work turns out lopsided
+const int PARALLEL_FOR_PIECES_PER_THREAD = 8;
+
+/* Work-stealing job scheduler. Every thread in it has its own Chase-Lev deque: it pushes and
+ * pops jobs at the bottom without any locks, and threads that run dry steal from the top of
+ * someone else's. The thread that called Init is one of them (worker 0), and it runs jobs
+ * whenever it Waits, so it's never just blocked while there's work about. Threads outside the
+ * system can still Run jobs, those go through a shared locked queue.
+ *
+ * Jobs are counted on a Counter: Run bumps it, finishing the job drops it, and Wait runs other
+ * jobs until it's zero. A job can also be held back until another counter reaches zero, which
+ * is how dependencies are expressed.
+ *
+ * Meant for lots of small CPU jobs, anything that blocks for long (file reads) belongs on a
+ * WorkerPool, it'd hold up every job queued behind it here. */
+class JobSystem {
+private:
+	struct Job;
+
+public:
+	class Counter {
+	public:
+		Counter();
+		bool IsDone();
+
+	private:
+		friend class JobSystem;
+		std::atomic<int> count;
+		std::atomic<int> finishing; // past the last decrement but still releasing waiters
+		std::mutex mutex;
+		std::vector<Job*> waiting;  // jobs held back until this reaches zero
+	};
+
+	struct Stats {
+		unsigned long long executed;
+		unsigned long long stolen;
+		unsigned long long stealAttempts;
+		unsigned long long splits; // ParallelFor ranges that were cut in half
+	};
+
+	JobSystem();
+	~JobSystem();
+
+	// Threads to run jobs on, the caller included. 0 means one per hardware thread.
+	bool Init(int);
+	// Waits for the workers to run out of work, anything left is run here
+	void Shutdown();
+
+	// The counter and dependency are both optional
+	void Run(std::function<void()>, Counter*, Counter* = nullptr);
+	void Wait(Counter*);
+	// Runs one queued job on the caller if there's one to be had
+	bool RunOne();
+
+	// Calls the function on pieces of [begin, end) across the threads and returns when they're
+	// all done. Each thread works through its part grain at a time (0 picks a grain from the
+	// range and thread count), and hands half of what's left to anyone hungry, so uneven work
+	// still spreads out. From a thread outside the system the range goes to the workers.
+	void ParallelFor(int, int, int, const std::function<void(int, int)>&);
+
+	int GetThreadCount();
+	// Per thread, index 0 is the one that called Init
+	void GetStats(int, Stats&);
+	void ResetStats();
+
+	// The caller's index in whichever JobSystem it belongs to, -1 for threads outside them
+	static int GetCurrentWorker();
+
+private:
+	struct Job {
+		std::function<void()> function;
+		// ParallelFor pieces call this instead, over [begin, end)
+		const std::function<void(int, int)>* pRangeFunction;
+		int begin, end, grain;
+		Counter* pCounter;
+		std::atomic<bool> inUse; // cleared once it's run, so the owner can hand it out again
+		bool allocated;          // made with new by a thread outside the system
+	};
+
+	// The ends of the deque get a cache line each, so thieves hitting top don't slow the owner
+	// down on bottom. Workers are far bigger than a line, they don't share any with each other.
+	struct Worker {
+		std::atomic<long long> top;    // thieves take from here
+		char topPadding[64];
+		std::atomic<long long> bottom; // the owner pushes and pops here
+		char bottomPadding[64];
+		std::atomic<Job*> queue[JOB_QUEUE_SIZE];
+		Job jobs[JOB_QUEUE_SIZE];
+		unsigned int nextJob;
+		unsigned int random;
+		std::atomic<unsigned long long> executed, stolen, stealAttempts, splits;
+	};
+
+	int GetCallerIndex();
+	Job* Allocate(int);
+	void Submit(int, Job*);
+	void Push(int, Job*);
+	Job* Pop(int);
+	Job* Steal(int);
+	Job* FindJob(int);
+	void Execute(int, Job*);
+	void RunRange(int, Job*);
+	void Finish(Counter*);
+	bool HasWork();
+	void WakeOne();
+	void WorkerMain(int);
+
+	Worker* pWorkers;
+	int threadCount;
+	std::vector<std::thread> threads;
+
+	// From threads that aren't in the system
+	std::mutex injectedMutex;
+	std::deque<Job*> injected;
+	std::atomic<int> injectedCount;
+
+	// Idle workers sleep here. A push only takes the lock when someone's asleep.
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> sleepers;
+	unsigned int wakeEpoch;
+	std::atomic<bool> stopping;
+};
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "LightShader.h"
+#include "Model.h"
 
 LightShader::LightShader() {
 	this->pVertexShader = nullptr;
@@ -8,10 +9,39 @@ LightShader::LightShader() {
 	this->pLightBuf = nullptr;
 	this->pCameraBuf = nullptr;
 	this->pSamplerState = nullptr;
+	this->pVertexShaderBuf = nullptr;
+	this->pPixelShaderBuf = nullptr;
+	this->pVsErrorMsg = nullptr;
+	this->pPsErrorMsg = nullptr;
 }
 
 bool LightShader::Init(ID3D11Device* pDevice, HWND hWnd) {
-	return this->InitShader(pDevice, hWnd, L"./LightVs.hlsl", L"./LightPs.hlsl");
+	// Both compiles always run so CreateShader can report whichever of them failed
+	CompileVertexShader();
+	CompilePixelShader();
+	return CreateShader(pDevice, hWnd);
+}
+
+// Compiling is pure CPU work (and the slow part), so these two can run on worker threads and
+// in parallel with each other. Errors are kept for CreateShader to report on the main thread.
+bool LightShader::CompileVertexShader() {
+	HRESULT result = D3DCompileFromFile(LIGHT_VS_FILENAME, nullptr, nullptr, "LightVertexShader",
+		"vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &this->pVertexShaderBuf, &this->pVsErrorMsg);
+	if (FAILED(result)) return false;
+	printf("Compiled vertex shader.\n");
+	return true;
+}
+
+bool LightShader::CompilePixelShader() {
+	HRESULT result = D3DCompileFromFile(LIGHT_PS_FILENAME, nullptr, nullptr, "LightPixelShader",
+		"ps_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &this->pPixelShaderBuf, &this->pPsErrorMsg);
+	if (FAILED(result)) return false;
+	printf("Compiled pixel shader.\n");
+	return true;
+}
+
+bool LightShader::CreateShader(ID3D11Device* pDevice, HWND hWnd) {
+	return this->InitShader(pDevice, hWnd, LIGHT_VS_FILENAME, LIGHT_PS_FILENAME);
 }
 
 void LightShader::Shutdown() {
@@ -22,55 +52,77 @@ bool LightShader::Render(ID3D11DeviceContext* dCtx, int idxCt, ID3D11ShaderResou
 	DirectX::XMMATRIX worldMx, DirectX::XMMATRIX viewMx, DirectX::XMMATRIX projMx,
 	DirectX::XMFLOAT3 lightDir, DirectX::XMFLOAT4 diffuseClr, DirectX::XMFLOAT4 ambientClr,
 	DirectX::XMFLOAT4 specClr, float specExp, DirectX::XMFLOAT3 cameraPos)
+{
+	// Now render the prepared buffers with the shader
+	bool result = Begin(dCtx, worldMx, viewMx, projMx, lightDir, diffuseClr, ambientClr, specClr, specExp, cameraPos);
+	if (result) DrawRange(dCtx, 0, idxCt, 0, pTex);
+
+	return result;
+}
+
+bool LightShader::Begin(ID3D11DeviceContext* dCtx,
+	DirectX::XMMATRIX worldMx, DirectX::XMMATRIX viewMx, DirectX::XMMATRIX projMx,
+	DirectX::XMFLOAT3 lightDir, DirectX::XMFLOAT4 diffuseClr, DirectX::XMFLOAT4 ambientClr,
+	DirectX::XMFLOAT4 specClr, float specExp, DirectX::XMFLOAT3 cameraPos)
 {
 	// Setting the shader paramteres externally like we talked about in Color.vs
-	bool result = this->SetShaderParams(dCtx, pTex, 
+	bool result = this->SetShaderParams(dCtx,
 										worldMx, viewMx, projMx, 
 										cameraPos, lightDir, 
 										diffuseClr, ambientClr,
 										specClr, specExp);
 
-	// Now render the prepared buffers with the shader
-	if (result) RenderShader(dCtx, idxCt);
+	if (result) RenderShader(dCtx);
 
 	return result;
 }
 
+// Begin should have been called before this, the constant buffers and shaders stay bound so
+// only the texture changes between ranges
+void LightShader::DrawRange(ID3D11DeviceContext* dCtx, int startIndex, int indexCount, int baseVertex, ID3D11ShaderResourceView* pTex) {
+	dCtx->PSSetShaderResources(0, 1, &pTex);
+	dCtx->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
 bool LightShader::InitShader(ID3D11Device* pDevice, HWND hWnd, 
 	const wchar_t* vsFilename, const wchar_t* psFilename)
 {
-	ID3D10Blob* pErrorMsg = nullptr;
-	ID3D10Blob* pVertexShaderBuf = nullptr; // compiled vertex shader
-	ID3D10Blob* pPixelShaderBuf = nullptr;  // compiled shader buffer
+	ID3D10Blob* pVertexShaderBuf = this->pVertexShaderBuf; // compiled vertex shader
+	ID3D10Blob* pPixelShaderBuf = this->pPixelShaderBuf;   // compiled shader buffer
+	this->pVertexShaderBuf = this->pPixelShaderBuf = nullptr;
 	D3D11_INPUT_ELEMENT_DESC polygonLayout[3]; // position, texel, normal
 
-	// Now we attempt to load and compile the shaders into a buffer. Interesting.
-	HRESULT result = D3DCompileFromFile(vsFilename, nullptr, nullptr, "LightVertexShader", 
-		"vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &pVertexShaderBuf, &pErrorMsg);
-	if (FAILED(result)) {
+	// The Compile_Shader() calls already ran, here we just see how they went
+	bool compiled = pVertexShaderBuf && pPixelShaderBuf;
+	if (!pVertexShaderBuf) {
 		// If the file loaded but just compilation failed, errorMessage should be populated
-		if (pErrorMsg)
-			this->OutputShaderErrorMessage(pErrorMsg, hWnd, vsFilename);
+		if (this->pVsErrorMsg)
+			this->OutputShaderErrorMessage(this->pVsErrorMsg, hWnd, vsFilename);
 		else
 			// If there's no error message, probably it couldn't find the file
 			MessageBox(hWnd, vsFilename, L"Missing shader file?", MB_OK);
-		return false;
+		if (this->pPsErrorMsg) this->pPsErrorMsg->Release();
 	}
-	printf("Compiled vertex shader.\n");
-
-	result = D3DCompileFromFile(psFilename, nullptr, nullptr, "LightPixelShader",
-		"ps_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, &pPixelShaderBuf, &pErrorMsg);
-	if (FAILED(result)) {
-		if (pErrorMsg)
-			this->OutputShaderErrorMessage(pErrorMsg, hWnd, vsFilename);
+	else if (!pPixelShaderBuf) {
+		if (this->pPsErrorMsg)
+			this->OutputShaderErrorMessage(this->pPsErrorMsg, hWnd, psFilename);
 		else
 			MessageBox(hWnd, psFilename, L"Missing shader file?", MB_OK);
+	}
+	else {
+		// Whatever's left in the error blobs is just warnings
+		if (this->pVsErrorMsg) this->pVsErrorMsg->Release();
+		if (this->pPsErrorMsg) this->pPsErrorMsg->Release();
+	}
+	this->pVsErrorMsg = this->pPsErrorMsg = nullptr;
+	if (!compiled) {
+		if (pVertexShaderBuf) pVertexShaderBuf->Release();
+		if (pPixelShaderBuf) pPixelShaderBuf->Release();
 		return false;
 	}
-	printf("Compiled pixel shader.\n");
 
 	// Now that the shader source files are compiled, construct objects from their buffers
-	result = pDevice->CreateVertexShader(
+	HRESULT result = pDevice->CreateVertexShader(
 		pVertexShaderBuf->GetBufferPointer(), pVertexShaderBuf->GetBufferSize(), 
 		NULL, &(this->pVertexShader));
 	if (FAILED(result)) {
@@ -89,6 +141,8 @@ bool LightShader::InitShader(ID3D11Device* pDevice, HWND hWnd,
 
 	// Create the vertex input layout description
 	// **->This setup needs to match the Vertex stucture in the Model class and in the shader.
+	// With the streams split the texture coords and normal come from the second buffer.
+	unsigned int attributeSlot = SPLIT_VERTEX_STREAMS ? 1 : 0;
 	polygonLayout[0].SemanticName = "POSITION";
 	polygonLayout[0].SemanticIndex = 0;
 	polygonLayout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
@@ -100,15 +154,15 @@ bool LightShader::InitShader(ID3D11Device* pDevice, HWND hWnd,
 	polygonLayout[1].SemanticName = "TEXCOORD"; // Matches the semantic in the HLSL files
 	polygonLayout[1].SemanticIndex = 0; // Index placed after the semantic name
 	polygonLayout[1].Format = DXGI_FORMAT_R32G32_FLOAT; // Texel coords
-	polygonLayout[1].InputSlot = 0;
-	polygonLayout[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[1].InputSlot = attributeSlot;
+	polygonLayout[1].AlignedByteOffset = SPLIT_VERTEX_STREAMS ? 0 : D3D11_APPEND_ALIGNED_ELEMENT;
 	polygonLayout[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 	polygonLayout[1].InstanceDataStepRate = 0;
 
 	polygonLayout[2].SemanticName = "NORMAL";
 	polygonLayout[2].SemanticIndex = 0;
 	polygonLayout[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-	polygonLayout[2].InputSlot = 0;
+	polygonLayout[2].InputSlot = attributeSlot;
 	polygonLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	polygonLayout[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 	polygonLayout[2].InstanceDataStepRate = 0;
@@ -245,8 +299,9 @@ void LightShader::OutputShaderErrorMessage(
 }
 
 // The matrices are passed in here from the Graphics class, and this function sends them into
-// VertexShader (after transposing them!) during the Render call. Also pass the texture data.
-bool LightShader::SetShaderParams(ID3D11DeviceContext* pDvCtx, ID3D11ShaderResourceView* pTex,
+// VertexShader (after transposing them!) during the Render call. The texture is set per range
+// in DrawRange.
+bool LightShader::SetShaderParams(ID3D11DeviceContext* pDvCtx,
 	DirectX::XMMATRIX worldMx, DirectX::XMMATRIX viewMx, DirectX::XMMATRIX projMx,
 	DirectX::XMFLOAT3 cameraPos, DirectX::XMFLOAT3 lightDir, 
 	DirectX::XMFLOAT4 diffuseClr, DirectX::XMFLOAT4 ambientClr, 
@@ -304,13 +359,11 @@ bool LightShader::SetShaderParams(ID3D11DeviceContext* pDvCtx, ID3D11ShaderResou
 	pDvCtx->Unmap(pLightBuf, 0);
 	pDvCtx->PSSetConstantBuffers(0, 1, &pLightBuf); // update the pixel shader
 
-	pDvCtx->PSSetShaderResources(0, 1, &pTex);
-
 	return true;
 }
 
-// SetShaderParams should have been called before this
-void LightShader::RenderShader(ID3D11DeviceContext* pDeviceContext, int indexCount) {
+// SetShaderParams should have been called before this. Binds everything for DrawRange.
+void LightShader::RenderShader(ID3D11DeviceContext* pDeviceContext) {
 	// First set the layout for vertex input
 	pDeviceContext->IASetInputLayout(this->pLayout);
 
@@ -318,7 +371,4 @@ void LightShader::RenderShader(ID3D11DeviceContext* pDeviceContext, int indexCou
 	pDeviceContext->VSSetShader(pVertexShader, nullptr, 0);
 	pDeviceContext->PSSetShader(pPixelShader, nullptr, 0);
 	pDeviceContext->PSSetSamplers(0, 1, &pSamplerState);
-
-	// Render it!
-	pDeviceContext->DrawIndexed(indexCount, 0, 0);
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <DirectXMath.h>
 #include <fstream>
 
+static const wchar_t* LIGHT_VS_FILENAME = L"./LightVs.hlsl";
+static const wchar_t* LIGHT_PS_FILENAME = L"./LightPs.hlsl";
+
 /* This class invokes the HLSL shaders for drawing 3D models on the GPU */
 // Mostly the same as ColorShader with changes to render Textures instead of plain colors.
 class LightShader {
@@ -33,11 +36,11 @@ private:
 	bool InitShader(ID3D11Device*, HWND, const wchar_t*, const wchar_t*);
 	void ShutdownShader();
 	void OutputShaderErrorMessage(ID3D10Blob*, HWND, const wchar_t*);
-	bool SetShaderParams(ID3D11DeviceContext*, ID3D11ShaderResourceView*, 
+	bool SetShaderParams(ID3D11DeviceContext*,
 						DirectX::XMMATRIX, DirectX::XMMATRIX, DirectX::XMMATRIX,
 						DirectX::XMFLOAT3, DirectX::XMFLOAT3,
 						DirectX::XMFLOAT4, DirectX::XMFLOAT4, DirectX::XMFLOAT4, float);
-	void RenderShader(ID3D11DeviceContext*, int);
+	void RenderShader(ID3D11DeviceContext*);
 
 	ID3D11VertexShader* pVertexShader;
 	ID3D11PixelShader* pPixelShader;
@@ -47,13 +50,34 @@ private:
 	ID3D11Buffer* pCameraBuf;
 	ID3D11SamplerState* pSamplerState;
 
+	// Compiled bytecode (or compiler errors) waiting for CreateShader
+	ID3D10Blob* pVertexShaderBuf;
+	ID3D10Blob* pPixelShaderBuf;
+	ID3D10Blob* pVsErrorMsg;
+	ID3D10Blob* pPsErrorMsg;
+
 public:
 	LightShader();
 
 	bool Init(ID3D11Device*, HWND);
+
+	// Init in steps for the startup load graph. The compiles can run on any thread (and at the
+	// same time), CreateShader makes the D3D objects once both are done.
+	bool CompileVertexShader();
+	bool CompilePixelShader();
+	bool CreateShader(ID3D11Device*, HWND);
 	void Shutdown();
 	bool Render(ID3D11DeviceContext*, int, ID3D11ShaderResourceView*,
 				DirectX::XMMATRIX, DirectX::XMMATRIX, DirectX::XMMATRIX,
 				DirectX::XMFLOAT3, DirectX::XMFLOAT4, DirectX::XMFLOAT4,
 				DirectX::XMFLOAT4, float, DirectX::XMFLOAT3);
+
+	// Render in two steps for models split into submeshes: Begin sets everything but the
+	// texture once, then DrawRange draws each range of the bound index buffer with its own
+	// (start index, index count, base vertex).
+	bool Begin(ID3D11DeviceContext*,
+				DirectX::XMMATRIX, DirectX::XMMATRIX, DirectX::XMMATRIX,
+				DirectX::XMFLOAT3, DirectX::XMFLOAT4, DirectX::XMFLOAT4,
+				DirectX::XMFLOAT4, float, DirectX::XMFLOAT3);
+	void DrawRange(ID3D11DeviceContext*, int, int, int, ID3D11ShaderResourceView*);
 };
\ No newline at end of file
@@ -20,7 +20,8 @@ struct VertexInput
 
 struct PixelInput
 {
-    float4 position : SV_Position;
+    // Must match the depth pre-pass exactly, see DepthVs
+    precise float4 position : SV_Position;
     float2 textureCoord : TEXCOORD0;
     float3 normal : NORMAL;
     float3 viewDir : TEXCOORD1;
@@ -39,6 +40,8 @@ PixelInput LightVertexShader(VertexInput vertexInput)
     psInput.textureCoord = vertexInput.textureCoord;
     psInput.normal = normalize(mul(vertexInput.normal, (float3x3) worldMatrix));
     
+    // Worked out again rather than shared with the position, which has to stay the same
+    // expression as DepthVs's
     float4 vertexWorldPos = mul(vertexInput.position, worldMatrix);
     psInput.viewDir = normalize(cameraPosition - vertexWorldPos.xyz);
     
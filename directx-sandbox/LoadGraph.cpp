@@ -0,0 +1,187 @@
+#include "LoadGraph.h"
+
+#include <stdio.h>
+#include <map>
+#include <algorithm>
+
+static const char* STAGE_NAMES[] = { "read", "decode", "create" };
+
+LoadGraph::LoadGraph() {
+	this->pJobs = nullptr;
+	this->inFlight = 0;
+	this->completed = 0;
+	this->failedTask = -1;
+}
+
+int LoadGraph::Add(const std::string& asset, Stage stage, std::function<bool()> function,
+	std::vector<int> dependencies)
+{
+	Task task;
+	task.asset = asset;
+	task.stage = stage;
+	task.function = function;
+	task.waitingOn = (int)dependencies.size();
+	task.succeeded = false;
+	task.worker = -1;
+
+	int id = (int)this->tasks.size();
+	this->tasks.push_back(task);
+	for (size_t i = 0; i < dependencies.size(); i++) {
+		this->tasks[dependencies[i]].dependents.push_back(id);
+	}
+	return id;
+}
+
+int LoadGraph::AddAsync(const std::string& asset, Stage stage, std::function<void(Done)> function,
+	std::vector<int> dependencies)
+{
+	int id = Add(asset, stage, nullptr, dependencies);
+	this->tasks[id].asyncFunction = function;
+	return id;
+}
+
+bool LoadGraph::Run(JobSystem* pJobs) {
+	this->pJobs = pJobs;
+	this->completed = 0;
+	this->failedTask = -1;
+	this->runStart = Clock::now();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	for (size_t i = 0; i < this->tasks.size(); i++) {
+		if (this->tasks[i].waitingOn == 0) Schedule((int)i);
+	}
+
+	// The calling thread is the device thread: it runs CREATE tasks as they become ready and
+	// otherwise helps with the jobs, only sleeping when there's nothing queued anywhere
+	while (this->inFlight > 0) {
+		if (this->mainQueue.empty()) {
+			lock.unlock();
+			bool ran = this->pJobs && this->pJobs->RunOne();
+			lock.lock();
+			if (!ran && this->mainQueue.empty() && this->inFlight > 0) this->changed.wait(lock);
+			continue;
+		}
+		int id = this->mainQueue.front();
+		this->mainQueue.pop_front();
+		if (this->failedTask >= 0) {
+			// Something already failed, no point making more device objects
+			Finish(id);
+			continue;
+		}
+		lock.unlock();
+		if (this->tasks[id].asyncFunction) {
+			Start(id); // its Done does the Finish
+			lock.lock();
+			continue;
+		}
+		Execute(id);
+		lock.lock();
+		Finish(id);
+	}
+
+	this->runEnd = Clock::now();
+	if (this->failedTask >= 0) {
+		const Task& task = this->tasks[this->failedTask];
+		printf("ERROR: Loading stopped, %s step of '%s' failed\n", STAGE_NAMES[task.stage], task.asset.c_str());
+		return false;
+	}
+	return this->completed == (int)this->tasks.size();
+}
+
+// Called with the lock held. Wakes the main thread either way, a job might be its to run.
+void LoadGraph::Schedule(int id) {
+	this->inFlight++;
+	this->changed.notify_all();
+	if (this->tasks[id].stage == STAGE_CREATE || !this->pJobs) {
+		this->mainQueue.push_back(id);
+		return;
+	}
+	if (this->tasks[id].asyncFunction) {
+		this->pJobs->Run([this, id] { Start(id); }, nullptr);
+		return;
+	}
+	this->pJobs->Run([this, id] {
+		Execute(id);
+		std::lock_guard<std::mutex> lock(this->mutex);
+		Finish(id);
+	}, nullptr);
+}
+
+// Called without the lock; each task only ever writes its own timing fields
+void LoadGraph::Execute(int id) {
+	Task& task = this->tasks[id];
+	task.worker = JobSystem::GetCurrentWorker();
+	task.start = Clock::now();
+	task.succeeded = task.function();
+	task.end = Clock::now();
+}
+
+// Kicks off an async task without the lock, its Done can come back on this very thread. The
+// timeline shows it from start to Done, so for a read that's the whole time it was queued.
+void LoadGraph::Start(int id) {
+	Task& task = this->tasks[id];
+	task.worker = JobSystem::GetCurrentWorker();
+	task.start = Clock::now();
+	task.asyncFunction([this, id](bool succeeded) {
+		Task& task = this->tasks[id];
+		task.succeeded = succeeded;
+		task.end = Clock::now();
+		std::lock_guard<std::mutex> lock(this->mutex);
+		Finish(id);
+	});
+}
+
+// Called with the lock held
+void LoadGraph::Finish(int id) {
+	this->inFlight--;
+	Task& task = this->tasks[id];
+	if (!task.succeeded) {
+		if (this->failedTask < 0) this->failedTask = id;
+	}
+	else {
+		this->completed++;
+		if (this->failedTask < 0) {
+			for (size_t i = 0; i < task.dependents.size(); i++) {
+				int dependent = task.dependents[i];
+				if (--this->tasks[dependent].waitingOn == 0) Schedule(dependent);
+			}
+		}
+	}
+	this->changed.notify_all();
+}
+
+void LoadGraph::PrintTimeline() {
+	auto ms = [this](Clock::time_point t) {
+		return std::chrono::duration<double, std::milli>(t - this->runStart).count();
+	};
+
+	double taskTotal = 0.0;
+	std::map<std::string, double> assetTotals;
+	printf("Startup timeline (%d threads):\n", this->pJobs ? this->pJobs->GetThreadCount() : 1);
+	printf("  %8s %8s  %-8s %-7s %s\n", "start", "ms", "thread", "stage", "asset");
+	std::vector<int> order;
+	for (size_t i = 0; i < this->tasks.size(); i++) {
+		if (this->tasks[i].end != Clock::time_point()) order.push_back((int)i); // skip ones that never ran
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b) { return this->tasks[a].start < this->tasks[b].start; });
+
+	for (size_t n = 0; n < order.size(); n++) {
+		const Task& task = this->tasks[order[n]];
+		double duration = ms(task.end) - ms(task.start);
+		taskTotal += duration;
+		assetTotals[task.asset] += duration;
+
+		char thread[16];
+		if (task.worker <= 0) snprintf(thread, sizeof(thread), "main");
+		else snprintf(thread, sizeof(thread), "worker%d", task.worker);
+		printf("  %8.2f %8.2f  %-8s %-7s %s%s\n", ms(task.start), duration, thread,
+			STAGE_NAMES[task.stage], task.asset.c_str(), task.succeeded ? "" : "  FAILED");
+	}
+
+	printf("  per asset:\n");
+	for (auto it = assetTotals.begin(); it != assetTotals.end(); ++it) {
+		printf("  %8.2f ms  %s\n", it->second, it->first.c_str());
+	}
+	double wall = ms(this->runEnd);
+	printf("  %.2f ms wall for %.2f ms of tasks (%.2fx)\n", wall, taskTotal, wall > 0.0 ? taskTotal / wall : 0.0);
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+#include "JobSystem.h"
+
+/* Startup loading as a graph of small tasks. Each task belongs to an asset and a stage, and
+ * only starts once the tasks it depends on are done. READ and DECODE tasks go to a JobSystem;
+ * CREATE tasks (anything that calls the device) run one at a time on the thread that called
+ * Run, so device calls stay serialized while the CPU work around them runs in parallel. That
+ * thread has to be the job system's own, it runs jobs too while there's nothing to create.
+ * Afterwards PrintTimeline shows when each task ran, where, and how long it took. */
+class LoadGraph {
+public:
+	enum Stage {
+		STAGE_READ,
+		STAGE_DECODE,
+		STAGE_CREATE,
+	};
+
+	LoadGraph();
+
+	// Returns the task's id for use as a dependency of later tasks. The function returns false
+	// on failure, which stops anything that depends on it from running.
+	int Add(const std::string&, Stage, std::function<bool()>, std::vector<int>);
+
+	// For work that finishes somewhere else, like an AssetIO read. The function starts it and
+	// returns; whoever finishes it calls the function it was given with the result, from any
+	// thread, and that's what lets the dependents (usually the decode) go.
+	typedef std::function<void(bool)> Done;
+	int AddAsync(const std::string&, Stage, std::function<void(Done)>, std::vector<int>);
+
+	// Runs every task and returns once they're all done (or one failed and whatever was
+	// already running has finished)
+	bool Run(JobSystem*);
+	void PrintTimeline();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Task {
+		std::string asset;
+		Stage stage;
+		std::function<bool()> function;
+		std::function<void(Done)> asyncFunction;
+		std::vector<int> dependents;
+		int waitingOn;
+		bool succeeded;
+		int worker;  // the job system's thread index, 0 (or -1 without one) for the main thread
+		Clock::time_point start, end;
+	};
+
+	void Schedule(int);
+	void Execute(int);
+	void Start(int);
+	void Finish(int);
+
+	std::vector<Task> tasks;
+	JobSystem* pJobs;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<int> mainQueue;
+	int inFlight;
+	int completed;
+	int failedTask;
+	Clock::time_point runStart, runEnd;
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "LzCodec.h"
+
+#include <string.h>
+#include <vector>
+
+static const size_t MIN_MATCH = 4;
+// The format wants the last 5 bytes to be literals and the last match to start at least 12
+// bytes from the end, that's what lets decoders copy in big unchecked steps
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_FIND_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 16;
+
+static unsigned int Read32(const unsigned char* p) {
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static unsigned int Hash(unsigned int sequence) {
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths past what fits in the token's 4 bits go out as a run of 255s and a remainder
+static bool WriteLength(size_t length, unsigned char*& pOut, const unsigned char* pOutEnd) {
+	while (length >= 255) {
+		if (pOut >= pOutEnd) return false;
+		*pOut++ = 255;
+		length -= 255;
+	}
+	if (pOut >= pOutEnd) return false;
+	*pOut++ = (unsigned char)length;
+	return true;
+}
+
+static bool WriteSequence(const unsigned char* pLiterals, size_t literalCount, size_t offset, size_t matchLength,
+	unsigned char*& pOut, const unsigned char* pOutEnd)
+{
+	if (pOut >= pOutEnd) return false;
+	unsigned char* pToken = pOut++;
+	size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+	*pToken = (unsigned char)(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+	if (literalCount >= 15 && !WriteLength(literalCount - 15, pOut, pOutEnd)) return false;
+	if ((size_t)(pOutEnd - pOut) < literalCount) return false;
+	if (literalCount) memcpy(pOut, pLiterals, literalCount);
+	pOut += literalCount;
+
+	if (matchLength == 0) return true; // the last sequence is literals only
+	if (pOutEnd - pOut < 2) return false;
+	*pOut++ = (unsigned char)(offset & 0xFF);
+	*pOut++ = (unsigned char)(offset >> 8);
+	if (matchCode >= 15 && !WriteLength(matchCode - 15, pOut, pOutEnd)) return false;
+	return true;
+}
+
+size_t LzCodec::GetCompressBound(size_t size) {
+	return size + size / 255 + 16;
+}
+
+size_t LzCodec::Compress(const unsigned char* pSrc, size_t srcSize, unsigned char* pDest, size_t destCapacity) {
+	unsigned char* pOut = pDest;
+	const unsigned char* pOutEnd = pDest + destCapacity;
+	size_t anchor = 0;
+
+	if (srcSize > MATCH_FIND_LIMIT) {
+		// Positions are stored +1 so zero means empty
+		std::vector<unsigned int> table((size_t)1 << HASH_BITS, 0);
+		size_t matchLimit = srcSize - LAST_LITERALS;
+		size_t pos = 0;
+		while (pos + MATCH_FIND_LIMIT <= srcSize) {
+			unsigned int sequence = Read32(pSrc + pos);
+			unsigned int& slot = table[Hash(sequence)];
+			size_t candidate = slot;
+			slot = (unsigned int)(pos + 1);
+
+			if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || Read32(pSrc + candidate - 1) != sequence) {
+				// Step further the longer we go without a match, so incompressible data is quick
+				pos += 1 + ((pos - anchor) >> 6);
+				continue;
+			}
+
+			size_t ref = candidate - 1;
+			size_t length = MIN_MATCH;
+			while (pos + length < matchLimit && pSrc[ref + length] == pSrc[pos + length]) length++;
+			// The match may well have started a little earlier than the hash caught it
+			while (pos > anchor && ref > 0 && pSrc[pos - 1] == pSrc[ref - 1]) {
+				pos--;
+				ref--;
+				length++;
+			}
+
+			if (!WriteSequence(pSrc + anchor, pos - anchor, pos - ref, length, pOut, pOutEnd)) return 0;
+			pos += length;
+			anchor = pos;
+			if (pos >= 2 && pos + MATCH_FIND_LIMIT <= srcSize) {
+				table[Hash(Read32(pSrc + pos - 2))] = (unsigned int)(pos - 2 + 1);
+			}
+		}
+	}
+
+	if (!WriteSequence(pSrc + anchor, srcSize - anchor, 0, 0, pOut, pOutEnd)) return 0;
+	return (size_t)(pOut - pDest);
+}
+
+bool LzCodec::Decompress(const unsigned char* pSrc, size_t srcSize, unsigned char* pDest, size_t destSize) {
+	const unsigned char* pIn = pSrc;
+	const unsigned char* pInEnd = pSrc + srcSize;
+	unsigned char* pOut = pDest;
+	unsigned char* pOutEnd = pDest + destSize;
+
+	auto readLength = [&](size_t& length) {
+		unsigned char byte;
+		do {
+			if (pIn >= pInEnd) return false;
+			byte = *pIn++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	};
+
+	while (pIn < pInEnd) {
+		unsigned char token = *pIn++;
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(literalCount)) return false;
+		if ((size_t)(pInEnd - pIn) < literalCount || (size_t)(pOutEnd - pOut) < literalCount) return false;
+		if (literalCount) memcpy(pOut, pIn, literalCount);
+		pIn += literalCount;
+		pOut += literalCount;
+
+		if (pIn == pInEnd) break; // that was the last sequence
+
+		if (pInEnd - pIn < 2) return false;
+		size_t offset = (size_t)pIn[0] | ((size_t)pIn[1] << 8);
+		pIn += 2;
+		if (offset == 0 || offset > (size_t)(pOut - pDest)) return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !readLength(length)) return false;
+		length += MIN_MATCH;
+		if ((size_t)(pOutEnd - pOut) < length) return false;
+
+		// Overlapping copies (offset < length) repeat the pattern, so those go byte by byte
+		const unsigned char* pMatch = pOut - offset;
+		if (offset >= length) {
+			memcpy(pOut, pMatch, length);
+			pOut += length;
+		}
+		else {
+			for (size_t i = 0; i < length; i++) *pOut++ = *pMatch++;
+		}
+	}
+	return pOut == pOutEnd;
+}
\ No newline at end of file
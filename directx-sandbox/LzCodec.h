@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+
+/* Byte-oriented LZ compression in the LZ4 block format: a run of literals, then a back
+ * reference (16-bit offset, length of at least 4), repeat. It doesn't squeeze as hard as
+ * deflate but decompressing is little more than memcpy, which is what matters at load time.
+ * The compressor is a single-probe hash table, good enough for packing assets offline. */
+class LzCodec {
+public:
+	// Worst case output size for an input this big (incompressible data grows a little)
+	static size_t GetCompressBound(size_t);
+
+	// Returns the compressed size, or 0 if the output didn't fit in the given capacity
+	static size_t Compress(const unsigned char*, size_t, unsigned char*, size_t);
+
+	// Decompresses exactly the given output size. False for corrupt or truncated input, it
+	// never reads or writes out of bounds either way.
+	static bool Decompress(const unsigned char*, size_t, unsigned char*, size_t);
+};
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "MappedFile.h"
+#include "AssetArchive.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile() {
+#ifdef _WIN32
+	this->hFile = INVALID_HANDLE_VALUE;
+	this->hMapping = nullptr;
+#else
+	this->fd = -1;
+#endif
+	this->pData = nullptr;
+	this->size = 0;
+	this->pDecompressed = nullptr;
+	this->fromArchive = false;
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const char* filename) {
+	AssetArchive* pArchive = AssetArchive::GetMounted();
+	int entry = pArchive ? pArchive->Find(filename) : -1;
+	if (entry < 0) return OpenLoose(filename);
+
+	Close();
+	this->fromArchive = true;
+	this->size = pArchive->GetSize(entry);
+	this->pData = pArchive->GetStoredData(entry);
+	if (this->pData) return true;
+
+	this->pDecompressed = new unsigned char[(size_t)this->size + 1];
+	if (!pArchive->Extract(entry, this->pDecompressed)) {
+		Close();
+		return false;
+	}
+	this->pData = this->pDecompressed;
+	return true;
+}
+
+bool MappedFile::OpenLoose(const char* filename) {
+	Close();
+
+#ifdef _WIN32
+	this->hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (this->hFile == INVALID_HANDLE_VALUE) {
+		printf("ERROR: Could not open '%s' for mapping (error %lu)\n", filename, GetLastError());
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(this->hFile, &fileSize) || fileSize.QuadPart == 0) {
+		printf("ERROR: '%s' is empty or its size couldn't be read\n", filename);
+		Close();
+		return false;
+	}
+	this->size = (unsigned long long)fileSize.QuadPart;
+
+	this->hMapping = CreateFileMappingA(this->hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!this->hMapping) {
+		printf("ERROR: CreateFileMapping failed for '%s' (error %lu)\n", filename, GetLastError());
+		Close();
+		return false;
+	}
+
+	this->pData = (const unsigned char*)MapViewOfFile(this->hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!this->pData) {
+		printf("ERROR: MapViewOfFile failed for '%s' (error %lu)\n", filename, GetLastError());
+		Close();
+		return false;
+	}
+#else
+	this->fd = open(filename, O_RDONLY);
+	if (this->fd < 0) {
+		printf("ERROR: Could not open '%s' for mapping\n", filename);
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(this->fd, &info) != 0 || info.st_size == 0) {
+		printf("ERROR: '%s' is empty or its size couldn't be read\n", filename);
+		Close();
+		return false;
+	}
+	this->size = (unsigned long long)info.st_size;
+
+	void* pMapped = mmap(nullptr, (size_t)this->size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+	if (pMapped == MAP_FAILED) {
+		printf("ERROR: mmap failed for '%s'\n", filename);
+		Close();
+		return false;
+	}
+	this->pData = (const unsigned char*)pMapped;
+#endif
+
+	return true;
+}
+
+void MappedFile::Close() {
+	if (this->fromArchive) {
+		// Nothing of ours is mapped, the archive owns that
+		delete[] this->pDecompressed;
+		this->pDecompressed = nullptr;
+		this->fromArchive = false;
+		this->pData = nullptr;
+		this->size = 0;
+		return;
+	}
+
+#ifdef _WIN32
+	if (this->pData) {
+		UnmapViewOfFile(this->pData);
+	}
+	if (this->hMapping) {
+		CloseHandle(this->hMapping);
+		this->hMapping = nullptr;
+	}
+	if (this->hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(this->hFile);
+		this->hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (this->pData) {
+		munmap((void*)this->pData, (size_t)this->size);
+	}
+	if (this->fd >= 0) {
+		close(this->fd);
+		this->fd = -1;
+	}
+#endif
+	this->pData = nullptr;
+	this->size = 0;
+}
+
+bool MappedFile::Exists(const char* filename) {
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(filename);
+	return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat info;
+	return stat(filename, &info) == 0 && S_ISREG(info.st_mode);
+#endif
+}
+
+bool MappedFile::IsOpen() {
+	return this->pData != nullptr;
+}
+
+const unsigned char* MappedFile::GetData() {
+	return this->pData;
+}
+
+unsigned long long MappedFile::GetSize() {
+	return this->size;
+}
\ No newline at end of file
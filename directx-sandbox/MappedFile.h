@@ -0,0 +1,39 @@
+#pragma once
+
+/* Read-only memory mapping of a whole file. Loaders that can use the file's bytes in place
+ * (cooked textures, DDS) point straight into the mapping instead of reading and copying. The
+ * pointer stays valid until Close() or the object is destroyed.
+ *
+ * With an AssetArchive mounted, Open serves files the archive has out of it: stored entries
+ * point into the archive's own mapping, compressed ones are decompressed into memory we own.
+ * OpenLoose always goes to the file system. */
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char*);
+	bool OpenLoose(const char*);
+	void Close();
+
+	static bool Exists(const char*);
+
+	bool IsOpen();
+	const unsigned char* GetData();
+	unsigned long long GetSize();
+
+private:
+	MappedFile(const MappedFile&);            // the mapping can't be shared
+	MappedFile& operator=(const MappedFile&);
+
+#ifdef _WIN32
+	void* hFile;     // HANDLE
+	void* hMapping;  // HANDLE
+#else
+	int fd;
+#endif
+	const unsigned char* pData;
+	unsigned long long size;
+	unsigned char* pDecompressed; // owned copy of a compressed archive entry
+	bool fromArchive;
+};
\ No newline at end of file
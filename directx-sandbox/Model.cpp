@@ -1,52 +1,211 @@
 #include "Model.h"
 #include <stdio.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <sstream>
 
 Model::Model() {
-	this->pVertexBuffer = nullptr;
+	for (int i = 0; i < GEOMETRY_MAX_STREAMS; i++) this->pVertexBuffers[i] = nullptr;
 	this->pIndexBuffer = nullptr;
+	this->pGeometryPool = nullptr;
 	this->pTexture = nullptr;
+	this->fileRows = nullptr;
 	this->vertexCount = 0;
 	this->indexCount = 0;
+	this->boundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	this->boundsExtents = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	this->boundsRadius = 0.0f;
+	this->pResidency = nullptr;
+	this->residencyHandle = -1;
+	this->bufferBytes = 0;
 }
 
 bool Model::Init(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, 
-	const char* textureFilename, std::string modelFilename) 
+	const char* textureFilename, std::string modelFilename, TextureResidency* pResidency) 
 {
 	// Load this model's texture
-	bool result = LoadTexture(pDevice, pDeviceContext, textureFilename);
+	bool result = LoadTextureData(textureFilename) && CreateTexture(pDevice, pDeviceContext);
 	if (!result) {
 		printf("ERROR: LoadTexture returned false.\n");
 		return false;
 	}
 
-	result = LoadModel(modelFilename);
-	if (!result) printf("ERROR: LoadModel returned false.\n");
+	result = ReadModelFile(modelFilename) && ParseModel() && CreateMaterialTextures(pDevice, pDeviceContext);
+	if (!result) {
+		printf("ERROR: LoadModel returned false.\n");
+		return false;
+	}
+
+	result = CreateBuffers(pDevice);
+	if (!result) return false;
+
+	AttachResidency(pResidency);
+	return true;
+}
+
+bool Model::LoadTextureData(const char* filename) {
+	if (!this->pTexture) this->pTexture = new Texture();
+	return this->pTexture->Load(filename);
+}
+
+bool Model::CreateTexture(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext) {
+	return this->pTexture->Create(pDevice, pDeviceContext);
+}
+
+// The textures ParseModel loaded for the submeshes, made into D3D textures here since this has
+// to happen on the device thread
+bool Model::CreateMaterialTextures(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext) {
+	for (size_t i = 0; i < this->materialTextures.size(); i++) {
+		if (!this->materialTextures[i]) continue;
+		if (!this->materialTextures[i]->Create(pDevice, pDeviceContext)) {
+			printf("ERROR: Could not create submesh texture '%s'\n", this->materialTextureNames[i].c_str());
+			return false;
+		}
+	}
+	return true;
+}
 
-	for (int i = 0; i < this->vertexCount; i++) {
-		ModelFileRow vx = this->fileRows[i];
-		printf("VERTEX %d=%.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f\n", i,
-			vx.posX, vx.posY, vx.posZ, vx.texU, 
-			vx.texV, vx.normX, vx.normY, vx.normZ);
+bool Model::CreateBuffers(ID3D11Device* pDevice) {
+	if (this->submeshes.empty()) {
+		Submesh whole = { 0, this->indexCount, "", nullptr };
+		this->submeshes.push_back(whole);
 	}
 
-	result = InitBuffers(pDevice);
+	bool result = InitBuffers(pDevice);
 	if (!result) {
 		printf("ERROR: InitBuffers returned false.\n");
 		return false;
 	}
 	printf("Model buffers initialized...\n");
-	
-	return result;
+
+	this->bufferBytes = (unsigned long long)this->vertexCount * sizeof(Vertex)
+		+ (unsigned long long)this->indexCount * sizeof(unsigned long);
+	return true;
 }
 
-bool Model::LoadModel(std::string modelFilename) {
+void Model::AttachResidency(TextureResidency* pResidency) {
+	this->pResidency = pResidency;
+	if (!this->pResidency) return;
+	this->residencyHandle = this->pResidency->Register(this->pTexture->GetFootprint(), this->pTexture);
+	this->materialHandles.assign(this->materialTextures.size(), -1);
+	for (size_t i = 0; i < this->materialTextures.size(); i++) {
+		Texture* pTexture = this->materialTextures[i];
+		if (pTexture) this->materialHandles[i] = this->pResidency->Register(pTexture->GetFootprint(), pTexture);
+	}
+	this->pResidency->AddPinnedBytes(this->bufferBytes);
+}
+
+void Model::UseGeometryPool(GeometryPool* pGeometryPool) {
+	this->pGeometryPool = pGeometryPool;
+}
+
+int Model::GetVertexStreams(unsigned int* pStrides) {
+	if (!SPLIT_VERTEX_STREAMS) {
+		pStrides[0] = sizeof(Vertex);
+		return 1;
+	}
+	pStrides[0] = sizeof(DirectX::XMFLOAT3);
+	pStrides[1] = sizeof(VertexAttributes);
+	return 2;
+}
+
+bool Model::InitBox(ID3D11Device* pDevice, unsigned char r, unsigned char g, unsigned char b) {
+	this->pTexture = new Texture();
+	if (!this->pTexture->InitSolid(pDevice, r, g, b, 255)) {
+		printf("ERROR: Could not create the box's texture.\n");
+		return false;
+	}
+
+	// Two triangles per face, wound clockwise when looking at the face from outside like the
+	// model files are. u and v are the face's two in-plane axes, picked so v x u = normal.
+	static const float faces[6][3][3] = {
+		{ { 1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+		{ { -1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, -1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+		{ { 0, 0, 1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+		{ { 0, 0, -1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+	};
+	static const float corners[6][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { -1, -1 }, { 1, 1 }, { 1, -1 } };
+
+	this->vertexCount = this->indexCount = 36;
+	this->vertices.resize(this->vertexCount);
+	this->indices.resize(this->indexCount);
+	for (int face = 0; face < 6; face++) {
+		const float* n = faces[face][0];
+		const float* u = faces[face][1];
+		const float* v = faces[face][2];
+		for (int corner = 0; corner < 6; corner++) {
+			float cu = corners[corner][0], cv = corners[corner][1];
+			Vertex& vertex = this->vertices[face * 6 + corner];
+			vertex.position = DirectX::XMFLOAT3(n[0] + cu * u[0] + cv * v[0],
+				n[1] + cu * u[1] + cv * v[1], n[2] + cu * u[2] + cv * v[2]);
+			vertex.texture = DirectX::XMFLOAT2(0.0f, 0.0f);
+			vertex.normal = DirectX::XMFLOAT3(n[0], n[1], n[2]);
+			this->indices[face * 6 + corner] = face * 6 + corner;
+		}
+	}
+	this->boundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	this->boundsExtents = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+	this->boundsRadius = sqrtf(3.0f);
+
+	return CreateBuffers(pDevice);
+}
+
+// Submesh texture names are relative to the model file, so this keeps its directory around
+static std::string getDirectory(const std::string& filename) {
+	size_t slash = filename.find_last_of("/\\");
+	return slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+}
+
+// Just pulls the whole file into memory, parsing is a separate step so the two can be timed
+// (and scheduled) separately
+bool Model::ReadModelFile(std::string modelFilename) {
+	this->modelDirectory = getDirectory(modelFilename);
+
+	// Out of the mounted archive if it's in there, that's already mapped
+	if (AssetArchive::IsArchived(modelFilename.c_str())) {
+		MappedFile file;
+		if (!file.Open(modelFilename.c_str())) return false;
+		this->modelText.assign((const char*)file.GetData(), (size_t)file.GetSize());
+		return true;
+	}
+
 	std::ifstream fin;
-	fin.open(modelFilename);
+	fin.open(modelFilename, std::ios::binary);
 	if (!fin.is_open()) {
 		printf("ERROR: Could not open file '%s'. Does it exist?\n", 
 			modelFilename.c_str());
 		return false;
 	}
+	std::ostringstream contents;
+	contents << fin.rdbuf();
+	this->modelText = contents.str();
+	fin.close();
+	return true;
+}
+
+void Model::ReadTextureFile(AssetIO* pIO, const char* filename, std::function<void(bool)> done) {
+	this->pTexture = new Texture();
+	this->pTexture->Read(pIO, filename, done);
+}
+
+void Model::ReadModelFile(AssetIO* pIO, std::string modelFilename, std::function<void(bool)> done) {
+	this->modelDirectory = getDirectory(modelFilename);
+	pIO->Read(modelFilename.c_str(), [this, done](AssetBuffer* pBuffer) {
+		if (pBuffer) {
+			this->modelText.assign((const char*)pBuffer->GetData(), (size_t)pBuffer->GetSize());
+			delete pBuffer;
+		}
+		done(pBuffer != nullptr);
+	});
+}
+
+// Parses the text ReadModelFile loaded and builds the vertex/index arrays InitBuffers uploads.
+// This can run on a worker thread, so it sticks to strtok_s rather than strtok's global state.
+bool Model::ParseModel() {
+	std::istringstream fin(this->modelText);
 	std::string line = "";
 	while (line.empty() && fin.good()) {
 		std::getline(fin, line);
@@ -67,19 +226,30 @@ bool Model::LoadModel(std::string modelFilename) {
 
 	int lineCount = 1, tokensPerRow = sizeof(ModelFileRow) / sizeof(float);
 	this->fileRows = new ModelFileRow[vertexCount];
+	std::vector<char> lineBuf;
 	for (line; std::getline(fin, line); lineCount++) {
-		printf("lineCount=%d, Processing line: %s\n", lineCount, line.c_str());
+		if (!line.empty() && line.back() == '\r') line.pop_back();
 		if (line.empty()) {
 			lineCount--;
 			continue;
 		}
 
+		// Models with materials list their submeshes after the vertices
+		if (line.compare(0, 8, "submesh ") == 0) {
+			if (!ParseSubmesh(line)) return false;
+			lineCount--;
+			continue;
+		}
+
 		if (lineCount > vertexCount) {
 			printf("ERROR: More vertices in file than specified. Expected %d\n", vertexCount);
 			return false;
 		}
 
-		char* token = strtok(_strdup(line.c_str()), " ");
+		lineBuf.assign(line.begin(), line.end());
+		lineBuf.push_back('\0');
+		char* context = nullptr;
+		char* token = strtok_s(lineBuf.data(), " ", &context);
 		float coords[TOKENS_PER_ROW] = { };
 		int index = 0;
 		while (token != nullptr && index < TOKENS_PER_ROW) {
@@ -91,7 +261,7 @@ bool Model::LoadModel(std::string modelFilename) {
 					"your model file.\n", token);
 				return false;
 			}
-			token = strtok(nullptr, " ");
+			token = strtok_s(nullptr, " ", &context);
 		}
 
 		this->fileRows[lineCount - 1].posX = coords[0];
@@ -109,18 +279,89 @@ bool Model::LoadModel(std::string modelFilename) {
 			lineCount, vertexCount);
 		return false;
 	}
+	for (size_t i = 0; i < this->submeshes.size(); i++) {
+		const Submesh& submesh = this->submeshes[i];
+		if (submesh.startIndex < 0 || submesh.indexCount < 0 || submesh.startIndex > vertexCount - submesh.indexCount) {
+			printf("ERROR: Submesh %d (%d + %d) runs past the %d vertices\n",
+				(int)i, submesh.startIndex, submesh.indexCount, vertexCount);
+			return false;
+		}
+	}
+	this->modelText.clear();
+	this->modelText.shrink_to_fit();
 
+	BuildVertices();
+	LoadMaterialTextures();
 	printf("Loaded file.\n");
-	fin.close();
+	return true;
+}
+
+// "submesh <start> <count> <material> <texture>", the texture is the rest of the line since it
+// can have spaces, "-" for none. The material name is only there for people reading the file.
+bool Model::ParseSubmesh(const std::string& line) {
+	std::istringstream iss(line.substr(8));
+	Submesh submesh;
+	std::string material;
+	if (!(iss >> submesh.startIndex >> submesh.indexCount >> material)) {
+		printf("ERROR: Could not parse submesh line '%s'\n", line.c_str());
+		return false;
+	}
+	std::getline(iss, submesh.textureFilename);
+	size_t start = submesh.textureFilename.find_first_not_of(" \t");
+	submesh.textureFilename = start == std::string::npos ? "" : submesh.textureFilename.substr(start);
+	if (submesh.textureFilename == "-") submesh.textureFilename.clear();
+	submesh.pTexture = nullptr;
+	this->submeshes.push_back(submesh);
+	return true;
+}
+
+// Reads and decodes the submesh textures on the parse thread, the same as LoadTextureData does
+// for the model's own texture. One that won't load is only a warning, its submeshes just use
+// the model's texture instead.
+void Model::LoadMaterialTextures() {
+	for (size_t i = 0; i < this->submeshes.size(); i++) {
+		Submesh& submesh = this->submeshes[i];
+		if (submesh.textureFilename.empty()) continue;
+
+		std::string filename = this->modelDirectory + submesh.textureFilename;
+		size_t found = 0;
+		while (found < this->materialTextureNames.size() && this->materialTextureNames[found] != filename) found++;
+		if (found == this->materialTextureNames.size()) {
+			Texture* pTexture = new Texture();
+			if (!pTexture->Load(filename.c_str())) {
+				printf("Could not load submesh texture '%s', using the model's texture instead\n", filename.c_str());
+				pTexture->Shutdown();
+				delete pTexture;
+				pTexture = nullptr;
+			}
+			this->materialTextureNames.push_back(filename);
+			this->materialTextures.push_back(pTexture);
+		}
+		submesh.pTexture = this->materialTextures[found];
+	}
 }
 
 void Model::Shutdown() {
+	if (this->pResidency) {
+		this->pResidency->Unregister(this->residencyHandle);
+		for (size_t i = 0; i < this->materialHandles.size(); i++) {
+			if (this->materialHandles[i] >= 0) this->pResidency->Unregister(this->materialHandles[i]);
+		}
+		this->materialHandles.clear();
+		this->pResidency->RemovePinnedBytes(this->bufferBytes);
+		this->pResidency = nullptr;
+		this->residencyHandle = -1;
+	}
 	ReleaseTexture();
 	ShutdownBuffers();
 }
 
 void Model::Render(ID3D11DeviceContext* pDeviceContext) {
-	RenderBuffers(pDeviceContext);
+	RenderBuffers(pDeviceContext, GEOMETRY_MAX_STREAMS);
+}
+
+void Model::RenderPositions(ID3D11DeviceContext* pDeviceContext) {
+	RenderBuffers(pDeviceContext, 1);
 }
 
 int Model::GetIndexCount() {
@@ -131,13 +372,54 @@ ID3D11ShaderResourceView* Model::GetTexture() {
 	return this->pTexture->GetTexture();
 }
 
-// This is where the vertex and index buffers are loaded from the model file that was read in.
-bool Model::InitBuffers(ID3D11Device* device) {
+int Model::GetSubmeshCount() {
+	return (int)this->submeshes.size();
+}
+
+void Model::GetSubmesh(int index, int& startIndex, int& indexCount, int& baseVertex, ID3D11ShaderResourceView*& pTexture) {
+	const Submesh& submesh = this->submeshes[index];
+	startIndex = submesh.startIndex + (int)this->geometry.firstIndex;
+	indexCount = submesh.indexCount;
+	baseVertex = (int)this->geometry.baseVertex;
+	pTexture = submesh.pTexture ? submesh.pTexture->GetTexture() : this->pTexture->GetTexture();
+}
+
+void Model::GetBoundingSphere(DirectX::XMFLOAT3& center, float& radius) {
+	center = this->boundsCenter;
+	radius = this->boundsRadius;
+}
+
+void Model::GetBoundingBox(DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents) {
+	center = this->boundsCenter;
+	extents = this->boundsExtents;
+}
+
+void Model::UpdateTexture(ID3D11Device* pDevice, float screenPixels) {
+	StreamTexture(pDevice, this->pTexture, this->residencyHandle, screenPixels);
+	for (size_t i = 0; i < this->materialTextures.size(); i++) {
+		if (!this->materialTextures[i]) continue;
+		int handle = i < this->materialHandles.size() ? this->materialHandles[i] : -1;
+		StreamTexture(pDevice, this->materialTextures[i], handle, screenPixels);
+	}
+}
+
+void Model::StreamTexture(ID3D11Device* pDevice, Texture* pTexture, int handle, float screenPixels) {
+	int mip = pTexture->ComputeDesiredMip(screenPixels);
+	if (this->pResidency && handle >= 0) this->pResidency->Request(handle, mip, screenPixels);
+	if (!pTexture->IsStreaming()) return;
+	pTexture->SetDesiredMip(mip);
+	pTexture->UpdateStreaming(pDevice);
+}
+
+// Turns the parsed file rows into the vertex and index arrays InitBuffers hands to the GPU
+void Model::BuildVertices() {
 	this->indexCount = this->vertexCount;
 	//this->vertexCount = 4;
 	//this->indexCount = 4;
-	Vertex* vertices = new Vertex[this->vertexCount];
-	unsigned long* indices = new unsigned long[this->indexCount];
+	this->vertices.resize(this->vertexCount);
+	this->indices.resize(this->indexCount);
+	std::vector<Vertex>& vertices = this->vertices;
+	std::vector<unsigned long>& indices = this->indices;
 
 	// NOTE: vertices are created CLOCKWISE. Somehow this determines where the GPU thinks the
 	// object is facing, so wrong order could result in unintentional face culling. Need to 
@@ -152,6 +434,25 @@ bool Model::InitBuffers(ID3D11Device* device) {
 		vertices[i].normal = DirectX::XMFLOAT3(fr.normX, fr.normY, fr.normZ);
 		indices[i] = i;
 	}
+
+	// Bounding sphere around the box center. Not the tightest sphere but plenty for sizing.
+	DirectX::XMFLOAT3 minPos(FLT_MAX, FLT_MAX, FLT_MAX), maxPos(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int i = 0; i < vertexCount; i++) {
+		const DirectX::XMFLOAT3& p = vertices[i].position;
+		minPos = DirectX::XMFLOAT3(fminf(minPos.x, p.x), fminf(minPos.y, p.y), fminf(minPos.z, p.z));
+		maxPos = DirectX::XMFLOAT3(fmaxf(maxPos.x, p.x), fmaxf(maxPos.y, p.y), fmaxf(maxPos.z, p.z));
+	}
+	if (vertexCount > 0) {
+		this->boundsCenter = DirectX::XMFLOAT3((minPos.x + maxPos.x) * 0.5f,
+			(minPos.y + maxPos.y) * 0.5f, (minPos.z + maxPos.z) * 0.5f);
+		this->boundsExtents = DirectX::XMFLOAT3((maxPos.x - minPos.x) * 0.5f,
+			(maxPos.y - minPos.y) * 0.5f, (maxPos.z - minPos.z) * 0.5f);
+		DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&this->boundsCenter);
+		for (int i = 0; i < vertexCount; i++) {
+			DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&vertices[i].position), center);
+			this->boundsRadius = fmaxf(this->boundsRadius, DirectX::XMVectorGetX(DirectX::XMVector3Length(offset)));
+		}
+	}
 	//vertices[0].position = DirectX::XMFLOAT3(-1.0f, -1.0f, 0.0f);  // bot left
 	//vertices[0].texture = DirectX::XMFLOAT2(0.0f, 1.0f);
 	//vertices[0].normal = DirectX::XMFLOAT3(0.0f, 0.0f, -1.0f);
@@ -172,31 +473,66 @@ bool Model::InitBuffers(ID3D11Device* device) {
 	//indices[1] = 1;
 	//indices[2] = 2;
 	//indices[3] = 3;
+}
 
+// This is where the vertex and index buffers are loaded from the model file that was read in.
+bool Model::InitBuffers(ID3D11Device* device) {
+	// The vertices are built interleaved, pulling them apart into streams is one more pass
+	// over them here rather than every loader and InitBox knowing about it
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<VertexAttributes> attributes;
+	unsigned int strides[GEOMETRY_MAX_STREAMS];
+	int streamCount = GetVertexStreams(strides);
+	const void* streams[GEOMETRY_MAX_STREAMS] = { this->vertices.data() };
+	if (SPLIT_VERTEX_STREAMS) {
+		positions.resize(this->vertexCount);
+		attributes.resize(this->vertexCount);
+		for (int i = 0; i < this->vertexCount; i++) {
+			positions[i] = this->vertices[i].position;
+			attributes[i].texture = this->vertices[i].texture;
+			attributes[i].normal = this->vertices[i].normal;
+		}
+		streams[0] = positions.data();
+		streams[1] = attributes.data();
+	}
 
+	if (this->pGeometryPool) {
+		if (!this->pGeometryPool->Allocate(streams, this->vertexCount,
+			this->indices.data(), this->indexCount, this->geometry))
+		{
+			printf("ERROR: No room in the geometry pool for %d vertices.\n", this->vertexCount);
+			return false;
+		}
+		std::vector<Vertex>().swap(this->vertices);
+		std::vector<unsigned long>().swap(this->indices);
+		return true;
+	}
 
-	D3D11_BUFFER_DESC vertexBufferDesc;
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(Vertex) * this->vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the vertex data
-	D3D11_SUBRESOURCE_DATA vertexData;
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
-	// Create the vertex buffer!
-	HRESULT result = device->CreateBuffer(
-		&vertexBufferDesc, &vertexData, &this->pVertexBuffer);
-	if (FAILED(result))
-	{
-		printf("ERROR: Failed to create vertex buffer: %s\n",
-			std::system_category().message(result).c_str());
-		return false;
+	HRESULT result = S_OK;
+	for (int stream = 0; stream < streamCount; stream++) {
+		D3D11_BUFFER_DESC vertexBufferDesc;
+		vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		vertexBufferDesc.ByteWidth = strides[stream] * this->vertexCount;
+		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vertexBufferDesc.CPUAccessFlags = 0;
+		vertexBufferDesc.MiscFlags = 0;
+		vertexBufferDesc.StructureByteStride = 0;
+
+		// Give the subresource structure a pointer to the vertex data
+		D3D11_SUBRESOURCE_DATA vertexData;
+		vertexData.pSysMem = streams[stream];
+		vertexData.SysMemPitch = 0;
+		vertexData.SysMemSlicePitch = 0;
+
+		// Create the vertex buffer!
+		result = device->CreateBuffer(
+			&vertexBufferDesc, &vertexData, &this->pVertexBuffers[stream]);
+		if (FAILED(result))
+		{
+			printf("ERROR: Failed to create vertex buffer: %s\n",
+				std::system_category().message(result).c_str());
+			return false;
+		}
 	}
 
 	D3D11_BUFFER_DESC indexBufferDesc;
@@ -209,7 +545,7 @@ bool Model::InitBuffers(ID3D11Device* device) {
 
 	// Give the subresource structure a pointer to the index data
 	D3D11_SUBRESOURCE_DATA indexData;
-	indexData.pSysMem = indices;
+	indexData.pSysMem = this->indices.data();
 	indexData.SysMemPitch = 0;
 	indexData.SysMemSlicePitch = 0;
 
@@ -221,50 +557,64 @@ bool Model::InitBuffers(ID3D11Device* device) {
 		return false;
 	}
 
-	delete[] vertices;
-	vertices = nullptr;
-
-	delete[] indices;
-	indices = nullptr;
+	// The GPU has them now
+	std::vector<Vertex>().swap(this->vertices);
+	std::vector<unsigned long>().swap(this->indices);
 
 	return true;
 }
 
 void Model::ShutdownBuffers() {
-	if (this->pVertexBuffer) {
-		this->pVertexBuffer->Release();
-		this->pVertexBuffer = nullptr;
+	if (this->pGeometryPool) this->pGeometryPool->Free(this->geometry);
+
+	for (int i = 0; i < GEOMETRY_MAX_STREAMS; i++) {
+		if (this->pVertexBuffers[i]) {
+			this->pVertexBuffers[i]->Release();
+			this->pVertexBuffers[i] = nullptr;
+		}
 	}
 
 	if (this->pIndexBuffer) {
 		this->pIndexBuffer->Release();
 		this->pIndexBuffer = nullptr;
 	}
+	this->submeshes.clear();
 }
 
-void Model::RenderBuffers(ID3D11DeviceContext* deviceContext) {
-	unsigned int stride = sizeof(Vertex);
-	unsigned int offset = 0;
-
-	// Set the vertex and index buffers to active in the input assembler so they can be rendered
-	deviceContext->IASetVertexBuffers(0, 1, &this->pVertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(this->pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+// Binds the first few of the vertex streams, however many the shader about to draw reads
+void Model::RenderBuffers(ID3D11DeviceContext* deviceContext, int streams) {
+	unsigned int strides[GEOMETRY_MAX_STREAMS];
+	unsigned int offsets[GEOMETRY_MAX_STREAMS] = {};
+	int streamCount = GetVertexStreams(strides);
+	if (streams > streamCount) streams = streamCount;
+
+	// Set the vertex and index buffers to active in the input assembler so they can be rendered.
+	// Pooled models skip this when the last model drawn was in the same page.
+	if (this->pGeometryPool) {
+		this->pGeometryPool->Bind(deviceContext, this->geometry.page, streams);
+	}
+	else {
+		deviceContext->IASetVertexBuffers(0, streams, this->pVertexBuffers, strides, offsets);
+		deviceContext->IASetIndexBuffer(this->pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	}
 
 	// This tells it to draw triangles. This might be fun to play around with.
 	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 }
 
-bool Model::LoadTexture(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, const char* filename) {
-	this->pTexture = new Texture();
-	return this->pTexture->Init(pDevice, pDeviceContext, filename);
-}
-
 void Model::ReleaseTexture() {
 	if (this->pTexture) {
 		this->pTexture->Shutdown();
 		delete this->pTexture;
 		this->pTexture = nullptr;
 	}
+	for (size_t i = 0; i < this->materialTextures.size(); i++) {
+		if (!this->materialTextures[i]) continue;
+		this->materialTextures[i]->Shutdown();
+		delete this->materialTextures[i];
+	}
+	this->materialTextures.clear();
+	this->materialTextureNames.clear();
 }
 
 void Model::ReleaseModel() {
@@ -2,14 +2,22 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
 #include <d3d11.h>
 #include <DirectXMath.h>
 #include <system_error>
 
 #include "Texture.h"
+#include "AssetArchive.h"
+#include "GeometryPool.h"
 
 static const int TOKENS_PER_ROW = 8;
 
+// Keeps vertex positions in a buffer of their own, with texture coords and normals in a second
+// one, so passes that only need positions (depth) fetch 12 bytes a vertex instead of all 32.
+// Off puts everything in the one interleaved buffer like it used to be.
+const bool SPLIT_VERTEX_STREAMS = true;
+
 /* This class is responsible for encapsulating the 3D geometry for models. */
 class Model {
 private:
@@ -19,35 +27,122 @@ private:
 		DirectX::XMFLOAT3 normal;
 	};
 
+	// The second stream when they're split, the first is just the positions
+	struct VertexAttributes {
+		DirectX::XMFLOAT2 texture;
+		DirectX::XMFLOAT3 normal;
+	};
+
 	struct ModelFileRow {
 		float posX, posY, posZ;
 		float texU, texV;
 		float normX, normY, normZ;
 	};
 
-	ID3D11Buffer* pVertexBuffer;
+	// A range of the index buffer drawn with one texture. Model files with materials list these
+	// after the vertices, anything else is a single submesh covering the whole buffer. Without
+	// a texture of its own (or if it wouldn't load) a submesh uses the model's.
+	struct Submesh {
+		int startIndex, indexCount;
+		std::string textureFilename; // relative to the model file
+		Texture* pTexture;           // owned by materialTextures, nullptr for the model's
+	};
+
+	// With a pool the model's geometry is a range of the pool's buffers, otherwise it has its
+	// own: a vertex buffer per stream and the index buffer
+	ID3D11Buffer* pVertexBuffers[GEOMETRY_MAX_STREAMS];
 	ID3D11Buffer* pIndexBuffer;
+	GeometryPool* pGeometryPool;
+	GeometryPool::Range geometry;
 	int vertexCount, indexCount;
 	Texture* pTexture;
 	ModelFileRow* fileRows;
+	std::string modelText;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned long> indices;
+	std::string modelDirectory;
+
+	// Each texture the submeshes name, once however many of them share it. Parallel vectors,
+	// a texture that failed to load stays in as nullptr so it isn't tried again.
+	std::vector<Submesh> submeshes;
+	std::vector<std::string> materialTextureNames;
+	std::vector<Texture*> materialTextures;
+	std::vector<int> materialHandles;
+
+	TextureResidency* pResidency;
+	int residencyHandle;
+	unsigned long long bufferBytes;
+
+	// Model-space bounds. The sphere is used to work out how big the model is on screen, the
+	// box's half extents are what a placeholder for the model gets scaled to.
+	DirectX::XMFLOAT3 boundsCenter;
+	DirectX::XMFLOAT3 boundsExtents;
+	float boundsRadius;
 
 	// These functions handle init and shutdown of the model's vertex and index buffers.
 	bool InitBuffers(ID3D11Device*);
 	void ShutdownBuffers();
-	void RenderBuffers(ID3D11DeviceContext*);
-	bool LoadTexture(ID3D11Device*, ID3D11DeviceContext*, const char*);
+	void RenderBuffers(ID3D11DeviceContext*, int);
+	void BuildVertices();
+	bool ParseSubmesh(const std::string&);
+	void LoadMaterialTextures();
+	void StreamTexture(ID3D11Device*, Texture*, int, float);
 	void ReleaseTexture();
-	bool LoadModel(std::string);
 	void ReleaseModel();
 
 public:
 	Model();
 
 	// These functions handle init and shutdown of the model's vertex and index buffers.
-	bool Init(ID3D11Device*, ID3D11DeviceContext*, const char*, std::string);
+	// The residency manager is optional, pass nullptr to load without a budget
+	bool Init(ID3D11Device*, ID3D11DeviceContext*, const char*, std::string, TextureResidency*);
 	void Shutdown();
 	void Render(ID3D11DeviceContext*);
 
+	// Binds only the positions, for shaders that read nothing else. With the streams split
+	// that's the small buffer, otherwise it's the interleaved one.
+	void RenderPositions(ID3D11DeviceContext*);
+
+	// Init's steps one at a time, for the startup load graph. The texture load, file read and
+	// parse only touch the CPU; CreateTexture/CreateBuffers/AttachResidency have to happen on
+	// the thread that owns device creation, after their inputs are ready.
+	bool LoadTextureData(const char*);
+	bool CreateTexture(ID3D11Device*, ID3D11DeviceContext*);
+	bool ReadModelFile(std::string);
+	bool ParseModel();
+	bool CreateMaterialTextures(ID3D11Device*, ID3D11DeviceContext*);
+	bool CreateBuffers(ID3D11Device*);
+	void AttachResidency(TextureResidency*);
+
+	// Has the buffers come out of the pool instead of being made just for this model. Set it
+	// before CreateBuffers (or InitBox).
+	void UseGeometryPool(GeometryPool*);
+
+	// Fills in the vertex size of each stream and returns how many streams there are
+	static int GetVertexStreams(unsigned int*);
+
+	// The file reads can also go through AssetIO so they're queued alongside everything else.
+	// Each calls its function with the result when the read is done, LoadTextureData and
+	// ParseModel then work from what was read.
+	void ReadTextureFile(AssetIO*, const char*, std::function<void(bool)>);
+	void ReadModelFile(AssetIO*, std::string, std::function<void(bool)>);
+
+	// A flat colored cube from -1 to 1 on every axis, built in code. Stands in for models that
+	// are still loading, scaled and moved onto their bounding box.
+	bool InitBox(ID3D11Device*, unsigned char, unsigned char, unsigned char);
+
 	int GetIndexCount();
 	ID3D11ShaderResourceView* GetTexture();
+
+	// Render binds the buffers (if they aren't already), then each submesh is a DrawIndexed
+	// of its range: start index, index count and base vertex
+	int GetSubmeshCount();
+	void GetSubmesh(int, int&, int&, int&, ID3D11ShaderResourceView*&);
+	void GetBoundingSphere(DirectX::XMFLOAT3&, float&);
+	void GetBoundingBox(DirectX::XMFLOAT3&, DirectX::XMFLOAT3&);
+
+	// Tells a streaming texture how many pixels the model covers on screen and lets it swap
+	// in (or drop) mips to match. Does nothing for textures that were loaded in full. Every
+	// submesh texture gets the same estimate since they all cover the same model.
+	void UpdateTexture(ID3D11Device*, float);
 };
\ No newline at end of file
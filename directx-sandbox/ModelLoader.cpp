@@ -0,0 +1,105 @@
+#include "ModelLoader.h"
+
+#include <stdio.h>
+
+ModelLoader::ModelLoader() {
+	this->pResidency = nullptr;
+	this->pGeometryPool = nullptr;
+}
+
+bool ModelLoader::Init(int threadCount, TextureResidency* pResidency, GeometryPool* pGeometryPool) {
+	this->pResidency = pResidency;
+	this->pGeometryPool = pGeometryPool;
+	return this->pool.Init(threadCount);
+}
+
+// Waits for loads that are already running, there's no cancelling a half read file
+void ModelLoader::Shutdown() {
+	this->pool.Shutdown();
+	for (size_t i = 0; i < this->requests.size(); i++) {
+		Request* pRequest = this->requests[i];
+		if (pRequest->pModel) {
+			pRequest->pModel->Shutdown();
+			delete pRequest->pModel;
+		}
+		delete pRequest;
+	}
+	this->requests.clear();
+}
+
+int ModelLoader::LoadAsync(const char* textureFilename, std::string modelFilename) {
+	Request* pRequest = new Request();
+	pRequest->textureFilename = textureFilename;
+	pRequest->modelFilename = modelFilename;
+	pRequest->pModel = new Model();
+	pRequest->pModel->UseGeometryPool(this->pGeometryPool);
+	pRequest->center = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	pRequest->extents = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	pRequest->state.store(STATE_LOADING);
+	pRequest->reported = false;
+	pRequest->startTime = std::chrono::steady_clock::now();
+
+	int handle = (int)this->requests.size();
+	this->requests.push_back(pRequest);
+	this->pool.Submit([this, pRequest] { LoadWorker(pRequest); });
+	return handle;
+}
+
+// Everything that only touches the CPU, the same steps the startup graph runs before its
+// CREATE tasks
+void ModelLoader::LoadWorker(Request* pRequest) {
+	Model* pModel = pRequest->pModel;
+	bool result = pModel->LoadTextureData(pRequest->textureFilename.c_str())
+		&& pModel->ReadModelFile(pRequest->modelFilename)
+		&& pModel->ParseModel();
+	if (result) pModel->GetBoundingBox(pRequest->center, pRequest->extents);
+	pRequest->state.store(result ? STATE_PARSED : STATE_FAILED, std::memory_order_release);
+}
+
+void ModelLoader::Poll(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext) {
+	int created = 0;
+	for (size_t i = 0; i < this->requests.size() && created < MODEL_CREATES_PER_FRAME; i++) {
+		Request* pRequest = this->requests[i];
+		int state = pRequest->state.load(std::memory_order_acquire);
+
+		// The model itself is left for Shutdown, the simulation thread may still be asking
+		// after this request
+		if (state == STATE_FAILED && !pRequest->reported) {
+			printf("ERROR: Background load of '%s' failed\n", pRequest->modelFilename.c_str());
+			pRequest->reported = true;
+			continue;
+		}
+		if (state != STATE_PARSED) continue;
+
+		Model* pModel = pRequest->pModel;
+		created++;
+		bool result = pModel->CreateTexture(pDevice, pDeviceContext)
+			&& pModel->CreateMaterialTextures(pDevice, pDeviceContext) && pModel->CreateBuffers(pDevice);
+		if (!result) {
+			pRequest->state.store(STATE_FAILED);
+			continue;
+		}
+		pModel->AttachResidency(this->pResidency);
+		pRequest->state.store(STATE_READY);
+
+		double ms = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - pRequest->startTime).count();
+		printf("Background load of '%s' ready after %.1f ms\n", pRequest->modelFilename.c_str(), ms);
+	}
+}
+
+ModelLoader::State ModelLoader::GetState(int handle) {
+	return (State)this->requests[handle]->state.load(std::memory_order_acquire);
+}
+
+Model* ModelLoader::GetModel(int handle) {
+	return GetState(handle) == STATE_READY ? this->requests[handle]->pModel : nullptr;
+}
+
+bool ModelLoader::GetBoundingBox(int handle, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extents) {
+	State state = GetState(handle);
+	if (state != STATE_PARSED && state != STATE_READY) return false;
+	center = this->requests[handle]->center;
+	extents = this->requests[handle]->extents;
+	return true;
+}
\ No newline at end of file
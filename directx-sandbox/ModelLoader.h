@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "Model.h"
+#include "WorkerPool.h"
+#include "TextureResidency.h"
+#include "GeometryPool.h"
+
+// Background threads for loads that happen while we're already rendering. Kept small so they
+// don't fight the main thread for cores.
+const int MODEL_LOAD_THREADS = 1;
+
+// How many finished loads get their D3D objects made per frame. Creating a texture uploads it
+// (and builds mips for .tga files), so doing a pile of them in one frame is exactly the hitch
+// we're trying to avoid.
+const int MODEL_CREATES_PER_FRAME = 1;
+
+/* Loads models in the background while the scene keeps rendering. LoadAsync hands back a
+ * handle straight away and the file read, texture decode and parse happen on a worker. Poll
+ * (once a frame, on the render thread) makes the D3D objects for whatever has finished, and
+ * until then GetModel returns nullptr so the caller draws something cheap in its place.
+ * GetState, GetModel and GetBoundingBox can be called from another thread than Poll's, so
+ * nothing a caller might be looking at is freed before Shutdown. */
+class ModelLoader {
+public:
+	enum State {
+		STATE_LOADING,  // still on the worker
+		STATE_PARSED,   // CPU side done, bounds are known, waiting for Poll to create it
+		STATE_READY,    // GetModel hands it out
+		STATE_FAILED,
+	};
+
+	ModelLoader();
+
+	// The geometry pool is optional like the residency manager, nullptr gives every model its
+	// own buffers
+	bool Init(int, TextureResidency*, GeometryPool*);
+	void Shutdown();
+
+	int LoadAsync(const char*, std::string);
+	void Poll(ID3D11Device*, ID3D11DeviceContext*);
+
+	State GetState(int);
+	Model* GetModel(int);
+
+	// Model-space bounding box of a load that has at least been parsed, false before that
+	bool GetBoundingBox(int, DirectX::XMFLOAT3&, DirectX::XMFLOAT3&);
+
+private:
+	struct Request {
+		std::string textureFilename;
+		std::string modelFilename;
+		Model* pModel;
+		// Copied out of the model by the worker, so they can be read while Poll is busy with it
+		DirectX::XMFLOAT3 center, extents;
+		// The worker's writes to pModel and the bounds are published by the release store of
+		// STATE_PARSED (or STATE_FAILED), so anyone who reads the state first can look at them.
+		std::atomic<int> state;
+		bool reported; // Poll's own, so a failure is only printed once
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	void LoadWorker(Request*);
+
+	WorkerPool pool;
+	std::vector<Request*> requests;
+	TextureResidency* pResidency;
+	GeometryPool* pGeometryPool;
+};
\ No newline at end of file
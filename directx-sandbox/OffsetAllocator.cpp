@@ -0,0 +1,230 @@
+#include "OffsetAllocator.h"
+
+#include <stddef.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static unsigned int lowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+static unsigned int highestBit(unsigned int mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return index;
+#else
+	return 31 - __builtin_clz(mask);
+#endif
+}
+
+// The lowest set bit at or above start, NO_SPACE if there isn't one
+static unsigned int lowestBitFrom(unsigned int mask, unsigned int start) {
+	unsigned int masked = start >= 32 ? 0 : mask & (0xFFFFFFFFu << start);
+	return masked ? lowestBit(masked) : OffsetAllocator::NO_SPACE;
+}
+
+OffsetAllocator::OffsetAllocator() {
+	this->size = 0;
+	this->maxAllocations = 0;
+	this->freeStorage = 0;
+	this->freeRangeCount = 0;
+	this->allocationCount = 0;
+	this->usedBinsTop = 0;
+	for (int i = 0; i < TOP_BINS; i++) this->usedBins[i] = 0;
+	for (int i = 0; i < BIN_COUNT; i++) this->binHeads[i] = NO_NODE;
+}
+
+void OffsetAllocator::Init(unsigned int size, unsigned int maxAllocations) {
+	this->size = size;
+	this->maxAllocations = maxAllocations;
+	// Every allocation can have a free range after it, plus one at the start
+	this->nodes.resize((size_t)maxAllocations * 2 + 1);
+	Reset();
+}
+
+void OffsetAllocator::Reset() {
+	this->freeStorage = 0;
+	this->freeRangeCount = 0;
+	this->allocationCount = 0;
+	this->usedBinsTop = 0;
+	for (int i = 0; i < TOP_BINS; i++) this->usedBins[i] = 0;
+	for (int i = 0; i < BIN_COUNT; i++) this->binHeads[i] = NO_NODE;
+
+	this->freeNodes.resize(this->nodes.size());
+	for (size_t i = 0; i < this->nodes.size(); i++) {
+		this->freeNodes[i] = (unsigned int)(this->nodes.size() - 1 - i);
+	}
+	if (this->size > 0) InsertFree(0, this->size);
+}
+
+// 3 bits of mantissa and the rest exponent, sizes under 8 get a bin each. Rounding up gives the
+// first bin where everything is big enough, rounding down the bin a range of that size goes in.
+unsigned int OffsetAllocator::SizeToBinRoundUp(unsigned int size) {
+	if (size < LEAF_BINS) return size;
+	unsigned int mantissaStart = highestBit(size) - 3;
+	unsigned int bin = ((mantissaStart + 1) << 3) + ((size >> mantissaStart) & 7);
+	if (size & ((1u << mantissaStart) - 1)) bin++; // carries into the exponent by itself
+	return bin;
+}
+
+unsigned int OffsetAllocator::SizeToBinRoundDown(unsigned int size) {
+	if (size < LEAF_BINS) return size;
+	unsigned int mantissaStart = highestBit(size) - 3;
+	return ((mantissaStart + 1) << 3) + ((size >> mantissaStart) & 7);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::Allocate(unsigned int size) {
+	Allocation allocation = { NO_SPACE, NO_NODE };
+	if (size == 0) size = 1;
+	if (this->allocationCount >= this->maxAllocations) return allocation;
+
+	// Smallest bin that's sure to fit, then the next bin up that has anything in it
+	unsigned int minBin = SizeToBinRoundUp(size);
+	unsigned int top = minBin >> 3;
+	unsigned int leaf = NO_SPACE;
+	if (top < TOP_BINS && (this->usedBinsTop & (1u << top))) leaf = lowestBitFrom(this->usedBins[top], minBin & 7);
+	if (leaf == NO_SPACE) top = lowestBitFrom(this->usedBinsTop, top + 1);
+	if (leaf == NO_SPACE && top != NO_SPACE) leaf = lowestBit(this->usedBins[top]);
+
+	unsigned int nodeIndex = NO_NODE;
+	if (leaf != NO_SPACE) {
+		nodeIndex = this->binHeads[(top << 3) | leaf];
+	}
+	else {
+		// Nothing's sure to fit, but the bin below can still have a range that does. Only
+		// worth a look when nearly full, so the walk doesn't cost anything the rest of the time.
+		unsigned int bin = SizeToBinRoundDown(size);
+		for (unsigned int i = this->binHeads[bin]; i != NO_NODE && nodeIndex == NO_NODE; i = this->nodes[i].binNext) {
+			if (this->nodes[i].size >= size) nodeIndex = i;
+		}
+		if (nodeIndex == NO_NODE) return allocation;
+	}
+
+	RemoveFree(nodeIndex);
+	Node& node = this->nodes[nodeIndex];
+	unsigned int remainder = node.size - size;
+	node.size = size;
+	node.used = true;
+
+	// What's left over goes back as a free range right after this one
+	if (remainder > 0) {
+		unsigned int restIndex = InsertFree(node.offset + size, remainder);
+		Node& rest = this->nodes[restIndex];
+		rest.neighborPrev = nodeIndex;
+		rest.neighborNext = node.neighborNext;
+		if (node.neighborNext != NO_NODE) this->nodes[node.neighborNext].neighborPrev = restIndex;
+		node.neighborNext = restIndex;
+	}
+
+	this->allocationCount++;
+	allocation.offset = node.offset;
+	allocation.node = nodeIndex;
+	return allocation;
+}
+
+void OffsetAllocator::Free(Allocation allocation) {
+	if (allocation.node == NO_NODE || allocation.node >= this->nodes.size()) return;
+	Node& node = this->nodes[allocation.node];
+	if (!node.used) return;
+
+	unsigned int offset = node.offset, size = node.size;
+	unsigned int prev = node.neighborPrev, next = node.neighborNext;
+	if (prev != NO_NODE && !this->nodes[prev].used) {
+		offset = this->nodes[prev].offset;
+		size += this->nodes[prev].size;
+		RemoveFree(prev);
+		this->freeNodes.push_back(prev);
+		prev = this->nodes[prev].neighborPrev;
+	}
+	if (next != NO_NODE && !this->nodes[next].used) {
+		size += this->nodes[next].size;
+		RemoveFree(next);
+		this->freeNodes.push_back(next);
+		next = this->nodes[next].neighborNext;
+	}
+	node.used = false;
+	this->freeNodes.push_back(allocation.node);
+
+	unsigned int mergedIndex = InsertFree(offset, size);
+	Node& merged = this->nodes[mergedIndex];
+	merged.neighborPrev = prev;
+	merged.neighborNext = next;
+	if (prev != NO_NODE) this->nodes[prev].neighborNext = mergedIndex;
+	if (next != NO_NODE) this->nodes[next].neighborPrev = mergedIndex;
+	this->allocationCount--;
+}
+
+unsigned int OffsetAllocator::GetSize() {
+	return this->size;
+}
+
+void OffsetAllocator::GetStats(Stats& stats) {
+	stats.totalFree = this->freeStorage;
+	stats.freeRanges = this->freeRangeCount;
+	stats.allocations = this->allocationCount;
+	stats.largestFree = 0;
+	if (!this->usedBinsTop) return;
+
+	// Everything in the highest bin is bigger than anything elsewhere, but the bin itself isn't
+	// sorted
+	unsigned int top = highestBit(this->usedBinsTop);
+	unsigned int bin = (top << 3) | highestBit(this->usedBins[top]);
+	for (unsigned int i = this->binHeads[bin]; i != NO_NODE; i = this->nodes[i].binNext) {
+		if (this->nodes[i].size > stats.largestFree) stats.largestFree = this->nodes[i].size;
+	}
+}
+
+float OffsetAllocator::GetFragmentation(const Stats& stats) {
+	if (stats.totalFree == 0) return 0.0f;
+	return 1.0f - (float)stats.largestFree / (float)stats.totalFree;
+}
+
+// Takes an unused node and puts it at the head of its bin's list. Neighbours are the caller's
+// to link up.
+unsigned int OffsetAllocator::InsertFree(unsigned int offset, unsigned int size) {
+	unsigned int index = this->freeNodes.back();
+	this->freeNodes.pop_back();
+
+	unsigned int bin = SizeToBinRoundDown(size);
+	Node& node = this->nodes[index];
+	node.offset = offset;
+	node.size = size;
+	node.used = false;
+	node.binPrev = NO_NODE;
+	node.binNext = this->binHeads[bin];
+	node.neighborPrev = NO_NODE;
+	node.neighborNext = NO_NODE;
+	if (node.binNext != NO_NODE) this->nodes[node.binNext].binPrev = index;
+	this->binHeads[bin] = index;
+
+	this->usedBins[bin >> 3] |= (unsigned char)(1u << (bin & 7));
+	this->usedBinsTop |= 1u << (bin >> 3);
+	this->freeStorage += size;
+	this->freeRangeCount++;
+	return index;
+}
+
+// Unlinks a free node from its bin, the node itself stays where it is
+void OffsetAllocator::RemoveFree(unsigned int index) {
+	Node& node = this->nodes[index];
+	unsigned int bin = SizeToBinRoundDown(node.size);
+	if (node.binPrev != NO_NODE) this->nodes[node.binPrev].binNext = node.binNext;
+	else this->binHeads[bin] = node.binNext;
+	if (node.binNext != NO_NODE) this->nodes[node.binNext].binPrev = node.binPrev;
+
+	if (this->binHeads[bin] == NO_NODE) {
+		this->usedBins[bin >> 3] &= (unsigned char)~(1u << (bin & 7));
+		if (!this->usedBins[bin >> 3]) this->usedBinsTop &= ~(1u << (bin >> 3));
+	}
+	this->freeStorage -= node.size;
+	this->freeRangeCount--;
+}
\ No newline at end of file
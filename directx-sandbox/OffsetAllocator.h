@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+/* Hands out ranges of some fixed size space (elements of a buffer, here) without touching the
+ * space itself. It's a TLSF style allocator: free ranges are kept in bins by size, the bin
+ * being the size rounded to a tiny float with 3 mantissa bits, so there are 8 bins for every
+ * power of two. Two levels of bitmasks say which bins have anything in them, which makes
+ * finding a big enough range a couple of bit scans however many ranges there are.
+ *
+ * Allocating takes the first range from the smallest bin that's guaranteed to fit (so it can
+ * waste up to 1/8 of a size class rather than searching a bin), and splits off what's left.
+ * Freeing merges the range with its free neighbours straight away, so the space never ends up
+ * in pieces smaller than what's been freed around them. */
+class OffsetAllocator {
+public:
+	static const unsigned int NO_SPACE = 0xFFFFFFFF;
+
+	struct Allocation {
+		unsigned int offset; // NO_SPACE when it didn't fit
+		unsigned int node;   // for Free
+	};
+
+	struct Stats {
+		unsigned int totalFree;
+		unsigned int largestFree;
+		unsigned int freeRanges;
+		unsigned int allocations;
+	};
+
+	OffsetAllocator();
+
+	// The space to manage and how many allocations can be live at once
+	void Init(unsigned int, unsigned int);
+	void Reset();
+
+	Allocation Allocate(unsigned int);
+	void Free(Allocation);
+
+	unsigned int GetSize();
+	void GetStats(Stats&);
+
+	// 0 when all the free space is one range, heading for 1 as it gets cut into many small ones
+	static float GetFragmentation(const Stats&);
+
+private:
+	static const unsigned int NO_NODE = 0xFFFFFFFF;
+	static const int TOP_BINS = 32;
+	static const int LEAF_BINS = 8;
+	static const int BIN_COUNT = TOP_BINS * LEAF_BINS;
+
+	struct Node {
+		unsigned int offset;
+		unsigned int size;
+		unsigned int binPrev, binNext;           // free list of the node's bin
+		unsigned int neighborPrev, neighborNext; // ranges on either side in the space
+		bool used;
+	};
+
+	static unsigned int SizeToBinRoundUp(unsigned int);
+	static unsigned int SizeToBinRoundDown(unsigned int);
+
+	unsigned int InsertFree(unsigned int, unsigned int);
+	void RemoveFree(unsigned int);
+
+	unsigned int size;
+	unsigned int maxAllocations;
+	unsigned int freeStorage;
+	unsigned int freeRangeCount;
+	unsigned int allocationCount;
+	unsigned int usedBinsTop;
+	unsigned char usedBins[TOP_BINS];
+	unsigned int binHeads[BIN_COUNT];
+	std::vector<Node> nodes;
+	std::vector<unsigned int> freeNodes; // stack of unused entries in nodes
+};
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "PipelineCounters.h"
+
+#include <stdio.h>
+
+PipelineCounters::PipelineCounters() {
+	for (int i = 0; i < PIPELINE_COUNTER_FRAMES; i++) {
+		this->frames[i].pStatistics = nullptr;
+		this->frames[i].pDisjoint = nullptr;
+		this->frames[i].pStart = nullptr;
+		this->frames[i].pEnd = nullptr;
+		this->frames[i].pending = false;
+		this->frames[i].discard = false;
+	}
+	this->nextFrame = 0;
+	this->activeFrame = -1;
+	Reset();
+}
+
+bool PipelineCounters::Init(ID3D11Device* pDevice) {
+	D3D11_QUERY_DESC statisticsDesc = { D3D11_QUERY_PIPELINE_STATISTICS, 0 };
+	D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+	for (int i = 0; i < PIPELINE_COUNTER_FRAMES; i++) {
+		Frame& frame = this->frames[i];
+		if (FAILED(pDevice->CreateQuery(&statisticsDesc, &frame.pStatistics))
+			|| FAILED(pDevice->CreateQuery(&disjointDesc, &frame.pDisjoint))
+			|| FAILED(pDevice->CreateQuery(&timestampDesc, &frame.pStart))
+			|| FAILED(pDevice->CreateQuery(&timestampDesc, &frame.pEnd)))
+		{
+			printf("ERROR: Failed to create the pipeline counter queries.\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+void PipelineCounters::Shutdown() {
+	for (int i = 0; i < PIPELINE_COUNTER_FRAMES; i++) {
+		Frame& frame = this->frames[i];
+		ID3D11Query** queries[] = { &frame.pStatistics, &frame.pDisjoint, &frame.pStart, &frame.pEnd };
+		for (ID3D11Query** ppQuery : queries) {
+			if (*ppQuery) (*ppQuery)->Release();
+			*ppQuery = nullptr;
+		}
+		frame.pending = false;
+	}
+}
+
+void PipelineCounters::Begin(ID3D11DeviceContext* pDeviceContext) {
+	this->activeFrame = -1;
+	Frame& frame = this->frames[this->nextFrame];
+	if (frame.pending || !frame.pStatistics) return;
+
+	pDeviceContext->Begin(frame.pDisjoint);
+	pDeviceContext->End(frame.pStart);
+	pDeviceContext->Begin(frame.pStatistics);
+	this->activeFrame = this->nextFrame;
+}
+
+void PipelineCounters::End(ID3D11DeviceContext* pDeviceContext) {
+	this->nextFrame = (this->nextFrame + 1) % PIPELINE_COUNTER_FRAMES;
+	if (this->activeFrame < 0) return;
+
+	Frame& frame = this->frames[this->activeFrame];
+	pDeviceContext->End(frame.pStatistics);
+	pDeviceContext->End(frame.pEnd);
+	pDeviceContext->End(frame.pDisjoint);
+	frame.pending = true;
+	frame.discard = false;
+	this->activeFrame = -1;
+}
+
+void PipelineCounters::Collect(ID3D11DeviceContext* pDeviceContext) {
+	for (int i = 0; i < PIPELINE_COUNTER_FRAMES; i++) {
+		Frame& frame = this->frames[i];
+		if (!frame.pending) continue;
+
+		// The disjoint query ends last, so once it's in so is everything else
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (pDeviceContext->GetData(frame.pDisjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) continue;
+		D3D11_QUERY_DATA_PIPELINE_STATISTICS statistics;
+		UINT64 start = 0, end = 0;
+		bool complete = pDeviceContext->GetData(frame.pStatistics, &statistics, sizeof(statistics), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK
+			&& pDeviceContext->GetData(frame.pStart, &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK
+			&& pDeviceContext->GetData(frame.pEnd, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+		if (!complete) continue;
+		frame.pending = false;
+		if (frame.discard) continue;
+
+		this->frameCount++;
+		this->vertexInvocations += statistics.VSInvocations;
+		this->pixelInvocations += statistics.PSInvocations;
+		this->primitives += statistics.CPrimitives;
+		// The clock can change speed partway through a frame, its time doesn't count then
+		if (!disjoint.Disjoint && disjoint.Frequency > 0) {
+			this->timedFrames++;
+			this->gpuMs += (double)(end - start) * 1000.0 / (double)disjoint.Frequency;
+		}
+	}
+}
+
+void PipelineCounters::Reset() {
+	for (int i = 0; i < PIPELINE_COUNTER_FRAMES; i++) {
+		if (this->frames[i].pending) this->frames[i].discard = true;
+	}
+	this->frameCount = 0;
+	this->timedFrames = 0;
+	this->vertexInvocations = 0;
+	this->pixelInvocations = 0;
+	this->primitives = 0;
+	this->gpuMs = 0.0;
+}
+
+unsigned long long PipelineCounters::GetFrameCount() {
+	return this->frameCount;
+}
+
+void PipelineCounters::PrintStats(const char* label) {
+	if (this->frameCount == 0) return;
+	double frames = (double)this->frameCount;
+	printf("%s: %llu frames, per frame %.0f pixel shader invocations, %.0f vertex shader invocations, "
+		"%.0f primitives, %.3f ms GPU\n",
+		label, this->frameCount, this->pixelInvocations / frames, this->vertexInvocations / frames,
+		this->primitives / frames, this->timedFrames ? this->gpuMs / (double)this->timedFrames : 0.0);
+}
\ No newline at end of file
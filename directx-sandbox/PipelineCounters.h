@@ -0,0 +1,51 @@
+#pragma once
+
+#include <d3d11.h>
+
+// Frames of queries in flight. The GPU runs a frame or two behind, so reading a frame's
+// results this many frames later doesn't wait on anything.
+const int PIPELINE_COUNTER_FRAMES = 4;
+
+/* What the GPU actually did over some frames: vertex and pixel shader invocations and
+ * primitives from a pipeline statistics query, and GPU time from a pair of timestamps. Begin
+ * and End go around a frame's drawing, Collect picks up the results of earlier frames that
+ * have finished without ever stalling on them. A frame whose queries are still out when its
+ * slot comes around again just isn't measured. */
+class PipelineCounters {
+public:
+	PipelineCounters();
+
+	bool Init(ID3D11Device*);
+	void Shutdown();
+
+	void Begin(ID3D11DeviceContext*);
+	void End(ID3D11DeviceContext*);
+	void Collect(ID3D11DeviceContext*);
+
+	// Starts counting again, dropping whatever frames are still in flight
+	void Reset();
+
+	unsigned long long GetFrameCount();
+	void PrintStats(const char*);
+
+private:
+	struct Frame {
+		ID3D11Query* pStatistics;
+		ID3D11Query* pDisjoint;
+		ID3D11Query* pStart;
+		ID3D11Query* pEnd;
+		bool pending;
+		bool discard;
+	};
+
+	Frame frames[PIPELINE_COUNTER_FRAMES];
+	int nextFrame;
+	int activeFrame; // -1 when this frame isn't being measured
+
+	unsigned long long frameCount;
+	unsigned long long timedFrames;
+	unsigned long long vertexInvocations;
+	unsigned long long pixelInvocations;
+	unsigned long long primitives;
+	double gpuMs;
+};
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "Scene.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MappedFile.h"
+
+Scene::Scene() {
+	this->pData = nullptr;
+	this->pHeader = nullptr;
+	this->pAssets = nullptr;
+	this->pInstances = nullptr;
+	this->pLights = nullptr;
+}
+
+Scene::~Scene() {
+	Close();
+}
+
+// Whether count items of the given size starting at offset all sit inside the file
+static bool sectionFits(unsigned long long offset, unsigned long long count, unsigned long long itemSize,
+	unsigned long long fileSize)
+{
+	return offset <= fileSize && offset % SCENE_SECTION_ALIGNMENT == 0 && count <= (fileSize - offset) / itemSize;
+}
+
+// Everything the accessors hand out is checked here once, so a damaged scene fails to load
+// rather than faulting halfway through building the entities
+bool Scene::Load(const char* filename) {
+	Close();
+	MappedFile file;
+	if (!file.Open(filename)) return false;
+
+	unsigned long long fileSize = file.GetSize();
+	if (fileSize < sizeof(SceneFileHeader) || ((const SceneFileHeader*)file.GetData())->magic != SCENE_MAGIC) {
+		printf("ERROR: '%s' isn't a compiled scene\n", filename);
+		return false;
+	}
+	this->pData = new unsigned long long[(size_t)((fileSize + 7) / 8)];
+	memcpy(this->pData, file.GetData(), (size_t)fileSize);
+	file.Close();
+
+	unsigned char* pFile = (unsigned char*)this->pData;
+	const SceneFileHeader* pHeader = (const SceneFileHeader*)pFile;
+	if (pHeader->version != SCENE_VERSION) {
+		printf("ERROR: '%s' is scene version %u, we read version %u\n", filename, pHeader->version, SCENE_VERSION);
+		Close();
+		return false;
+	}
+	if (!sectionFits(pHeader->assetsOffset, pHeader->assetCount, sizeof(SceneAsset), fileSize)
+		|| !sectionFits(pHeader->instancesOffset, pHeader->instanceCount, sizeof(SceneInstance), fileSize)
+		|| !sectionFits(pHeader->lightsOffset, pHeader->lightCount, sizeof(SceneLight), fileSize)
+		|| !sectionFits(pHeader->stringsOffset, pHeader->stringsSize, 1, fileSize)
+		|| (pHeader->stringsSize > 0 && pFile[pHeader->stringsOffset + pHeader->stringsSize - 1] != 0))
+	{
+		printf("ERROR: '%s' has a section that runs past the end of the file\n", filename);
+		Close();
+		return false;
+	}
+
+	// With the last string terminated, any offset inside the block is a whole string
+	SceneAsset* pAssets = (SceneAsset*)(pFile + pHeader->assetsOffset);
+	const char* pStrings = (const char*)(pFile + pHeader->stringsOffset);
+	for (unsigned int i = 0; i < pHeader->assetCount; i++) {
+		if (pAssets[i].modelOffset >= pHeader->stringsSize || pAssets[i].textureOffset >= pHeader->stringsSize) {
+			printf("ERROR: Asset %u of '%s' is damaged\n", i, filename);
+			Close();
+			return false;
+		}
+	}
+
+	// Parents have to come first so the caller can create everything in one pass
+	const SceneInstance* pInstances = (const SceneInstance*)(pFile + pHeader->instancesOffset);
+	for (unsigned int i = 0; i < pHeader->instanceCount; i++) {
+		const SceneInstance& instance = pInstances[i];
+		if (instance.asset >= pHeader->assetCount
+			|| (instance.parent != SCENE_NO_PARENT && (instance.parent < 0 || (unsigned int)instance.parent >= i)))
+		{
+			printf("ERROR: Instance %u of '%s' is damaged\n", i, filename);
+			Close();
+			return false;
+		}
+	}
+
+	for (unsigned int i = 0; i < pHeader->assetCount; i++) {
+		const char* pModelFilename = pStrings + pAssets[i].modelOffset;
+		const char* pTextureFilename = pStrings + pAssets[i].textureOffset;
+		pAssets[i].pModelFilename = pModelFilename;
+		pAssets[i].pTextureFilename = pTextureFilename;
+	}
+
+	this->pHeader = pHeader;
+	this->pAssets = pAssets;
+	this->pInstances = pInstances;
+	this->pLights = (const SceneLight*)(pFile + pHeader->lightsOffset);
+	return true;
+}
+
+void Scene::Close() {
+	delete[] this->pData;
+	this->pData = nullptr;
+	this->pHeader = nullptr;
+	this->pAssets = nullptr;
+	this->pInstances = nullptr;
+	this->pLights = nullptr;
+}
+
+const SceneCamera& Scene::GetCamera() {
+	return this->pHeader->camera;
+}
+
+int Scene::GetAssetCount() {
+	return this->pHeader ? (int)this->pHeader->assetCount : 0;
+}
+
+const SceneAsset* Scene::GetAssets() {
+	return this->pAssets;
+}
+
+int Scene::GetInstanceCount() {
+	return this->pHeader ? (int)this->pHeader->instanceCount : 0;
+}
+
+const SceneInstance* Scene::GetInstances() {
+	return this->pInstances;
+}
+
+int Scene::GetLightCount() {
+	return this->pHeader ? (int)this->pHeader->lightCount : 0;
+}
+
+const SceneLight* Scene::GetLights() {
+	return this->pLights;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "SceneFile.h"
+
+/* A compiled scene file, read whole into memory we own. Load checks every offset and index once
+ * and fixes up the asset filenames into pointers, after which everything is handed out straight
+ * from that one block: no per-instance allocations or parsing, however big the scene is.
+ *
+ * Goes through MappedFile, so scenes can come out of a mounted asset archive like everything
+ * else. */
+class Scene {
+public:
+	Scene();
+	~Scene();
+
+	bool Load(const char*);
+	void Close();
+
+	const SceneCamera& GetCamera();
+	int GetAssetCount();
+	const SceneAsset* GetAssets();
+	int GetInstanceCount();
+	const SceneInstance* GetInstances();
+	int GetLightCount();
+	const SceneLight* GetLights();
+
+private:
+	Scene(const Scene&);
+	Scene& operator=(const Scene&);
+
+	unsigned long long* pData; // 8 byte aligned for the header and assets
+	const SceneFileHeader* pHeader;
+	SceneAsset* pAssets;
+	const SceneInstance* pInstances;
+	const SceneLight* pLights;
+};
\ No newline at end of file
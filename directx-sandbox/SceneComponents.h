@@ -0,0 +1,92 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "EntityStore.h"
+
+class Model;
+
+// The components scene entities are made of, as EntityStore type numbers
+enum SceneComponentType {
+	COMPONENT_TRANSFORM,
+	COMPONENT_MODEL,
+	COMPONENT_BOUNDS,
+	COMPONENT_MATERIAL,
+	COMPONENT_LIGHT,
+	COMPONENT_SPIN,
+	COMPONENT_PENDING_MODEL,
+	SCENE_COMPONENT_TYPES
+};
+
+// Signature bits, or'd together for EntityStore::Create and Query
+const unsigned int HAS_TRANSFORM = 1u << COMPONENT_TRANSFORM;
+const unsigned int HAS_MODEL = 1u << COMPONENT_MODEL;
+const unsigned int HAS_BOUNDS = 1u << COMPONENT_BOUNDS;
+const unsigned int HAS_MATERIAL = 1u << COMPONENT_MATERIAL;
+const unsigned int HAS_LIGHT = 1u << COMPONENT_LIGHT;
+const unsigned int HAS_SPIN = 1u << COMPONENT_SPIN;
+const unsigned int HAS_PENDING_MODEL = 1u << COMPONENT_PENDING_MODEL;
+
+// Where it is, as an id in Graphics' TransformSystem
+struct TransformComponent {
+	static const int TYPE = COMPONENT_TRANSFORM;
+	int transform;
+};
+
+// What's drawn there. Graphics (or the loader) owns the model, entities only point at it, so
+// any number of them can share one.
+struct ModelComponent {
+	static const int TYPE = COMPONENT_MODEL;
+	Model* pModel;
+};
+
+// Model-space bounding sphere, for working out how big it is on screen
+struct BoundsComponent {
+	static const int TYPE = COMPONENT_BOUNDS;
+	DirectX::XMFLOAT3 center;
+	float radius;
+};
+
+// How shiny the surface is. Models drawn without one get DEFAULT_MATERIAL.
+struct MaterialComponent {
+	static const int TYPE = COMPONENT_MATERIAL;
+	DirectX::XMFLOAT4 specularColor;
+	float specularExp;
+};
+
+// A directional light. The lit pass uses the first one it finds.
+struct LightComponent {
+	static const int TYPE = COMPONENT_LIGHT;
+	DirectX::XMFLOAT3 direction;
+	DirectX::XMFLOAT4 diffuseColor;
+	DirectX::XMFLOAT4 ambientColor;
+};
+
+// Keeps the transform turning: each frame its rotation is set to the resting one followed by
+// the frame's rotation angle times spin, about y, x then z
+struct SpinComponent {
+	static const int TYPE = COMPONENT_SPIN;
+	DirectX::XMFLOAT4 rotation;
+	DirectX::XMFLOAT3 spin;
+};
+
+// A model still loading in the background (a ModelLoader handle), with the placeholder entity
+// that's drawn in its place until it's ready
+struct PendingModelComponent {
+	static const int TYPE = COMPONENT_PENDING_MODEL;
+	int load;
+	EntityStore::Entity placeholder;
+};
+
+const MaterialComponent DEFAULT_MATERIAL = { DirectX::XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f), 50.0f };
+
+// In SceneComponentType order, for EntityStore::Init
+const unsigned int SCENE_COMPONENT_SIZES[SCENE_COMPONENT_TYPES] = {
+	sizeof(TransformComponent),
+	sizeof(ModelComponent),
+	sizeof(BoundsComponent),
+	sizeof(MaterialComponent),
+	sizeof(LightComponent),
+	sizeof(SpinComponent),
+	sizeof(PendingModelComponent),
+};
\ No newline at end of file
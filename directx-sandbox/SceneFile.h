@@ -0,0 +1,77 @@
+#pragma once
+
+/* On-disk layout of a compiled scene (.scene), written by scene-compiler from its text form and
+ * read by Scene. The file is a header (camera included), then the assets (each model/texture
+ * pair the scene uses), the instances, the lights and finally the strings the assets name,
+ * each section 16 byte aligned. Everything is fixed size plain data, so loading is one read
+ * and turning the assets' string offsets into pointers.
+ *
+ * Instances refer to assets and to their parent by index. A parent always comes before its
+ * children, so they can be created in file order. */
+
+static const unsigned int SCENE_MAGIC = 0x454E4353; // "SCNE"
+static const unsigned int SCENE_VERSION = 1;
+
+static const unsigned int SCENE_SECTION_ALIGNMENT = 16;
+
+// SceneAsset::flags. Streamed assets load in the background after the first frame, with a
+// placeholder box drawn where they'll be until then.
+static const unsigned int SCENE_ASSET_STREAMED = 0x1;
+
+// SceneInstance::parent for instances at the top of the hierarchy
+static const int SCENE_NO_PARENT = -1;
+
+struct SceneCamera {
+	float position[3];
+	float rotation[3]; // degrees, as Camera::SetRotation takes them
+};
+
+struct SceneFileHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int assetCount;
+	unsigned int instanceCount;
+	unsigned int lightCount;
+	unsigned int reserved;
+	unsigned long long assetsOffset; // all from the start of the file
+	unsigned long long instancesOffset;
+	unsigned long long lightsOffset;
+	unsigned long long stringsOffset;
+	unsigned long long stringsSize;
+	SceneCamera camera;
+};
+
+// On disk the filenames are offsets into the strings, zero terminated. Scene swaps them for
+// pointers once it's checked them.
+struct SceneAsset {
+	union {
+		unsigned long long modelOffset;
+		const char* pModelFilename;
+	};
+	union {
+		unsigned long long textureOffset;
+		const char* pTextureFilename;
+	};
+	unsigned int flags;
+	unsigned int reserved;
+};
+
+// Local transform, applied scale, rotation (a quaternion) then translation like
+// TransformSystem does. Spin keeps it turning about y, x then z, in multiples of the frame's
+// rotation angle.
+struct SceneInstance {
+	unsigned int asset;
+	int parent;
+	float translation[3];
+	float rotation[4];
+	float scale[3];
+	float spin[3];
+	unsigned int reserved;
+};
+
+struct SceneLight {
+	float direction[3];
+	float diffuseColor[4];
+	float ambientColor[4];
+	unsigned int reserved;
+};
\ No newline at end of file
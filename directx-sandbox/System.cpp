@@ -7,6 +7,7 @@
 System::System() {
 	this->pInput = NULL;
 	this->pGraphics = NULL;
+	this->pFrames = NULL;
 }
 
 System::System(const System& other) {
@@ -42,10 +43,21 @@ bool System::Init() {
 	}
 	
 	bool result = this->pGraphics->Init(screenWidth, screenHeight, this->hWnd);
-	return result;
+	if (!result) return false;
+
+	this->pFrames = new FramePipeline();
+	return true;
 }
 
 void System::Shutdown() {
+	// The frame threads use the graphics object, so they're stopped before it goes
+	if (this->pFrames)
+	{
+		this->pFrames->Stop();
+		delete this->pFrames;
+		this->pFrames = NULL;
+	}
+
 	// Release the graphics object.
 	if (this->pGraphics)
 	{
@@ -70,45 +82,60 @@ void System::Run() {
 
 	ZeroMemory(&msg, sizeof(MSG));
 
+	// Frames are simulated and drawn on threads of their own from here on. This one only
+	// handles the window's messages, queueing key events for the simulation to sample at the
+	// start of each frame, so a slow frame can't hold up input.
+	Input* pInput = this->pInput;
+	Graphics* pGraphics = this->pGraphics;
+	this->pFrames->Start(
+		[pInput, pGraphics](FrameState& state) {
+			pInput->Sample(state.input);
+			if (state.input.WasPressed(VK_ESCAPE)) return false;
+			return pGraphics->Simulate(state);
+		},
+		[pGraphics](const FrameState& state) { return pGraphics->Submit(state); });
+
 	// Loop until there is a quit message from the window or the user.
 	while (!quit) {
-		// Check for system messages
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		// Check for system messages, everything that's come in
+		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
+			// Windows-signalled quit
+			if (msg.message == WM_QUIT)
+			{
+				quit = true;
+				break;
+			}
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 		}
+		if (quit) break;
 
-		// Windows-signalled quit
-		if (msg.message == WM_QUIT)
-		{
-			quit = true;
-			continue;
-		}
 		quit = Frame();
+		if (!quit) MsgWaitForMultipleObjects(0, NULL, FALSE, MESSAGE_WAIT_MS, QS_ALLINPUT);
 	}
+
+	this->pFrames->Stop();
 }
 
+// What's left of a frame on the window thread: deciding whether to quit, which the frame
+// threads do (Escape, or a draw failing) by stopping
 bool System::Frame() {
-	if (this->pInput->IsKeyDown(VK_ESCAPE)) {
-		return true;
-	}
-
-	// Pass off to Graphics processing
-	return this->pGraphics->Frame();
+	return !this->pFrames->IsRunning();
 }
 
 LRESULT CALLBACK System::MessageHandler(HWND hwnd, UINT umsg, WPARAM wparam, LPARAM lparam) {
 	switch (umsg)
 	{
 	case WM_KEYDOWN: {
-		// Send key presses to input object to record the state
-		this->pInput->KeyDown((unsigned int)wparam);
+		// Queued for the simulation. Bit 30 is set when the key was already down, so holding it
+		// isn't taken for a string of presses.
+		this->pInput->KeyDown((unsigned int)wparam, (lparam & (1 << 30)) != 0);
 		return 0;
 	}
 
 	case WM_KEYUP: {
-		// Send to input object to clear the state for that key
+		// Queued too, so the simulation sees the key go up in order
 		this->pInput->KeyUp((unsigned int)wparam);
 		return 0;
 	}
@@ -5,6 +5,11 @@
 
 #include "Input.h"
 #include "Graphics.h"
+#include "FramePipeline.h"
+
+// The window thread sleeps this long at most waiting for messages, before looking whether the
+// frame threads have stopped
+const int MESSAGE_WAIT_MS = 10;
 
 class System {
 public:
@@ -30,6 +35,7 @@ private:
 
 	Input* pInput;
 	Graphics* pGraphics;
+	FramePipeline* pFrames;
 };
 
 // Included so we can re-direct Windows messages to our MessageHandler
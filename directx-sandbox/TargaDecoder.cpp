@@ -0,0 +1,221 @@
+#include "TargaDecoder.h"
+#include <string.h>
+
+TargaDecoder::TargaDecoder() {
+	this->pFile = nullptr;
+	this->pReadBuf = nullptr;
+	this->pReadData = nullptr;
+	this->readPos = 0;
+	this->readEnd = 0;
+	this->bytesPerPixel = 0;
+	memset(&this->header, 0, sizeof(TargaHeader));
+}
+
+TargaDecoder::~TargaDecoder() {
+	Close();
+}
+
+bool TargaDecoder::Open(const char* filename) {
+	Close();
+
+	int error = fopen_s(&this->pFile, filename, "rb");
+	if (error != 0) {
+		printf("ERROR: error opening file, fopen_s returned %d\n", error);
+		this->pFile = nullptr;
+		return false;
+	}
+
+	this->pReadBuf = new unsigned char[READ_BUFFER_SIZE];
+	this->pReadData = this->pReadBuf;
+	this->readPos = 0;
+	this->readEnd = 0;
+	return ReadHeader(filename);
+}
+
+bool TargaDecoder::OpenMemory(const unsigned char* pData, unsigned int size, const char* filename) {
+	Close();
+
+	this->pReadData = pData;
+	this->readPos = 0;
+	this->readEnd = size;
+	return ReadHeader(filename);
+}
+
+// Reads and checks the header, leaving the read position at the first pixel
+bool TargaDecoder::ReadHeader(const char* filename) {
+	if (!ReadBytes((unsigned char*)&this->header, sizeof(TargaHeader))) {
+		printf("ERROR: \"%s\" is too short to hold a targa header\n", filename);
+		Close();
+		return false;
+	}
+
+	int imageType = (int)this->header.imageType;
+	if (imageType != IMAGE_TYPE_TRUECOLOR && imageType != IMAGE_TYPE_TRUECOLOR_RLE) {
+		printf("ERROR: Unsupported targa image type in \"%s\": %d. Only true-color raw (2) " \
+			"and RLE (10) are supported.\n", filename, imageType);
+		Close();
+		return false;
+	}
+
+	int bpp = (int)this->header.bpp;
+	if (bpp != 24 && bpp != 32) {
+		printf("ERROR: Read in an unexpected bpp from \"%s\": %d\n", filename, bpp);
+		Close();
+		return false;
+	}
+	this->bytesPerPixel = bpp / 8;
+
+	if (this->header.width == 0 || this->header.height == 0) {
+		printf("ERROR: \"%s\" has an empty image (%dx%d)\n", filename,
+			(int)this->header.width, (int)this->header.height);
+		Close();
+		return false;
+	}
+
+	// The image ID and (unused for true-color) color map sit between the header and the pixels
+	unsigned int colorMapBytes = 0;
+	if (this->header.colorMapType != 0) {
+		colorMapBytes = (unsigned int)this->header.colorMapLength
+			* (((unsigned int)this->header.colorMapDepth + 7) / 8);
+	}
+	if (!SkipBytes((unsigned int)this->header.idLength + colorMapBytes)) {
+		printf("ERROR: \"%s\" ended before the pixel data\n", filename);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool TargaDecoder::Decode(unsigned char* pDest, unsigned int destRowPitch) {
+	if (!this->pReadData) {
+		printf("ERROR: TargaDecoder::Decode called without an open file\n");
+		return false;
+	}
+
+	int width = GetWidth(), height = GetHeight();
+	int bytesPerPixel = this->bytesPerPixel;
+
+	// Descriptor bit 5 set means rows are stored top-down and bit 4 set means right-to-left.
+	// Most files are bottom-up, which is why the old loader always flipped.
+	bool topOrigin = (this->header.descriptor & 0x20) != 0;
+	bool rightOrigin = (this->header.descriptor & 0x10) != 0;
+
+	unsigned char pixel[4] = { 0, 0, 0, 255 };
+	int packetRemaining = 0;
+	bool packetIsRun = false;
+
+	for (int row = 0; row < height; row++) {
+		int destRow = topOrigin ? row : (height - 1 - row);
+		unsigned char* pDestRow = pDest + (size_t)destRow * destRowPitch;
+
+		for (int col = 0; col < width; col++) {
+			if (!IsCompressed()) {
+				if (!ReadBytes(pixel, bytesPerPixel)) {
+					printf("ERROR: Targa pixel data ended early at row %d\n", row);
+					return false;
+				}
+			}
+			else {
+				// RLE packets may cross scanlines, so the packet state carries across rows
+				if (packetRemaining == 0) {
+					unsigned char packetHeader;
+					if (!ReadBytes(&packetHeader, 1)) {
+						printf("ERROR: Targa RLE data ended early at row %d\n", row);
+						return false;
+					}
+					packetIsRun = (packetHeader & 0x80) != 0;
+					packetRemaining = (packetHeader & 0x7F) + 1;
+
+					// A run packet has one pixel value that gets repeated
+					if (packetIsRun && !ReadBytes(pixel, bytesPerPixel)) {
+						printf("ERROR: Targa RLE data ended early at row %d\n", row);
+						return false;
+					}
+				}
+
+				if (!packetIsRun && !ReadBytes(pixel, bytesPerPixel)) {
+					printf("ERROR: Targa RLE data ended early at row %d\n", row);
+					return false;
+				}
+				packetRemaining--;
+			}
+
+			// Targa stores BGR(A), we want RGBA. 24-bit images get an opaque alpha.
+			unsigned char* pOut = pDestRow + (rightOrigin ? (width - 1 - col) : col) * 4;
+			pOut[0] = pixel[2];
+			pOut[1] = pixel[1];
+			pOut[2] = pixel[0];
+			pOut[3] = (bytesPerPixel == 4) ? pixel[3] : 255;
+		}
+	}
+
+	return true;
+}
+
+void TargaDecoder::Close() {
+	if (this->pFile) {
+		int error = fclose(this->pFile);
+		if (error != 0) printf("ERROR: error closing file, fclose returned %d\n", error);
+		this->pFile = nullptr;
+	}
+
+	if (this->pReadBuf) {
+		delete[] this->pReadBuf;
+		this->pReadBuf = nullptr;
+	}
+	this->pReadData = nullptr;
+	this->readPos = 0;
+	this->readEnd = 0;
+}
+
+int TargaDecoder::GetWidth() {
+	return (int)this->header.width;
+}
+
+int TargaDecoder::GetHeight() {
+	return (int)this->header.height;
+}
+
+int TargaDecoder::GetBpp() {
+	return (int)this->header.bpp;
+}
+
+bool TargaDecoder::IsCompressed() {
+	return this->header.imageType == IMAGE_TYPE_TRUECOLOR_RLE;
+}
+
+// Pulls the next chunk of the file into the read buffer. Returns false at end of file, which
+// for a file in memory is as soon as we've used it all.
+bool TargaDecoder::Refill() {
+	if (!this->pFile) return false;
+	this->readPos = 0;
+	this->readEnd = (unsigned int)fread(this->pReadBuf, 1, READ_BUFFER_SIZE, this->pFile);
+	return this->readEnd > 0;
+}
+
+bool TargaDecoder::ReadBytes(unsigned char* pOut, unsigned int count) {
+	while (count > 0) {
+		if (this->readPos == this->readEnd && !Refill()) return false;
+
+		unsigned int available = this->readEnd - this->readPos;
+		unsigned int toCopy = count < available ? count : available;
+		memcpy(pOut, this->pReadData + this->readPos, toCopy);
+		this->readPos += toCopy;
+		pOut += toCopy;
+		count -= toCopy;
+	}
+	return true;
+}
+
+bool TargaDecoder::SkipBytes(unsigned int count) {
+	while (count > 0) {
+		if (this->readPos == this->readEnd && !Refill()) return false;
+
+		unsigned int available = this->readEnd - this->readPos;
+		unsigned int toSkip = count < available ? count : available;
+		this->readPos += toSkip;
+		count -= toSkip;
+	}
+	return true;
+}
\ No newline at end of file
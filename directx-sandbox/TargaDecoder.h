@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdio.h>
+
+/* Streaming decoder for .tga files. Handles uncompressed (type 2) and RLE (type 10) true-color
+ * images at 24 or 32 bpp and writes them straight into an RGBA8 destination. Only a small read
+ * buffer is held at a time so we never have the whole (compressed) file in memory. */
+class TargaDecoder {
+private:
+	// This is the .tga file header structure. It has to be packed since the colormap spec
+	// fields sit at odd offsets, otherwise the compiler pads it out past the 18 bytes on disk.
+#pragma pack(push, 1)
+	struct TargaHeader {
+		unsigned char idLength;
+		unsigned char colorMapType;
+		unsigned char imageType;
+		unsigned short colorMapOrigin;
+		unsigned short colorMapLength;
+		unsigned char colorMapDepth;
+		unsigned short xOrigin;
+		unsigned short yOrigin;
+		unsigned short width;
+		unsigned short height;
+		unsigned char bpp;
+		unsigned char descriptor;
+	};
+#pragma pack(pop)
+
+	static const int IMAGE_TYPE_TRUECOLOR = 2;
+	static const int IMAGE_TYPE_TRUECOLOR_RLE = 10;
+	static const unsigned int READ_BUFFER_SIZE = 64 * 1024;
+
+	bool ReadHeader(const char*);
+	bool Refill();
+	bool ReadBytes(unsigned char*, unsigned int);
+	bool SkipBytes(unsigned int);
+
+	FILE* pFile;
+	TargaHeader header;
+	unsigned char* pReadBuf;
+	// Where the bytes come from: pReadBuf for a file, the caller's memory for OpenMemory
+	const unsigned char* pReadData;
+	unsigned int readPos, readEnd;
+	int bytesPerPixel;
+
+public:
+	TargaDecoder();
+	~TargaDecoder();
+
+	// Open reads and validates the header. Decode then expands the pixels into pDest, which
+	// must hold height rows of at least width * 4 bytes spaced destRowPitch bytes apart. Row 0
+	// of the destination is always the top of the image regardless of the file's origin.
+	bool Open(const char*);
+	// Same as Open for a file that's already in memory. The memory has to outlive Decode, the
+	// name is only for error messages.
+	bool OpenMemory(const unsigned char*, unsigned int, const char*);
+	bool Decode(unsigned char*, unsigned int);
+	void Close();
+
+	int GetWidth();
+	int GetHeight();
+	int GetBpp();
+	bool IsCompressed();
+};
\ No newline at end of file
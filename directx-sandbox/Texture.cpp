@@ -1,22 +1,244 @@
 #include "Texture.h"
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
 
 Texture::Texture() {
 	this->pTargaData = nullptr;		// Raw loaded .tga data
+	this->pFileBuffer = nullptr;	// The file itself, when Read got it for us
+	this->prebuilt = false;
 	this->pTexture = nullptr;		// Actual DirectX texture
 	this->pTextureView = nullptr;	// ?? Mystery
+	this->streaming = false;
+	this->tailMip = this->residentMip = this->desiredMip = this->residencyMip = 0;
+	ZeroMemory(&this->footprint, sizeof(this->footprint));
+	this->dropFrames = 0;
+	this->streamBusy = false;
+	this->streamReady = false;
+	this->pendingMip = 0;
+	this->pPendingTexture = nullptr;
+	this->pPendingView = nullptr;
 }
 
 Texture::~Texture() {
 }
 
+static void InitPrebuiltDesc(D3D11_TEXTURE2D_DESC&);
+
+// True if the filename ends with the given extension (case-sensitive, extension includes the dot)
+static bool HasExtension(const char* filename, const char* extension) {
+	size_t nameLen = strlen(filename), extLen = strlen(extension);
+	return nameLen >= extLen && strcmp(filename + nameLen - extLen, extension) == 0;
+}
+
+// Works out how a DXGI format is laid out in memory: either 4x4 blocks of blockBytes each, or
+// single texels of blockBytes each. Returns false for formats we don't know how to size.
+static bool GetFormatLayout(DXGI_FORMAT format, bool& blockCompressed, unsigned int& blockBytes) {
+	blockCompressed = false;
+	switch (format) {
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		blockCompressed = true;
+		blockBytes = 8;
+		return true;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockCompressed = true;
+		blockBytes = 16;
+		return true;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: case DXGI_FORMAT_R32G32B32A32_UINT:
+		blockBytes = 16;
+		return true;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		blockBytes = 8;
+		return true;
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS: case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_R10G10B10A2_UNORM: case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R16G16_FLOAT: case DXGI_FORMAT_R16G16_UNORM: case DXGI_FORMAT_R32_FLOAT:
+		blockBytes = 4;
+		return true;
+	case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM:
+		blockBytes = 2;
+		return true;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		blockBytes = 1;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Halves an RGBA8 image with a 2x2 box filter. The SSE loop does two output texels at a time
+// (one 16 byte load from each source row); odd edges and 1-texel-wide images fall back to the
+// scalar path, which clamps its reads so a 1xN image still averages down properly.
+static void DownsampleBox2x2(const unsigned char* pSrc, int width, int height, unsigned char* pDest) {
+	int halfWidth = width > 1 ? width / 2 : 1, halfHeight = height > 1 ? height / 2 : 1;
+	const __m128i zero = _mm_setzero_si128(), rounding = _mm_set1_epi16(2);
+
+	for (int y = 0; y < halfHeight; y++) {
+		int y0 = y * 2 < height ? y * 2 : height - 1, y1 = y * 2 + 1 < height ? y * 2 + 1 : height - 1;
+		const unsigned char* pRow0 = pSrc + (size_t)y0 * width * 4;
+		const unsigned char* pRow1 = pSrc + (size_t)y1 * width * 4;
+		unsigned char* pOut = pDest + (size_t)y * halfWidth * 4;
+
+		int x = 0;
+		if (width > 1) {
+			for (; x + 2 <= halfWidth; x += 2) {
+				__m128i a = _mm_loadu_si128((const __m128i*)(pRow0 + x * 8));
+				__m128i b = _mm_loadu_si128((const __m128i*)(pRow1 + x * 8));
+				// Widen to 16 bits and add the rows: lo holds texels 0,1 and hi holds 2,3
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				// Then add neighbouring texels
+				lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+				hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+				__m128i sum = _mm_unpacklo_epi64(lo, hi);
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+				_mm_storel_epi64((__m128i*)(pOut + x * 4), _mm_packus_epi16(sum, zero));
+			}
+		}
+		for (; x < halfWidth; x++) {
+			int x0 = x * 2 < width ? x * 2 : width - 1, x1 = x * 2 + 1 < width ? x * 2 + 1 : width - 1;
+			for (int c = 0; c < 4; c++) {
+				int sum = pRow0[x0 * 4 + c] + pRow0[x1 * 4 + c] + pRow1[x0 * 4 + c] + pRow1[x1 * 4 + c];
+				pOut[x * 4 + c] = (unsigned char)((sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+// Only .tga files are read whole. Cooked and DDS files are mapped by Load instead, their levels
+// get used straight out of the file and reading them into a buffer would just be a copy.
+void Texture::Read(AssetIO* pIO, const char* filename, std::function<void(bool)> done) {
+	if (HasExtension(filename, ".ctex") || HasExtension(filename, ".dds")) {
+		done(true);
+		return;
+	}
+	pIO->Read(filename, [this, done](AssetBuffer* pBuffer) {
+		this->pFileBuffer = pBuffer;
+		done(pBuffer != nullptr);
+	});
+}
+
 bool Texture::Init(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const char* filename) {
+	return Load(filename) && Create(device, deviceContext);
+}
+
+// Everything up to the point where we need the device: reading, decoding, parsing headers and
+// skipping mips. Nothing here touches D3D, so it's safe to run on a worker thread.
+bool Texture::Load(const char* filename) {
+	bool cooked = HasExtension(filename, ".ctex");
+	this->prebuilt = cooked || HasExtension(filename, ".dds");
+	if (!this->prebuilt) return LoadTargaData(filename);
+
+	bool result = cooked ? LoadCooked(filename) : LoadDds(filename);
+	if (!result) {
+		printf("ERROR: Failed to load %s texture \"%s\"\n", cooked ? "cooked" : "DDS", filename);
+		this->mappedFile.Close();
+		this->subresources.clear();
+		return false;
+	}
+	// A texture we can't size would count as nothing against the residency budget, so one
+	// doesn't get through even if a loader lets it
+	if (!GetFormatLayout(this->prebuiltDesc.Format, this->footprint.blockCompressed, this->footprint.blockBytes)) {
+		printf("ERROR: Can't work out how big texture \"%s\" is (DXGI format %d)\n", filename, (int)this->prebuiltDesc.Format);
+		this->mappedFile.Close();
+		this->subresources.clear();
+		return false;
+	}
+	SkipTopMips(TEXTURE_SKIP_MIPS);
+	printf("%s texture loaded from \"%s\" (%ux%u, %u mips, %u slices)!\n", cooked ? "Cooked" : "DDS",
+		filename, this->prebuiltDesc.Width, this->prebuiltDesc.Height,
+		this->prebuiltDesc.MipLevels, this->prebuiltDesc.ArraySize);
+
+	this->footprint.width = this->prebuiltDesc.Width;
+	this->footprint.height = this->prebuiltDesc.Height;
+	this->footprint.mipCount = this->prebuiltDesc.MipLevels;
+	this->footprint.arraySize = this->prebuiltDesc.ArraySize;
+	this->footprint.coarsestMip = 0; // InitStreaming raises this to the tail
+	return true;
+}
+
+// Makes the D3D objects out of what Load left behind. Has to come after a successful Load.
+bool Texture::Create(ID3D11Device* device, ID3D11DeviceContext* deviceContext) {
+	if (!this->prebuilt) return InitTarga(device, deviceContext);
+	if (TEXTURE_STREAMING && this->prebuiltDesc.MipLevels > 1) return InitStreaming(device);
+	return InitPrebuilt(device);
+}
+
+// Goes through the prebuilt path with a single level that lives on our stack, InitPrebuilt
+// drops the subresource pointer once the texture is created
+bool Texture::InitSolid(ID3D11Device* device, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+	unsigned char texel[4] = { r, g, b, a };
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = texel;
+	data.SysMemPitch = sizeof(texel);
+	data.SysMemSlicePitch = sizeof(texel);
+
+	InitPrebuiltDesc(this->prebuiltDesc);
+	this->prebuiltDesc.Width = 1;
+	this->prebuiltDesc.Height = 1;
+	this->prebuiltDesc.MipLevels = 1;
+	this->prebuiltDesc.ArraySize = 1;
+	this->prebuiltDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	this->subresources.assign(1, data);
+	this->prebuilt = true;
+
+	this->footprint.width = this->footprint.height = 1;
+	this->footprint.mipCount = 1;
+	this->footprint.arraySize = 1;
+	this->footprint.blockBytes = 4;
+	this->footprint.blockCompressed = false;
+	this->footprint.coarsestMip = 0;
+
+	return InitPrebuilt(device);
+}
+
+bool Texture::LoadTargaData(const char* filename) {
 	int width, height;
 	bool result = LoadTarga(filename, height, width);
 	if (!result) {
 		printf("ERROR: Failed to load Targa \"%s\"\n", filename);
 		return false;
 	}
-	printf("Targa loaded from \"%s\"!\n", filename);
+
+	// No mips in the file, so to skip levels we have to make the smaller image ourselves
+	for (int skip = 0; skip < TEXTURE_SKIP_MIPS && (width > 1 || height > 1); skip++) {
+		int halfWidth = width > 1 ? width / 2 : 1, halfHeight = height > 1 ? height / 2 : 1;
+		unsigned char* pHalf = new unsigned char[halfWidth * halfHeight * 4];
+		DownsampleBox2x2(this->pTargaData, width, height, pHalf);
+		delete[] this->pTargaData;
+		this->pTargaData = pHalf;
+		width = halfWidth;
+		height = halfHeight;
+	}
+	printf("Targa loaded from \"%s\" (%dx%d)!\n", filename, width, height);
+
+	// GenerateMips fills a full chain down to 1x1
+	this->footprint.width = width;
+	this->footprint.height = height;
+	this->footprint.mipCount = 1;
+	for (int w = width, h = height; w > 1 || h > 1; this->footprint.mipCount++) {
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	this->footprint.arraySize = 1;
+	this->footprint.blockBytes = 4;
+	this->footprint.blockCompressed = false;
+	this->footprint.coarsestMip = 0;
+	return true;
+}
+
+bool Texture::InitTarga(ID3D11Device* device, ID3D11DeviceContext* deviceContext) {
+	int width = this->footprint.width, height = this->footprint.height;
 	D3D11_TEXTURE2D_DESC textureDesc;
 	textureDesc.Height = height;
 	textureDesc.Width = width;
@@ -67,7 +289,247 @@ bool Texture::Init(ID3D11Device* device, ID3D11DeviceContext* deviceContext, con
 	return true;
 }
 
+// Creates the texture from the description and subresources a Load_() function filled in.
+// The subresources point into the file mapping, so nothing gets copied on our side.
+bool Texture::InitPrebuilt(ID3D11Device* device) {
+	bool result = CreateFromMip(device, 0, &this->pTexture, &this->pTextureView);
+
+	// The GPU has its own copy now (or failed to make one), either way we're done with the file
+	this->subresources.clear();
+	this->mappedFile.Close();
+
+	return result;
+}
+
+// Drops the largest levels of a loaded prebuilt texture by pointing the description at a
+// smaller mip. The skipped levels' pages in the mapping are never touched, so they're never
+// read from disk. Always keeps at least one level, and for BC formats the new top has to be
+// whole 4x4 blocks.
+void Texture::SkipTopMips(int skip) {
+	if (skip > (int)this->prebuiltDesc.MipLevels - 1) skip = this->prebuiltDesc.MipLevels - 1;
+	skip = GetCoarsestTopMip(skip);
+	if (skip <= 0) return;
+
+	unsigned int mipCount = this->prebuiltDesc.MipLevels;
+	std::vector<D3D11_SUBRESOURCE_DATA> kept;
+	kept.reserve((size_t)this->prebuiltDesc.ArraySize * (mipCount - skip));
+	for (unsigned int slice = 0; slice < this->prebuiltDesc.ArraySize; slice++) {
+		const D3D11_SUBRESOURCE_DATA* pSlice = &this->subresources[(size_t)slice * mipCount];
+		kept.insert(kept.end(), pSlice + skip, pSlice + mipCount);
+	}
+	this->subresources.swap(kept);
+
+	this->prebuiltDesc.Width = this->prebuiltDesc.Width >> skip > 0 ? this->prebuiltDesc.Width >> skip : 1;
+	this->prebuiltDesc.Height = this->prebuiltDesc.Height >> skip > 0 ? this->prebuiltDesc.Height >> skip : 1;
+	this->prebuiltDesc.MipLevels = mipCount - skip;
+}
+
+// Uploads just the mip tail so the texture is usable right away. Everything finer gets
+// streamed in later by UpdateStreaming once something asks for it.
+bool Texture::InitStreaming(ID3D11Device* device) {
+	int mip = 0;
+	while (mip + 1 < (int)this->prebuiltDesc.MipLevels
+		&& ((this->prebuiltDesc.Width >> mip) > STREAMING_TAIL_SIZE
+			|| (this->prebuiltDesc.Height >> mip) > STREAMING_TAIL_SIZE))
+	{
+		mip++;
+	}
+	this->tailMip = GetCoarsestTopMip(mip);
+
+	if (!CreateFromMip(device, this->tailMip, &this->pTexture, &this->pTextureView)) {
+		this->subresources.clear();
+		this->mappedFile.Close();
+		return false;
+	}
+
+	this->streaming = this->tailMip > 0;
+	this->residentMip = this->desiredMip = this->tailMip;
+	this->footprint.coarsestMip = this->tailMip;
+	if (!this->streaming) {
+		// The whole thing is the tail, nothing left to stream
+		this->subresources.clear();
+		this->mappedFile.Close();
+	}
+	printf("Streaming texture: mips %d..%u resident, %d finer mips on demand\n", this->tailMip,
+		this->prebuiltDesc.MipLevels - 1, this->tailMip);
+	return true;
+}
+
+// Walks up from mip toward mip 0 until the level can be the top of a texture. Block-compressed
+// textures need their top level in whole 4x4 blocks.
+int Texture::GetCoarsestTopMip(int mip) {
+	bool blockCompressed;
+	unsigned int blockBytes;
+	if (!GetFormatLayout(this->prebuiltDesc.Format, blockCompressed, blockBytes) || !blockCompressed) return mip;
+
+	while (mip > 0 && (((this->prebuiltDesc.Width >> mip) % 4) != 0 || ((this->prebuiltDesc.Height >> mip) % 4) != 0)) {
+		mip--;
+	}
+	return mip;
+}
+
+bool Texture::CreateFromMip(ID3D11Device* device, int firstMip,
+	ID3D11Texture2D** ppTexture, ID3D11ShaderResourceView** ppView)
+{
+	D3D11_TEXTURE2D_DESC desc = this->prebuiltDesc;
+	desc.Width = desc.Width >> firstMip > 0 ? desc.Width >> firstMip : 1;
+	desc.Height = desc.Height >> firstMip > 0 ? desc.Height >> firstMip : 1;
+	desc.MipLevels = this->prebuiltDesc.MipLevels - firstMip;
+
+	// Subresources are slice-major, so each slice contributes its levels from firstMip down
+	std::vector<D3D11_SUBRESOURCE_DATA> levels;
+	levels.reserve((size_t)desc.ArraySize * desc.MipLevels);
+	for (unsigned int slice = 0; slice < desc.ArraySize; slice++) {
+		const D3D11_SUBRESOURCE_DATA* pSlice = &this->subresources[(size_t)slice * this->prebuiltDesc.MipLevels];
+		levels.insert(levels.end(), pSlice + firstMip, pSlice + this->prebuiltDesc.MipLevels);
+	}
+
+	HRESULT hResult = device->CreateTexture2D(&desc, levels.data(), ppTexture);
+	if (FAILED(hResult)) {
+		printf("ERROR: Failed to create Texture2D from prebuilt levels.\n");
+		return false;
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = desc.Format;
+	if (desc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MostDetailedMip = 0;
+		srvDesc.TextureCube.MipLevels = -1;
+	}
+	else if (desc.ArraySize > 1) {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = -1;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+	}
+	else {
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = -1;
+	}
+
+	hResult = device->CreateShaderResourceView(*ppTexture, &srvDesc, ppView);
+	if (FAILED(hResult)) {
+		printf("ERROR: Failed to create shader resource view.\n");
+		(*ppTexture)->Release();
+		*ppTexture = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+// Runs on the stream thread. The device is free-threaded (we don't create it with
+// D3D11_CREATE_DEVICE_SINGLETHREADED), so building the new texture here is fine; the page
+// faults on the mapped file and the driver's copy both happen off the render thread. Only the
+// swap in UpdateStreaming touches what the renderer sees.
+void Texture::StreamWorker(ID3D11Device* device, int firstMip) {
+	if (!CreateFromMip(device, firstMip, &this->pPendingTexture, &this->pPendingView)) {
+		this->pPendingTexture = nullptr;
+		this->pPendingView = nullptr;
+	}
+	this->streamReady = true;
+}
+
+int Texture::ComputeDesiredMip(float screenPixels) {
+	if (!this->streaming) return 0;
+
+	// One texel per pixel is enough, so each halving of on-screen size is one more mip we can skip
+	float texels = (float)(this->prebuiltDesc.Width > this->prebuiltDesc.Height
+		? this->prebuiltDesc.Width : this->prebuiltDesc.Height);
+	if (screenPixels < 1.0f) screenPixels = 1.0f;
+	int mip = (int)floorf(log2f(texels / screenPixels));
+	return mip < 0 ? 0 : (mip > this->tailMip ? this->tailMip : mip);
+}
+
+void Texture::SetDesiredMip(int mip) {
+	if (mip < this->residencyMip) mip = this->residencyMip;
+	this->desiredMip = GetCoarsestTopMip(mip < 0 ? 0 : (mip > this->tailMip ? this->tailMip : mip));
+}
+
+void Texture::SetResidencyMip(int mip) {
+	this->residencyMip = mip;
+}
+
+const TextureFootprint& Texture::GetFootprint() {
+	return this->footprint;
+}
+
+void Texture::UpdateStreaming(ID3D11Device* device) {
+	if (!this->streaming) return;
+
+	if (this->streamBusy) {
+		if (!this->streamReady) return;
+		this->streamThread.join();
+		this->streamBusy = false;
+
+		if (!this->pPendingTexture) {
+			// Don't keep retrying a load that can't work, stay on what we have
+			printf("ERROR: Streaming mip %d failed, staying at mip %d\n", this->pendingMip, this->residentMip);
+			this->streaming = false;
+			return;
+		}
+
+		// The old view may still be bound this frame, but the context holds its own reference
+		this->pTextureView->Release();
+		this->pTexture->Release();
+		this->pTexture = this->pPendingTexture;
+		this->pTextureView = this->pPendingView;
+		this->pPendingTexture = nullptr;
+		this->pPendingView = nullptr;
+		this->residentMip = this->pendingMip;
+		printf("Streamed texture now resident from mip %d\n", this->residentMip);
+	}
+
+	if (this->desiredMip > this->residentMip) {
+		if (++this->dropFrames < STREAMING_DROP_DELAY) return;
+	}
+	this->dropFrames = 0;
+	if (this->desiredMip == this->residentMip) return;
+
+	this->pendingMip = this->desiredMip;
+	this->streamReady = false;
+	this->streamBusy = true;
+	this->streamThread = std::thread(&Texture::StreamWorker, this, device, this->pendingMip);
+}
+
+bool Texture::IsStreaming() {
+	return this->streaming;
+}
+
+int Texture::GetResidentMip() {
+	return this->residentMip;
+}
+
+// Fills in the parts of prebuiltDesc that are the same for every prebuilt texture. Every level
+// is already in the file, so there's no GenerateMips and no need for the texture to be a
+// render target. IMMUTABLE lets the driver put it wherever it likes.
+static void InitPrebuiltDesc(D3D11_TEXTURE2D_DESC& desc) {
+	ZeroMemory(&desc, sizeof(desc));
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+}
+
 void Texture::Shutdown() {
+	if (this->streamBusy) {
+		this->streamThread.join();
+		this->streamBusy = false;
+	}
+	if (this->pPendingView) {
+		this->pPendingView->Release();
+		this->pPendingView = nullptr;
+	}
+	if (this->pPendingTexture) {
+		this->pPendingTexture->Release();
+		this->pPendingTexture = nullptr;
+	}
+	this->streaming = false;
+
 	if (this->pTextureView) {
 		this->pTextureView->Release();
 		this->pTextureView = nullptr;
@@ -82,6 +544,14 @@ void Texture::Shutdown() {
 		delete[] this->pTargaData;
 		this->pTargaData = nullptr;
 	}
+
+	if (this->pFileBuffer) {
+		delete this->pFileBuffer;
+		this->pFileBuffer = nullptr;
+	}
+
+	this->subresources.clear();
+	this->mappedFile.Close();
 }
 
 ID3D11ShaderResourceView* Texture::GetTexture() {
@@ -89,68 +559,247 @@ ID3D11ShaderResourceView* Texture::GetTexture() {
 }
 
 bool Texture::LoadTarga(const char* filename, int& height, int& width) {
-	FILE* pFile;
-	int error = fopen_s(&pFile, filename, "rb");
-	if (error != 0) {
-		printf("ERROR: error opening file, fopen_s returned %d\n", error);
+	// Decode out of the file Read brought in if there is one, or out of the mounted archive,
+	// otherwise read it as we go
+	TargaDecoder decoder;
+	MappedFile archived;
+	bool opened;
+	if (this->pFileBuffer) {
+		opened = decoder.OpenMemory(this->pFileBuffer->GetData(), (unsigned int)this->pFileBuffer->GetSize(), filename);
+	}
+	else if (AssetArchive::IsArchived(filename)) {
+		opened = archived.Open(filename)
+			&& decoder.OpenMemory(archived.GetData(), (unsigned int)archived.GetSize(), filename);
+	}
+	else {
+		opened = decoder.Open(filename);
+	}
+	if (!opened) return false;
+
+	height = decoder.GetHeight();
+	width = decoder.GetWidth();
+
+	// The decoder expands (and un-flips, if the file is stored bottom-up) straight into our
+	// RGBA buffer, so there's no intermediate copy of the raw file data anymore.
+	unsigned int rowPitch = width * 4;
+	this->pTargaData = new unsigned char[rowPitch * height];
+	if (!decoder.Decode(this->pTargaData, rowPitch)) {
+		printf("ERROR: Failed to decode targa pixel data from \"%s\"\n", filename);
+		delete[] this->pTargaData;
+		this->pTargaData = nullptr;
 		return false;
 	}
 
-	// Read the file header
-	TargaHeader targaFileHeader;
-	unsigned int readCount = (unsigned int)fread(&targaFileHeader, sizeof(TargaHeader), 1, pFile);
-	if (readCount != 1) {
-		printf("ERROR: Read in an unexpected number of elements on 'fread()': %d\n", readCount);
+	decoder.Close();
+	delete this->pFileBuffer;
+	this->pFileBuffer = nullptr;
+	return true;
+}
+
+// Maps the .ctex file and points one D3D11_SUBRESOURCE_DATA at each stored level
+bool Texture::LoadCooked(const char* filename) {
+	if (!this->mappedFile.Open(filename)) return false;
+	const unsigned char* pFile = this->mappedFile.GetData();
+	unsigned long long fileSize = this->mappedFile.GetSize();
+
+	if (fileSize < sizeof(CookedTextureHeader)) {
+		printf("ERROR: \"%s\" is too small to be a cooked texture\n", filename);
 		return false;
 	}
 
-	height = (int)targaFileHeader.height;
-	width = (int)targaFileHeader.width;
-	int bpp = (int)targaFileHeader.bpp;
+	const CookedTextureHeader* pHeader = (const CookedTextureHeader*)pFile;
+	if (pHeader->magic != COOKED_TEXTURE_MAGIC || pHeader->version != COOKED_TEXTURE_VERSION) {
+		printf("ERROR: \"%s\" is not a version %u cooked texture\n", filename, COOKED_TEXTURE_VERSION);
+		return false;
+	}
 
-	// We are only accepting 32-bit texture files
-	if (bpp != 32) {
-		printf("ERROR: Read in an unexpected bpp from \"%s\": %d\n", filename, bpp);
+	if (pHeader->width == 0 || pHeader->height == 0) {
+		printf("ERROR: \"%s\" is %ux%u\n", filename, pHeader->width, pHeader->height);
+		return false;
+	}
+	bool blockCompressed;
+	unsigned int blockBytes;
+	if (!GetFormatLayout((DXGI_FORMAT)pHeader->format, blockCompressed, blockBytes)) {
+		printf("ERROR: \"%s\" uses a pixel format we can't load (DXGI format %u)\n", filename, pHeader->format);
 		return false;
 	}
 
-	// Allocate memory for the raw targa data
-	int imageSize = width * height * 4; // in bytes; each pixel has 4: r, g, b, a
-	unsigned char* targaImageRawData = new unsigned char[imageSize];
-	readCount = (unsigned int)fread(targaImageRawData, 1, imageSize, pFile);
-	if (readCount != imageSize) {
-		// we expect to have read # of bytes based on width * height * 4
-		printf("ERROR: Read unexpected number of bytes %d. Expected %d. " \
-			"This could be due to compression.\n", readCount, imageSize);
+	unsigned long long tableEnd = sizeof(CookedTextureHeader) + (unsigned long long)pHeader->mipCount * sizeof(CookedMipEntry);
+	if (pHeader->mipCount == 0 || tableEnd > fileSize) {
+		printf("ERROR: \"%s\" has a bad mip table (%u mips)\n", filename, pHeader->mipCount);
 		return false;
 	}
 
-	// We're done reading!
-	error = fclose(pFile);
-	if (error != 0) {
-		printf("ERROR: error closing file, fclose returned %d\n", error);
+	// D3D reads rowPitch bytes for every row of each level, so the entries can't be taken on
+	// trust: each level has to be at least as big as its size and format make it, and all of
+	// it has to be inside the file
+	const CookedMipEntry* pMips = (const CookedMipEntry*)(pFile + sizeof(CookedTextureHeader));
+	this->subresources.resize(pHeader->mipCount);
+	unsigned int width = pHeader->width, height = pHeader->height;
+	for (unsigned int i = 0; i < pHeader->mipCount; i++) {
+		unsigned long long minRowPitch, rows;
+		if (blockCompressed) {
+			minRowPitch = (unsigned long long)((width + 3) / 4) * blockBytes;
+			rows = (height + 3) / 4;
+		}
+		else {
+			minRowPitch = (unsigned long long)width * blockBytes;
+			rows = height;
+		}
+		if (pMips[i].rowPitch < minRowPitch || pMips[i].dataSize < pMips[i].rowPitch * rows) {
+			printf("ERROR: Mip %u of \"%s\" is too small for %ux%u texels\n", i, filename, width, height);
+			return false;
+		}
+		if (pMips[i].offset > fileSize || pMips[i].dataSize > fileSize - pMips[i].offset) {
+			printf("ERROR: Mip %u of \"%s\" runs past the end of the file\n", i, filename);
+			return false;
+		}
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+
+		this->subresources[i].pSysMem = pFile + pMips[i].offset;
+		this->subresources[i].SysMemPitch = pMips[i].rowPitch;
+		this->subresources[i].SysMemSlicePitch = pMips[i].dataSize;
+	}
+
+	InitPrebuiltDesc(this->prebuiltDesc);
+	this->prebuiltDesc.Width = pHeader->width;
+	this->prebuiltDesc.Height = pHeader->height;
+	this->prebuiltDesc.MipLevels = pHeader->mipCount;
+	this->prebuiltDesc.ArraySize = 1;
+	this->prebuiltDesc.Format = (DXGI_FORMAT)pHeader->format;
+
+	return true;
+}
+
+// Maps an old-style (pre-DX10 header) pixel format to its DXGI equivalent
+static DXGI_FORMAT GetLegacyDdsFormat(const DdsPixelFormat& pf) {
+	if (pf.flags & DDS_PF_FOURCC) {
+		switch (pf.fourCC) {
+		case DDS_FOURCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+		case DDS_FOURCC('D', 'X', 'T', '2'):
+		case DDS_FOURCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+		case DDS_FOURCC('D', 'X', 'T', '4'):
+		case DDS_FOURCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+		case DDS_FOURCC('A', 'T', 'I', '1'):
+		case DDS_FOURCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+		case DDS_FOURCC('A', 'T', 'I', '2'):
+		case DDS_FOURCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+		default: return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	if ((pf.flags & DDS_PF_RGB) && pf.rgbBitCount == 32) {
+		if (pf.rBitMask == 0x000000FF && pf.gBitMask == 0x0000FF00 && pf.bBitMask == 0x00FF0000) {
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+		if (pf.rBitMask == 0x00FF0000 && pf.gBitMask == 0x0000FF00 && pf.bBitMask == 0x000000FF) {
+			return (pf.flags & DDS_PF_ALPHAPIXELS) ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_B8G8R8X8_UNORM;
+		}
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+// Parses just the DDS header(s) and points a D3D11_SUBRESOURCE_DATA at every mip of every
+// array slice inside the mapping. None of the texel data is touched on the CPU.
+bool Texture::LoadDds(const char* filename) {
+	if (!this->mappedFile.Open(filename)) return false;
+	const unsigned char* pFile = this->mappedFile.GetData();
+	unsigned long long fileSize = this->mappedFile.GetSize();
+
+	if (fileSize < sizeof(unsigned int) + sizeof(DdsHeader) || *(const unsigned int*)pFile != DDS_MAGIC) {
+		printf("ERROR: \"%s\" is not a DDS file\n", filename);
 		return false;
 	}
 
-	// Now we have to read the raw targa data backwards into our destination data array since targa
-	// format stores the data upside down lmao
-	this->pTargaData = new unsigned char[imageSize];
-	int loadIndex = 0;
-	int targaIndex = (height * width * 4) - (width * 4); // start at the end of the raw targa buffer
-	for (int i = 0; i < height; i++) {
-		for (int j = 0; j < width; j++) {
-			this->pTargaData[loadIndex++] = targaImageRawData[targaIndex + 2]; // red
-			this->pTargaData[loadIndex++] = targaImageRawData[targaIndex + 1]; // green
-			this->pTargaData[loadIndex++] = targaImageRawData[targaIndex + 0]; // blue
-			this->pTargaData[loadIndex++] = targaImageRawData[targaIndex + 4]; // alpha
+	const DdsHeader* pHeader = (const DdsHeader*)(pFile + sizeof(unsigned int));
+	unsigned long long dataOffset = sizeof(unsigned int) + sizeof(DdsHeader);
+	if (pHeader->size != sizeof(DdsHeader) || pHeader->pixelFormat.size != sizeof(DdsPixelFormat)) {
+		printf("ERROR: \"%s\" has a malformed DDS header\n", filename);
+		return false;
+	}
+	if ((pHeader->caps2 & DDS_CAPS2_VOLUME) || pHeader->depth > 1) {
+		printf("ERROR: \"%s\" is a volume texture, only 2D textures are supported\n", filename);
+		return false;
+	}
+
+	InitPrebuiltDesc(this->prebuiltDesc);
+	D3D11_TEXTURE2D_DESC& desc = this->prebuiltDesc;
+	desc.Width = pHeader->width;
+	desc.Height = pHeader->height;
+	desc.MipLevels = (pHeader->flags & DDS_FLAG_MIPMAPCOUNT) && pHeader->mipMapCount > 0 ? pHeader->mipMapCount : 1;
+	desc.ArraySize = 1;
+
+	bool hasDx10Header = (pHeader->pixelFormat.flags & DDS_PF_FOURCC)
+		&& pHeader->pixelFormat.fourCC == DDS_FOURCC('D', 'X', '1', '0');
+	if (hasDx10Header) {
+		if (fileSize < dataOffset + sizeof(DdsHeaderDx10)) {
+			printf("ERROR: \"%s\" is missing its DX10 header\n", filename);
+			return false;
+		}
+		const DdsHeaderDx10* pDx10 = (const DdsHeaderDx10*)(pFile + dataOffset);
+		dataOffset += sizeof(DdsHeaderDx10);
 
-			targaIndex += 4;
+		if (pDx10->resourceDimension != DDS_DIMENSION_TEXTURE2D) {
+			printf("ERROR: \"%s\" is not a 2D texture (dimension %u)\n", filename, pDx10->resourceDimension);
+			return false;
 		}
-		targaIndex -= (width * 8);
+		desc.Format = (DXGI_FORMAT)pDx10->dxgiFormat;
+		desc.ArraySize = pDx10->arraySize > 0 ? pDx10->arraySize : 1;
+		if (pDx10->miscFlag & DDS_MISC_TEXTURECUBE) {
+			desc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE;
+			desc.ArraySize *= 6; // arraySize counts whole cubes
+		}
+	}
+	else {
+		desc.Format = GetLegacyDdsFormat(pHeader->pixelFormat);
+		if (pHeader->caps2 & DDS_CAPS2_CUBEMAP) {
+			if ((pHeader->caps2 & DDS_CAPS2_CUBEMAP_ALLFACES) != DDS_CAPS2_CUBEMAP_ALLFACES) {
+				printf("ERROR: \"%s\" is a partial cube map, all six faces are needed\n", filename);
+				return false;
+			}
+			desc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE;
+			desc.ArraySize = 6;
+		}
+	}
+
+	bool blockCompressed;
+	unsigned int blockBytes;
+	if (!GetFormatLayout(desc.Format, blockCompressed, blockBytes)) {
+		printf("ERROR: \"%s\" uses a pixel format we can't load (DXGI format %d)\n", filename, (int)desc.Format);
+		return false;
 	}
 
-	delete[] targaImageRawData;
-	targaImageRawData = nullptr;
+	this->subresources.resize((size_t)desc.ArraySize * desc.MipLevels);
+	unsigned long long offset = dataOffset;
+	for (unsigned int slice = 0; slice < desc.ArraySize; slice++) {
+		unsigned int width = desc.Width, height = desc.Height;
+		for (unsigned int mip = 0; mip < desc.MipLevels; mip++) {
+			unsigned int rowPitch, rows;
+			if (blockCompressed) {
+				rowPitch = ((width + 3) / 4) * blockBytes;
+				rows = (height + 3) / 4;
+			}
+			else {
+				rowPitch = width * blockBytes;
+				rows = height;
+			}
+			unsigned long long levelSize = (unsigned long long)rowPitch * rows;
+			if (offset + levelSize > fileSize) {
+				printf("ERROR: \"%s\" ends in the middle of slice %u mip %u\n", filename, slice, mip);
+				return false;
+			}
+
+			D3D11_SUBRESOURCE_DATA& subresource = this->subresources[(size_t)slice * desc.MipLevels + mip];
+			subresource.pSysMem = pFile + offset;
+			subresource.SysMemPitch = rowPitch;
+			subresource.SysMemSlicePitch = (unsigned int)levelSize;
+
+			offset += levelSize;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
 
 	return true;
 }
\ No newline at end of file
@@ -2,33 +2,118 @@
 
 #include <d3d11.h>
 #include <stdio.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "TargaDecoder.h"
+#include "CookedTexture.h"
+#include "DdsFile.h"
+#include "MappedFile.h"
+#include "AssetArchive.h"
+#include "TextureResidency.h"
+#include "AssetIO.h"
+
+// With streaming on, prebuilt (.ctex/.dds) textures start out with just their mip tail resident
+// and the finer mips are brought in on a background thread as the texture gets bigger on screen.
+const bool TEXTURE_STREAMING = true;
+
+// Texture quality setting for lower-end machines: this many of the largest mip levels are
+// dropped at load time, so every skipped level is roughly a 4x cut in memory and upload.
+// Pre-mipped files never read the skipped levels, .tga images get box-filtered down.
+const int TEXTURE_SKIP_MIPS = 0;
+
+// Every mip at or below this size is part of the tail that's uploaded up front
+const unsigned int STREAMING_TAIL_SIZE = 64;
+
+// How many updates in a row a texture has to want fewer mips before we actually drop them, so
+// something hovering around a mip boundary doesn't get rebuilt every frame
+const int STREAMING_DROP_DELAY = 60;
 
 class Texture
 {
 private:
-	// This is the .tga file header structure
-	struct TargaHeader {
-		unsigned char data1[12];
-		unsigned short width;
-		unsigned short height;
-		unsigned char bpp;
-		unsigned char data2;
-	};
-
 	// Supporting other formats would just be other Load_() functions here.
 	bool LoadTarga(const char*, int&, int&);
+	bool LoadCooked(const char*);
+	bool LoadDds(const char*);
+
+	// .tga files are uploaded as a single level and the GPU builds the mips. Cooked and DDS
+	// files already carry every level so they go up in one CreateTexture2D call, straight
+	// out of the file mapping.
+	bool LoadTargaData(const char*);
+	bool InitTarga(ID3D11Device*, ID3D11DeviceContext*);
+	bool InitPrebuilt(ID3D11Device*);
+	bool InitStreaming(ID3D11Device*);
+	void SkipTopMips(int);
+
+	// Builds a texture and view holding mips firstMip..end of the prebuilt levels
+	bool CreateFromMip(ID3D11Device*, int, ID3D11Texture2D**, ID3D11ShaderResourceView**);
+	int GetCoarsestTopMip(int);
+	void StreamWorker(ID3D11Device*, int);
 
 	unsigned char* pTargaData;
+	AssetBuffer* pFileBuffer;
+	bool prebuilt;
+	TextureFootprint footprint;
+	MappedFile mappedFile;
+	D3D11_TEXTURE2D_DESC prebuiltDesc;
+	std::vector<D3D11_SUBRESOURCE_DATA> subresources;
 	ID3D11Texture2D* pTexture;
 	ID3D11ShaderResourceView* pTextureView;
 
+	// Streaming state. The mapping and subresources stay alive for as long as we stream since
+	// every rebuild reads its levels straight out of them.
+	bool streaming;
+	int tailMip, residentMip, desiredMip, residencyMip, dropFrames;
+	std::thread streamThread;
+	bool streamBusy;
+	std::atomic<bool> streamReady;
+	int pendingMip;
+	ID3D11Texture2D* pPendingTexture;
+	ID3D11ShaderResourceView* pPendingView;
+
 public:
 	Texture();
 	Texture(const Texture&);
 	~Texture();
 
 	bool Init(ID3D11Device*, ID3D11DeviceContext*, const char*);
+
+	// Init split in two for the startup load graph: Load does the CPU work and can run on any
+	// thread, Create makes the D3D objects and runs wherever device calls are serialized.
+	bool Load(const char*);
+	bool Create(ID3D11Device*, ID3D11DeviceContext*);
+
+	// Optional step before Load that reads the file through AssetIO, so the read can be queued
+	// with everything else's. The function gets called with the result once it's in.
+	void Read(AssetIO*, const char*, std::function<void(bool)>);
+
+	// A 1x1 texture of a single RGBA color, for things that have no texture of their own
+	bool InitSolid(ID3D11Device*, unsigned char, unsigned char, unsigned char, unsigned char);
+
 	void Shutdown();
 
 	ID3D11ShaderResourceView* GetTexture();
+
+	// Streaming. ComputeDesiredMip turns the number of pixels the texture spans on screen into
+	// the finest mip worth having, UpdateStreaming (once a frame) swaps in finished loads and
+	// kicks off a new one when the desired mip differs from what's resident.
+	int ComputeDesiredMip(float);
+	void SetDesiredMip(int);
+	void UpdateStreaming(ID3D11Device*);
+	bool IsStreaming();
+	int GetResidentMip();
+
+	// The residency manager's limit on the finest mip we may have, SetDesiredMip won't go past it
+	void SetResidencyMip(int);
+	const TextureFootprint& GetFootprint();
+};
+
+// Hands the residency manager's decisions to the Texture they were registered with
+class TextureResidencyAllocator : public ResidencyAllocator {
+public:
+	void SetFirstMip(void* pUser, int mip) override {
+		((Texture*)pUser)->SetResidencyMip(mip);
+	}
 };
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "TextureResidency.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+TextureResidency::TextureResidency() {
+	this->pAllocator = nullptr;
+	this->budgetBytes = 0;
+	this->pinnedBytes = 0;
+	this->residentBytes = 0;
+	this->evictionCount = 0;
+	this->frame = 0;
+}
+
+void TextureResidency::Init(unsigned long long budgetBytes, ResidencyAllocator* pAllocator) {
+	this->budgetBytes = budgetBytes;
+	this->pAllocator = pAllocator;
+}
+
+void TextureResidency::Shutdown() {
+	this->entries.clear();
+	this->freeHandles.clear();
+	this->pAllocator = nullptr;
+	this->pinnedBytes = 0;
+	this->residentBytes = 0;
+}
+
+int TextureResidency::Register(const TextureFootprint& footprint, void* pUser) {
+	Entry entry;
+	entry.used = true;
+	entry.footprint = footprint;
+	entry.pUser = pUser;
+	entry.requestedMip = footprint.coarsestMip;
+	entry.appliedMip = footprint.coarsestMip;
+	entry.screenPixels = 0.0f;
+	entry.lastUsedFrame = this->frame;
+
+	int handle;
+	if (!this->freeHandles.empty()) {
+		handle = this->freeHandles.back();
+		this->freeHandles.pop_back();
+		this->entries[handle] = entry;
+	}
+	else {
+		handle = (int)this->entries.size();
+		this->entries.push_back(entry);
+	}
+	this->residentBytes += GetChainBytes(footprint, entry.appliedMip);
+	return handle;
+}
+
+void TextureResidency::Unregister(int handle) {
+	if (handle < 0 || handle >= (int)this->entries.size() || !this->entries[handle].used) return;
+	Entry& entry = this->entries[handle];
+	this->residentBytes -= GetChainBytes(entry.footprint, entry.appliedMip);
+	entry.used = false;
+	this->freeHandles.push_back(handle);
+}
+
+void TextureResidency::AddPinnedBytes(unsigned long long bytes) {
+	this->pinnedBytes += bytes;
+}
+
+void TextureResidency::RemovePinnedBytes(unsigned long long bytes) {
+	this->pinnedBytes -= bytes < this->pinnedBytes ? bytes : this->pinnedBytes;
+}
+
+void TextureResidency::Request(int handle, int mip, float screenPixels) {
+	if (handle < 0 || handle >= (int)this->entries.size() || !this->entries[handle].used) return;
+	Entry& entry = this->entries[handle];
+	entry.requestedMip = ClampMip(entry, mip);
+	entry.screenPixels = screenPixels;
+	entry.lastUsedFrame = this->frame;
+}
+
+int TextureResidency::ClampMip(const Entry& entry, int mip) {
+	return mip < 0 ? 0 : (mip > entry.footprint.coarsestMip ? entry.footprint.coarsestMip : mip);
+}
+
+void TextureResidency::Update() {
+	// Start from what everyone wants
+	std::vector<int> targets(this->entries.size(), 0);
+	unsigned long long total = this->pinnedBytes;
+	std::vector<int> trimmable;
+	for (size_t i = 0; i < this->entries.size(); i++) {
+		const Entry& entry = this->entries[i];
+		if (!entry.used) continue;
+		targets[i] = entry.requestedMip;
+		total += GetChainBytes(entry.footprint, targets[i]);
+		if (targets[i] < entry.footprint.coarsestMip) trimmable.push_back((int)i);
+	}
+
+	if (total > this->budgetBytes && !trimmable.empty()) {
+		// Least recently used first, then smallest on screen
+		std::sort(trimmable.begin(), trimmable.end(), [this](int a, int b) {
+			const Entry& ea = this->entries[a];
+			const Entry& eb = this->entries[b];
+			if (ea.lastUsedFrame != eb.lastUsedFrame) return ea.lastUsedFrame < eb.lastUsedFrame;
+			return ea.screenPixels < eb.screenPixels;
+		});
+
+		// Whatever wasn't drawn this frame goes all the way down to its coarsest mip
+		size_t firstVisible = 0;
+		for (; firstVisible < trimmable.size() && total > this->budgetBytes; firstVisible++) {
+			int i = trimmable[firstVisible];
+			const Entry& entry = this->entries[i];
+			if (entry.lastUsedFrame == this->frame) break;
+			total -= GetChainBytes(entry.footprint, targets[i]);
+			targets[i] = entry.footprint.coarsestMip;
+			total += GetChainBytes(entry.footprint, targets[i]);
+		}
+
+		// Then the visible ones give up a level each in turn, so they all soften together
+		// rather than one of them dropping to a blur
+		bool trimmed = true;
+		while (total > this->budgetBytes && trimmed) {
+			trimmed = false;
+			for (size_t n = firstVisible; n < trimmable.size() && total > this->budgetBytes; n++) {
+				int i = trimmable[n];
+				const Entry& entry = this->entries[i];
+				if (targets[i] >= entry.footprint.coarsestMip) continue;
+				total -= GetChainBytes(entry.footprint, targets[i]);
+				targets[i]++;
+				total += GetChainBytes(entry.footprint, targets[i]);
+				trimmed = true;
+			}
+		}
+	}
+
+	this->residentBytes = 0;
+	for (size_t i = 0; i < this->entries.size(); i++) {
+		Entry& entry = this->entries[i];
+		if (!entry.used) continue;
+		if (targets[i] != entry.appliedMip) {
+			// Only count levels we dropped because of the budget, not ones nobody wanted
+			if (targets[i] > entry.appliedMip && targets[i] > entry.requestedMip) {
+				int from = entry.appliedMip > entry.requestedMip ? entry.appliedMip : entry.requestedMip;
+				this->evictionCount += targets[i] - from;
+			}
+			entry.appliedMip = targets[i];
+			if (this->pAllocator) this->pAllocator->SetFirstMip(entry.pUser, entry.appliedMip);
+		}
+		this->residentBytes += GetChainBytes(entry.footprint, entry.appliedMip);
+	}
+
+	this->frame++;
+}
+
+unsigned long long TextureResidency::GetBudgetBytes() {
+	return this->budgetBytes;
+}
+
+// Textures only, pinned bytes aren't included
+unsigned long long TextureResidency::GetResidentBytes() {
+	return this->residentBytes;
+}
+
+unsigned long long TextureResidency::GetEvictionCount() {
+	return this->evictionCount;
+}
+
+void TextureResidency::PrintStats() {
+	int textures = 0;
+	for (size_t i = 0; i < this->entries.size(); i++) if (this->entries[i].used) textures++;
+	printf("Residency: %d textures, %.1f MB textures + %.1f MB pinned of %.1f MB budget, %llu mips evicted\n",
+		textures, this->residentBytes / (1024.0 * 1024.0), this->pinnedBytes / (1024.0 * 1024.0),
+		this->budgetBytes / (1024.0 * 1024.0), this->evictionCount);
+}
+
+unsigned long long TextureResidency::GetChainBytes(const TextureFootprint& footprint, int firstMip) {
+	unsigned long long bytes = 0;
+	for (unsigned int mip = firstMip; mip < footprint.mipCount; mip++) {
+		unsigned long long width = footprint.width >> mip, height = footprint.height >> mip;
+		if (width < 1) width = 1;
+		if (height < 1) height = 1;
+		if (footprint.blockCompressed) {
+			width = (width + 3) / 4;
+			height = (height + 3) / 4;
+		}
+		bytes += width * height * footprint.blockBytes;
+	}
+	return bytes * footprint.arraySize;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+/* Keeps the textures we have resident under a memory budget. Every texture registers its
+ * footprint (enough to work out the bytes for any mip range) and each frame says which mip it
+ * would like based on how big it is on screen. Update() then decides what actually fits: when
+ * the wanted total is over budget, textures that haven't been on screen recently are trimmed
+ * to their coarsest mip first (least recently used first), then visible ones lose a level at
+ * a time, smallest on screen first. The decision is handed to a ResidencyAllocator, which is
+ * the only part that touches the GPU, so the whole thing runs fine against a mock allocator. */
+
+// What the manager needs to know to size a texture at any mip
+struct TextureFootprint {
+	unsigned int width, height;
+	unsigned int mipCount;
+	unsigned int arraySize;
+	unsigned int blockBytes;  // bytes per texel, or per 4x4 block when blockCompressed
+	bool blockCompressed;
+	int coarsestMip;          // the most we're allowed to drop to; 0 means it can't be trimmed
+};
+
+// Applies the manager's decisions. pUser is whatever was passed to Register.
+class ResidencyAllocator {
+public:
+	virtual ~ResidencyAllocator() {}
+	virtual void SetFirstMip(void*, int) = 0;
+};
+
+class TextureResidency {
+public:
+	TextureResidency();
+
+	void Init(unsigned long long, ResidencyAllocator*);
+	void Shutdown();
+
+	// Returns a handle for Request/Unregister
+	int Register(const TextureFootprint&, void*);
+	void Unregister(int);
+
+	// Memory that counts against the budget but can't be trimmed (vertex/index buffers, ...)
+	void AddPinnedBytes(unsigned long long);
+	void RemovePinnedBytes(unsigned long long);
+
+	// Called for every texture drawn this frame with the mip it would like and how many
+	// pixels it covers (the bigger, the later it gets trimmed)
+	void Request(int, int, float);
+
+	// Once a frame, after the requests
+	void Update();
+
+	unsigned long long GetBudgetBytes();
+	unsigned long long GetResidentBytes();
+	unsigned long long GetEvictionCount();
+	void PrintStats();
+
+	static unsigned long long GetChainBytes(const TextureFootprint&, int);
+
+private:
+	struct Entry {
+		bool used;
+		TextureFootprint footprint;
+		void* pUser;
+		int requestedMip;
+		int appliedMip;
+		float screenPixels;
+		unsigned long long lastUsedFrame;
+	};
+
+	int ClampMip(const Entry&, int);
+
+	std::vector<Entry> entries;
+	std::vector<int> freeHandles;
+	ResidencyAllocator* pAllocator;
+	unsigned long long budgetBytes;
+	unsigned long long pinnedBytes;
+	unsigned long long residentBytes;
+	unsigned long long evictionCount;
+	unsigned long long frame;
+};
\ No newline at end of file
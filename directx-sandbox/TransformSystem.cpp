@@ -0,0 +1,230 @@
+#include "TransformSystem.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+TransformSystem::TransformSystem() {
+	this->sorted = true;
+	this->lastUpdateCount = 0;
+	this->levelStarts.push_back(0);
+}
+
+void TransformSystem::Reserve(int count) {
+	this->translations.reserve(count);
+	this->rotations.reserve(count);
+	this->scales.reserve(count);
+	this->parents.reserve(count);
+	this->depths.reserve(count);
+	this->dirty.reserve(count);
+	this->worlds.reserve(count);
+	this->slotOfId.reserve(count);
+	this->idOfSlot.reserve(count);
+}
+
+int TransformSystem::Create(int parent) {
+	int id = (int)this->slotOfId.size();
+	int slot = (int)this->translations.size();
+	int parentSlot = parent == NO_PARENT ? NO_PARENT : this->slotOfId[parent];
+	int depth = parentSlot == NO_PARENT ? 0 : this->depths[parentSlot] + 1;
+
+	this->translations.push_back(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+	this->rotations.push_back(DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+	this->scales.push_back(DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+	this->parents.push_back(parentSlot);
+	this->depths.push_back(depth);
+	this->dirty.push_back(1);
+	DirectX::XMFLOAT4X4A identity;
+	DirectX::XMStoreFloat4x4A(&identity, DirectX::XMMatrixIdentity());
+	this->worlds.push_back(identity);
+	this->slotOfId.push_back(slot);
+	this->idOfSlot.push_back(id);
+
+	// Still in order as long as it's no shallower than the last one, which is the usual case
+	// of creating a parent and then its children. Anything else waits for a sort.
+	int lastDepth = (int)this->levelStarts.size() - 2;
+	if (!this->sorted || depth < lastDepth) {
+		this->sorted = false;
+	}
+	else {
+		while ((int)this->levelStarts.size() - 2 < depth) this->levelStarts.insert(this->levelStarts.end() - 1, slot);
+		this->levelStarts.back() = slot + 1;
+	}
+	return id;
+}
+
+bool TransformSystem::SetParent(int id, int parent) {
+	int slot = this->slotOfId[id];
+	int parentSlot = parent == NO_PARENT ? NO_PARENT : this->slotOfId[parent];
+	for (int up = parentSlot; up != NO_PARENT; up = this->parents[up]) {
+		if (up == slot) {
+			printf("ERROR: Transform %d can't be parented to %d, it's under it\n", id, parent);
+			return false;
+		}
+	}
+	this->parents[slot] = parentSlot;
+	this->dirty[slot] = 1;
+	this->sorted = false;
+	return true;
+}
+
+int TransformSystem::GetParent(int id) {
+	int parentSlot = this->parents[this->slotOfId[id]];
+	return parentSlot == NO_PARENT ? NO_PARENT : this->idOfSlot[parentSlot];
+}
+
+void TransformSystem::SetLocal(int id, const DirectX::XMFLOAT3& translation,
+	const DirectX::XMFLOAT4& rotation, const DirectX::XMFLOAT3& scale)
+{
+	int slot = this->slotOfId[id];
+	this->translations[slot] = translation;
+	this->rotations[slot] = rotation;
+	this->scales[slot] = scale;
+	this->dirty[slot] = 1;
+}
+
+void TransformSystem::SetTranslation(int id, const DirectX::XMFLOAT3& translation) {
+	int slot = this->slotOfId[id];
+	this->translations[slot] = translation;
+	this->dirty[slot] = 1;
+}
+
+void TransformSystem::SetRotation(int id, const DirectX::XMFLOAT4& rotation) {
+	int slot = this->slotOfId[id];
+	this->rotations[slot] = rotation;
+	this->dirty[slot] = 1;
+}
+
+void TransformSystem::SetScale(int id, const DirectX::XMFLOAT3& scale) {
+	int slot = this->slotOfId[id];
+	this->scales[slot] = scale;
+	this->dirty[slot] = 1;
+}
+
+void TransformSystem::Update(JobSystem* pJobs) {
+	if (!this->sorted) Sort();
+
+	this->lastUpdateCount = 0;
+	for (size_t level = 0; level + 1 < this->levelStarts.size(); level++) {
+		this->lastUpdateCount += UpdateLevel(pJobs, this->levelStarts[level], this->levelStarts[level + 1]);
+	}
+
+	// Children have all seen their parents' flags by now
+	if (!this->dirty.empty()) memset(this->dirty.data(), 0, this->dirty.size());
+}
+
+DirectX::XMMATRIX TransformSystem::GetWorld(int id) {
+	return DirectX::XMLoadFloat4x4A(&this->worlds[this->slotOfId[id]]);
+}
+
+int TransformSystem::GetCount() {
+	return (int)this->slotOfId.size();
+}
+
+int TransformSystem::GetDepthCount() {
+	return (int)this->levelStarts.size() - 1;
+}
+
+int TransformSystem::GetLastUpdateCount() {
+	return this->lastUpdateCount;
+}
+
+// Works out everyone's depth from their parents, then a counting sort by depth. It's stable,
+// so transforms at the same depth keep the order they were in.
+void TransformSystem::Sort() {
+	int count = (int)this->translations.size();
+
+	// A parent can be anywhere in the arrays until this is done, so depths are found by
+	// walking up to the first transform whose depth is already known
+	std::vector<int> newDepths(count, -1);
+	std::vector<int> chain;
+	int maxDepth = 0;
+	for (int slot = 0; slot < count; slot++) {
+		int up = slot;
+		while (up != NO_PARENT && newDepths[up] < 0) {
+			chain.push_back(up);
+			up = this->parents[up];
+		}
+		int depth = up == NO_PARENT ? -1 : newDepths[up];
+		while (!chain.empty()) {
+			newDepths[chain.back()] = ++depth;
+			chain.pop_back();
+		}
+		if (newDepths[slot] > maxDepth) maxDepth = newDepths[slot];
+	}
+
+	this->levelStarts.assign(maxDepth + 2, 0);
+	for (int slot = 0; slot < count; slot++) this->levelStarts[newDepths[slot] + 1]++;
+	for (int level = 0; level <= maxDepth; level++) this->levelStarts[level + 1] += this->levelStarts[level];
+	std::vector<int> newSlots(count);
+	std::vector<int> next(this->levelStarts.begin(), this->levelStarts.end() - 1);
+	for (int slot = 0; slot < count; slot++) newSlots[slot] = next[newDepths[slot]]++;
+
+	std::vector<DirectX::XMFLOAT3> translations(count), scales(count);
+	std::vector<DirectX::XMFLOAT4> rotations(count);
+	std::vector<int> parents(count);
+	std::vector<unsigned char> dirty(count);
+	std::vector<DirectX::XMFLOAT4X4A> worlds(count);
+	for (int slot = 0; slot < count; slot++) {
+		int to = newSlots[slot];
+		translations[to] = this->translations[slot];
+		rotations[to] = this->rotations[slot];
+		scales[to] = this->scales[slot];
+		parents[to] = this->parents[slot] == NO_PARENT ? NO_PARENT : newSlots[this->parents[slot]];
+		dirty[to] = this->dirty[slot];
+		worlds[to] = this->worlds[slot];
+		this->depths[to] = newDepths[slot];
+	}
+	for (int id = 0; id < count; id++) {
+		this->slotOfId[id] = newSlots[this->slotOfId[id]];
+		this->idOfSlot[this->slotOfId[id]] = id;
+	}
+
+	this->translations.swap(translations);
+	this->rotations.swap(rotations);
+	this->scales.swap(scales);
+	this->parents.swap(parents);
+	this->dirty.swap(dirty);
+	this->worlds.swap(worlds);
+	this->sorted = true;
+}
+
+// One stretch of a single depth. Parents are all at the depth before, already finished, so
+// nothing here is written by anyone else. Returns how many it recomputed.
+int TransformSystem::UpdateRange(int begin, int end) {
+	int updated = 0;
+	for (int slot = begin; slot < end; slot++) {
+		int parent = this->parents[slot];
+		if (parent != NO_PARENT && this->dirty[parent]) this->dirty[slot] = 1;
+		if (!this->dirty[slot]) continue;
+
+		// Scale then rotate then translate. For row vectors S * R is R's rows scaled, and the
+		// translation is the last row, so that's all the composing there is.
+		const DirectX::XMFLOAT3& scale = this->scales[slot];
+		DirectX::XMMATRIX local = DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&this->rotations[slot]));
+		local.r[0] = DirectX::XMVectorScale(local.r[0], scale.x);
+		local.r[1] = DirectX::XMVectorScale(local.r[1], scale.y);
+		local.r[2] = DirectX::XMVectorScale(local.r[2], scale.z);
+		local.r[3] = DirectX::XMVectorSetW(DirectX::XMLoadFloat3(&this->translations[slot]), 1.0f);
+
+		if (parent != NO_PARENT) {
+			local = DirectX::XMMatrixMultiply(local, DirectX::XMLoadFloat4x4A(&this->worlds[parent]));
+		}
+		DirectX::XMStoreFloat4x4A(&this->worlds[slot], local);
+		updated++;
+	}
+	return updated;
+}
+
+// Small levels (or no job system) are done right here. Otherwise ParallelFor spreads the level
+// over the threads, this one included, and only returns once it's all done, so the next depth
+// never starts early.
+int TransformSystem::UpdateLevel(JobSystem* pJobs, int begin, int end) {
+	if (!pJobs || end - begin <= TRANSFORM_BATCH) return UpdateRange(begin, end);
+
+	std::atomic<int> updated(0);
+	pJobs->ParallelFor(begin, end, TRANSFORM_BATCH, [&](int rangeBegin, int rangeEnd) {
+		updated += UpdateRange(rangeBegin, rangeEnd);
+	});
+	return updated.load();
+}
\ No newline at end of file
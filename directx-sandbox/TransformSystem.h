@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+
+#include "JobSystem.h"
+
+// Transforms per piece when Update spreads a level of the hierarchy over the job system, and
+// the smallest level worth spreading. Big enough that a job costs nothing next to doing it.
+const int TRANSFORM_BATCH = 4096;
+
+/* Every object's transform, kept as arrays of each part (translations, rotations, scales,
+ * parents, world matrices...) rather than an object per transform, so Update streams straight
+ * through them.
+ *
+ * Objects are kept sorted by how deep they are in the hierarchy, roots first, so a parent's
+ * world matrix is always done before its children's, and everything at one depth can be done
+ * at the same time. Setting anything marks that transform dirty, and Update only recomputes
+ * the dirty ones and everything under them.
+ *
+ * Transforms are referred to by the id Create gives back, which stays the same when they get
+ * moved around by a sort. */
+class TransformSystem {
+public:
+	static const int NO_PARENT = -1;
+
+	TransformSystem();
+
+	void Reserve(int);
+
+	// A new identity transform under the parent (or NO_PARENT), returns its id
+	int Create(int);
+
+	// Fails (and changes nothing) if the parent is the transform itself or one of its children
+	bool SetParent(int, int);
+	int GetParent(int);
+
+	// Local translation, rotation quaternion and scale, applied scale first
+	void SetLocal(int, const DirectX::XMFLOAT3&, const DirectX::XMFLOAT4&, const DirectX::XMFLOAT3&);
+	void SetTranslation(int, const DirectX::XMFLOAT3&);
+	void SetRotation(int, const DirectX::XMFLOAT4&);
+	void SetScale(int, const DirectX::XMFLOAT3&);
+
+	// Re-sorts if the hierarchy changed, then brings every dirty world matrix up to date. With
+	// a job system, each depth's transforms are spread over its threads with ParallelFor (the
+	// caller's included), without one it all happens here.
+	void Update(JobSystem*);
+
+	// As of the last Update
+	DirectX::XMMATRIX GetWorld(int);
+
+	int GetCount();
+	int GetDepthCount();
+	int GetLastUpdateCount();
+
+private:
+	void Sort();
+	int UpdateRange(int, int);
+	int UpdateLevel(JobSystem*, int, int);
+
+	// Per transform, in update order (by depth). parents holds the parent's index in these
+	// arrays rather than its id.
+	std::vector<DirectX::XMFLOAT3> translations;
+	std::vector<DirectX::XMFLOAT4> rotations;
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<int> parents;
+	std::vector<int> depths;
+	std::vector<unsigned char> dirty;
+	std::vector<DirectX::XMFLOAT4X4A> worlds;
+
+	// Ids stay put while the arrays above get reordered
+	std::vector<int> slotOfId;
+	std::vector<int> idOfSlot;
+
+	// Where each depth starts in the arrays, plus one past the end
+	std::vector<int> levelStarts;
+	bool sorted;
+	int lastUpdateCount;
+};
\ No newline at end of file
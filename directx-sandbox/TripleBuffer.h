@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+
+/* Hands whole values from one writer thread to one reader thread without either ever waiting
+ * on the other. There are three slots: the writer fills one, the reader reads another, and the
+ * third sits in the middle holding the newest finished value. Publish swaps the writer's slot
+ * into the middle and Acquire swaps the middle out to the reader, each with a single atomic
+ * exchange, so nobody ever sees a half-written value. If the writer publishes twice before the
+ * reader looks, the older one is simply written over.
+ *
+ * The slots are reused, not cleared, so a writer can keep its vectors' capacity from one
+ * round to the next. */
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() {
+		this->writeSlot = 0;
+		this->middle.store(1);
+		this->readSlot = 2;
+	}
+
+	// Writer side
+	T& GetWriteBuffer() {
+		return this->slots[this->writeSlot];
+	}
+
+	void Publish() {
+		// Release hands over everything written to the slot, acquire takes back whatever the
+		// reader finished with when it left that slot in the middle
+		unsigned int previous = this->middle.exchange(this->writeSlot | FRESH, std::memory_order_acq_rel);
+		this->writeSlot = previous & SLOT_MASK;
+	}
+
+	// Reader side. True (and a new read buffer) when something was published since the last
+	// time, otherwise the read buffer stays as it was.
+	bool Acquire() {
+		if (!(this->middle.load(std::memory_order_relaxed) & FRESH)) return false;
+		unsigned int previous = this->middle.exchange(this->readSlot, std::memory_order_acq_rel);
+		this->readSlot = previous & SLOT_MASK;
+		return true;
+	}
+
+	T& GetReadBuffer() {
+		return this->slots[this->readSlot];
+	}
+
+private:
+	TripleBuffer(const TripleBuffer&);
+	TripleBuffer& operator=(const TripleBuffer&);
+
+	static const unsigned int SLOT_MASK = 0x3;
+	static const unsigned int FRESH = 0x4; // set on the middle slot by Publish, cleared by Acquire
+
+	T slots[3];
+	unsigned int writeSlot; // only the writer touches this
+	char writerPadding[64];
+	std::atomic<unsigned int> middle;
+	char middlePadding[64];
+	unsigned int readSlot;  // and only the reader this
+};
\ No newline at end of file
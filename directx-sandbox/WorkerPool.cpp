@@ -0,0 +1,70 @@
+#include "WorkerPool.h"
+
+#include <stdio.h>
+
+static thread_local int currentWorker = -1;
+
+WorkerPool::WorkerPool() {
+	this->stopping = false;
+}
+
+WorkerPool::~WorkerPool() {
+	Shutdown();
+}
+
+bool WorkerPool::Init(int threadCount) {
+	if (threadCount <= 0) {
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+		if (threadCount < 1) threadCount = 1;
+	}
+
+	this->stopping = false;
+	for (int i = 0; i < threadCount; i++) {
+		this->threads.push_back(std::thread(&WorkerPool::WorkerMain, this, i));
+	}
+	return true;
+}
+
+// Finishes whatever is already queued, then stops the threads
+void WorkerPool::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+	this->wake.notify_all();
+	for (size_t i = 0; i < this->threads.size(); i++) {
+		this->threads[i].join();
+	}
+	this->threads.clear();
+}
+
+void WorkerPool::Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->tasks.push_back(std::move(task));
+	}
+	this->wake.notify_one();
+}
+
+int WorkerPool::GetThreadCount() {
+	return (int)this->threads.size();
+}
+
+int WorkerPool::GetCurrentWorker() {
+	return currentWorker;
+}
+
+void WorkerPool::WorkerMain(int index) {
+	currentWorker = index;
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->wake.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+			if (this->tasks.empty()) return; // only empty here when we're stopping
+			task = std::move(this->tasks.front());
+			this->tasks.pop_front();
+		}
+		task();
+	}
+}
\ No newline at end of file
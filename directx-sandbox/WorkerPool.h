@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/* A fixed set of worker threads pulling tasks off one shared queue. Nothing fancy, it's for
+ * the chunky CPU work at load time (decoding, parsing, compiling), not for tiny per-frame jobs. */
+class WorkerPool {
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	// 0 threads means one per hardware thread, minus one for the main thread
+	bool Init(int);
+	void Shutdown();
+
+	void Submit(std::function<void()>);
+	int GetThreadCount();
+
+	// Index of the worker running the caller, or -1 when called from outside the pool
+	static int GetCurrentWorker();
+
+private:
+	void WorkerMain(int);
+
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <chrono>
+
+#include "../directx-sandbox/FramePipeline.h"
+
+/* Runs FramePipeline headless, with made-up stages that just spin for a while: simulation
+ * fills in a FrameState with draw items stamped with their frame number, submission checks
+ * every item it's handed belongs to the frame it says and that frames arrive one after
+ * another with none lost. The same stages are then run back to back on one thread, the way
+ * a frame used to go, to show what overlapping the two buys.
+ *
+ * While the pipeline runs, this thread plays the window thread and taps keys far quicker
+ * than frames go by. The simulation samples Input each frame like the real one does, and at
+ * the end every press has to be accounted for, along with how long they sat in the queue. */
+
+struct BenchOptions {
+	int frames;
+	int items;
+	int simulateUs;
+	int submitUs;
+	int keyUs;
+
+	BenchOptions() {
+		frames = 600;
+		items = 10000;
+		simulateUs = 2000;
+		submitUs = 2000;
+		keyUs = 500;
+	}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printUsage() {
+	printf("Usage: frame-bench [options]\n");
+	printf("  --frames N       frames to run (default 600)\n");
+	printf("  --items N        draw items per frame (default 10000)\n");
+	printf("  --simulate-us N  time simulating each frame takes, in microseconds (default 2000)\n");
+	printf("  --submit-us N    time submitting each frame takes, in microseconds (default 2000)\n");
+	printf("  --key-us N       time between key taps, in microseconds (default 500)\n");
+}
+
+int parseArgs(int argc, char* argv[], BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--frames" && i + 1 < argc) {
+			options.frames = atoi(argv[++i]);
+		}
+		else if (arg == "--items" && i + 1 < argc) {
+			options.items = atoi(argv[++i]);
+		}
+		else if (arg == "--simulate-us" && i + 1 < argc) {
+			options.simulateUs = atoi(argv[++i]);
+		}
+		else if (arg == "--submit-us" && i + 1 < argc) {
+			options.submitUs = atoi(argv[++i]);
+		}
+		else if (arg == "--key-us" && i + 1 < argc) {
+			options.keyUs = atoi(argv[++i]);
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.frames <= 0 || options.items < 0 || options.simulateUs < 0 || options.submitUs < 0 || options.keyUs < 0) {
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+// Stands in for real work without needing a core to itself to be timed right
+void spin(int us) {
+	Clock::time_point end = Clock::now() + std::chrono::microseconds(us);
+	while (Clock::now() < end) {
+	}
+}
+
+// Both stages, with what they've seen. Each field is only touched by one of them, so nothing
+// here needs to be atomic.
+struct Stages {
+	const BenchOptions* pOptions;
+	Input* pInput; // sampled at the start of each simulated frame when there is one
+	unsigned long long lastFrame;
+	int errors;
+	unsigned long long events, presses;
+	double latencyTotalMs, latencyMaxMs;
+
+	// Every key event, and how long it waited from being queued to being sampled
+	void CountInput(const InputSnapshot& snapshot) {
+		for (size_t i = 0; i < snapshot.events.size(); i++) {
+			const InputEvent& event = snapshot.events[i];
+			this->events++;
+			if (event.type == InputEvent::KEY_DOWN && !event.repeat) this->presses++;
+			double ms = std::chrono::duration<double, std::milli>(snapshot.time - event.time).count();
+			this->latencyTotalMs += ms;
+			if (ms > this->latencyMaxMs) this->latencyMaxMs = ms;
+			if (i > 0 && event.time < snapshot.events[i - 1].time) {
+				printf("ERROR: key events came out of order\n");
+				this->errors++;
+			}
+		}
+	}
+
+	bool Simulate(FrameState& state) {
+		if (state.frame > (unsigned long long)this->pOptions->frames) return false;
+		if (this->pInput) {
+			this->pInput->Sample(state.input);
+			CountInput(state.input);
+		}
+		state.view = DirectX::XMFLOAT4X4();
+		state.view._41 = (float)state.frame;
+		state.drawItems.resize(this->pOptions->items);
+		for (int i = 0; i < this->pOptions->items; i++) {
+			DrawItem& item = state.drawItems[i];
+			item.pModel = nullptr;
+			item.world = DirectX::XMFLOAT4X4();
+			item.world._41 = (float)state.frame;
+			item.world._42 = (float)i;
+			item.screenPixels = 0.0f;
+		}
+		spin(this->pOptions->simulateUs);
+		return true;
+	}
+
+	bool Submit(const FrameState& state) {
+		if (state.frame != this->lastFrame + 1) {
+			printf("ERROR: frame %llu came after %llu\n", state.frame, this->lastFrame);
+			this->errors++;
+		}
+		this->lastFrame = state.frame;
+		bool torn = state.view._41 != (float)state.frame || (int)state.drawItems.size() != this->pOptions->items;
+		for (size_t i = 0; i < state.drawItems.size() && !torn; i++) {
+			torn = state.drawItems[i].world._41 != (float)state.frame || state.drawItems[i].world._42 != (float)i;
+		}
+		if (torn) {
+			printf("ERROR: frame %llu's state is a mix of frames\n", state.frame);
+			this->errors++;
+		}
+		spin(this->pOptions->submitUs);
+		return true;
+	}
+};
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+	printf("%d frames, %d draw items each, %d us simulating and %d us submitting\n",
+		options.frames, options.items, options.simulateUs, options.submitUs);
+
+	// Back to back on this thread
+	Stages serial = { &options, nullptr, 0, 0, 0, 0, 0.0, 0.0 };
+	FrameState state;
+	auto serialStart = Clock::now();
+	for (int frame = 1; frame <= options.frames; frame++) {
+		state.frame = frame;
+		serial.Simulate(state);
+		serial.Submit(state);
+	}
+	double serialMs = msSince(serialStart);
+	printf("One thread:  %8.1f ms, %6.2f ms/frame\n", serialMs, serialMs / options.frames);
+
+	Input input;
+	input.Init();
+	Stages piped = { &options, &input, 0, 0, 0, 0, 0.0, 0.0 };
+	FramePipeline pipeline;
+	auto pipedStart = Clock::now();
+	pipeline.Start([&piped](FrameState& state) { return piped.Simulate(state); },
+		[&piped](const FrameState& state) { return piped.Submit(state); });
+	// Simulation stops it after the last frame, and submission has always taken that one by
+	// then, so there's nothing to wait for but the threads. Meanwhile keys get tapped, down
+	// and straight back up.
+	unsigned long long tapped = 0;
+	while (pipeline.IsRunning()) {
+		unsigned int key = 'A' + (unsigned int)(tapped % 26);
+		input.KeyDown(key, false);
+		input.KeyUp(key);
+		tapped++;
+		spin(options.keyUs);
+	}
+	pipeline.Stop();
+	double pipedMs = msSince(pipedStart);
+
+	// Whatever came in after the last frame was sampled is still queued
+	InputSnapshot leftover;
+	input.Sample(leftover);
+	unsigned long long sampledPresses = piped.presses;
+	piped.CountInput(leftover);
+
+	FramePipeline::Stats stats;
+	pipeline.GetStats(stats);
+	printf("Pipelined:   %8.1f ms, %6.2f ms/frame, %.2fx\n", pipedMs, pipedMs / options.frames,
+		pipedMs > 0.0 ? serialMs / pipedMs : 0.0);
+	// Whatever the stages took beyond the wall time must have run side by side
+	double overlapMs = stats.simulateMs + stats.submitMs - pipedMs;
+	printf("  %llu simulated in %.1f ms, %llu submitted in %.1f ms, %.1f ms of that overlapped\n",
+		stats.simulated, stats.simulateMs, stats.submitted, stats.submitMs, overlapMs > 0.0 ? overlapMs : 0.0);
+
+	// Each tap is a down and an up, every one of them has to have been sampled or dropped
+	printf("Input: %llu taps, %llu sampled by the frames, %llu events dropped, %.3f ms average wait, %.3f ms longest\n",
+		tapped, sampledPresses, input.GetDroppedCount(),
+		piped.events > 0 ? piped.latencyTotalMs / piped.events : 0.0, piped.latencyMaxMs);
+	if (piped.events + input.GetDroppedCount() != 2 * tapped) {
+		printf("ERROR: %llu key events went in but %llu came out\n", 2 * tapped, piped.events + input.GetDroppedCount());
+		return -10;
+	}
+
+	if (stats.submitted != stats.simulated || piped.lastFrame != (unsigned long long)options.frames) {
+		printf("ERROR: %llu frames simulated but %llu submitted, the last one %llu\n",
+			stats.simulated, stats.submitted, piped.lastFrame);
+		return -10;
+	}
+	if (serial.errors > 0 || piped.errors > 0) return -10;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../directx-sandbox/AssetIO.h"
+
+/* Runs AssetIO headless against files it writes itself, many more of them than the queue is
+ * deep. A first read is held up in its callback while the rest pile up, so the I/O thread gets
+ * them as one big batch, the way the startup reads arrive. Small files, files bigger than a
+ * chunk and missing files are mixed together, and every read has to come back exactly once
+ * with the bytes that were written (or fail, for the missing ones). */
+
+struct BenchOptions {
+	int files;
+	int largeEvery;
+	int missingEvery;
+	int holdMs;
+	int repeat;
+
+	BenchOptions() {
+		files = 300;
+		largeEvery = 50;
+		missingEvery = 37;
+		holdMs = 50;
+		repeat = 3;
+	}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printUsage() {
+	printf("Usage: io-bench [options]\n");
+	printf("  --files N          files to read each run (default 300)\n");
+	printf("  --large-every N    every Nth file is a few chunks long, 0 for none (default 50)\n");
+	printf("  --missing-every N  every Nth file doesn't exist, 0 for none (default 37)\n");
+	printf("  --hold-ms N        how long the first callback holds up the I/O thread (default 50)\n");
+	printf("  --repeat N         runs, on the same AssetIO (default 3)\n");
+}
+
+int parseArgs(int argc, char* argv[], BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--files" && i + 1 < argc) {
+			options.files = atoi(argv[++i]);
+		}
+		else if (arg == "--large-every" && i + 1 < argc) {
+			options.largeEvery = atoi(argv[++i]);
+		}
+		else if (arg == "--missing-every" && i + 1 < argc) {
+			options.missingEvery = atoi(argv[++i]);
+		}
+		else if (arg == "--hold-ms" && i + 1 < argc) {
+			options.holdMs = atoi(argv[++i]);
+		}
+		else if (arg == "--repeat" && i + 1 < argc) {
+			options.repeat = atoi(argv[++i]);
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.files <= 0 || options.largeEvery < 0 || options.missingEvery < 0 || options.holdMs < 0 || options.repeat <= 0) {
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+std::string fileName(int index) {
+	return "io-bench-" + std::to_string(index) + ".bin";
+}
+
+bool isMissing(const BenchOptions& options, int index) {
+	return options.missingEvery > 0 && index % options.missingEvery == options.missingEvery - 1;
+}
+
+// 1-12 KiB and not a multiple of the alignment, or for the large ones a couple of chunks and
+// a bit, so the last chunk is short too
+unsigned long long fileSize(const BenchOptions& options, int index) {
+	if (options.largeEvery > 0 && index % options.largeEvery == options.largeEvery - 1) {
+		return 2ULL * ASSET_IO_CHUNK_SIZE + 12345 + index;
+	}
+	return 1024 + (unsigned long long)(index * 2741) % (11 * 1024) + 1;
+}
+
+unsigned char fileByte(int index, unsigned long long offset) {
+	return (unsigned char)(index * 131 + offset * 7 + (offset >> 12));
+}
+
+bool writeFiles(const BenchOptions& options, unsigned long long& totalBytes) {
+	totalBytes = 0;
+	std::vector<unsigned char> data;
+	for (int i = 0; i < options.files; i++) {
+		std::string filename = fileName(i);
+		remove(filename.c_str());
+		if (isMissing(options, i)) continue;
+		unsigned long long size = fileSize(options, i);
+		data.resize((size_t)size);
+		for (unsigned long long j = 0; j < size; j++) data[(size_t)j] = fileByte(i, j);
+		FILE* pFile = fopen(filename.c_str(), "wb");
+		if (!pFile) {
+			printf("ERROR: Could not open '%s' for writing\n", filename.c_str());
+			return false;
+		}
+		bool ok = fwrite(data.data(), 1, data.size(), pFile) == data.size();
+		ok = fclose(pFile) == 0 && ok;
+		if (!ok) {
+			printf("ERROR: Could not write '%s'\n", filename.c_str());
+			return false;
+		}
+		totalBytes += size;
+	}
+	return true;
+}
+
+void removeFiles(const BenchOptions& options) {
+	for (int i = 0; i < options.files; i++) remove(fileName(i).c_str());
+}
+
+// What came back, counted from the I/O threads
+struct Results {
+	std::vector<std::atomic<int>> calls;
+	std::atomic<int> read, failed, wrong;
+
+	Results(int count) : calls(count), read(0), failed(0), wrong(0) {
+	}
+};
+
+void checkRead(const BenchOptions& options, Results& results, int index, AssetBuffer* pBuffer) {
+	results.calls[index]++;
+	if (!pBuffer) {
+		results.failed++;
+		if (!isMissing(options, index)) {
+			printf("ERROR: Reading '%s' failed\n", fileName(index).c_str());
+			results.wrong++;
+		}
+		return;
+	}
+	results.read++;
+	bool ok = !isMissing(options, index) && pBuffer->GetSize() == fileSize(options, index) &&
+		(uintptr_t)pBuffer->GetData() % ASSET_IO_ALIGNMENT == 0 && pBuffer->GetData()[pBuffer->GetSize()] == 0;
+	for (unsigned long long j = 0; ok && j < pBuffer->GetSize(); j++) ok = pBuffer->GetData()[j] == fileByte(index, j);
+	if (!ok) {
+		printf("ERROR: '%s' didn't read back as it was written\n", fileName(index).c_str());
+		results.wrong++;
+	}
+	delete pBuffer;
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	unsigned long long totalBytes = 0;
+	if (!writeFiles(options, totalBytes)) {
+		removeFiles(options);
+		return -10;
+	}
+
+	AssetIO io;
+	if (!io.Init(ASSET_IO_QUEUE_DEPTH, 0)) {
+		removeFiles(options);
+		return -10;
+	}
+	printf("%d files, %.1f MB, read through %s with a queue depth of %d\n",
+		options.files, totalBytes / (1024.0 * 1024.0), io.GetBackendName(), ASSET_IO_QUEUE_DEPTH);
+
+	int errors = 0;
+	for (int r = 0; r < options.repeat; r++) {
+		Results results(options.files);
+		auto start = Clock::now();
+		// The first read sits in its callback while the rest are queued behind it, so they all
+		// reach the I/O thread at once, far more than it can have in flight
+		int holdMs = options.holdMs;
+		io.Read(fileName(0).c_str(), [&options, &results, holdMs](AssetBuffer* pBuffer) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(holdMs));
+			checkRead(options, results, 0, pBuffer);
+		});
+		for (int i = 1; i < options.files; i++) {
+			io.Read(fileName(i).c_str(), [&options, &results, i](AssetBuffer* pBuffer) {
+				checkRead(options, results, i, pBuffer);
+			});
+		}
+		io.Wait();
+		double ms = msSince(start);
+
+		int expectedMissing = 0;
+		for (int i = 0; i < options.files; i++) {
+			if (isMissing(options, i)) expectedMissing++;
+			if (results.calls[i] != 1) {
+				printf("ERROR: '%s' called back %d times\n", fileName(i).c_str(), results.calls[i].load());
+				errors++;
+			}
+		}
+		if (results.failed != expectedMissing) {
+			printf("ERROR: %d reads failed, %d files are missing\n", results.failed.load(), expectedMissing);
+			errors++;
+		}
+		errors += results.wrong;
+		printf("  run %d: %d read, %d failed, %8.2f ms (%.2f ms of it held up), %.1f MB/s\n", r + 1,
+			results.read.load(), results.failed.load(), ms, (double)options.holdMs,
+			ms > options.holdMs ? totalBytes / (1024.0 * 1024.0) / ((ms - options.holdMs) / 1000.0) : 0.0);
+	}
+
+	io.Shutdown();
+	removeFiles(options);
+	return errors > 0 ? -10 : 0;
+}
\ No newline at end of file
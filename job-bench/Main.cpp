@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../directx-sandbox/JobSystem.h"
+
+/* Micro-benchmarks for JobSystem: what a job costs (pushed from one thread, and spawned from
+ * inside other jobs so everyone's stealing), how long a chain of dependent jobs takes per
+ * link, and how ParallelFor scales from one thread up, on even work and on work that gets
+ * heavier towards the end of the range. Each run prints how much got stolen and split. */
+
+struct BenchOptions {
+	int threads;
+	int jobs;
+	int chain;
+	int size;
+	int repeat;
+
+	BenchOptions() {
+		threads = 0;
+		jobs = 200000;
+		chain = 2000;
+		size = 1 << 22;
+		repeat = 5;
+	}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printUsage() {
+	printf("Usage: job-bench [options]\n");
+	printf("  --threads N    most threads to scale up to, 0 for one per hardware thread (default 0)\n");
+	printf("  --jobs N       empty jobs per overhead run (default 200000)\n");
+	printf("  --chain N      dependent jobs in the chain (default 2000)\n");
+	printf("  --size N       ParallelFor elements (default 4194304)\n");
+	printf("  --repeat N     runs of each, the best is kept (default 5)\n");
+}
+
+int parseArgs(int argc, char* argv[], BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			options.threads = atoi(argv[++i]);
+		}
+		else if (arg == "--jobs" && i + 1 < argc) {
+			options.jobs = atoi(argv[++i]);
+		}
+		else if (arg == "--chain" && i + 1 < argc) {
+			options.chain = atoi(argv[++i]);
+		}
+		else if (arg == "--size" && i + 1 < argc) {
+			options.size = atoi(argv[++i]);
+		}
+		else if (arg == "--repeat" && i + 1 < argc) {
+			options.repeat = atoi(argv[++i]);
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.threads < 0 || options.jobs <= 0 || options.chain <= 0 || options.size <= 0 || options.repeat <= 0) {
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+// Totals over every thread since the last ResetStats
+void printStats(JobSystem& jobs) {
+	JobSystem::Stats total = {};
+	unsigned long long mainExecuted = 0;
+	for (int i = 0; i < jobs.GetThreadCount(); i++) {
+		JobSystem::Stats stats;
+		jobs.GetStats(i, stats);
+		if (i == 0) mainExecuted = stats.executed;
+		total.executed += stats.executed;
+		total.stolen += stats.stolen;
+		total.stealAttempts += stats.stealAttempts;
+		total.splits += stats.splits;
+	}
+	printf("      %llu jobs run (%.0f%% on the main thread), %llu stolen in %llu attempts (%.1f%%), %llu splits\n",
+		total.executed, total.executed ? 100.0 * mainExecuted / total.executed : 0.0,
+		total.stolen, total.stealAttempts, total.stealAttempts ? 100.0 * total.stolen / total.stealAttempts : 0.0,
+		total.splits);
+}
+
+// Every job is pushed by the main thread, which then helps until they're done
+double timeFlatJobs(JobSystem& jobs, int count, std::atomic<int>& ran) {
+	auto start = Clock::now();
+	JobSystem::Counter counter;
+	for (int i = 0; i < count; i++) jobs.Run([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+	jobs.Wait(&counter);
+	return msSince(start);
+}
+
+// A few jobs each spawn a batch of children from wherever they're running, so the pushes are
+// spread over every thread's deque and most of the work has to be stolen to get started
+double timeNestedJobs(JobSystem& jobs, int count, std::atomic<int>& ran) {
+	const int CHILDREN = 256;
+	auto start = Clock::now();
+	JobSystem::Counter counter;
+	for (int parent = 0; parent < count / CHILDREN; parent++) {
+		jobs.Run([&] {
+			for (int i = 0; i < CHILDREN; i++) jobs.Run([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		}, &counter);
+	}
+	jobs.Wait(&counter);
+	return msSince(start);
+}
+
+// Each link can only start once the one before it has finished, so this is all latency: the
+// finishing thread hands the next job out, someone picks it up
+double timeChain(JobSystem& jobs, int length, bool& inOrder) {
+	std::vector<JobSystem::Counter> counters(length);
+	std::atomic<int> next(0);
+	std::atomic<bool> ordered(true);
+	auto start = Clock::now();
+	for (int i = 0; i < length; i++) {
+		jobs.Run([i, &next, &ordered] {
+			if (next.fetch_add(1) != i) ordered = false;
+		}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+	}
+	jobs.Wait(&counters[length - 1]);
+	double ms = msSince(start);
+	inOrder = ordered && next == length;
+	return ms;
+}
+
+// A few dozen flops per element, with the uneven version doing up to 16 times as much at
+// the end of the range as at the start
+float work(int i, int size, bool uneven) {
+	int rounds = uneven ? 1 + (int)(15.0 * i / size) : 4;
+	float value = (float)i;
+	for (int r = 0; r < rounds; r++) value = sqrtf(value * 1.0001f + 1.0f) + sinf(value);
+	return value;
+}
+
+double timeParallelFor(JobSystem& jobs, std::vector<float>& output, std::vector<unsigned char>& visits, bool uneven) {
+	int size = (int)output.size();
+	auto start = Clock::now();
+	jobs.ParallelFor(0, size, 0, [&](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			output[i] = work(i, size, uneven);
+			visits[i]++;
+		}
+	});
+	return msSince(start);
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+	int maxThreads = options.threads;
+	if (maxThreads <= 0) {
+		maxThreads = (int)std::thread::hardware_concurrency();
+		if (maxThreads < 1) maxThreads = 1;
+	}
+
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	printf("Job overhead, %d empty jobs:\n", options.jobs);
+	for (size_t t = 0; t < threadCounts.size(); t++) {
+		JobSystem jobs;
+		jobs.Init(threadCounts[t]);
+		for (int nested = 0; nested < 2; nested++) {
+			double best = 0.0;
+			for (int r = 0; r < options.repeat; r++) {
+				if (r == options.repeat - 1) jobs.ResetStats();
+				std::atomic<int> ran(0);
+				double ms = nested ? timeNestedJobs(jobs, options.jobs, ran) : timeFlatJobs(jobs, options.jobs, ran);
+				int expected = nested ? options.jobs / 256 * 256 : options.jobs;
+				if (ran != expected) {
+					printf("ERROR: %d of %d jobs ran\n", ran.load(), expected);
+					return -10;
+				}
+				if (r == 0 || ms < best) best = ms;
+			}
+			int count = nested ? options.jobs / 256 * 256 : options.jobs;
+			printf("  %2d threads, %-6s %8.2f ms, %6.1f ns per job\n", jobs.GetThreadCount(),
+				nested ? "nested" : "flat", best, best * 1e6 / count);
+			printStats(jobs);
+		}
+		jobs.Shutdown();
+	}
+
+	printf("Dependency chain, %d links:\n", options.chain);
+	for (size_t t = 0; t < threadCounts.size(); t++) {
+		JobSystem jobs;
+		jobs.Init(threadCounts[t]);
+		double best = 0.0;
+		for (int r = 0; r < options.repeat; r++) {
+			if (r == options.repeat - 1) jobs.ResetStats();
+			bool inOrder = false;
+			double ms = timeChain(jobs, options.chain, inOrder);
+			if (!inOrder) {
+				printf("ERROR: the chain ran out of order\n");
+				return -10;
+			}
+			if (r == 0 || ms < best) best = ms;
+		}
+		printf("  %2d threads  %8.2f ms, %6.2f us per link\n", jobs.GetThreadCount(), best, best * 1000.0 / options.chain);
+		printStats(jobs);
+		jobs.Shutdown();
+	}
+
+	std::vector<float> output(options.size);
+	std::vector<unsigned char> visits(options.size);
+	for (int uneven = 0; uneven < 2; uneven++) {
+		printf("ParallelFor scaling, %d elements, %s work:\n", options.size, uneven ? "uneven" : "even");
+		double single = 0.0;
+		for (size_t t = 0; t < threadCounts.size(); t++) {
+			JobSystem jobs;
+			jobs.Init(threadCounts[t]);
+			double best = 0.0;
+			for (int r = 0; r < options.repeat; r++) {
+				if (r == options.repeat - 1) jobs.ResetStats();
+				std::fill(visits.begin(), visits.end(), (unsigned char)0);
+				double ms = timeParallelFor(jobs, output, visits, uneven != 0);
+				for (int i = 0; i < options.size; i++) {
+					if (visits[i] != 1) {
+						printf("ERROR: element %d was visited %d times\n", i, visits[i]);
+						return -10;
+					}
+				}
+				if (r == 0 || ms < best) best = ms;
+			}
+			if (t == 0) single = best;
+			printf("  %2d threads  %8.2f ms, %.2fx\n", jobs.GetThreadCount(), best, best > 0.0 ? single / best : 0.0);
+			printStats(jobs);
+			jobs.Shutdown();
+		}
+	}
+	return 0;
+}
\ No newline at end of file
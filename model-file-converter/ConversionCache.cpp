@@ -0,0 +1,139 @@
+#include "ConversionCache.h"
+
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <filesystem>
+
+static const char* const CACHE_HEADER = "model-file-converter cache 1";
+
+static const unsigned long long FNV_OFFSET = 14695981039346656037ull;
+static const unsigned long long FNV_PRIME = 1099511628211ull;
+
+ConversionCache::ConversionCache() {
+}
+
+bool ConversionCache::Load(const std::string& filename) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->filename = filename;
+	this->entries.clear();
+
+	std::ifstream fin(filename);
+	if (!fin.is_open()) return true;
+
+	std::string line;
+	if (!std::getline(fin, line) || line != CACHE_HEADER) {
+		printf("Ignoring conversion cache '%s', it's from something else\n", filename.c_str());
+		return false;
+	}
+	// <content hash> <options hash> <output size> <output path>, the path last since it can have spaces
+	while (std::getline(fin, line)) {
+		std::istringstream iss(line);
+		Entry entry;
+		std::string outputPath;
+		if (!(iss >> std::hex >> entry.contentHash >> entry.optionsHash >> std::dec >> entry.outputSize)) {
+			printf("Ignoring damaged conversion cache '%s'\n", filename.c_str());
+			this->entries.clear();
+			return false;
+		}
+		iss.get();
+		std::getline(iss, outputPath);
+		this->entries[outputPath] = entry;
+	}
+	return true;
+}
+
+// Written to the side and renamed over the old one, so a crash mid-save can't leave a cache that
+// claims outputs are up to date when they aren't
+bool ConversionCache::Save() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (this->filename.empty()) return false;
+
+	std::string tempFilename = this->filename + ".tmp";
+	std::ofstream fout(tempFilename, std::ios::trunc);
+	if (!fout.is_open()) {
+		printf("ERROR: could not write conversion cache '%s'\n", tempFilename.c_str());
+		return false;
+	}
+	fout << CACHE_HEADER << "\n";
+	char hashes[64];
+	for (auto it = this->entries.begin(); it != this->entries.end(); ++it) {
+		snprintf(hashes, sizeof(hashes), "%016llx %016llx ", it->second.contentHash, it->second.optionsHash);
+		fout << hashes << it->second.outputSize << " " << it->first << "\n";
+	}
+	fout.close();
+	if (fout.fail()) {
+		printf("ERROR: could not write conversion cache '%s'\n", tempFilename.c_str());
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFilename, this->filename, error);
+	if (error) {
+		printf("ERROR: could not replace conversion cache '%s': %s\n", this->filename.c_str(), error.message().c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ConversionCache::Lookup(const std::string& outputPath, unsigned long long contentHash, unsigned long long optionsHash) {
+	Entry entry;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto it = this->entries.find(outputPath);
+		if (it == this->entries.end()) return false;
+		entry = it->second;
+	}
+	if (entry.contentHash != contentHash || entry.optionsHash != optionsHash) return false;
+
+	// Someone may have deleted or touched the output since
+	std::error_code error;
+	unsigned long long size = std::filesystem::file_size(outputPath, error);
+	return !error && size == entry.outputSize;
+}
+
+void ConversionCache::Store(const std::string& outputPath, unsigned long long contentHash, unsigned long long optionsHash) {
+	std::error_code error;
+	unsigned long long size = std::filesystem::file_size(outputPath, error);
+	if (error) return;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	Entry& entry = this->entries[outputPath];
+	entry.contentHash = contentHash;
+	entry.optionsHash = optionsHash;
+	entry.outputSize = size;
+}
+
+void ConversionCache::Forget(const std::string& outputPath) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->entries.erase(outputPath);
+}
+
+// 64-bit FNV-1a over the whole file. Not cryptographic, it only has to notice edits, and it's a
+// lot cheaper than the conversion it saves.
+bool ConversionCache::HashFile(const std::string& filename, unsigned long long& hash) {
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin.is_open()) return false;
+
+	hash = FNV_OFFSET;
+	std::vector<char> chunk(1 << 20);
+	while (fin) {
+		fin.read(chunk.data(), chunk.size());
+		std::streamsize count = fin.gcount();
+		for (std::streamsize i = 0; i < count; i++) {
+			hash ^= (unsigned char)chunk[i];
+			hash *= FNV_PRIME;
+		}
+	}
+	return fin.eof();
+}
+
+unsigned long long ConversionCache::HashString(const std::string& text) {
+	unsigned long long hash = FNV_OFFSET;
+	for (size_t i = 0; i < text.size(); i++) {
+		hash ^= (unsigned char)text[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
\ No newline at end of file
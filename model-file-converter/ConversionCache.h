@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+
+/* Remembers what each output file was converted from, so a batch run can skip any input that
+ * hasn't changed since last time. An entry matches when the input's content hash and the
+ * converter's options fingerprint are both the same and the output is still there at the size
+ * we wrote it. Keyed by output path since that's what identifies a conversion in a batch.
+ *
+ * Lookup and Store are safe to call from several threads at once. */
+class ConversionCache {
+public:
+	ConversionCache();
+
+	// A missing cache file is fine (everything converts), a damaged one is just ignored
+	bool Load(const std::string&);
+	bool Save();
+
+	bool Lookup(const std::string&, unsigned long long, unsigned long long);
+	void Store(const std::string&, unsigned long long, unsigned long long);
+	void Forget(const std::string&);
+
+	static bool HashFile(const std::string&, unsigned long long&);
+	static unsigned long long HashString(const std::string&);
+
+private:
+	struct Entry {
+		unsigned long long contentHash;
+		unsigned long long optionsHash;
+		unsigned long long outputSize;
+	};
+
+	std::string filename;
+	std::map<std::string, Entry> entries;
+	std::mutex mutex;
+};
\ No newline at end of file
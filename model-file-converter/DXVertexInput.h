@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+// This represents the output type of this program (i.e., the input to the DirectX vertex buf)
+struct DXVertexInput {
+	float posX, posY, posZ;
+	float texU, texV;
+	float normX, normY, normZ;
+
+	DXVertexInput() {
+		posX = posY = posZ = texU = texV = normX = normY = normZ = 0.0f;
+	}
+
+	DXVertexInput(
+		const std::vector<float>& pos,
+		const std::vector<float>& tex,
+		const std::vector<float>& norm)
+	{
+		posX = pos.at(0); posY = pos.at(1); posZ = pos.at(2);
+		texU = tex.at(0); texV = 1.0 - tex.at(1);
+		normX = norm.at(0); normY = norm.at(1); normZ = norm.at(2);
+	}
+};
+
+// A run of vertices sharing one material. These follow the vertices in the output as
+// "submesh <first vertex> <vertex count> <material> <texture>" lines, and the game draws each
+// one as its own range of the shared buffers. The texture is whatever the material file names,
+// or "-" without one, and comes last since paths can have spaces in them.
+struct SubmeshRange {
+	unsigned long long start, count;
+	std::string material;
+	std::string texture;
+
+	std::string Format() const {
+		char strBuf[64];
+		snprintf(strBuf, sizeof(strBuf), "submesh %llu %llu ", start, count);
+		return strBuf + material + " " + (texture.empty() ? "-" : texture) + "\n";
+	}
+};
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include "GlbImporter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <string>
+#include <algorithm>
+
+static const unsigned int GLB_MAGIC = 0x46546C67;      // "glTF"
+static const unsigned int GLB_VERSION = 2;
+static const unsigned int GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+static const unsigned int GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+static const int COMPONENT_BYTE = 5120;
+static const int COMPONENT_UNSIGNED_BYTE = 5121;
+static const int COMPONENT_SHORT = 5122;
+static const int COMPONENT_UNSIGNED_SHORT = 5123;
+static const int COMPONENT_UNSIGNED_INT = 5125;
+static const int COMPONENT_FLOAT = 5126;
+
+static const int MODE_TRIANGLES = 4;
+
+// Node hierarchies deeper than this are almost certainly a cycle
+static const int MAX_NODE_DEPTH = 256;
+static const size_t EMIT_BLOCK_VERTICES = 64 * 1024;
+
+static int componentSize(int componentType) {
+	switch (componentType) {
+	case COMPONENT_BYTE: case COMPONENT_UNSIGNED_BYTE: return 1;
+	case COMPONENT_SHORT: case COMPONENT_UNSIGNED_SHORT: return 2;
+	case COMPONENT_UNSIGNED_INT: case COMPONENT_FLOAT: return 4;
+	default: return 0;
+	}
+}
+
+static int typeComponents(const std::string& type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+static unsigned int read32(const unsigned char* p) {
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+// One component of any type as a float, normalized the way the glTF spec says if asked to
+static float readComponent(const unsigned char* p, int componentType, bool normalized) {
+	switch (componentType) {
+	case COMPONENT_BYTE: {
+		signed char value = (signed char)*p;
+		return normalized ? fmaxf(value / 127.0f, -1.0f) : (float)value;
+	}
+	case COMPONENT_UNSIGNED_BYTE:
+		return normalized ? *p / 255.0f : (float)*p;
+	case COMPONENT_SHORT: {
+		short value;
+		memcpy(&value, p, sizeof(value));
+		return normalized ? fmaxf(value / 32767.0f, -1.0f) : (float)value;
+	}
+	case COMPONENT_UNSIGNED_SHORT: {
+		unsigned short value;
+		memcpy(&value, p, sizeof(value));
+		return normalized ? value / 65535.0f : (float)value;
+	}
+	case COMPONENT_UNSIGNED_INT:
+		return (float)read32(p);
+	default: {
+		float value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	}
+}
+
+static void identity(float* m) {
+	memset(m, 0, 16 * sizeof(float));
+	m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+// out = a * b, all column major
+static void multiply(const float* a, const float* b, float* out) {
+	float result[16];
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			float sum = 0.0f;
+			for (int k = 0; k < 4; k++) sum += a[k * 4 + row] * b[col * 4 + k];
+			result[col * 4 + row] = sum;
+		}
+	}
+	memcpy(out, result, sizeof(result));
+}
+
+// A node's local transform, from either its matrix or its translation/rotation/scale
+static void nodeMatrix(const JsonValue& node, float* m) {
+	identity(m);
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.GetCount() == 16) {
+		for (size_t i = 0; i < 16; i++) m[i] = (float)matrix[i].GetNumber(m[i]);
+		return;
+	}
+
+	const JsonValue& t = node["translation"];
+	const JsonValue& r = node["rotation"];
+	const JsonValue& s = node["scale"];
+	float x = (float)r[(size_t)0].GetNumber(0.0), y = (float)r[1].GetNumber(0.0);
+	float z = (float)r[2].GetNumber(0.0), w = (float)r[3].GetNumber(1.0);
+	float sx = (float)s[(size_t)0].GetNumber(1.0), sy = (float)s[1].GetNumber(1.0), sz = (float)s[2].GetNumber(1.0);
+
+	// Rotation matrix of the unit quaternion, with each column scaled
+	m[0] = (1 - 2 * (y * y + z * z)) * sx;
+	m[1] = (2 * (x * y + z * w)) * sx;
+	m[2] = (2 * (x * z - y * w)) * sx;
+	m[4] = (2 * (x * y - z * w)) * sy;
+	m[5] = (1 - 2 * (x * x + z * z)) * sy;
+	m[6] = (2 * (y * z + x * w)) * sy;
+	m[8] = (2 * (x * z + y * w)) * sz;
+	m[9] = (2 * (y * z - x * w)) * sz;
+	m[10] = (1 - 2 * (x * x + y * y)) * sz;
+	m[12] = (float)t[(size_t)0].GetNumber(0.0);
+	m[13] = (float)t[1].GetNumber(0.0);
+	m[14] = (float)t[2].GetNumber(0.0);
+}
+
+static void normalize(float* v) {
+	float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length > 0.0f) {
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+}
+
+GlbImporter::GlbImporter() {
+	this->pBin = nullptr;
+	this->binSize = 0;
+	this->vertexCount = 0;
+	this->inPlaceAccessors = 0;
+	this->convertedAccessors = 0;
+}
+
+bool GlbImporter::Open(const char* filename) {
+	Close();
+	if (!this->file.OpenLoose(filename)) return false;
+
+	const unsigned char* pData = this->file.GetData();
+	unsigned long long size = this->file.GetSize();
+	if (size < 20 || read32(pData) != GLB_MAGIC) {
+		printf("ERROR: '%s' isn't a binary glTF file\n", filename);
+		return false;
+	}
+	if (read32(pData + 4) != GLB_VERSION) {
+		printf("ERROR: '%s' is glTF version %u, only version 2 is supported\n", filename, read32(pData + 4));
+		return false;
+	}
+	if (read32(pData + 8) < size) size = read32(pData + 8);
+
+	// The JSON chunk always comes first, a BIN chunk may follow
+	const char* pJson = nullptr;
+	unsigned long long jsonSize = 0;
+	for (unsigned long long offset = 12; offset + 8 <= size; ) {
+		unsigned long long chunkSize = read32(pData + offset);
+		unsigned int chunkType = read32(pData + offset + 4);
+		if (chunkSize > size - offset - 8) {
+			printf("ERROR: '%s' has a chunk that runs past the end of the file\n", filename);
+			return false;
+		}
+		if (chunkType == GLB_CHUNK_JSON && !pJson) {
+			pJson = (const char*)pData + offset + 8;
+			jsonSize = chunkSize;
+		}
+		else if (chunkType == GLB_CHUNK_BIN && !this->pBin) {
+			this->pBin = pData + offset + 8;
+			this->binSize = chunkSize;
+		}
+		offset += 8 + ((chunkSize + 3) & ~3ull);
+	}
+	if (!pJson) {
+		printf("ERROR: '%s' has no JSON chunk\n", filename);
+		return false;
+	}
+	if (!JsonValue::Parse(pJson, (size_t)jsonSize, this->json)) {
+		printf("ERROR: '%s' has broken JSON\n", filename);
+		return false;
+	}
+
+	// Everything in the default scene, or with no scenes at all, every mesh as it is
+	const JsonValue& scenes = this->json["scenes"];
+	if (scenes.GetCount() > 0) {
+		const JsonValue& scene = scenes[(size_t)this->json["scene"].GetInt(0)];
+		const JsonValue& roots = scene["nodes"];
+		float root[16];
+		identity(root);
+		for (size_t i = 0; i < roots.GetCount(); i++) {
+			if (!CollectNode(roots[i].GetInt(-1), root, 0)) return false;
+		}
+	}
+	else {
+		float root[16];
+		identity(root);
+		for (size_t i = 0; i < this->json["meshes"].GetCount(); i++) {
+			if (!AddMesh((int)i, root)) return false;
+		}
+	}
+
+	// Stable, so primitives sharing a material keep their order
+	std::stable_sort(this->draws.begin(), this->draws.end(), [](const Draw& a, const Draw& b) { return a.material < b.material; });
+	return true;
+}
+
+void GlbImporter::Close() {
+	this->file.Close();
+	this->json = JsonValue();
+	this->pBin = nullptr;
+	this->binSize = 0;
+	this->draws.clear();
+	this->vertexCount = 0;
+	this->inPlaceAccessors = 0;
+	this->convertedAccessors = 0;
+}
+
+unsigned long long GlbImporter::GetVertexCount() {
+	return this->vertexCount;
+}
+
+int GlbImporter::GetPrimitiveCount() {
+	return (int)this->draws.size();
+}
+
+int GlbImporter::GetInPlaceAccessors() {
+	return this->inPlaceAccessors;
+}
+
+int GlbImporter::GetConvertedAccessors() {
+	return this->convertedAccessors;
+}
+
+void GlbImporter::GetSubmeshes(std::vector<SubmeshRange>& submeshes) {
+	submeshes.clear();
+	bool anyMaterial = false;
+	for (size_t i = 0; i < this->draws.size(); i++) anyMaterial |= this->draws[i].material >= 0;
+	if (!anyMaterial) return;
+
+	unsigned long long start = 0;
+	for (size_t i = 0; i < this->draws.size(); i++) {
+		const Draw& draw = this->draws[i];
+		if (i > 0 && this->draws[i - 1].material == draw.material) {
+			submeshes.back().count += draw.vertexCount;
+		}
+		else {
+			SubmeshRange range;
+			range.start = start;
+			range.count = draw.vertexCount;
+			range.material = "-";
+			range.texture = "-";
+			if (draw.material >= 0) {
+				range.material = this->json["materials"][(size_t)draw.material]["name"].GetString();
+				if (range.material.empty()) range.material = "material" + std::to_string(draw.material);
+				for (size_t c = 0; c < range.material.size(); c++) {
+					if (isspace((unsigned char)range.material[c])) range.material[c] = '_';
+				}
+				range.texture = GetTextureUri(draw.material);
+			}
+			submeshes.push_back(range);
+		}
+		start += draw.vertexCount;
+	}
+}
+
+// Follows material -> texture -> image, only external files have something to give back
+std::string GlbImporter::GetTextureUri(int materialIndex) {
+	const JsonValue& material = this->json["materials"][(size_t)materialIndex];
+	int textureIndex = material["pbrMetallicRoughness"]["baseColorTexture"]["index"].GetInt(-1);
+	if (textureIndex < 0) return "-";
+	int imageIndex = this->json["textures"][(size_t)textureIndex]["source"].GetInt(-1);
+	if (imageIndex < 0) return "-";
+	const std::string& uri = this->json["images"][(size_t)imageIndex]["uri"].GetString();
+	if (uri.empty() || uri.compare(0, 5, "data:") == 0) return "-";
+	return uri;
+}
+
+bool GlbImporter::CollectNode(int nodeIndex, const float* parent, int depth) {
+	const JsonValue& node = this->json["nodes"][(size_t)nodeIndex];
+	if (nodeIndex < 0 || node.IsNull() || depth > MAX_NODE_DEPTH) {
+		printf("ERROR: Node %d is missing or nested too deep\n", nodeIndex);
+		return false;
+	}
+
+	float local[16], world[16];
+	nodeMatrix(node, local);
+	multiply(parent, local, world);
+	if (node.Has("mesh") && !AddMesh(node["mesh"].GetInt(-1), world)) return false;
+
+	const JsonValue& children = node["children"];
+	for (size_t i = 0; i < children.GetCount(); i++) {
+		if (!CollectNode(children[i].GetInt(-1), world, depth + 1)) return false;
+	}
+	return true;
+}
+
+// Queues up the mesh's triangle primitives and adds up how many vertices they'll make, so the
+// count can be written before any vertices are
+bool GlbImporter::AddMesh(int meshIndex, const float* matrix) {
+	const JsonValue& mesh = this->json["meshes"][(size_t)meshIndex];
+	if (meshIndex < 0 || mesh.IsNull()) {
+		printf("ERROR: Mesh %d is missing\n", meshIndex);
+		return false;
+	}
+
+	const JsonValue& primitives = mesh["primitives"];
+	for (size_t i = 0; i < primitives.GetCount(); i++) {
+		const JsonValue& primitive = primitives[i];
+		if (primitive["mode"].GetInt(MODE_TRIANGLES) != MODE_TRIANGLES) {
+			printf("Skipping primitive %d of mesh %d, it isn't a triangle list\n", (int)i, meshIndex);
+			continue;
+		}
+
+		Accessor positions;
+		if (!GetAccessor(primitive["attributes"]["POSITION"].GetInt(-1), 3, positions)) return false;
+		unsigned long long count = positions.count;
+		if (primitive.Has("indices")) {
+			Accessor indices;
+			if (!GetAccessor(primitive["indices"].GetInt(-1), 1, indices)) return false;
+			if (indices.componentType != COMPONENT_UNSIGNED_BYTE && indices.componentType != COMPONENT_UNSIGNED_SHORT
+				&& indices.componentType != COMPONENT_UNSIGNED_INT)
+			{
+				printf("ERROR: Primitive %d of mesh %d has indices that aren't unsigned integers\n", (int)i, meshIndex);
+				return false;
+			}
+			count = indices.count;
+		}
+		if (count % 3 != 0) {
+			printf("ERROR: Primitive %d of mesh %d has %llu vertices, not whole triangles\n", (int)i, meshIndex, count);
+			return false;
+		}
+
+		Draw draw;
+		draw.pPrimitive = &primitive;
+		memcpy(draw.matrix, matrix, sizeof(draw.matrix));
+		draw.material = primitive["material"].GetInt(-1);
+		draw.vertexCount = count;
+		this->draws.push_back(draw);
+		this->vertexCount += count;
+	}
+	return true;
+}
+
+// Checks the accessor lies inside the BIN chunk, and gives back where its elements start
+bool GlbImporter::GetAccessor(int index, int components, Accessor& accessor) {
+	const JsonValue& json = this->json["accessors"][(size_t)index];
+	if (index < 0 || json.IsNull()) {
+		printf("ERROR: Accessor %d is missing\n", index);
+		return false;
+	}
+	if (json.Has("sparse") || !json.Has("bufferView")) {
+		printf("ERROR: Accessor %d is sparse or has no buffer view, neither is supported\n", index);
+		return false;
+	}
+
+	accessor.componentType = json["componentType"].GetInt(0);
+	accessor.components = typeComponents(json["type"].GetString());
+	accessor.normalized = json["normalized"].GetBool(false);
+	accessor.count = (unsigned long long)json["count"].GetNumber(0.0);
+	int size = componentSize(accessor.componentType);
+	if (size == 0 || accessor.components != components) {
+		printf("ERROR: Accessor %d has type %s/%d, expected %d components\n",
+			index, json["type"].GetString().c_str(), accessor.componentType, components);
+		return false;
+	}
+
+	const JsonValue& view = this->json["bufferViews"][(size_t)json["bufferView"].GetInt(-1)];
+	const JsonValue& buffer = this->json["buffers"][(size_t)view["buffer"].GetInt(-1)];
+	if (view.IsNull() || view["buffer"].GetInt(-1) != 0 || buffer.Has("uri") || !this->pBin) {
+		printf("ERROR: Accessor %d isn't in the GLB's own binary chunk (external buffers aren't supported)\n", index);
+		return false;
+	}
+
+	size_t elementSize = (size_t)size * components;
+	accessor.stride = (size_t)view["byteStride"].GetInt(0);
+	if (accessor.stride == 0) accessor.stride = elementSize;
+	unsigned long long viewOffset = (unsigned long long)view["byteOffset"].GetNumber(0.0);
+	unsigned long long viewLength = (unsigned long long)view["byteLength"].GetNumber(0.0);
+	unsigned long long offset = (unsigned long long)json["byteOffset"].GetNumber(0.0);
+	unsigned long long span = accessor.count == 0 ? 0 : accessor.stride * (accessor.count - 1) + elementSize;
+	if (accessor.stride < elementSize || viewOffset > this->binSize || viewLength > this->binSize - viewOffset
+		|| offset > viewLength || span > viewLength - offset)
+	{
+		printf("ERROR: Accessor %d runs outside its buffer view or the binary chunk\n", index);
+		return false;
+	}
+	accessor.pData = this->pBin + viewOffset + offset;
+	return true;
+}
+
+// Tightly packed, aligned floats are used straight out of the mapping. Anything else gets
+// converted into the scratch vector.
+const float* GlbImporter::ReadFloats(const Accessor& accessor, std::vector<float>& scratch) {
+	size_t elementSize = accessor.components * sizeof(float);
+	if (accessor.componentType == COMPONENT_FLOAT && accessor.stride == elementSize
+		&& (size_t)accessor.pData % alignof(float) == 0)
+	{
+		this->inPlaceAccessors++;
+		return (const float*)accessor.pData;
+	}
+
+	this->convertedAccessors++;
+	int size = componentSize(accessor.componentType);
+	scratch.resize((size_t)accessor.count * accessor.components);
+	for (unsigned long long i = 0; i < accessor.count; i++) {
+		const unsigned char* pElement = accessor.pData + i * accessor.stride;
+		for (int c = 0; c < accessor.components; c++) {
+			scratch[(size_t)i * accessor.components + c] = readComponent(pElement + c * size, accessor.componentType, accessor.normalized);
+		}
+	}
+	return scratch.data();
+}
+
+const unsigned int* GlbImporter::ReadIndices(const Accessor& accessor, std::vector<unsigned int>& scratch) {
+	if (accessor.componentType == COMPONENT_UNSIGNED_INT && accessor.stride == sizeof(unsigned int)
+		&& (size_t)accessor.pData % alignof(unsigned int) == 0)
+	{
+		this->inPlaceAccessors++;
+		return (const unsigned int*)accessor.pData;
+	}
+
+	this->convertedAccessors++;
+	scratch.resize((size_t)accessor.count);
+	for (unsigned long long i = 0; i < accessor.count; i++) {
+		const unsigned char* pElement = accessor.pData + i * accessor.stride;
+		switch (accessor.componentType) {
+		case COMPONENT_UNSIGNED_BYTE: scratch[(size_t)i] = *pElement; break;
+		case COMPONENT_UNSIGNED_SHORT: { unsigned short value; memcpy(&value, pElement, 2); scratch[(size_t)i] = value; break; }
+		default: scratch[(size_t)i] = read32(pElement); break;
+		}
+	}
+	return scratch.data();
+}
+
+bool GlbImporter::Emit(const Sink& sink) {
+	std::vector<DXVertexInput> block;
+	block.reserve(EMIT_BLOCK_VERTICES);
+	for (size_t i = 0; i < this->draws.size(); i++) {
+		if (!EmitDraw(this->draws[i], block, sink)) return false;
+	}
+	return block.empty() || sink(block.data(), block.size());
+}
+
+bool GlbImporter::EmitDraw(const Draw& draw, std::vector<DXVertexInput>& block, const Sink& sink) {
+	const JsonValue& primitive = *draw.pPrimitive;
+	const JsonValue& attributes = primitive["attributes"];
+	std::vector<float> positionScratch, normalScratch, texelScratch;
+	std::vector<unsigned int> indexScratch;
+
+	Accessor positions, normals, texels, indices;
+	if (!GetAccessor(attributes["POSITION"].GetInt(-1), 3, positions)) return false;
+	const float* pPositions = ReadFloats(positions, positionScratch);
+	const float* pNormals = nullptr;
+	const float* pTexels = nullptr;
+	if (attributes.Has("NORMAL")) {
+		if (!GetAccessor(attributes["NORMAL"].GetInt(-1), 3, normals)) return false;
+		pNormals = ReadFloats(normals, normalScratch);
+	}
+	if (attributes.Has("TEXCOORD_0")) {
+		if (!GetAccessor(attributes["TEXCOORD_0"].GetInt(-1), 2, texels)) return false;
+		pTexels = ReadFloats(texels, texelScratch);
+	}
+	if ((pNormals && normals.count < positions.count) || (pTexels && texels.count < positions.count)) {
+		printf("ERROR: A primitive has fewer normals or texcoords than positions\n");
+		return false;
+	}
+
+	const unsigned int* pIndices = nullptr;
+	unsigned long long count = positions.count;
+	if (primitive.Has("indices")) {
+		if (!GetAccessor(primitive["indices"].GetInt(-1), 1, indices)) return false;
+		pIndices = ReadIndices(indices, indexScratch);
+		count = indices.count;
+	}
+
+	// Normals take the inverse transpose of the upper 3x3. Its columns are the cross products of
+	// the matrix's columns over the determinant; only the determinant's sign matters once the
+	// normal is renormalized. A mirroring transform also turns the triangles inside out, so
+	// their winding gets swapped back.
+	const float* m = draw.matrix;
+	float cofactor[9] = {
+		m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+		m[9] * m[2] - m[10] * m[1], m[10] * m[0] - m[8] * m[2], m[8] * m[1] - m[9] * m[0],
+		m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4],
+	};
+	float determinant = m[0] * cofactor[0] + m[1] * cofactor[1] + m[2] * cofactor[2];
+	float normalSign = determinant < 0.0f ? -1.0f : 1.0f;
+
+	for (unsigned long long t = 0; t < count; t += 3) {
+		DXVertexInput corners[3];
+		for (int c = 0; c < 3; c++) {
+			unsigned long long vertex = pIndices ? pIndices[t + c] : t + c;
+			if (vertex >= positions.count) {
+				printf("ERROR: Index %llu is past the %llu positions\n", vertex, positions.count);
+				return false;
+			}
+			const float* p = pPositions + vertex * 3;
+			DXVertexInput& out = corners[c];
+			out.posX = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+			out.posY = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+			out.posZ = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+			if (pTexels) {
+				out.texU = pTexels[vertex * 2];
+				out.texV = pTexels[vertex * 2 + 1];
+			}
+			if (pNormals) {
+				const float* n = pNormals + vertex * 3;
+				float normal[3];
+				for (int k = 0; k < 3; k++) {
+					normal[k] = normalSign * (cofactor[k] * n[0] + cofactor[3 + k] * n[1] + cofactor[6 + k] * n[2]);
+				}
+				normalize(normal);
+				out.normX = normal[0];
+				out.normY = normal[1];
+				out.normZ = normal[2];
+			}
+		}
+
+		// No normals in the file means flat shading, per the spec
+		if (!pNormals) {
+			float e1[3] = { corners[1].posX - corners[0].posX, corners[1].posY - corners[0].posY, corners[1].posZ - corners[0].posZ };
+			float e2[3] = { corners[2].posX - corners[0].posX, corners[2].posY - corners[0].posY, corners[2].posZ - corners[0].posZ };
+			float normal[3] = {
+				normalSign * (e1[1] * e2[2] - e1[2] * e2[1]),
+				normalSign * (e1[2] * e2[0] - e1[0] * e2[2]),
+				normalSign * (e1[0] * e2[1] - e1[1] * e2[0]),
+			};
+			normalize(normal);
+			for (int c = 0; c < 3; c++) {
+				corners[c].normX = normal[0];
+				corners[c].normY = normal[1];
+				corners[c].normZ = normal[2];
+			}
+		}
+		if (determinant < 0.0f) {
+			DXVertexInput swap = corners[1];
+			corners[1] = corners[2];
+			corners[2] = swap;
+		}
+
+		for (int c = 0; c < 3; c++) block.push_back(corners[c]);
+		if (block.size() >= EMIT_BLOCK_VERTICES) {
+			if (!sink(block.data(), block.size())) return false;
+			block.clear();
+		}
+	}
+	return true;
+}
\ No newline at end of file
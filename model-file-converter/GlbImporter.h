@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "DXVertexInput.h"
+#include "JsonValue.h"
+#include "../directx-sandbox/MappedFile.h"
+
+/* Reads binary glTF 2.0 (.glb) files into the converter's output vertices. The file is memory
+ * mapped and accessors are read right where they sit in the BIN chunk; only attributes that
+ * aren't tightly packed floats (or indices that aren't packed 32-bit) get converted into a
+ * scratch copy first. Every triangle primitive in the default scene comes out expanded to three
+ * vertices, with its node's transform applied, in blocks so the whole model never has to be
+ * held at once.
+ *
+ * Primitives are emitted grouped by material, and GetSubmeshes gives the range each material
+ * covers. A material's texture is the base color image's uri, embedded images can't be named
+ * so those come out without one.
+ *
+ * Like the OBJ route there's no handedness conversion. glTF texcoords already have their origin
+ * top left, so they pass through without the V flip OBJ needs. */
+class GlbImporter {
+public:
+	typedef std::function<bool(const DXVertexInput*, size_t)> Sink;
+
+	GlbImporter();
+
+	bool Open(const char*);
+	void Close();
+
+	unsigned long long GetVertexCount();
+	int GetPrimitiveCount();
+	int GetInPlaceAccessors();
+	int GetConvertedAccessors();
+
+	// Empty when no primitive has a material
+	void GetSubmeshes(std::vector<SubmeshRange>&);
+
+	// Hands the vertices to the sink a block at a time, stops early if the sink returns false
+	bool Emit(const Sink&);
+
+private:
+	struct Accessor {
+		const unsigned char* pData; // first element, inside the mapping
+		unsigned long long count;
+		int componentType;
+		int components;
+		size_t stride;
+		bool normalized;
+	};
+
+	// One triangle primitive and where it goes in the world
+	struct Draw {
+		const JsonValue* pPrimitive;
+		float matrix[16]; // column major, like glTF
+		int material;     // -1 for none
+		unsigned long long vertexCount;
+	};
+
+	bool CollectNode(int, const float*, int);
+	bool AddMesh(int, const float*);
+	bool GetAccessor(int, int, Accessor&);
+	const float* ReadFloats(const Accessor&, std::vector<float>&);
+	const unsigned int* ReadIndices(const Accessor&, std::vector<unsigned int>&);
+	std::string GetTextureUri(int);
+	bool EmitDraw(const Draw&, std::vector<DXVertexInput>&, const Sink&);
+
+	MappedFile file;
+	JsonValue json;
+	const unsigned char* pBin;
+	unsigned long long binSize;
+	std::vector<Draw> draws;
+	unsigned long long vertexCount;
+	int inPlaceAccessors;
+	int convertedAccessors;
+};
\ No newline at end of file
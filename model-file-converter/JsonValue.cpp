@@ -0,0 +1,285 @@
+#include "JsonValue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Deep enough for anything glTF nests, shallow enough that a hostile file can't blow the stack
+static const int MAX_DEPTH = 64;
+
+static const JsonValue nullValue;
+
+class JsonValue::Parser {
+public:
+	Parser(const char* pText, size_t length) {
+		this->p = pText;
+		this->pStart = pText;
+		this->pEnd = pText + length;
+	}
+
+	bool ParseDocument(JsonValue& value) {
+		if (!ParseValue(value, 0)) return false;
+		SkipSpace();
+		if (this->p != this->pEnd) return Fail("unexpected text after the document");
+		return true;
+	}
+
+private:
+	bool Fail(const char* message) {
+		printf("ERROR: JSON %s at offset %d\n", message, (int)(this->p - this->pStart));
+		return false;
+	}
+
+	void SkipSpace() {
+		while (this->p < this->pEnd && (*this->p == ' ' || *this->p == '\t' || *this->p == '\n' || *this->p == '\r')) this->p++;
+	}
+
+	bool Match(const char* word) {
+		size_t length = strlen(word);
+		if ((size_t)(this->pEnd - this->p) < length || memcmp(this->p, word, length) != 0) return false;
+		this->p += length;
+		return true;
+	}
+
+	bool ParseValue(JsonValue& value, int depth) {
+		if (depth > MAX_DEPTH) return Fail("nests too deep");
+		SkipSpace();
+		if (this->p == this->pEnd) return Fail("ends early");
+
+		char c = *this->p;
+		if (c == '{') return ParseObject(value, depth);
+		if (c == '[') return ParseArray(value, depth);
+		if (c == '"') {
+			value.type = JSON_STRING;
+			return ParseString(value.text);
+		}
+		if (Match("true")) {
+			value.type = JSON_BOOL;
+			value.boolean = true;
+			return true;
+		}
+		if (Match("false")) {
+			value.type = JSON_BOOL;
+			value.boolean = false;
+			return true;
+		}
+		if (Match("null")) {
+			value.type = JSON_NULL;
+			return true;
+		}
+		return ParseNumber(value);
+	}
+
+	bool ParseObject(JsonValue& value, int depth) {
+		value.type = JSON_OBJECT;
+		this->p++;
+		SkipSpace();
+		if (this->p < this->pEnd && *this->p == '}') {
+			this->p++;
+			return true;
+		}
+		for (;;) {
+			SkipSpace();
+			if (this->p == this->pEnd || *this->p != '"') return Fail("expected a member name");
+			value.keys.push_back(std::string());
+			if (!ParseString(value.keys.back())) return false;
+			SkipSpace();
+			if (this->p == this->pEnd || *this->p != ':') return Fail("expected ':'");
+			this->p++;
+			value.items.push_back(JsonValue());
+			if (!ParseValue(value.items.back(), depth + 1)) return false;
+			SkipSpace();
+			if (this->p < this->pEnd && *this->p == ',') {
+				this->p++;
+				continue;
+			}
+			if (this->p < this->pEnd && *this->p == '}') {
+				this->p++;
+				return true;
+			}
+			return Fail("expected ',' or '}'");
+		}
+	}
+
+	bool ParseArray(JsonValue& value, int depth) {
+		value.type = JSON_ARRAY;
+		this->p++;
+		SkipSpace();
+		if (this->p < this->pEnd && *this->p == ']') {
+			this->p++;
+			return true;
+		}
+		for (;;) {
+			value.items.push_back(JsonValue());
+			if (!ParseValue(value.items.back(), depth + 1)) return false;
+			SkipSpace();
+			if (this->p < this->pEnd && *this->p == ',') {
+				this->p++;
+				continue;
+			}
+			if (this->p < this->pEnd && *this->p == ']') {
+				this->p++;
+				return true;
+			}
+			return Fail("expected ',' or ']'");
+		}
+	}
+
+	bool ParseHex4(unsigned int& code) {
+		if (this->pEnd - this->p < 4) return Fail("has a short \\u escape");
+		code = 0;
+		for (int i = 0; i < 4; i++) {
+			char c = *this->p++;
+			code <<= 4;
+			if (c >= '0' && c <= '9') code |= c - '0';
+			else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+			else return Fail("has a bad \\u escape");
+		}
+		return true;
+	}
+
+	static void AppendUtf8(std::string& out, unsigned int code) {
+		if (code < 0x80) {
+			out += (char)code;
+		}
+		else if (code < 0x800) {
+			out += (char)(0xC0 | (code >> 6));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000) {
+			out += (char)(0xE0 | (code >> 12));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else {
+			out += (char)(0xF0 | (code >> 18));
+			out += (char)(0x80 | ((code >> 12) & 0x3F));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool ParseString(std::string& out) {
+		this->p++; // opening quote
+		out.clear();
+		while (this->p < this->pEnd) {
+			char c = *this->p++;
+			if (c == '"') return true;
+			if ((unsigned char)c < 0x20) return Fail("has a control character in a string");
+			if (c != '\\') {
+				out += c;
+				continue;
+			}
+			if (this->p == this->pEnd) break;
+			char escape = *this->p++;
+			switch (escape) {
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				unsigned int code;
+				if (!ParseHex4(code)) return false;
+				// Characters past the first plane come as a surrogate pair
+				if (code >= 0xD800 && code <= 0xDBFF && this->pEnd - this->p >= 6 && this->p[0] == '\\' && this->p[1] == 'u') {
+					this->p += 2;
+					unsigned int low;
+					if (!ParseHex4(low)) return false;
+					if (low < 0xDC00 || low > 0xDFFF) return Fail("has a broken surrogate pair");
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(out, code);
+				break;
+			}
+			default:
+				return Fail("has an unknown escape");
+			}
+		}
+		return Fail("has an unterminated string");
+	}
+
+	bool ParseNumber(JsonValue& value) {
+		// The text isn't zero terminated, so the number gets copied out for strtod
+		const char* pNumberEnd = this->p;
+		while (pNumberEnd < this->pEnd && *pNumberEnd && strchr("+-0123456789.eE", *pNumberEnd)) pNumberEnd++;
+		if (pNumberEnd == this->p || pNumberEnd - this->p > 63) return Fail("has something that isn't a value");
+
+		char number[64];
+		memcpy(number, this->p, pNumberEnd - this->p);
+		number[pNumberEnd - this->p] = '\0';
+		char* pParsed;
+		value.number = strtod(number, &pParsed);
+		if (*pParsed != '\0') return Fail("has a malformed number");
+		value.type = JSON_NUMBER;
+		this->p = pNumberEnd;
+		return true;
+	}
+
+	const char* p;
+	const char* pStart;
+	const char* pEnd;
+};
+
+JsonValue::JsonValue() {
+	this->type = JSON_NULL;
+	this->number = 0.0;
+	this->boolean = false;
+}
+
+bool JsonValue::Parse(const char* pText, size_t length, JsonValue& value) {
+	value = JsonValue();
+	Parser parser(pText, length);
+	return parser.ParseDocument(value);
+}
+
+JsonValue::Type JsonValue::GetType() const {
+	return this->type;
+}
+
+bool JsonValue::IsNull() const {
+	return this->type == JSON_NULL;
+}
+
+bool JsonValue::Has(const char* name) const {
+	return !(*this)[name].IsNull();
+}
+
+// Linear, but glTF objects have a handful of members
+const JsonValue& JsonValue::operator[](const char* name) const {
+	if (this->type != JSON_OBJECT) return nullValue;
+	for (size_t i = 0; i < this->keys.size(); i++) {
+		if (this->keys[i] == name) return this->items[i];
+	}
+	return nullValue;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+	if (this->type != JSON_ARRAY || index >= this->items.size()) return nullValue;
+	return this->items[index];
+}
+
+size_t JsonValue::GetCount() const {
+	return this->type == JSON_ARRAY ? this->items.size() : 0;
+}
+
+double JsonValue::GetNumber(double fallback) const {
+	return this->type == JSON_NUMBER ? this->number : fallback;
+}
+
+int JsonValue::GetInt(int fallback) const {
+	if (this->type != JSON_NUMBER || this->number < -2147483648.0 || this->number > 2147483647.0) return fallback;
+	return (int)this->number;
+}
+
+bool JsonValue::GetBool(bool fallback) const {
+	return this->type == JSON_BOOL ? this->boolean : fallback;
+}
+
+const std::string& JsonValue::GetString() const {
+	return this->text;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/* Just enough JSON for reading glTF: parses a document into a tree of values. Looking up a
+ * member or element that isn't there gives back a null value rather than failing, so optional
+ * glTF properties can be read with a fallback in one go. */
+class JsonValue {
+public:
+	enum Type {
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT,
+	};
+
+	JsonValue();
+
+	// Prints what went wrong and where on failure
+	static bool Parse(const char*, size_t, JsonValue&);
+
+	Type GetType() const;
+	bool IsNull() const;
+	bool Has(const char*) const;
+
+	// Members by name and elements by index
+	const JsonValue& operator[](const char*) const;
+	const JsonValue& operator[](size_t) const;
+	size_t GetCount() const;
+
+	double GetNumber(double) const;
+	int GetInt(int) const;
+	bool GetBool(bool) const;
+	const std::string& GetString() const;
+
+private:
+	class Parser;
+
+	Type type;
+	double number;
+	bool boolean;
+	std::string text;
+	std::vector<std::string> keys;  // objects only, parallel to items
+	std::vector<JsonValue> items;   // array elements or object member values
+};
\ No newline at end of file
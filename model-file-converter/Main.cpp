@@ -1,48 +1,51 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 
-// This represents the output type of this program (i.e., the input to the DirectX vertex buf)
-struct DXVertexInput {
-	float posX, posY, posZ;
-	float texU, texV;
-	float normX, normY, normZ;
+#include "DXVertexInput.h"
+#include "ConversionCache.h"
+#include "OutOfCoreConverter.h"
+#include "GlbImporter.h"
+#include "MaterialTable.h"
+#include "../directx-sandbox/JobSystem.h"
 
-	DXVertexInput() {
-		posX = posY = posZ = texU = texV = normX = normY = normZ = 0.0f;
-	}
-
-	DXVertexInput(
-		const std::vector<float>& pos,
-		const std::vector<float>& tex,
-		const std::vector<float>& norm)
-	{
-		posX = pos.at(0); posY = pos.at(1); posZ = pos.at(2);
-		texU = tex.at(0); texV = 1.0 - tex.at(1);
-		normX = norm.at(0); normY = norm.at(1); normZ = norm.at(2);
-	}
-};
+// Bump whenever a change makes the output differ for the same input, so batch runs don't
+// trust cache entries from an older converter
+const char* const CONVERTER_VERSION = "obj-to-txt 2";
 
 int loadLineVectors(
 	std::string filename,
 	std::vector<std::string>& vLines,
 	std::vector<std::string>& vtLines,
 	std::vector<std::string>& vnLines,
-	std::vector<std::string>& fLines)
+	std::vector<std::string>& fLines,
+	std::vector<int>& fMaterials,
+	MaterialTable& materials)
 {
 	vLines.clear();
 	vtLines.clear();
 	vnLines.clear();
 	fLines.clear();
+	fMaterials.clear();
 
 	std::ifstream fin;
 	fin.open(filename);
+	if (!fin.is_open()) return -1;
 
 	std::string line;
 	int lineCount = 0;
+	int material = 0;
 	while (std::getline(fin, line)) {
 		if (line.rfind("v ", 0) == 0) {
 			vLines.push_back(line);
@@ -55,6 +58,13 @@ int loadLineVectors(
 		}
 		else if (line.rfind("f ", 0) == 0) {
 			fLines.push_back(line);
+			fMaterials.push_back(material);
+		}
+		else if (line.rfind("usemtl ", 0) == 0) {
+			material = materials.Use(MaterialTable::GetArgument(line, 7));
+		}
+		else if (line.rfind("mtllib ", 0) == 0) {
+			materials.LoadLibrary(filename, MaterialTable::GetArgument(line, 7));
 		}
 		else {
 			printf("Skipping line with unknown prefix: '%s'\n", line.c_str());
@@ -102,6 +112,7 @@ int parseInputLines(
 			return -1;
 		}
 	}
+	return 0;
 }
 
 int parseFaceInputLines(
@@ -133,18 +144,19 @@ int parseFaceInputLines(
 			return -1;
 		}
 	}
+	return 0;
 }
 
 std::vector<DXVertexInput> materializeFaces(
-	std::vector<std::vector<float>> v,
-	std::vector<std::vector<float>> vt,
-	std::vector<std::vector<float>> vn,
-	std::vector<std::vector<std::string>> faces)
+	const std::vector<std::vector<float>>& v,
+	const std::vector<std::vector<float>>& vt,
+	const std::vector<std::vector<float>>& vn,
+	const std::vector<std::vector<std::string>>& faces)
 {
 	std::vector<DXVertexInput> dxInputs(faces.size() * 3);
 
 	for (int i = 0; i < faces.size(); i++) {
-		std::vector<std::string> face = faces.at(i);
+		const std::vector<std::string>& face = faces.at(i);
 		for (int j = 0; j < 3; j++) {
 			std::string faceVertex = face.at(j);
 			int off1 = faceVertex.find("/");
@@ -155,9 +167,9 @@ std::vector<DXVertexInput> materializeFaces(
 			int vtIndex = stoi(faceVertex.substr(off1 + 1, off2 - (off1 + 1))) - 1;
 			int vIndex = stoi(faceVertex.substr(0, off1)) - 1;
 
-			const std::vector<float> vertex = v.at(vIndex);
-			const std::vector<float> texel = vt.at(vtIndex);
-			const std::vector<float> normal = vn.at(vnIndex);
+			const std::vector<float>& vertex = v.at(vIndex);
+			const std::vector<float>& texel = vt.at(vtIndex);
+			const std::vector<float>& normal = vn.at(vnIndex);
 
 			dxInputs.at(i * 3 + j) = DXVertexInput(vertex, texel, normal);
 		}
@@ -166,21 +178,114 @@ std::vector<DXVertexInput> materializeFaces(
 	return dxInputs;
 }
 
+// Reorders the faces so each material's faces sit together, in the order the materials were
+// first used and keeping their order within a material. One counting pass, then one move each.
+void groupFacesByMaterial(
+	std::vector<std::vector<std::string>>& faces,
+	const std::vector<int>& faceMaterials,
+	MaterialTable& materials,
+	std::vector<SubmeshRange>& submeshes)
+{
+	std::vector<unsigned long long> counts(materials.GetCount(), 0);
+	for (size_t i = 0; i < faceMaterials.size(); i++) counts[faceMaterials[i]]++;
 
+	std::vector<unsigned long long> next(counts.size(), 0);
+	for (size_t i = 1; i < counts.size(); i++) next[i] = next[i - 1] + counts[i - 1];
 
-int main(int argc, char* argv[]) {
-	printf("Model converter started.  argc=%d\n", argc);
-	if (argc < 3) {
-		printf("ERROR: missing input or output filename parameter\n");
-		return -5;
+	std::vector<std::vector<std::string>> grouped(faces.size());
+	for (size_t i = 0; i < faces.size(); i++) grouped[next[faceMaterials[i]]++].swap(faces[i]);
+	faces.swap(grouped);
+
+	materials.GetRanges(counts, submeshes);
+}
+
+
+
+// The output format, shared by every input format: the vertex count, then one line per vertex
+void writeVertexCount(std::ofstream& outfile, unsigned long long count) {
+	char strBuf[32];
+	snprintf(strBuf, sizeof(strBuf), "%llu\n", count);
+	outfile << strBuf;
+}
+
+void writeVertices(std::ofstream& outfile, const DXVertexInput* pVertices, size_t count) {
+	// Big enough for 8 of the longest floats %f can print
+	char strBuf[512];
+	for (size_t i = 0; i < count; i++) {
+		const DXVertexInput& dxi = pVertices[i];
+		snprintf(strBuf, sizeof(strBuf), "%f %f %f %f %f %f %f %f\n",
+			dxi.posX, dxi.posY, dxi.posZ, dxi.texU, dxi.texV, dxi.normX, dxi.normY, dxi.normZ);
+		outfile << strBuf;
+	}
+}
+
+// Models with materials list their ranges after the vertices, see SubmeshRange
+void writeSubmeshes(std::ofstream& outfile, const std::vector<SubmeshRange>& submeshes) {
+	for (size_t i = 0; i < submeshes.size(); i++) outfile << submeshes[i].Format();
+}
+
+bool hasExtension(const std::string& filename, const char* extension) {
+	std::string actual = std::filesystem::path(filename).extension().string();
+	for (size_t i = 0; i < actual.size(); i++) actual[i] = (char)tolower((unsigned char)actual[i]);
+	return actual == extension;
+}
+
+// Binary glTF goes straight from the mapped file to the output a block at a time, so it never
+// needs the memory cap
+int convertGlb(const std::string& inputModelFilename, const std::string& outputModelFilename) {
+	auto startTime = std::chrono::steady_clock::now();
+	printf("Attempting to convert glTF binary: %s\n", inputModelFilename.c_str());
+
+	GlbImporter importer;
+	if (!importer.Open(inputModelFilename.c_str())) return -10;
+
+	std::ofstream outfile(outputModelFilename);
+	writeVertexCount(outfile, importer.GetVertexCount());
+	bool ok = importer.Emit([&outfile](const DXVertexInput* pVertices, size_t count) {
+		writeVertices(outfile, pVertices, count);
+		return !outfile.fail();
+	});
+	std::vector<SubmeshRange> submeshes;
+	importer.GetSubmeshes(submeshes);
+	writeSubmeshes(outfile, submeshes);
+	outfile.close();
+	if (!ok || outfile.fail()) {
+		printf("ERROR: failed while converting or writing: %s\n", outputModelFilename.c_str());
+		return -20;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Imported %d primitives, %llu vertices in %.1f ms (%d accessors read in place, %d converted)\n",
+		importer.GetPrimitiveCount(), importer.GetVertexCount(), ms,
+		importer.GetInPlaceAccessors(), importer.GetConvertedAccessors());
+	printf("Output written to: %s\n", outputModelFilename.c_str());
+	return 0;
+}
+
+// Converts one OBJ or GLB file, returns 0 or a negative error code. Only touches its own
+// locals, so batch mode runs several of these at once. With a memory cap OBJs are streamed
+// through OutOfCoreConverter instead, the output is the same either way.
+int convertModel(const std::string& inputModelFilename, const std::string& outputModelFilename,
+	unsigned long long maxMemory)
+{
+	if (hasExtension(inputModelFilename, ".glb")) {
+		return convertGlb(inputModelFilename, outputModelFilename);
+	}
+	if (maxMemory > 0) {
+		OutOfCoreConverter converter;
+		return converter.Convert(inputModelFilename, outputModelFilename, maxMemory) ? 0 : -25;
 	}
 
-	std::string inputModelFilename = argv[1];
-	std::string outputModelFilename = argv[2];
 	printf("Attempting to convert model file: %s\n", inputModelFilename.c_str());
 
 	std::vector<std::string> vLines, vtLines, vnLines, fLines;
-	int lineCount = loadLineVectors(inputModelFilename, vLines, vtLines, vnLines, fLines);
+	std::vector<int> fMaterials;
+	MaterialTable materials;
+	int lineCount = loadLineVectors(inputModelFilename, vLines, vtLines, vnLines, fLines, fMaterials, materials);
+	if (lineCount < 0) {
+		printf("ERROR: could not read model file: %s\n", inputModelFilename.c_str());
+		return -5;
+	}
 	printf("Extracted %d relevant lines from model file.\n", lineCount);
 
 	//printf("Vertices:\n");
@@ -257,6 +362,12 @@ int main(int argc, char* argv[]) {
 	//	std::cout << std::endl;
 	//}
 
+	std::vector<SubmeshRange> submeshes;
+	if (materials.IsUsed()) {
+		groupFacesByMaterial(f, fMaterials, materials, submeshes);
+		printf("Grouped faces into %d submeshes by material\n", (int)submeshes.size());
+	}
+
 	std::vector<DXVertexInput> dxInputs = materializeFaces(v, vt, vn, f);
 	printf("Materialized!\n");
 	//for (int i = 0; i < dxInputs.size(); i++) {
@@ -266,17 +377,290 @@ int main(int argc, char* argv[]) {
 	//}
 
 	std::ofstream outfile(outputModelFilename);
-	char strBuf[100];
-	sprintf(strBuf, "%d\n", (int)dxInputs.size());
-	outfile << strBuf;
-	for (int i = 0; i < dxInputs.size(); i++) {
-		DXVertexInput dxi = dxInputs.at(i);
-		sprintf(strBuf, "%f %f %f %f %f %f %f %f\n",
-			dxi.posX, dxi.posY, dxi.posZ, dxi.texU, dxi.texV, dxi.normX, dxi.normY, dxi.normZ);
-		outfile << strBuf;
-	}
+	writeVertexCount(outfile, dxInputs.size());
+	writeVertices(outfile, dxInputs.data(), dxInputs.size());
+	writeSubmeshes(outfile, submeshes);
 	outfile.close();
+	if (outfile.fail()) {
+		printf("ERROR: failed while writing: %s\n", outputModelFilename.c_str());
+		return -20;
+	}
 
 	printf("Output written to: %s\n", outputModelFilename.c_str());
 	return 0;
+}
+
+struct BatchOptions {
+	std::string source;    // a directory of .obj/.glb files, or a manifest listing them
+	std::string outputDir;
+	std::string cacheFilename;
+	bool useCache;
+	int threads;
+	unsigned long long maxMemory; // 0 converts in memory
+
+	BatchOptions() {
+		useCache = true;
+		threads = 0;
+		maxMemory = 0;
+	}
+};
+
+struct BatchJob {
+	std::string input;
+	std::string output;
+};
+
+void printUsage() {
+	printf("Usage: model-file-converter <input.obj or .glb> <output.txt> [--max-mem SIZE]\n");
+	printf("       model-file-converter --batch <directory or manifest> <output directory> [options]\n");
+	printf("  --threads N      conversions to run at once (default: one per hardware thread)\n");
+	printf("  --cache FILE     where to remember finished conversions (default: <output directory>/.converter-cache)\n");
+	printf("  --no-cache       convert everything, and leave the cache alone\n");
+	printf("  --max-mem SIZE   convert OBJs out of core, keeping buffers under SIZE (e.g. 2G, 512M), split\n");
+	printf("                   between the batch threads (fewer run at once if that leaves one under 16M).\n");
+	printf("                   Attributes spill to temp files by the output.\n");
+	printf("                   GLBs are always read from a mapping and streamed, so they don't need it.\n");
+	printf("A directory converts every .obj and .glb under it, keeping the layout. A manifest lists\n");
+	printf("one input per line, optionally followed by its output, relative to the manifest and the\n");
+	printf("output directory. Inputs whose contents and converter options match the cache are skipped.\n");
+}
+
+// "2G", "512M", "64K" or a plain byte count, 0 if it's none of those
+unsigned long long parseMemorySize(const std::string& text) {
+	char* pEnd;
+	unsigned long long value = strtoull(text.c_str(), &pEnd, 10);
+	if (pEnd == text.c_str()) return 0;
+	switch (toupper((unsigned char)*pEnd)) {
+	case 'G': value *= 1024; // fall through
+	case 'M': value *= 1024; // fall through
+	case 'K': value *= 1024; pEnd++; break;
+	case '\0': break;
+	default: return 0;
+	}
+	return *pEnd == '\0' || toupper((unsigned char)*pEnd) == 'B' ? value : 0;
+}
+
+int parseBatchArgs(int argc, char* argv[], BatchOptions& options) {
+	if (argc < 4) {
+		printf("ERROR: --batch needs a source and an output directory\n");
+		return -1;
+	}
+	options.source = argv[2];
+	options.outputDir = argv[3];
+	for (int i = 4; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--threads" && i + 1 < argc) {
+			options.threads = atoi(argv[++i]);
+		}
+		else if (arg == "--cache" && i + 1 < argc) {
+			options.cacheFilename = argv[++i];
+		}
+		else if (arg == "--no-cache") {
+			options.useCache = false;
+		}
+		else if (arg == "--max-mem" && i + 1 < argc) {
+			options.maxMemory = parseMemorySize(argv[++i]);
+			if (options.maxMemory == 0) {
+				printf("ERROR: can't read --max-mem '%s'\n", argv[i]);
+				return -1;
+			}
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.cacheFilename.empty()) {
+		options.cacheFilename = (std::filesystem::path(options.outputDir) / ".converter-cache").generic_string();
+	}
+	if (options.threads <= 0) {
+		options.threads = (int)std::thread::hardware_concurrency();
+		if (options.threads < 1) options.threads = 1;
+	}
+	if (options.maxMemory > 0 && options.maxMemory < OUT_OF_CORE_MIN_MEMORY) {
+		printf("ERROR: --max-mem has to be at least %llu MB for even one conversion\n", OUT_OF_CORE_MIN_MEMORY / (1024 * 1024));
+		return -1;
+	}
+	return 0;
+}
+
+// Everything that changes what a given input converts to. Cache entries only match when this
+// does too.
+std::string getOptionsFingerprint() {
+	return CONVERTER_VERSION;
+}
+
+// What a conversion's output depends on: the model file, and for an OBJ every .mtl library
+// it pulls in, since the submesh lines carry their material names and textures. A library
+// that can't be read hashes as missing, so it turning up later counts as a change too. The
+// OBJ is read a second time to find its mtllib lines, still far cheaper than converting it.
+bool hashModelInputs(const std::string& input, unsigned long long& hash) {
+	if (!ConversionCache::HashFile(input, hash)) return false;
+	if (!hasExtension(input, ".obj")) return true;
+
+	std::ifstream fin(input);
+	std::string line, libraries;
+	while (std::getline(fin, line)) {
+		if (line.rfind("mtllib ", 0) != 0) continue;
+		std::string library = MaterialTable::GetLibraryPath(input, MaterialTable::GetArgument(line, 7));
+		unsigned long long libraryHash;
+		libraries += library + (ConversionCache::HashFile(library, libraryHash) ? " " + std::to_string(libraryHash) : " missing") + "\n";
+	}
+	if (!libraries.empty()) hash = ConversionCache::HashString(std::to_string(hash) + "\n" + libraries);
+	return true;
+}
+
+bool isModelFile(const std::filesystem::path& path) {
+	return hasExtension(path.string(), ".obj") || hasExtension(path.string(), ".glb");
+}
+
+int collectBatchJobs(const BatchOptions& options, std::vector<BatchJob>& jobs) {
+	std::filesystem::path outputDir(options.outputDir);
+	std::error_code error;
+
+	if (std::filesystem::is_directory(options.source, error)) {
+		std::filesystem::path sourceDir(options.source);
+		for (auto it = std::filesystem::recursive_directory_iterator(sourceDir, error);
+			!error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+		{
+			if (!it->is_regular_file(error) || !isModelFile(it->path())) continue;
+			BatchJob job;
+			job.input = it->path().generic_string();
+			job.output = (outputDir / std::filesystem::relative(it->path(), sourceDir).replace_extension(".txt")).generic_string();
+			jobs.push_back(job);
+		}
+		if (error) {
+			printf("ERROR: couldn't list '%s': %s\n", options.source.c_str(), error.message().c_str());
+			return -1;
+		}
+	}
+	else {
+		std::ifstream manifest(options.source);
+		if (!manifest.is_open()) {
+			printf("ERROR: '%s' isn't a directory or a readable manifest\n", options.source.c_str());
+			return -1;
+		}
+		std::filesystem::path manifestDir = std::filesystem::path(options.source).parent_path();
+		std::string line;
+		while (std::getline(manifest, line)) {
+			std::istringstream iss(line);
+			std::string input, output;
+			if (!(iss >> input) || input[0] == '#') continue;
+			iss >> output;
+			if (output.empty()) output = std::filesystem::path(input).filename().replace_extension(".txt").string();
+			BatchJob job;
+			job.input = (manifestDir / input).generic_string();
+			job.output = (outputDir / output).generic_string();
+			jobs.push_back(job);
+		}
+	}
+
+	std::sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) { return a.input < b.input; });
+	std::map<std::string, std::string> outputs;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		auto inserted = outputs.insert(std::make_pair(jobs[i].output, jobs[i].input));
+		if (!inserted.second) {
+			printf("ERROR: '%s' and '%s' would both write '%s'\n",
+				inserted.first->second.c_str(), jobs[i].input.c_str(), jobs[i].output.c_str());
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Each input is hashed (with its material libraries) and checked against the cache in a job,
+// so unchanged files cost a read and nothing else. The cache is saved once at the end, only successful conversions go in.
+int runBatch(const BatchOptions& options) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::vector<BatchJob> jobs;
+	if (collectBatchJobs(options, jobs) < 0) return -1;
+
+	ConversionCache cache;
+	if (options.useCache) cache.Load(options.cacheFilename);
+	unsigned long long optionsHash = ConversionCache::HashString(getOptionsFingerprint());
+
+	// Every conversion running at once gets an equal share of the cap, so with a small cap and
+	// lots of threads fewer run at once rather than each getting too little to work in
+	int threads = options.threads;
+	if (options.maxMemory > 0 && options.maxMemory / OUT_OF_CORE_MIN_MEMORY < (unsigned long long)threads) {
+		threads = (int)(options.maxMemory / OUT_OF_CORE_MIN_MEMORY);
+		printf("A %llu MB cap only has room for %d conversions at once, running that many\n",
+			options.maxMemory / (1024 * 1024), threads);
+	}
+	unsigned long long perConversionMemory = options.maxMemory / threads;
+	std::atomic<int> converted(0), upToDate(0), failed(0);
+	// This thread runs conversions too while it waits, so threads is how many run at once
+	JobSystem jobSystem;
+	jobSystem.Init(threads);
+	JobSystem::Counter done;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		const BatchJob& job = jobs[i];
+		jobSystem.Run([&, job]() {
+			unsigned long long contentHash;
+			if (!hashModelInputs(job.input, contentHash)) {
+				printf("ERROR: could not read model file: %s\n", job.input.c_str());
+				failed++;
+				return;
+			}
+			if (options.useCache && cache.Lookup(job.output, contentHash, optionsHash)) {
+				upToDate++;
+				return;
+			}
+
+			std::error_code error;
+			std::filesystem::path outputParent = std::filesystem::path(job.output).parent_path();
+			if (!outputParent.empty()) std::filesystem::create_directories(outputParent, error);
+			if (convertModel(job.input, job.output, perConversionMemory) < 0) {
+				printf("ERROR: conversion failed: %s\n", job.input.c_str());
+				cache.Forget(job.output);
+				failed++;
+				return;
+			}
+			cache.Store(job.output, contentHash, optionsHash);
+			converted++;
+		}, &done);
+	}
+	jobSystem.Wait(&done);
+	jobSystem.Shutdown();
+
+	if (options.useCache && converted > 0) cache.Save();
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Batch done: %d converted, %d up to date, %d failed, %.1f ms on %d threads\n",
+		converted.load(), upToDate.load(), failed.load(), ms, threads);
+	return failed > 0 ? -1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+	printf("Model converter started.  argc=%d\n", argc);
+
+	if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+		BatchOptions options;
+		if (parseBatchArgs(argc, argv, options) < 0) {
+			printUsage();
+			return -5;
+		}
+		return runBatch(options) < 0 ? -30 : 0;
+	}
+
+	if (argc < 3) {
+		printf("ERROR: missing input or output filename parameter\n");
+		printUsage();
+		return -5;
+	}
+	unsigned long long maxMemory = 0;
+	if (argc == 5 && strcmp(argv[3], "--max-mem") == 0) {
+		maxMemory = parseMemorySize(argv[4]);
+		if (maxMemory == 0) {
+			printf("ERROR: can't read --max-mem '%s'\n", argv[4]);
+			return -5;
+		}
+	}
+	else if (argc != 3) {
+		printf("ERROR: unknown or incomplete option '%s'\n", argv[3]);
+		printUsage();
+		return -5;
+	}
+	return convertModel(argv[1], argv[2], maxMemory);
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "MaterialTable.h"
+
+#include <stdio.h>
+#include <fstream>
+#include <filesystem>
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+MaterialTable::MaterialTable() {
+	this->names.push_back("-");
+}
+
+void MaterialTable::LoadLibrary(const std::string& objFilename, const std::string& libraryName) {
+	std::string libraryPath = GetLibraryPath(objFilename, libraryName);
+	std::ifstream fin(libraryPath);
+	if (!fin.is_open()) {
+		printf("Could not read material library '%s', its materials won't have textures\n", libraryPath.c_str());
+		return;
+	}
+
+	std::string line, material;
+	while (std::getline(fin, line)) {
+		size_t start = 0;
+		while (start < line.size() && isSpace(line[start])) start++;
+		if (line.compare(start, 7, "newmtl ") == 0) {
+			material = GetArgument(line, start + 7);
+		}
+		else if (line.compare(start, 7, "map_Kd ") == 0 && !material.empty()) {
+			// Options like "-s 1 1 1" can come before the filename. With any of those around
+			// take the last word, otherwise the whole rest of the line in case it has spaces.
+			std::string texture = GetArgument(line, start + 7);
+			if (!texture.empty() && texture[0] == '-') {
+				size_t lastSpace = texture.find_last_of(" \t");
+				texture = lastSpace == std::string::npos ? "" : texture.substr(lastSpace + 1);
+			}
+			for (size_t i = 0; i < texture.size(); i++) {
+				if (texture[i] == '\\') texture[i] = '/';
+			}
+			// Texture paths are relative to the library, the model only knows where the OBJ is
+			if (!texture.empty()) {
+				std::filesystem::path libraryDir = std::filesystem::path(libraryName).parent_path();
+				this->textures[material] = (libraryDir / texture).lexically_normal().generic_string();
+			}
+		}
+	}
+}
+
+int MaterialTable::Use(const std::string& name) {
+	auto found = this->indices.find(name);
+	if (found != this->indices.end()) return found->second;
+	int index = (int)this->names.size();
+	this->names.push_back(name);
+	this->indices[name] = index;
+	return index;
+}
+
+bool MaterialTable::IsUsed() {
+	return this->names.size() > 1;
+}
+
+int MaterialTable::GetCount() {
+	return (int)this->names.size();
+}
+
+void MaterialTable::GetRanges(const std::vector<unsigned long long>& faceCounts, std::vector<SubmeshRange>& ranges) {
+	ranges.clear();
+	unsigned long long start = 0;
+	for (size_t i = 0; i < this->names.size() && i < faceCounts.size(); i++) {
+		if (faceCounts[i] == 0) continue;
+
+		SubmeshRange range;
+		range.start = start;
+		range.count = faceCounts[i] * 3;
+		// The name is one word in the output
+		range.material = this->names[i].empty() ? "-" : this->names[i];
+		for (size_t c = 0; c < range.material.size(); c++) {
+			if (isSpace(range.material[c])) range.material[c] = '_';
+		}
+		auto texture = this->textures.find(this->names[i]);
+		range.texture = texture == this->textures.end() ? "-" : texture->second;
+		ranges.push_back(range);
+		start += range.count;
+	}
+}
+
+std::string MaterialTable::GetArgument(const std::string& line, size_t offset) {
+	size_t start = offset, end = line.size();
+	while (start < end && isSpace(line[start])) start++;
+	while (end > start && isSpace(line[end - 1])) end--;
+	return line.substr(start, end - start);
+}
+
+std::string MaterialTable::GetLibraryPath(const std::string& objFilename, const std::string& libraryName) {
+	return (std::filesystem::path(objFilename).parent_path() / libraryName).string();
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "DXVertexInput.h"
+
+/* Keeps track of the materials an OBJ switches between with usemtl, and the diffuse texture
+ * (map_Kd) each one names in the .mtl libraries pulled in with mtllib. Both converters tag
+ * every face with a material index from here, then write the faces grouped by material so each
+ * material ends up as one submesh range.
+ *
+ * Index 0 is for faces that come before any usemtl. The rest are numbered in the order they
+ * are first used, which is also the order the submeshes come out in. Groups and objects (g/o)
+ * don't matter for drawing, faces only get split where the material changes. */
+class MaterialTable {
+public:
+	MaterialTable();
+
+	// Library names are relative to the OBJ, and so are the texture names that come out of
+	// them. A missing library is only a warning, its materials just come out without textures.
+	void LoadLibrary(const std::string&, const std::string&);
+	int Use(const std::string&);
+
+	// False if the file never said usemtl, then there's nothing worth splitting
+	bool IsUsed();
+	int GetCount();
+
+	// Turns per material face counts into submesh ranges, skipping empty materials
+	void GetRanges(const std::vector<unsigned long long>&, std::vector<SubmeshRange>&);
+
+	// The rest of an OBJ or MTL line after its keyword, without surrounding whitespace
+	static std::string GetArgument(const std::string&, size_t);
+	// Where an mtllib line in the given OBJ points
+	static std::string GetLibraryPath(const std::string&, const std::string&);
+
+private:
+	std::vector<std::string> names;
+	std::map<std::string, int> indices;
+	std::map<std::string, std::string> textures;
+};
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "OutOfCoreConverter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <algorithm>
+#include <chrono>
+
+#include "../directx-sandbox/MappedFile.h"
+
+static const unsigned long long MB = 1024ull * 1024;
+
+// Floats per entry of each attribute spill, and ints per face (v/vt/vn for 3 corners, then the
+// material index)
+static const int POSITION_FLOATS = 3;
+static const int TEXEL_FLOATS = 2;
+static const int NORMAL_FLOATS = 3;
+static const int FACE_INTS = 10;
+static const int FACE_MATERIAL = 9;
+
+static unsigned long long clampBuffer(unsigned long long size, unsigned long long low, unsigned long long high) {
+	return std::min(std::max(size, low), high);
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static const char* skipSpace(const char* p, const char* pEnd) {
+	while (p < pEnd && isSpace(*p)) p++;
+	return p;
+}
+
+OutOfCoreConverter::OutOfCoreConverter() {
+	this->currentMaterial = 0;
+	this->maxMemory = 0;
+	this->bufferedBytes = 0;
+	this->skippedLines = 0;
+	this->lineNumber = 0;
+	this->bytesRead = 0;
+	this->bytesWritten = 0;
+	for (int i = 0; i < SPILL_COUNT; i++) {
+		this->spills[i].used = 0;
+		this->spills[i].count = 0;
+	}
+}
+
+OutOfCoreConverter::~OutOfCoreConverter() {
+	RemoveSpills();
+}
+
+bool OutOfCoreConverter::Convert(const std::string& inputFilename, const std::string& outputFilename, unsigned long long maxMemory) {
+	if (maxMemory < OUT_OF_CORE_MIN_MEMORY) {
+		printf("ERROR: a memory cap of %llu MB is too small, need at least %llu MB\n", maxMemory / MB, OUT_OF_CORE_MIN_MEMORY / MB);
+		return false;
+	}
+	this->maxMemory = maxMemory;
+	this->inputFilename = inputFilename;
+	printf("Converting out of core: %s (cap %llu MB)\n", inputFilename.c_str(), maxMemory / MB);
+
+	// Spills go next to the output, that's the disk we already know has room for something this size
+	const char* suffixes[SPILL_COUNT] = { ".v.tmp", ".vt.tmp", ".vn.tmp", ".f.tmp" };
+	size_t spillBufferSize = (size_t)clampBuffer(maxMemory / 16, 256 * 1024, 16 * MB);
+	for (int i = 0; i < SPILL_COUNT; i++) {
+		if (!OpenSpill((Spill)i, outputFilename + suffixes[i], spillBufferSize)) return false;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	if (!ParsePass(inputFilename)) return false;
+	for (int i = 0; i < SPILL_COUNT; i++) {
+		if (!FlushSpill((Spill)i)) return false;
+		this->spills[i].stream.close();
+		this->bufferedBytes -= this->spills[i].buffer.size();
+		std::vector<char>().swap(this->spills[i].buffer);
+	}
+	double parseMs = elapsedMs(startTime);
+
+	startTime = std::chrono::steady_clock::now();
+	if (!ResolvePass(outputFilename)) return false;
+	double resolveMs = elapsedMs(startTime);
+	RemoveSpills();
+
+	unsigned long long faces = this->spills[SPILL_FACES].count / FACE_INTS;
+	printf("Parsed %.1f MB in %.0f ms (%.1f MB/s): %llu positions, %llu texels, %llu normals, %llu faces",
+		(double)this->bytesRead / MB, parseMs, (double)this->bytesRead / MB / std::max(parseMs / 1000.0, 0.001),
+		this->spills[SPILL_POSITIONS].count / POSITION_FLOATS, this->spills[SPILL_TEXELS].count / TEXEL_FLOATS,
+		this->spills[SPILL_NORMALS].count / NORMAL_FLOATS, faces);
+	if (this->skippedLines) printf(", skipped %llu other lines", this->skippedLines);
+	printf("\n");
+	printf("Resolved and wrote %.1f MB in %.0f ms (%.1f MB/s, %.2f M faces/s)\n",
+		(double)this->bytesWritten / MB, resolveMs, (double)this->bytesWritten / MB / std::max(resolveMs / 1000.0, 0.001),
+		faces / 1e6 / std::max(resolveMs / 1000.0, 0.001));
+	return true;
+}
+
+// Streams the file through one fixed buffer, a line at a time. A line split across two reads
+// gets moved to the front of the buffer before the next read.
+bool OutOfCoreConverter::ParsePass(const std::string& inputFilename) {
+	std::ifstream fin(inputFilename, std::ios::binary);
+	if (!fin.is_open()) {
+		printf("ERROR: could not read model file: %s\n", inputFilename.c_str());
+		return false;
+	}
+
+	std::vector<char> buffer((size_t)clampBuffer(this->maxMemory / 8, MB, 64 * MB));
+	this->bufferedBytes += buffer.size();
+	size_t kept = 0;
+	bool ok = true;
+	while (ok) {
+		fin.read(buffer.data() + kept, buffer.size() - kept);
+		size_t filled = kept + (size_t)fin.gcount();
+		this->bytesRead += (size_t)fin.gcount();
+		bool atEnd = fin.gcount() == 0 || fin.eof();
+
+		size_t lineStart = 0;
+		for (;;) {
+			const char* pNewline = (const char*)memchr(buffer.data() + lineStart, '\n', filled - lineStart);
+			if (!pNewline) break;
+			size_t lineEnd = pNewline - buffer.data();
+			if (!ParseLine(buffer.data() + lineStart, lineEnd - lineStart)) {
+				ok = false;
+				break;
+			}
+			lineStart = lineEnd + 1;
+		}
+		if (!ok) break;
+
+		kept = filled - lineStart;
+		if (atEnd) {
+			if (kept) ok = ParseLine(buffer.data() + lineStart, kept); // no newline on the last line
+			break;
+		}
+		if (kept == buffer.size()) {
+			printf("ERROR: line %llu is longer than the whole %llu MB read buffer\n", this->lineNumber + 1, (unsigned long long)buffer.size() / MB);
+			ok = false;
+			break;
+		}
+		memmove(buffer.data(), buffer.data() + lineStart, kept);
+	}
+
+	this->bufferedBytes -= buffer.size();
+	if (ok && fin.bad()) {
+		printf("ERROR: failed while reading: %s\n", inputFilename.c_str());
+		ok = false;
+	}
+	return ok;
+}
+
+// Same acceptance rules as the in-memory path: exactly 3 floats for v and vn, 2 for vt, and
+// faces are triangles of v/vt/vn triples
+bool OutOfCoreConverter::ParseLine(const char* pLine, size_t length) {
+	this->lineNumber++;
+	const char* pEnd = pLine + length;
+
+	Spill spill;
+	int coords;
+	const char* p;
+	if (length >= 2 && pLine[0] == 'v' && pLine[1] == ' ') {
+		spill = SPILL_POSITIONS; coords = POSITION_FLOATS; p = pLine + 2;
+	}
+	else if (length >= 3 && pLine[0] == 'v' && pLine[1] == 't' && pLine[2] == ' ') {
+		spill = SPILL_TEXELS; coords = TEXEL_FLOATS; p = pLine + 3;
+	}
+	else if (length >= 3 && pLine[0] == 'v' && pLine[1] == 'n' && pLine[2] == ' ') {
+		spill = SPILL_NORMALS; coords = NORMAL_FLOATS; p = pLine + 3;
+	}
+	else if (length >= 2 && pLine[0] == 'f' && pLine[1] == ' ') {
+		spill = SPILL_FACES; coords = 3; p = pLine + 2;
+	}
+	else if (length >= 7 && (memcmp(pLine, "usemtl ", 7) == 0 || memcmp(pLine, "mtllib ", 7) == 0)) {
+		std::string argument = MaterialTable::GetArgument(std::string(pLine, length), 7);
+		if (pLine[0] == 'u') this->currentMaterial = this->materials.Use(argument);
+		else this->materials.LoadLibrary(this->inputFilename, argument);
+		return true;
+	}
+	else {
+		// One count at the end rather than a line each, these files have millions of them
+		this->skippedLines++;
+		return true;
+	}
+
+	// strtof/strtoul stop at the end of the token, but the line isn't zero terminated, so
+	// tokens get copied out first
+	char token[128];
+	unsigned int indices[FACE_INTS];
+	float values[3];
+	for (int i = 0; i < coords; i++) {
+		p = skipSpace(p, pEnd);
+		const char* pTokenEnd = p;
+		while (pTokenEnd < pEnd && !isSpace(*pTokenEnd)) pTokenEnd++;
+		size_t tokenLength = pTokenEnd - p;
+		if (tokenLength == 0 || tokenLength >= sizeof(token)) {
+			printf("ERROR: Not enough tokens (or one too long) in line %llu: '%.*s'\n", this->lineNumber, (int)length, pLine);
+			return false;
+		}
+		memcpy(token, p, tokenLength);
+		token[tokenLength] = '\0';
+		p = pTokenEnd;
+
+		if (spill != SPILL_FACES) {
+			char* pParsed;
+			errno = 0;
+			values[i] = strtof(token, &pParsed);
+			if (pParsed == token || *pParsed != '\0' || errno == ERANGE) {
+				printf("ERROR: Failed to convert token '%s' in line %llu to float.\n", token, this->lineNumber);
+				return false;
+			}
+			continue;
+		}
+
+		// v/vt/vn, 1-based
+		const char* pPart = token;
+		for (int part = 0; part < 3; part++) {
+			char* pParsed;
+			errno = 0;
+			unsigned long value = (*pPart >= '0' && *pPart <= '9') ? strtoul(pPart, &pParsed, 10) : 0;
+			char expected = part < 2 ? '/' : '\0';
+			if (value == 0 || *pParsed != expected || errno == ERANGE || value > UINT_MAX) {
+				printf("ERROR: Face vertex '%s' in line %llu isn't a v/vt/vn triple\n", token, this->lineNumber);
+				return false;
+			}
+			indices[i * 3 + part] = (unsigned int)(value - 1);
+			pPart = pParsed + 1;
+		}
+	}
+	if (skipSpace(p, pEnd) != pEnd) {
+		printf("ERROR: Too many tokens in line %llu: '%.*s'. Expected %d.\n", this->lineNumber, (int)length, pLine, coords);
+		return false;
+	}
+
+	if (spill == SPILL_FACES) {
+		indices[FACE_MATERIAL] = (unsigned int)this->currentMaterial;
+		if (this->materialFaces.size() <= (size_t)this->currentMaterial) this->materialFaces.resize(this->currentMaterial + 1, 0);
+		this->materialFaces[this->currentMaterial]++;
+		return WriteSpill(spill, indices, sizeof(indices));
+	}
+	return WriteSpill(spill, values, coords * sizeof(float));
+}
+
+// Faces come back off disk a chunk at a time and get looked up in the mapped attributes. Each
+// chunk's text goes out before the next is read, so memory use doesn't grow with the model.
+bool OutOfCoreConverter::ResolvePass(const std::string& outputFilename) {
+	MappedFile attributes[3];
+	const float* pAttributes[3] = { nullptr, nullptr, nullptr };
+	unsigned long long attributeCounts[3];
+	const int attributeFloats[3] = { POSITION_FLOATS, TEXEL_FLOATS, NORMAL_FLOATS };
+	const char* attributeNames[3] = { "position", "texel", "normal" };
+	for (int i = 0; i < 3; i++) {
+		attributeCounts[i] = this->spills[i].count / attributeFloats[i];
+		if (attributeCounts[i] == 0) continue; // empty files can't be mapped, and nothing can refer to them anyway
+		if (!attributes[i].OpenLoose(this->spills[i].filename.c_str())) return false;
+		pAttributes[i] = (const float*)attributes[i].GetData();
+	}
+
+	std::ifstream faceIn(this->spills[SPILL_FACES].filename, std::ios::binary);
+	// Text mode like the in-memory writer, so line endings match on Windows too
+	std::ofstream fout(outputFilename, std::ios::trunc);
+	if (!faceIn.is_open() || !fout.is_open()) {
+		printf("ERROR: could not open '%s' for writing\n", outputFilename.c_str());
+		return false;
+	}
+
+	// Half the cap for face indices, a quarter for output text
+	unsigned long long faceCount = this->spills[SPILL_FACES].count / FACE_INTS;
+	size_t chunkFaces = (size_t)clampBuffer(this->maxMemory / 2 / (FACE_INTS * sizeof(unsigned int)), 1024, 4 * MB);
+	std::vector<unsigned int> faces(chunkFaces * FACE_INTS);
+	std::vector<char> text((size_t)clampBuffer(this->maxMemory / 4, MB, 64 * MB));
+	this->bufferedBytes += faces.size() * sizeof(unsigned int) + text.size();
+	if (this->bufferedBytes > this->maxMemory) {
+		printf("ERROR: buffers need %llu MB, more than the %llu MB cap\n", this->bufferedBytes / MB, this->maxMemory / MB);
+		return false;
+	}
+
+	size_t textUsed = (size_t)snprintf(text.data(), text.size(), "%llu\n", faceCount * 3);
+	bool ok = true;
+	// Without materials it's one pass writing everything
+	bool grouped = this->materials.IsUsed();
+	int passes = grouped ? this->materials.GetCount() : 1;
+	for (int material = 0; ok && material < passes; material++) {
+		if (grouped && ((size_t)material >= this->materialFaces.size() || this->materialFaces[material] == 0)) continue;
+		faceIn.clear();
+		faceIn.seekg(0);
+
+		for (unsigned long long firstFace = 0; ok && firstFace < faceCount; firstFace += chunkFaces) {
+			size_t count = (size_t)std::min<unsigned long long>(chunkFaces, faceCount - firstFace);
+			faceIn.read((char*)faces.data(), count * FACE_INTS * sizeof(unsigned int));
+			if ((size_t)faceIn.gcount() != count * FACE_INTS * sizeof(unsigned int)) {
+				printf("ERROR: face spill file came back short\n");
+				ok = false;
+				break;
+			}
+
+			for (size_t f = 0; ok && f < count; f++) {
+				const unsigned int* pFace = &faces[f * FACE_INTS];
+				if (grouped && pFace[FACE_MATERIAL] != (unsigned int)material) continue;
+
+				for (int corner = 0; ok && corner < 3; corner++) {
+					const unsigned int* pCorner = pFace + corner * 3;
+					for (int a = 0; a < 3; a++) {
+						if (pCorner[a] >= attributeCounts[a]) {
+							printf("ERROR: Face %llu refers to %s %u, there are only %llu\n",
+								firstFace + f + 1, attributeNames[a], pCorner[a] + 1, attributeCounts[a]);
+							ok = false;
+						}
+					}
+					if (!ok) break;
+
+					const float* pPos = pAttributes[0] + (size_t)pCorner[0] * POSITION_FLOATS;
+					const float* pTex = pAttributes[1] + (size_t)pCorner[1] * TEXEL_FLOATS;
+					const float* pNorm = pAttributes[2] + (size_t)pCorner[2] * NORMAL_FLOATS;
+					// Same flip and the same double round trip as DXVertexInput, so the text matches exactly
+					float texV = (float)(1.0 - pTex[1]);
+					char line[512];
+					int lineLength = snprintf(line, sizeof(line), "%f %f %f %f %f %f %f %f\n",
+						pPos[0], pPos[1], pPos[2], pTex[0], texV, pNorm[0], pNorm[1], pNorm[2]);
+					if (textUsed + lineLength > text.size()) {
+						fout.write(text.data(), textUsed);
+						this->bytesWritten += textUsed;
+						textUsed = 0;
+					}
+					memcpy(text.data() + textUsed, line, lineLength);
+					textUsed += lineLength;
+				}
+			}
+		}
+	}
+	fout.write(text.data(), textUsed);
+	this->bytesWritten += textUsed;
+
+	if (ok && grouped) {
+		std::vector<SubmeshRange> submeshes;
+		this->materials.GetRanges(this->materialFaces, submeshes);
+		for (size_t i = 0; i < submeshes.size(); i++) fout << submeshes[i].Format();
+		printf("Grouped faces into %d submeshes by material, one pass each\n", (int)submeshes.size());
+	}
+	fout.close();
+
+	this->bufferedBytes -= faces.size() * sizeof(unsigned int) + text.size();
+	if (ok && fout.fail()) {
+		printf("ERROR: failed while writing: %s\n", outputFilename.c_str());
+		ok = false;
+	}
+	return ok;
+}
+
+bool OutOfCoreConverter::OpenSpill(Spill spill, const std::string& filename, size_t bufferSize) {
+	SpillFile& file = this->spills[spill];
+	file.filename = filename;
+	file.stream.open(filename, std::ios::binary | std::ios::trunc);
+	if (!file.stream.is_open()) {
+		printf("ERROR: could not create spill file '%s'\n", filename.c_str());
+		return false;
+	}
+	file.buffer.resize(bufferSize);
+	file.used = 0;
+	file.count = 0;
+	this->bufferedBytes += bufferSize;
+	return true;
+}
+
+bool OutOfCoreConverter::WriteSpill(Spill spill, const void* pData, size_t size) {
+	SpillFile& file = this->spills[spill];
+	if (file.used + size > file.buffer.size() && !FlushSpill(spill)) return false;
+	memcpy(file.buffer.data() + file.used, pData, size);
+	file.used += size;
+	file.count += size / (spill == SPILL_FACES ? sizeof(unsigned int) : sizeof(float));
+	return true;
+}
+
+bool OutOfCoreConverter::FlushSpill(Spill spill) {
+	SpillFile& file = this->spills[spill];
+	file.stream.write(file.buffer.data(), file.used);
+	file.used = 0;
+	if (file.stream.fail()) {
+		printf("ERROR: failed while writing spill file '%s' (out of disk?)\n", file.filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+void OutOfCoreConverter::RemoveSpills() {
+	for (int i = 0; i < SPILL_COUNT; i++) {
+		SpillFile& file = this->spills[i];
+		if (file.filename.empty()) continue;
+		if (file.stream.is_open()) file.stream.close();
+		remove(file.filename.c_str());
+		file.filename.clear();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "MaterialTable.h"
+
+// Smallest memory cap a conversion can work in, its buffers don't get any smaller than this
+const unsigned long long OUT_OF_CORE_MIN_MEMORY = 16ull * 1024 * 1024;
+
+/* Converts OBJ files too big to hold in memory, producing exactly what the in-memory path
+ * does. Nothing is ever held whole:
+ *
+ *  1. The input is streamed through a fixed buffer. Positions, texels and normals are spilled
+ *     as packed floats to temp files next to the output, face indices to a fourth one.
+ *  2. The attribute spills are memory mapped, so only the pages faces actually touch are
+ *     resident and the OS can drop them again under pressure.
+ *  3. Faces are read back in chunks sized to the memory cap, resolved against the mappings and
+ *     each chunk is formatted and appended to the output before the next one starts.
+ *     Models with materials get one pass over the faces per material, each pass writing only
+ *     that material's faces, which groups them the same way the in-memory path does without
+ *     ever sorting the faces.
+ *
+ * Our own buffers stay under the cap. The mapped pages are page cache rather than heap, the
+ * OS reclaims them as needed. */
+class OutOfCoreConverter {
+public:
+	OutOfCoreConverter();
+	~OutOfCoreConverter();
+
+	bool Convert(const std::string&, const std::string&, unsigned long long);
+
+private:
+	enum Spill {
+		SPILL_POSITIONS,
+		SPILL_TEXELS,
+		SPILL_NORMALS,
+		SPILL_FACES,
+		SPILL_COUNT,
+	};
+
+	struct SpillFile {
+		std::string filename;
+		std::ofstream stream;
+		std::vector<char> buffer;
+		size_t used;
+		unsigned long long count; // floats, or ints for faces
+	};
+
+	bool ParsePass(const std::string&);
+	bool ParseLine(const char*, size_t);
+	bool ResolvePass(const std::string&);
+	bool OpenSpill(Spill, const std::string&, size_t);
+	bool WriteSpill(Spill, const void*, size_t);
+	bool FlushSpill(Spill);
+	void RemoveSpills();
+
+	std::string inputFilename;
+	MaterialTable materials;
+	int currentMaterial;
+	std::vector<unsigned long long> materialFaces; // faces per material index
+	unsigned long long maxMemory;
+	unsigned long long bufferedBytes; // all of our own buffers, to check against the cap
+	SpillFile spills[SPILL_COUNT];
+	unsigned long long skippedLines;
+	unsigned long long lineNumber;
+	unsigned long long bytesRead;
+	unsigned long long bytesWritten;
+};
\ No newline at end of file
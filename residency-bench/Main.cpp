@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "../directx-sandbox/TextureResidency.h"
+
+/* Drives TextureResidency with a mock allocator, no GPU needed. First a handful of small
+ * scenes where the right answer is known: nothing trimmed under budget, textures that went
+ * off screen trimmed least recently used first, visible ones losing a level each smallest on
+ * screen first, pinned bytes squeezing the textures, trimmed mips coming back once there's
+ * room, and the counters matching what the allocator was told. Then a random streaming
+ * workload checks the same rules hold every frame and times Update. */
+
+struct BenchOptions {
+	int textures;
+	int frames;
+	int visiblePercent;
+	int budgetPercent;
+	unsigned int seed;
+
+	BenchOptions() {
+		textures = 4096;
+		frames = 1000;
+		visiblePercent = 30;
+		budgetPercent = 15;
+		seed = 1;
+	}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printUsage() {
+	printf("Usage: residency-bench [options]\n");
+	printf("  --textures N  textures in the streaming workload (default 4096)\n");
+	printf("  --frames N    frames to run it for (default 1000)\n");
+	printf("  --visible N   percent of textures drawn each frame (default 30)\n");
+	printf("  --budget N    budget as a percent of every texture at full detail (default 15)\n");
+	printf("  --seed N      for the random workload (default 1)\n");
+}
+
+int parseArgs(int argc, char* argv[], BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--textures" && i + 1 < argc) {
+			options.textures = atoi(argv[++i]);
+		}
+		else if (arg == "--frames" && i + 1 < argc) {
+			options.frames = atoi(argv[++i]);
+		}
+		else if (arg == "--visible" && i + 1 < argc) {
+			options.visiblePercent = atoi(argv[++i]);
+		}
+		else if (arg == "--budget" && i + 1 < argc) {
+			options.budgetPercent = atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			options.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.textures <= 0 || options.frames <= 0 || options.visiblePercent < 0 || options.visiblePercent > 100
+		|| options.budgetPercent <= 0)
+	{
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+// What a texture looks like from the allocator's side: the first mip it's been told to keep
+struct MockTexture {
+	int handle;
+	int firstMip;
+};
+
+class MockAllocator : public ResidencyAllocator {
+public:
+	MockAllocator() {
+		this->calls = 0;
+	}
+
+	void SetFirstMip(void* pUser, int mip) override {
+		((MockTexture*)pUser)->firstMip = mip;
+		this->calls++;
+	}
+
+	unsigned long long calls;
+};
+
+// RGBA8 or BC1, square, with a full chain down to 1x1 and a tail of the last few levels that
+// never gets trimmed
+TextureFootprint makeFootprint(unsigned int size, bool compressed) {
+	TextureFootprint footprint;
+	footprint.width = footprint.height = size;
+	footprint.mipCount = 1;
+	while ((size >> footprint.mipCount) > 0) footprint.mipCount++;
+	footprint.arraySize = 1;
+	footprint.blockCompressed = compressed;
+	footprint.blockBytes = compressed ? 8 : 4;
+	footprint.coarsestMip = footprint.mipCount > 4 ? footprint.mipCount - 4 : 0;
+	return footprint;
+}
+
+// A small scene: the manager, the allocator and the textures it's been handed, with checks
+// that print what went wrong
+struct Scene {
+	TextureResidency residency;
+	MockAllocator allocator;
+	std::vector<TextureFootprint> footprints;
+	std::vector<MockTexture> textures;
+	int errors;
+
+	Scene(unsigned long long budget, int count) : textures(count) {
+		this->residency.Init(budget, &this->allocator);
+		this->errors = 0;
+	}
+
+	void Add(int i, const TextureFootprint& footprint) {
+		if ((int)this->footprints.size() <= i) this->footprints.resize(i + 1);
+		this->footprints[i] = footprint;
+		this->textures[i].firstMip = footprint.coarsestMip;
+		this->textures[i].handle = this->residency.Register(footprint, &this->textures[i]);
+	}
+
+	unsigned long long Bytes(int i, int mip) {
+		return TextureResidency::GetChainBytes(this->footprints[i], mip);
+	}
+
+	void ExpectMip(const char* scene, int i, int mip) {
+		if (this->textures[i].firstMip != mip) {
+			printf("ERROR: %s: texture %d is at mip %d, should be %d\n", scene, i, this->textures[i].firstMip, mip);
+			this->errors++;
+		}
+	}
+
+	void ExpectEvictions(const char* scene, unsigned long long evictions) {
+		if (this->residency.GetEvictionCount() != evictions) {
+			printf("ERROR: %s: %llu mips evicted, should be %llu\n", scene, this->residency.GetEvictionCount(), evictions);
+			this->errors++;
+		}
+	}
+
+	// Resident bytes have to be what the allocator was told to keep, nothing more or less
+	void ExpectResidentMatches(const char* scene) {
+		unsigned long long bytes = 0;
+		for (size_t i = 0; i < this->textures.size(); i++) {
+			if (this->textures[i].handle >= 0) bytes += Bytes((int)i, this->textures[i].firstMip);
+		}
+		if (this->residency.GetResidentBytes() != bytes) {
+			printf("ERROR: %s: %llu bytes resident, the allocator holds %llu\n", scene, this->residency.GetResidentBytes(), bytes);
+			this->errors++;
+		}
+	}
+};
+
+int checkUnderBudget() {
+	const char* name = "under budget";
+	TextureFootprint footprint = makeFootprint(256, false);
+	unsigned long long full = TextureResidency::GetChainBytes(footprint, 0);
+	Scene scene(4 * full, 4);
+	for (int i = 0; i < 4; i++) scene.Add(i, footprint);
+	for (int i = 0; i < 4; i++) scene.residency.Request(scene.textures[i].handle, 0, 100.0f);
+	scene.residency.Update();
+	for (int i = 0; i < 4; i++) scene.ExpectMip(name, i, 0);
+	scene.ExpectEvictions(name, 0);
+	scene.ExpectResidentMatches(name);
+
+	// Asking again for what's already there doesn't bother the allocator
+	unsigned long long calls = scene.allocator.calls;
+	for (int i = 0; i < 4; i++) scene.residency.Request(scene.textures[i].handle, 0, 100.0f);
+	scene.residency.Update();
+	if (scene.allocator.calls != calls) {
+		printf("ERROR: %s: the allocator was called again with nothing changed\n", name);
+		scene.errors++;
+	}
+	return scene.errors;
+}
+
+// Each texture is asked for on its own frame, so the least recently used is the first. With
+// all three wanted only one of the off-screen two has to go, and it's the older one.
+int checkLeastRecentlyUsed() {
+	const char* name = "least recently used";
+	TextureFootprint footprint = makeFootprint(256, false);
+	unsigned long long full = TextureResidency::GetChainBytes(footprint, 0);
+	unsigned long long coarse = TextureResidency::GetChainBytes(footprint, footprint.coarsestMip);
+	Scene scene(2 * full + coarse, 3);
+	for (int i = 0; i < 3; i++) scene.Add(i, footprint);
+	for (int i = 0; i < 3; i++) {
+		scene.residency.Request(scene.textures[i].handle, 0, 100.0f);
+		scene.residency.Update();
+	}
+	scene.ExpectMip(name, 0, footprint.coarsestMip);
+	scene.ExpectMip(name, 1, 0);
+	scene.ExpectMip(name, 2, 0);
+	scene.ExpectEvictions(name, footprint.coarsestMip);
+	scene.ExpectResidentMatches(name);
+	return scene.errors;
+}
+
+// Everything's on screen, so nothing drops to its tail: the smallest on screen gives up a
+// level first, and when that's not enough the others follow a level at a time. Pinned bytes
+// do the squeezing, once the textures are all resident at full detail.
+int checkVisibleTrimming() {
+	const char* name = "visible trimming";
+	TextureFootprint footprint = makeFootprint(256, true);
+	unsigned long long full = TextureResidency::GetChainBytes(footprint, 0);
+	unsigned long long oneDown = TextureResidency::GetChainBytes(footprint, 1);
+	float pixels[3] = { 500.0f, 20.0f, 300.0f };
+	int errors = 0;
+
+	// Just enough squeezed out for the smallest to go down a level, then a bit less room than
+	// every one of them down a level, so the smallest goes down another
+	unsigned long long pinned[2] = { full - oneDown, 3 * (full - oneDown) + 1 };
+	int expected[2][3] = { { 0, 1, 0 }, { 1, 2, 1 } };
+	unsigned long long evictions[2] = { 1, 4 };
+	for (int n = 0; n < 2; n++) {
+		Scene scene(3 * full, 3);
+		for (int i = 0; i < 3; i++) scene.Add(i, footprint);
+		for (int i = 0; i < 3; i++) scene.residency.Request(scene.textures[i].handle, 0, pixels[i]);
+		scene.residency.Update();
+		scene.residency.AddPinnedBytes(pinned[n]);
+		for (int i = 0; i < 3; i++) scene.residency.Request(scene.textures[i].handle, 0, pixels[i]);
+		scene.residency.Update();
+		for (int i = 0; i < 3; i++) scene.ExpectMip(name, i, expected[n][i]);
+		scene.ExpectEvictions(name, evictions[n]);
+		scene.ExpectResidentMatches(name);
+		errors += scene.errors;
+	}
+	return errors;
+}
+
+// Pinned bytes push the textures down, and once they're gone (or a texture is) the trimmed
+// levels come back without counting as more evictions. Levels that were held back before
+// they were ever resident aren't evictions either.
+int checkPinnedAndRestore() {
+	const char* name = "pinned bytes";
+	TextureFootprint footprint = makeFootprint(512, false);
+	unsigned long long full = TextureResidency::GetChainBytes(footprint, 0);
+	Scene scene(2 * full, 2);
+	scene.Add(0, footprint);
+	scene.Add(1, footprint);
+	scene.residency.AddPinnedBytes(full / 2);
+	scene.residency.Request(scene.textures[0].handle, 0, 100.0f);
+	scene.residency.Request(scene.textures[1].handle, 0, 50.0f);
+	scene.residency.Update();
+	scene.ExpectMip(name, 0, 0);
+	scene.ExpectMip(name, 1, 1);
+	scene.ExpectEvictions(name, 0);
+	scene.ExpectResidentMatches(name);
+
+	scene.residency.RemovePinnedBytes(full / 2);
+	scene.residency.Request(scene.textures[0].handle, 0, 100.0f);
+	scene.residency.Request(scene.textures[1].handle, 0, 50.0f);
+	scene.residency.Update();
+	scene.ExpectMip(name, 1, 0);
+	scene.ExpectEvictions(name, 0);
+	scene.ExpectResidentMatches(name);
+
+	scene.residency.AddPinnedBytes(full / 2);
+	scene.residency.Request(scene.textures[0].handle, 0, 100.0f);
+	scene.residency.Request(scene.textures[1].handle, 0, 50.0f);
+	scene.residency.Update();
+	scene.ExpectMip(name, 0, 0);
+	scene.ExpectMip(name, 1, 1);
+	scene.ExpectEvictions(name, 1);
+	scene.ExpectResidentMatches(name);
+
+	// Too much pinned for anything but the tails, which is as far as it can go
+	scene.residency.AddPinnedBytes(2 * full);
+	scene.residency.Request(scene.textures[0].handle, 0, 100.0f);
+	scene.residency.Request(scene.textures[1].handle, 0, 50.0f);
+	scene.residency.Update();
+	scene.ExpectMip(name, 0, footprint.coarsestMip);
+	scene.ExpectMip(name, 1, footprint.coarsestMip);
+	scene.ExpectEvictions(name, 2 * footprint.coarsestMip);
+
+	// Unregistering frees its bytes at once
+	scene.residency.Unregister(scene.textures[1].handle);
+	scene.textures[1].handle = -1;
+	scene.ExpectResidentMatches(name);
+	return scene.errors;
+}
+
+// Random textures come and go from view, asking for the mip their distance would give them.
+// Every frame: the allocator agrees with the counters, nobody is finer than they asked for,
+// and if the budget's still blown it's because everything that could be trimmed has been.
+int runWorkload(const BenchOptions& options) {
+	std::mt19937 random(options.seed);
+	std::vector<TextureFootprint> footprints(options.textures);
+	unsigned long long fullBytes = 0;
+	for (int i = 0; i < options.textures; i++) {
+		footprints[i] = makeFootprint(64u << (random() % 6), random() % 2 == 0);
+		fullBytes += TextureResidency::GetChainBytes(footprints[i], 0);
+	}
+	unsigned long long budget = fullBytes / 100 * options.budgetPercent;
+
+	Scene scene(budget, options.textures);
+	for (int i = 0; i < options.textures; i++) scene.Add(i, footprints[i]);
+	printf("Workload: %d textures, %.1f MB at full detail, %.1f MB budget, %d%% visible, seed %u\n",
+		options.textures, fullBytes / (1024.0 * 1024.0), budget / (1024.0 * 1024.0), options.visiblePercent, options.seed);
+
+	std::vector<int> requested(options.textures);
+	double updateMs = 0.0;
+	for (int frame = 0; frame < options.frames && scene.errors == 0; frame++) {
+		for (int i = 0; i < options.textures; i++) requested[i] = -1;
+		for (int i = 0; i < options.textures; i++) {
+			if ((int)(random() % 100) >= options.visiblePercent) continue;
+			requested[i] = (int)(random() % (footprints[i].coarsestMip + 1));
+			float pixels = (float)(footprints[i].width >> requested[i]);
+			scene.residency.Request(scene.textures[i].handle, requested[i], pixels);
+		}
+		auto start = Clock::now();
+		scene.residency.Update();
+		updateMs += msSince(start);
+
+		scene.ExpectResidentMatches("workload");
+		bool allCoarsest = true;
+		for (int i = 0; i < options.textures; i++) {
+			int mip = scene.textures[i].firstMip;
+			if (mip < footprints[i].coarsestMip) allCoarsest = false;
+			if (requested[i] >= 0 && mip < requested[i]) {
+				printf("ERROR: workload frame %d: texture %d is at mip %d, finer than the %d it asked for\n",
+					frame, i, mip, requested[i]);
+				scene.errors++;
+			}
+		}
+		if (scene.residency.GetResidentBytes() > budget && !allCoarsest) {
+			printf("ERROR: workload frame %d: %llu bytes resident over a budget of %llu with mips still to trim\n",
+				frame, scene.residency.GetResidentBytes(), budget);
+			scene.errors++;
+		}
+	}
+
+	scene.residency.PrintStats();
+	printf("  %d frames, %.3f ms per Update, %llu allocator calls\n", options.frames, updateMs / options.frames,
+		scene.allocator.calls);
+	return scene.errors;
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	int errors = 0;
+	errors += checkUnderBudget();
+	errors += checkLeastRecentlyUsed();
+	errors += checkVisibleTrimming();
+	errors += checkPinnedAndRestore();
+	printf("Scenes: %s\n", errors == 0 ? "all as expected" : "FAILED");
+
+	errors += runWorkload(options);
+	return errors > 0 ? -10 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <DirectXMath.h>
+
+#include "../directx-sandbox/SceneFile.h"
+#include "../directx-sandbox/Scene.h"
+
+/* Turns the text form of a scene into the compiled .scene the sandbox loads, makes big
+ * synthetic scenes for stress testing, and times loading them. The text form is one thing per
+ * line, '#' to the end of a line is a comment:
+ *
+ *   camera [position x y z] [rotation x y z]
+ *   light [direction x y z] [diffuse r g b a] [ambient r g b a]
+ *   instance model <file> texture <file> [streamed] [position x y z] [rotation x y z]
+ *            [scale x y z] [spin x y z] [parent n]
+ *
+ * Rotations are degrees about x, y and z (applied z, x, then y, like the camera), parent is the
+ * number of an earlier instance counting from 0, and spin keeps an instance turning (see
+ * SceneInstance). Instances with the same model, texture and streaming share an asset. */
+
+enum Mode {
+	MODE_COMPILE,
+	MODE_GENERATE,
+	MODE_TIME,
+};
+
+struct CompileOptions {
+	Mode mode;
+	std::string inputFilename;
+	std::string outputFilename;
+	int instanceCount;
+	unsigned int seed;
+	bool text;
+	int repeat;
+
+	CompileOptions() {
+		mode = MODE_COMPILE;
+		instanceCount = 100000;
+		seed = 1;
+		text = false;
+		repeat = 10;
+	}
+};
+
+// The scene as written, before rotations become quaternions
+struct InstanceDesc {
+	unsigned int asset;
+	int parent;
+	float translation[3];
+	float rotation[3];
+	float scale[3];
+	float spin[3];
+};
+
+struct AssetDesc {
+	std::string modelFilename;
+	std::string textureFilename;
+	unsigned int flags;
+};
+
+struct SceneDesc {
+	SceneCamera camera;
+	std::vector<AssetDesc> assets;
+	std::vector<InstanceDesc> instances;
+	std::vector<SceneLight> lights;
+
+	SceneDesc() {
+		memset(&camera, 0, sizeof(camera));
+	}
+};
+
+void printUsage() {
+	printf("Usage: scene-compiler <input.txt> <output.scene>\n");
+	printf("       scene-compiler --generate <output> [--count N] [--seed N] [--text]\n");
+	printf("       scene-compiler --time <scene.scene> [--repeat N]\n");
+	printf("  --count N     instances in a generated scene (default 100000)\n");
+	printf("  --seed N      for the generated scene (default 1)\n");
+	printf("  --text        write the generated scene in the text form instead of compiled\n");
+	printf("  --repeat N    loads to time (default 10)\n");
+}
+
+int parseArgs(int argc, char* argv[], CompileOptions& options) {
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--generate") {
+			options.mode = MODE_GENERATE;
+		}
+		else if (arg == "--time") {
+			options.mode = MODE_TIME;
+		}
+		else if (arg == "--count" && i + 1 < argc) {
+			options.instanceCount = atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			options.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--text") {
+			options.text = true;
+		}
+		else if (arg == "--repeat" && i + 1 < argc) {
+			options.repeat = atoi(argv[++i]);
+		}
+		else if (arg.rfind("--", 0) == 0) {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+		else {
+			positional.push_back(arg);
+		}
+	}
+
+	size_t expected = options.mode == MODE_COMPILE ? 2 : 1;
+	if (positional.size() != expected) {
+		printf("ERROR: wrong number of filenames\n");
+		return -1;
+	}
+	if (options.mode == MODE_COMPILE) {
+		options.inputFilename = positional[0];
+		options.outputFilename = positional[1];
+	}
+	else if (options.mode == MODE_GENERATE) {
+		options.outputFilename = positional[0];
+	}
+	else {
+		options.inputFilename = positional[0];
+	}
+	if (options.instanceCount <= 0 || options.repeat <= 0) {
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+unsigned int findAsset(SceneDesc& scene, const AssetDesc& asset) {
+	for (size_t i = 0; i < scene.assets.size(); i++) {
+		const AssetDesc& other = scene.assets[i];
+		if (other.modelFilename == asset.modelFilename && other.textureFilename == asset.textureFilename
+			&& other.flags == asset.flags)
+		{
+			return (unsigned int)i;
+		}
+	}
+	scene.assets.push_back(asset);
+	return (unsigned int)scene.assets.size() - 1;
+}
+
+// Reads count floats following a keyword, false if there aren't that many
+bool readFloats(std::istringstream& words, float* pValues, int count) {
+	for (int i = 0; i < count; i++) {
+		if (!(words >> pValues[i])) return false;
+	}
+	return true;
+}
+
+int parseSceneText(const std::string& filename, SceneDesc& scene) {
+	std::ifstream file(filename);
+	if (!file) {
+		printf("ERROR: could not open '%s'\n", filename.c_str());
+		return -1;
+	}
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+		std::istringstream words(line);
+		std::string kind;
+		if (!(words >> kind)) continue;
+
+		SceneLight light = { { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0 };
+		InstanceDesc instance = { 0, SCENE_NO_PARENT, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f },
+			{ 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+		AssetDesc asset;
+		asset.flags = 0;
+		if (kind != "camera" && kind != "light" && kind != "instance") {
+			printf("ERROR: %s:%d: expected camera, light or instance, not '%s'\n", filename.c_str(), lineNumber, kind.c_str());
+			return -1;
+		}
+
+		std::string word;
+		bool ok = true;
+		while (ok && words >> word) {
+			if (kind == "camera" && word == "position") ok = readFloats(words, scene.camera.position, 3);
+			else if (kind == "camera" && word == "rotation") ok = readFloats(words, scene.camera.rotation, 3);
+			else if (kind == "light" && word == "direction") ok = readFloats(words, light.direction, 3);
+			else if (kind == "light" && word == "diffuse") ok = readFloats(words, light.diffuseColor, 4);
+			else if (kind == "light" && word == "ambient") ok = readFloats(words, light.ambientColor, 4);
+			else if (kind == "instance" && word == "model") ok = !!(words >> asset.modelFilename);
+			else if (kind == "instance" && word == "texture") ok = !!(words >> asset.textureFilename);
+			else if (kind == "instance" && word == "streamed") asset.flags |= SCENE_ASSET_STREAMED;
+			else if (kind == "instance" && word == "position") ok = readFloats(words, instance.translation, 3);
+			else if (kind == "instance" && word == "rotation") ok = readFloats(words, instance.rotation, 3);
+			else if (kind == "instance" && word == "scale") ok = readFloats(words, instance.scale, 3);
+			else if (kind == "instance" && word == "spin") ok = readFloats(words, instance.spin, 3);
+			else if (kind == "instance" && word == "parent") ok = !!(words >> instance.parent);
+			else {
+				printf("ERROR: %s:%d: '%s' doesn't go on a %s line\n", filename.c_str(), lineNumber, word.c_str(), kind.c_str());
+				return -1;
+			}
+		}
+		if (!ok) {
+			printf("ERROR: %s:%d: '%s' is missing its values\n", filename.c_str(), lineNumber, word.c_str());
+			return -1;
+		}
+
+		if (kind == "light") {
+			scene.lights.push_back(light);
+		}
+		else if (kind == "instance") {
+			if (asset.modelFilename.empty() || asset.textureFilename.empty()) {
+				printf("ERROR: %s:%d: instances need a model and a texture\n", filename.c_str(), lineNumber);
+				return -1;
+			}
+			if (instance.parent != SCENE_NO_PARENT && (instance.parent < 0 || instance.parent >= (int)scene.instances.size())) {
+				printf("ERROR: %s:%d: parent %d isn't an earlier instance\n", filename.c_str(), lineNumber, instance.parent);
+				return -1;
+			}
+			instance.asset = findAsset(scene, asset);
+			scene.instances.push_back(instance);
+		}
+	}
+	return 0;
+}
+
+// A cloud of instances spread over a cube that grows with the count, so the density stays the
+// same. One in five hangs off an earlier instance and one in ten spins.
+void generateScene(const CompileOptions& options, SceneDesc& scene) {
+	static const char* const models[] = { "./data/sq_cubes.txt", "./data/sphere.txt", "./data/cube_moved.txt" };
+	static const char* const textures[] = { "./data/aluminum.tga", "./data/stone01.tga", "./data/danger.tga" };
+	for (int i = 0; i < 3; i++) {
+		AssetDesc asset;
+		asset.modelFilename = models[i];
+		asset.textureFilename = textures[i];
+		asset.flags = 0;
+		scene.assets.push_back(asset);
+	}
+
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	float halfSize = 4.0f * cbrtf((float)options.instanceCount);
+	scene.instances.resize(options.instanceCount);
+	for (int i = 0; i < options.instanceCount; i++) {
+		InstanceDesc& instance = scene.instances[i];
+		instance.asset = random() % scene.assets.size();
+		bool child = i > 0 && random() % 5 == 0;
+		instance.parent = child ? (int)(random() % i) : SCENE_NO_PARENT;
+		float spread = child ? 3.0f : halfSize;
+		for (int axis = 0; axis < 3; axis++) {
+			instance.translation[axis] = unit(random) * spread;
+			instance.rotation[axis] = unit(random) * 180.0f;
+			instance.spin[axis] = 0.0f;
+		}
+		float scale = child ? 0.5f : 1.0f + unit(random) * 0.5f;
+		instance.scale[0] = instance.scale[1] = instance.scale[2] = scale;
+		if (random() % 10 == 0) instance.spin[1] = unit(random) * 2.0f;
+	}
+
+	scene.camera.position[2] = -halfSize - 25.0f;
+	SceneLight light = { { 0.0f, -0.5f, 1.0f }, { 0.7f, 0.7f, 0.7f, 1.0f }, { 0.15f, 0.15f, 0.15f, 1.0f }, 0 };
+	scene.lights.push_back(light);
+}
+
+unsigned long long alignUp(unsigned long long value, unsigned long long alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Laid out in memory exactly as it'll be read back, then written in one go
+int writeScene(const std::string& filename, const SceneDesc& scene) {
+	std::string strings;
+	std::map<std::string, unsigned long long> stringOffsets;
+	auto addString = [&](const std::string& value) {
+		auto found = stringOffsets.find(value);
+		if (found != stringOffsets.end()) return found->second;
+		unsigned long long offset = strings.size();
+		strings.append(value.c_str(), value.size() + 1);
+		stringOffsets[value] = offset;
+		return offset;
+	};
+
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SCENE_MAGIC;
+	header.version = SCENE_VERSION;
+	header.assetCount = (unsigned int)scene.assets.size();
+	header.instanceCount = (unsigned int)scene.instances.size();
+	header.lightCount = (unsigned int)scene.lights.size();
+	header.camera = scene.camera;
+	header.assetsOffset = alignUp(sizeof(SceneFileHeader), SCENE_SECTION_ALIGNMENT);
+	header.instancesOffset = alignUp(header.assetsOffset + sizeof(SceneAsset) * scene.assets.size(), SCENE_SECTION_ALIGNMENT);
+	header.lightsOffset = alignUp(header.instancesOffset + sizeof(SceneInstance) * scene.instances.size(), SCENE_SECTION_ALIGNMENT);
+	header.stringsOffset = alignUp(header.lightsOffset + sizeof(SceneLight) * scene.lights.size(), SCENE_SECTION_ALIGNMENT);
+
+	std::vector<SceneAsset> assets(scene.assets.size());
+	for (size_t i = 0; i < scene.assets.size(); i++) {
+		memset(&assets[i], 0, sizeof(SceneAsset));
+		assets[i].modelOffset = addString(scene.assets[i].modelFilename);
+		assets[i].textureOffset = addString(scene.assets[i].textureFilename);
+		assets[i].flags = scene.assets[i].flags;
+	}
+	header.stringsSize = strings.size();
+
+	std::vector<unsigned char> file((size_t)(header.stringsOffset + header.stringsSize), 0);
+	memcpy(file.data(), &header, sizeof(header));
+	if (!assets.empty()) memcpy(&file[(size_t)header.assetsOffset], assets.data(), sizeof(SceneAsset) * assets.size());
+	if (!scene.lights.empty()) memcpy(&file[(size_t)header.lightsOffset], scene.lights.data(), sizeof(SceneLight) * scene.lights.size());
+	if (!strings.empty()) memcpy(&file[(size_t)header.stringsOffset], strings.data(), strings.size());
+
+	SceneInstance* pInstances = (SceneInstance*)&file[(size_t)header.instancesOffset];
+	for (size_t i = 0; i < scene.instances.size(); i++) {
+		const InstanceDesc& desc = scene.instances[i];
+		SceneInstance& instance = pInstances[i];
+		instance.asset = desc.asset;
+		instance.parent = desc.parent;
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationRollPitchYaw(
+			DirectX::XMConvertToRadians(desc.rotation[0]), DirectX::XMConvertToRadians(desc.rotation[1]),
+			DirectX::XMConvertToRadians(desc.rotation[2])));
+		instance.rotation[0] = rotation.x;
+		instance.rotation[1] = rotation.y;
+		instance.rotation[2] = rotation.z;
+		instance.rotation[3] = rotation.w;
+		memcpy(instance.translation, desc.translation, sizeof(instance.translation));
+		memcpy(instance.scale, desc.scale, sizeof(instance.scale));
+		memcpy(instance.spin, desc.spin, sizeof(instance.spin));
+	}
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (!pFile) {
+		printf("ERROR: could not open '%s' for writing\n", filename.c_str());
+		return -1;
+	}
+	bool ok = fwrite(file.data(), 1, file.size(), pFile) == file.size();
+	ok = (fclose(pFile) == 0) && ok;
+	if (!ok) {
+		printf("ERROR: failed while writing '%s'\n", filename.c_str());
+		return -1;
+	}
+	printf("%d assets, %d instances, %d lights, %llu bytes\n", (int)scene.assets.size(),
+		(int)scene.instances.size(), (int)scene.lights.size(), (unsigned long long)file.size());
+	return 0;
+}
+
+int writeSceneText(const std::string& filename, const SceneDesc& scene) {
+	FILE* pFile = fopen(filename.c_str(), "w");
+	if (!pFile) {
+		printf("ERROR: could not open '%s' for writing\n", filename.c_str());
+		return -1;
+	}
+	const SceneCamera& camera = scene.camera;
+	fprintf(pFile, "camera position %g %g %g rotation %g %g %g\n", camera.position[0], camera.position[1],
+		camera.position[2], camera.rotation[0], camera.rotation[1], camera.rotation[2]);
+	for (size_t i = 0; i < scene.lights.size(); i++) {
+		const SceneLight& light = scene.lights[i];
+		fprintf(pFile, "light direction %g %g %g diffuse %g %g %g %g ambient %g %g %g %g\n",
+			light.direction[0], light.direction[1], light.direction[2],
+			light.diffuseColor[0], light.diffuseColor[1], light.diffuseColor[2], light.diffuseColor[3],
+			light.ambientColor[0], light.ambientColor[1], light.ambientColor[2], light.ambientColor[3]);
+	}
+	for (size_t i = 0; i < scene.instances.size(); i++) {
+		const InstanceDesc& instance = scene.instances[i];
+		const AssetDesc& asset = scene.assets[instance.asset];
+		fprintf(pFile, "instance model %s texture %s%s position %g %g %g rotation %g %g %g scale %g %g %g",
+			asset.modelFilename.c_str(), asset.textureFilename.c_str(),
+			(asset.flags & SCENE_ASSET_STREAMED) ? " streamed" : "",
+			instance.translation[0], instance.translation[1], instance.translation[2],
+			instance.rotation[0], instance.rotation[1], instance.rotation[2],
+			instance.scale[0], instance.scale[1], instance.scale[2]);
+		if (instance.spin[0] != 0.0f || instance.spin[1] != 0.0f || instance.spin[2] != 0.0f) {
+			fprintf(pFile, " spin %g %g %g", instance.spin[0], instance.spin[1], instance.spin[2]);
+		}
+		if (instance.parent != SCENE_NO_PARENT) fprintf(pFile, " parent %d", instance.parent);
+		fprintf(pFile, "\n");
+	}
+	bool ok = ferror(pFile) == 0;
+	ok = (fclose(pFile) == 0) && ok;
+	if (!ok) {
+		printf("ERROR: failed while writing '%s'\n", filename.c_str());
+		return -1;
+	}
+	printf("%d instances written as text\n", (int)scene.instances.size());
+	return 0;
+}
+
+// Loads it through the same Scene the sandbox uses, with a cold first load and then warm ones
+int timeScene(const CompileOptions& options) {
+	double firstMs = 0.0, bestMs = 0.0, totalMs = 0.0;
+	Scene scene;
+	for (int i = 0; i < options.repeat; i++) {
+		auto startTime = std::chrono::steady_clock::now();
+		bool ok = scene.Load(options.inputFilename.c_str());
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		if (!ok) return -10;
+		if (i == 0) firstMs = bestMs = ms;
+		if (ms < bestMs) bestMs = ms;
+		totalMs += ms;
+	}
+	printf("%d assets, %d instances, %d lights\n", scene.GetAssetCount(), scene.GetInstanceCount(), scene.GetLightCount());
+	printf("Loaded in %.3f ms the first time, %.3f ms best, %.3f ms average over %d\n",
+		firstMs, bestMs, totalMs / options.repeat, options.repeat);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	CompileOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+	if (options.mode == MODE_TIME) return timeScene(options);
+
+	auto startTime = std::chrono::steady_clock::now();
+	SceneDesc scene;
+	if (options.mode == MODE_GENERATE) {
+		generateScene(options, scene);
+	}
+	else if (parseSceneText(options.inputFilename, scene) < 0) {
+		return -10;
+	}
+
+	int result = options.text ? writeSceneText(options.outputFilename, scene) : writeScene(options.outputFilename, scene);
+	if (result < 0) return -20;
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Output written to: %s (%.2f ms)\n", options.outputFilename.c_str(), ms);
+	return 0;
+}
\ No newline at end of file
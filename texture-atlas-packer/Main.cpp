@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "../directx-sandbox/TargaDecoder.h"
+#include "MaxRectsPacker.h"
+
+/* Packs the textures of many small props into a few big atlases so they can share one SRV
+ * (and eventually one draw). The manifest lists one "<model.txt> <texture.tga>" pair per line,
+ * models being the converter's output. Each texture becomes a sprite in an atlas, each model is
+ * rewritten with its UVs remapped into its sprite, and atlas.txt says which atlas goes with
+ * which rewritten model. Models split into submeshes by material aren't supported. */
+
+struct PackOptions {
+	std::string manifestFilename;
+	std::string outputDir;
+	int atlasSize;
+	int padding;
+	int cleanMips;
+
+	PackOptions() {
+		atlasSize = 2048;
+		padding = 0;
+		cleanMips = 4;
+	}
+};
+
+// One input texture. Several models can point at the same one; it's only packed once.
+struct Sprite {
+	std::string filename;
+	int width, height;
+	bool atlased;  // false if a model using it tiles its UVs outside 0..1
+	MaxRectsPacker::Placement cell;
+	int x, y;      // where the texels start inside the cell's atlas
+};
+
+struct ModelEntry {
+	std::string inputFilename;
+	std::string outputFilename;
+	int sprite;
+	std::vector<float> rows;  // 8 floats per vertex, same as the converter writes them
+};
+
+static const int FLOATS_PER_VERTEX = 8;
+static const int TEX_U = 3, TEX_V = 4;
+
+void printUsage() {
+	printf("Usage: texture-atlas-packer <manifest.txt> <output dir> [options]\n");
+	printf("  manifest lines are '<model.txt> <texture.tga>', # starts a comment\n");
+	printf("  --size N      atlas width and height in texels (default 2048)\n");
+	printf("  --padding N   extra empty texels around each sprite (default 0)\n");
+	printf("  --mips N      mip levels that must not bleed between sprites (default 4)\n");
+}
+
+int parseArgs(int argc, char* argv[], PackOptions& options) {
+	if (argc < 3) {
+		printf("ERROR: missing manifest or output directory parameter\n");
+		return -1;
+	}
+	options.manifestFilename = argv[1];
+	options.outputDir = argv[2];
+
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--size" && i + 1 < argc) options.atlasSize = atoi(argv[++i]);
+		else if (arg == "--padding" && i + 1 < argc) options.padding = atoi(argv[++i]);
+		else if (arg == "--mips" && i + 1 < argc) options.cleanMips = atoi(argv[++i]);
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+
+	if (options.atlasSize < 1 || options.padding < 0 || options.cleanMips < 0 || options.cleanMips > 12
+		|| options.atlasSize % (1 << options.cleanMips) != 0)
+	{
+		printf("ERROR: atlas size must be a multiple of 2^mips, padding and mips can't be negative\n");
+		return -1;
+	}
+	return 0;
+}
+
+std::string getBaseName(const std::string& path) {
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string joinPath(const std::string& dir, const std::string& name) {
+	if (dir.empty() || dir.back() == '/' || dir.back() == '\\') return dir + name;
+	return dir + "/" + name;
+}
+
+int loadManifest(const std::string& filename, std::vector<ModelEntry>& models, std::vector<Sprite>& sprites) {
+	std::ifstream fin(filename);
+	if (!fin.is_open()) {
+		printf("ERROR: could not open manifest '%s'\n", filename.c_str());
+		return -1;
+	}
+
+	std::map<std::string, int> spriteIndices;
+	std::string line;
+	for (int lineNumber = 1; std::getline(fin, line); lineNumber++) {
+		size_t hash = line.find('#');
+		if (hash != std::string::npos) line.erase(hash);
+
+		std::istringstream iss(line);
+		std::string modelName, textureName, extra;
+		if (!(iss >> modelName)) continue;
+		if (!(iss >> textureName) || (iss >> extra)) {
+			printf("ERROR: manifest line %d should be '<model.txt> <texture.tga>'\n", lineNumber);
+			return -1;
+		}
+
+		auto found = spriteIndices.find(textureName);
+		if (found == spriteIndices.end()) {
+			Sprite sprite;
+			sprite.filename = textureName;
+			sprite.width = sprite.height = 0;
+			sprite.atlased = true;
+			sprite.x = sprite.y = 0;
+			found = spriteIndices.insert(std::make_pair(textureName, (int)sprites.size())).first;
+			sprites.push_back(sprite);
+		}
+
+		ModelEntry model;
+		model.inputFilename = modelName;
+		model.sprite = found->second;
+		models.push_back(model);
+	}
+	return 0;
+}
+
+// Reads a converter output file: a vertex count line, then 8 floats per vertex. Models with
+// materials follow those with submesh lines, each drawing its range with its own texture,
+// which one sprite per model can't stand in for, so they're turned away.
+int loadModelRows(ModelEntry& model) {
+	std::ifstream fin(model.inputFilename);
+	int vertexCount = 0;
+	if (!fin.is_open() || !(fin >> vertexCount) || vertexCount < 0) {
+		printf("ERROR: could not read vertex count from '%s'\n", model.inputFilename.c_str());
+		return -1;
+	}
+
+	model.rows.resize((size_t)vertexCount * FLOATS_PER_VERTEX);
+	for (size_t i = 0; i < model.rows.size(); i++) {
+		if (!(fin >> model.rows[i])) {
+			printf("ERROR: '%s' ends early, expected %d vertices\n", model.inputFilename.c_str(), vertexCount);
+			return -1;
+		}
+	}
+
+	std::string rest;
+	if (fin >> rest) {
+		if (rest == "submesh") {
+			printf("ERROR: '%s' has submeshes with their own materials, only single-texture models can be atlased\n",
+				model.inputFilename.c_str());
+		}
+		else {
+			printf("ERROR: '%s' has more than its %d vertices in it\n", model.inputFilename.c_str(), vertexCount);
+		}
+		return -1;
+	}
+	return 0;
+}
+
+int writeModelRows(const ModelEntry& model) {
+	FILE* pFile = fopen(model.outputFilename.c_str(), "w");
+	if (!pFile) {
+		printf("ERROR: could not open '%s' for writing\n", model.outputFilename.c_str());
+		return -1;
+	}
+	int vertexCount = (int)(model.rows.size() / FLOATS_PER_VERTEX);
+	fprintf(pFile, "%d\n", vertexCount);
+	for (int i = 0; i < vertexCount; i++) {
+		const float* v = &model.rows[(size_t)i * FLOATS_PER_VERTEX];
+		fprintf(pFile, "%f %f %f %f %f %f %f %f\n", v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+	}
+	bool ok = ferror(pFile) == 0;
+	fclose(pFile);
+	return ok ? 0 : -1;
+}
+
+// Writes an uncompressed 32-bit targa, top row first, which the engine's TargaDecoder reads
+int writeTarga(const std::string& filename, const unsigned char* pRgba, int width, int height) {
+	unsigned char header[18] = { };
+	header[2] = 2;  // uncompressed true-color
+	header[12] = (unsigned char)(width & 0xFF);
+	header[13] = (unsigned char)(width >> 8);
+	header[14] = (unsigned char)(height & 0xFF);
+	header[15] = (unsigned char)(height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;  // top-left origin, 8 alpha bits
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (!pFile) {
+		printf("ERROR: could not open '%s' for writing\n", filename.c_str());
+		return -1;
+	}
+	fwrite(header, 1, sizeof(header), pFile);
+
+	std::vector<unsigned char> row((size_t)width * 4);
+	for (int y = 0; y < height; y++) {
+		const unsigned char* pSrc = pRgba + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++) {
+			row[x * 4 + 0] = pSrc[x * 4 + 2];
+			row[x * 4 + 1] = pSrc[x * 4 + 1];
+			row[x * 4 + 2] = pSrc[x * 4 + 0];
+			row[x * 4 + 3] = pSrc[x * 4 + 3];
+		}
+		fwrite(row.data(), 1, row.size(), pFile);
+	}
+
+	bool ok = ferror(pFile) == 0;
+	fclose(pFile);
+	return ok ? 0 : -1;
+}
+
+int roundUp(int value, int multiple) {
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+// Decodes the sprite and copies it into its cell. The whole cell (gutter and any round-up
+// slack included) is filled by clamping to the sprite's edge texels, so filtering that
+// reaches past the sprite picks up its own border instead of a neighbour.
+int blitSprite(const Sprite& sprite, unsigned char* pAtlas, int atlasSize) {
+	TargaDecoder decoder;
+	if (!decoder.Open(sprite.filename.c_str())) return -1;
+	std::vector<unsigned char> texels((size_t)sprite.width * sprite.height * 4);
+	if (!decoder.Decode(texels.data(), sprite.width * 4)) {
+		printf("ERROR: could not decode '%s'\n", sprite.filename.c_str());
+		return -1;
+	}
+	decoder.Close();
+
+	const MaxRectsPacker::Rect& cell = sprite.cell.rect;
+	for (int cy = cell.y; cy < cell.y + cell.height; cy++) {
+		int sy = cy - sprite.y;
+		sy = sy < 0 ? 0 : (sy >= sprite.height ? sprite.height - 1 : sy);
+		unsigned char* pDest = pAtlas + ((size_t)cy * atlasSize + cell.x) * 4;
+		const unsigned char* pSrcRow = texels.data() + (size_t)sy * sprite.width * 4;
+		for (int cx = cell.x; cx < cell.x + cell.width; cx++, pDest += 4) {
+			int sx = cx - sprite.x;
+			sx = sx < 0 ? 0 : (sx >= sprite.width ? sprite.width - 1 : sx);
+			memcpy(pDest, pSrcRow + sx * 4, 4);
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	printf("Texture atlas packer started.  argc=%d\n", argc);
+
+	PackOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	std::vector<ModelEntry> models;
+	std::vector<Sprite> sprites;
+	if (loadManifest(options.manifestFilename, models, sprites) < 0) return -10;
+	if (models.empty()) {
+		printf("ERROR: manifest '%s' lists no models\n", options.manifestFilename.c_str());
+		return -10;
+	}
+
+	for (size_t i = 0; i < sprites.size(); i++) {
+		TargaDecoder decoder;
+		if (!decoder.Open(sprites[i].filename.c_str())) {
+			printf("ERROR: could not open '%s' as a targa\n", sprites[i].filename.c_str());
+			return -10;
+		}
+		sprites[i].width = decoder.GetWidth();
+		sprites[i].height = decoder.GetHeight();
+		decoder.Close();
+	}
+
+	// A model that wraps its UVs is relying on the sampler repeating the texture, which an
+	// atlas can't do. Its texture stays a standalone texture.
+	for (size_t i = 0; i < models.size(); i++) {
+		if (loadModelRows(models[i]) < 0) return -10;
+		const std::vector<float>& rows = models[i].rows;
+		for (size_t v = 0; v < rows.size(); v += FLOATS_PER_VERTEX) {
+			float u = rows[v + TEX_U], t = rows[v + TEX_V];
+			if (u < -0.001f || u > 1.001f || t < -0.001f || t > 1.001f) {
+				Sprite& sprite = sprites[models[i].sprite];
+				if (sprite.atlased) {
+					printf("'%s' has UVs outside 0..1, leaving '%s' out of the atlas\n",
+						models[i].inputFilename.c_str(), sprite.filename.c_str());
+				}
+				sprite.atlased = false;
+				break;
+			}
+		}
+	}
+
+	// Each sprite sits in a cell with a gutter of 2^mips texels on every side, and cells are
+	// sized and placed on a 2^mips grid. That way a texel of mip N (N < mips) never averages
+	// texels from two different cells, and bilinear taps at mip N land in the gutter, not in a
+	// neighbour. Packing in grid units gives us the alignment for free.
+	int grid = 1 << options.cleanMips;
+	int gutter = grid;
+	std::vector<MaxRectsPacker::Rect> cells;
+	std::vector<int> cellSprites;
+	for (size_t i = 0; i < sprites.size(); i++) {
+		if (!sprites[i].atlased) continue;
+		MaxRectsPacker::Rect cell;
+		cell.x = cell.y = 0;
+		cell.width = roundUp(sprites[i].width + 2 * (gutter + options.padding), grid) / grid;
+		cell.height = roundUp(sprites[i].height + 2 * (gutter + options.padding), grid) / grid;
+		if (cell.width * grid > options.atlasSize || cell.height * grid > options.atlasSize) {
+			printf("'%s' (%dx%d) won't fit a %d atlas with its gutter, leaving it out\n",
+				sprites[i].filename.c_str(), sprites[i].width, sprites[i].height, options.atlasSize);
+			sprites[i].atlased = false;
+			continue;
+		}
+		cells.push_back(cell);
+		cellSprites.push_back((int)i);
+	}
+
+	MaxRectsPacker packer;
+	std::vector<MaxRectsPacker::Placement> placements;
+	int atlasCount = packer.Pack(cells, options.atlasSize / grid, options.atlasSize / grid, placements);
+	for (size_t c = 0; c < cells.size(); c++) {
+		Sprite& sprite = sprites[cellSprites[c]];
+		MaxRectsPacker::Rect& rect = placements[c].rect;
+		rect.x *= grid;
+		rect.y *= grid;
+		rect.width *= grid;
+		rect.height *= grid;
+		sprite.cell = placements[c];
+		sprite.x = rect.x + gutter + options.padding;
+		sprite.y = rect.y + gutter + options.padding;
+	}
+
+	std::vector<unsigned char> atlas((size_t)options.atlasSize * options.atlasSize * 4);
+	for (int a = 0; a < atlasCount; a++) {
+		memset(atlas.data(), 0, atlas.size());
+		for (size_t i = 0; i < sprites.size(); i++) {
+			if (!sprites[i].atlased || sprites[i].cell.bin != a) continue;
+			if (blitSprite(sprites[i], atlas.data(), options.atlasSize) < 0) return -15;
+		}
+		char name[32];
+		sprintf(name, "atlas%d.tga", a);
+		if (writeTarga(joinPath(options.outputDir, name), atlas.data(), options.atlasSize, options.atlasSize) < 0) {
+			return -20;
+		}
+	}
+
+	// Remap UVs into each model's sprite and note which texture each rewritten model wants
+	std::ofstream listing(joinPath(options.outputDir, "atlas.txt"));
+	if (!listing.is_open()) {
+		printf("ERROR: could not write atlas.txt to '%s'\n", options.outputDir.c_str());
+		return -20;
+	}
+	float scale = 1.0f / options.atlasSize;
+	for (size_t i = 0; i < models.size(); i++) {
+		ModelEntry& model = models[i];
+		const Sprite& sprite = sprites[model.sprite];
+		model.outputFilename = joinPath(options.outputDir, getBaseName(model.inputFilename));
+
+		std::string texture = sprite.filename;
+		if (sprite.atlased) {
+			for (size_t v = 0; v < model.rows.size(); v += FLOATS_PER_VERTEX) {
+				model.rows[v + TEX_U] = (sprite.x + model.rows[v + TEX_U] * sprite.width) * scale;
+				model.rows[v + TEX_V] = (sprite.y + model.rows[v + TEX_V] * sprite.height) * scale;
+			}
+			char name[32];
+			sprintf(name, "atlas%d.tga", sprite.cell.bin);
+			texture = joinPath(options.outputDir, name);
+		}
+		if (writeModelRows(model) < 0) {
+			printf("ERROR: failed writing '%s'\n", model.outputFilename.c_str());
+			return -20;
+		}
+		listing << model.outputFilename << " " << texture << "\n";
+	}
+	listing.close();
+
+	int standalone = 0;
+	for (size_t i = 0; i < sprites.size(); i++) if (!sprites[i].atlased) standalone++;
+	printf("Packed %d of %d textures into %d %dx%d atlases (%.1f%% occupied), %d left standalone\n",
+		(int)cells.size(), (int)sprites.size(), atlasCount, options.atlasSize, options.atlasSize,
+		packer.GetOccupancy() * 100.0, standalone);
+	printf("  %d models now bind %d textures instead of %d\n", (int)models.size(),
+		atlasCount + standalone, (int)sprites.size());
+	printf("Output written to: %s\n", options.outputDir.c_str());
+	return 0;
+}
\ No newline at end of file
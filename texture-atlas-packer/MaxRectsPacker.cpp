@@ -0,0 +1,167 @@
+#include "MaxRectsPacker.h"
+
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+
+MaxRectsPacker::MaxRectsPacker() {
+	this->binWidth = 0;
+	this->binHeight = 0;
+}
+
+static bool Contains(const MaxRectsPacker::Rect& outer, const MaxRectsPacker::Rect& inner) {
+	return inner.x >= outer.x && inner.y >= outer.y
+		&& inner.x + inner.width <= outer.x + outer.width
+		&& inner.y + inner.height <= outer.y + outer.height;
+}
+
+int MaxRectsPacker::Pack(const std::vector<Rect>& sizes, int binWidth, int binHeight,
+	std::vector<Placement>& placements)
+{
+	this->bins.clear();
+	this->binWidth = binWidth;
+	this->binHeight = binHeight;
+	placements.assign(sizes.size(), Placement());
+
+	// Biggest first, by longer side and then area
+	std::vector<int> order(sizes.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+	std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b) {
+		int maxA = std::max(sizes[a].width, sizes[a].height), maxB = std::max(sizes[b].width, sizes[b].height);
+		if (maxA != maxB) return maxA > maxB;
+		return sizes[a].width * sizes[a].height > sizes[b].width * sizes[b].height;
+	});
+
+	for (size_t n = 0; n < order.size(); n++) {
+		int i = order[n];
+		int width = sizes[i].width, height = sizes[i].height;
+		Placement& placement = placements[i];
+		placement.bin = -1;
+		placement.rect = { 0, 0, width, height };
+
+		if (width <= 0 || height <= 0 || width > binWidth || height > binHeight) {
+			printf("ERROR: %dx%d rect can't go in a %dx%d bin\n", width, height, binWidth, binHeight);
+			continue;
+		}
+
+		// Try every open bin and keep the best fit overall, so a later bin can still take a
+		// rect that fits it better than the first bin with room
+		int bestBin = -1, bestShort = INT_MAX, bestLong = INT_MAX;
+		Rect bestRect = { 0, 0, 0, 0 };
+		for (size_t b = 0; b < this->bins.size(); b++) {
+			Rect rect;
+			int shortFit, longFit;
+			if (!FindPosition(this->bins[b], width, height, rect, shortFit, longFit)) continue;
+			if (shortFit < bestShort || (shortFit == bestShort && longFit < bestLong)) {
+				bestBin = (int)b;
+				bestShort = shortFit;
+				bestLong = longFit;
+				bestRect = rect;
+			}
+		}
+
+		if (bestBin < 0) {
+			Bin bin;
+			bin.freeRects.push_back({ 0, 0, binWidth, binHeight });
+			bin.usedArea = 0;
+			this->bins.push_back(bin);
+			bestBin = (int)this->bins.size() - 1;
+			bestRect = { 0, 0, width, height };
+		}
+
+		PlaceRect(this->bins[bestBin], bestRect);
+		placement.bin = bestBin;
+		placement.rect = bestRect;
+	}
+
+	return (int)this->bins.size();
+}
+
+double MaxRectsPacker::GetOccupancy() {
+	if (this->bins.empty()) return 0.0;
+	long long used = 0;
+	for (size_t b = 0; b < this->bins.size(); b++) used += this->bins[b].usedArea;
+	return (double)used / ((double)this->binWidth * this->binHeight * this->bins.size());
+}
+
+// Best short side fit: the free rect where the smaller of the two leftover sides is smallest.
+// Rects are never rotated since that would turn the texture sideways.
+bool MaxRectsPacker::FindPosition(const Bin& bin, int width, int height, Rect& best,
+	int& bestShort, int& bestLong)
+{
+	bestShort = INT_MAX;
+	bestLong = INT_MAX;
+	for (size_t i = 0; i < bin.freeRects.size(); i++) {
+		const Rect& free = bin.freeRects[i];
+		if (free.width < width || free.height < height) continue;
+
+		int leftoverX = free.width - width, leftoverY = free.height - height;
+		int shortFit = std::min(leftoverX, leftoverY), longFit = std::max(leftoverX, leftoverY);
+		if (shortFit < bestShort || (shortFit == bestShort && longFit < bestLong)) {
+			best = { free.x, free.y, width, height };
+			bestShort = shortFit;
+			bestLong = longFit;
+		}
+	}
+	return bestShort != INT_MAX;
+}
+
+void MaxRectsPacker::PlaceRect(Bin& bin, const Rect& placed) {
+	std::vector<Rect> newRects;
+	for (size_t i = 0; i < bin.freeRects.size();) {
+		if (SplitFreeRect(bin.freeRects[i], placed, newRects)) {
+			bin.freeRects[i] = bin.freeRects.back();
+			bin.freeRects.pop_back();
+		}
+		else {
+			i++;
+		}
+	}
+	bin.freeRects.insert(bin.freeRects.end(), newRects.begin(), newRects.end());
+	PruneFreeRects(bin);
+	bin.usedArea += (long long)placed.width * placed.height;
+}
+
+// If placed overlaps free, pushes up to four maximal rects covering what's left of free and
+// returns true so the caller drops the original
+bool MaxRectsPacker::SplitFreeRect(const Rect& free, const Rect& placed, std::vector<Rect>& out) {
+	if (placed.x >= free.x + free.width || placed.x + placed.width <= free.x
+		|| placed.y >= free.y + free.height || placed.y + placed.height <= free.y)
+	{
+		return false;
+	}
+
+	if (placed.x > free.x) {
+		out.push_back({ free.x, free.y, placed.x - free.x, free.height });
+	}
+	if (placed.x + placed.width < free.x + free.width) {
+		int x = placed.x + placed.width;
+		out.push_back({ x, free.y, free.x + free.width - x, free.height });
+	}
+	if (placed.y > free.y) {
+		out.push_back({ free.x, free.y, free.width, placed.y - free.y });
+	}
+	if (placed.y + placed.height < free.y + free.height) {
+		int y = placed.y + placed.height;
+		out.push_back({ free.x, y, free.width, free.y + free.height - y });
+	}
+	return true;
+}
+
+void MaxRectsPacker::PruneFreeRects(Bin& bin) {
+	std::vector<Rect>& rects = bin.freeRects;
+	for (size_t i = 0; i < rects.size();) {
+		bool removed = false;
+		for (size_t j = i + 1; j < rects.size();) {
+			if (Contains(rects[j], rects[i])) {
+				rects.erase(rects.begin() + i);
+				removed = true;
+				break;
+			}
+			if (Contains(rects[i], rects[j])) rects.erase(rects.begin() + j);
+			else j++;
+		}
+		if (!removed) i++;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+/* MaxRects bin packer (Jukka Jylanki's "A Thousand Ways to Pack the Bin"). Every bin keeps a
+ * list of maximal free rectangles that may overlap each other. A new rect goes into the free
+ * rect that leaves the shortest leftover side (best short side fit), then every free rect it
+ * touches is split and the ones contained in another are pruned. When nothing fits, a new bin
+ * is opened, so Pack never fails for rects that fit in an empty bin. */
+class MaxRectsPacker {
+public:
+	struct Rect {
+		int x, y, width, height;
+	};
+
+	// Where an input rect ended up. bin is -1 if it was bigger than an empty bin.
+	struct Placement {
+		int bin;
+		Rect rect;
+	};
+
+	MaxRectsPacker();
+
+	// Packs all the sizes at once (largest first, which packs a lot tighter than arrival
+	// order) into as many binWidth x binHeight bins as it takes. placements lines up with
+	// sizes. Returns the number of bins used.
+	int Pack(const std::vector<Rect>&, int, int, std::vector<Placement>&);
+
+	// Fraction of the used bins' area covered by placed rects
+	double GetOccupancy();
+
+private:
+	struct Bin {
+		std::vector<Rect> freeRects;
+		long long usedArea;
+	};
+
+	bool FindPosition(const Bin&, int, int, Rect&, int&, int&);
+	void PlaceRect(Bin&, const Rect&);
+	bool SplitFreeRect(const Rect&, const Rect&, std::vector<Rect>&);
+	void PruneFreeRects(Bin&);
+
+	std::vector<Bin> bins;
+	int binWidth, binHeight;
+};
\ No newline at end of file
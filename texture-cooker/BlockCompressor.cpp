@@ -0,0 +1,661 @@
+#include "BlockCompressor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <emmintrin.h>
+
+#include "ParallelRows.h"
+
+// BC7 index interpolation weights for 4-bit indices, out of 64
+static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Number of +/-1 endpoint nudging rounds the high quality BC1 path is allowed
+static const int BC1_SEARCH_ROUNDS = 4;
+
+static inline float HorizontalSum(__m128 v) {
+	__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	sums = _mm_add_ss(sums, shuffled);
+	return _mm_cvtss_f32(sums);
+}
+
+static inline float Clamp(float v, float lo, float hi) {
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Picks the nearest palette entry for each texel. The mask zeroes the channels that don't
+// count (alpha for BC1). Returns the summed squared error of the block.
+static float FitIndices(const __m128* pTexels, const __m128* pPalette, int paletteSize,
+	__m128 mask, unsigned char* pIndices)
+{
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float best = FLT_MAX;
+		int bestIndex = 0;
+		for (int k = 0; k < paletteSize; k++) {
+			__m128 diff = _mm_and_ps(_mm_sub_ps(pTexels[i], pPalette[k]), mask);
+			float error = HorizontalSum(_mm_mul_ps(diff, diff));
+			if (error < best) {
+				best = error;
+				bestIndex = k;
+			}
+		}
+		pIndices[i] = (unsigned char)bestIndex;
+		total += best;
+	}
+	return total;
+}
+
+// Solves for the two endpoints that best reproduce the block given fixed indices, where
+// pWeights[index] is how much of endpoint 1 that index blends in. Returns false when every
+// texel landed on the same weight and the system is singular.
+static bool LeastSquaresEndpoints(const __m128* pTexels, const unsigned char* pIndices,
+	const float* pWeights, __m128& e0, __m128& e1)
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	__m128 ap = _mm_setzero_ps(), bp = _mm_setzero_ps();
+	for (int i = 0; i < 16; i++) {
+		float b = pWeights[pIndices[i]];
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		ap = _mm_add_ps(ap, _mm_mul_ps(_mm_set1_ps(a), pTexels[i]));
+		bp = _mm_add_ps(bp, _mm_mul_ps(_mm_set1_ps(b), pTexels[i]));
+	}
+
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f) return false;
+
+	__m128 invDet = _mm_set1_ps(1.0f / det);
+	e0 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(bb), ap), _mm_mul_ps(_mm_set1_ps(ab), bp)), invDet);
+	e1 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(aa), bp), _mm_mul_ps(_mm_set1_ps(ab), ap)), invDet);
+	return true;
+}
+
+// Fits a line through the block's texels (in the masked channels) and returns the two
+// extreme points along it. Fast mode uses the bounding box, flipping the minor channels that
+// run against the widest one so the diagonal follows the data.
+static void FindEndpoints(const __m128* pTexels, __m128 mask, bool principalAxis, __m128& e0, __m128& e1) {
+	__m128 mean = _mm_setzero_ps();
+	__m128 lo = _mm_set1_ps(FLT_MAX), hi = _mm_set1_ps(-FLT_MAX);
+	for (int i = 0; i < 16; i++) {
+		mean = _mm_add_ps(mean, pTexels[i]);
+		lo = _mm_min_ps(lo, pTexels[i]);
+		hi = _mm_max_ps(hi, pTexels[i]);
+	}
+	mean = _mm_mul_ps(mean, _mm_set1_ps(1.0f / 16.0f));
+
+	float m[4], l[4], h[4];
+	_mm_storeu_ps(m, mean);
+	_mm_storeu_ps(l, lo);
+	_mm_storeu_ps(h, hi);
+
+	float useChannel[4];
+	_mm_storeu_ps(useChannel, _mm_and_ps(_mm_set1_ps(1.0f), mask));
+
+	// Covariance of the (masked) channels around the mean
+	float cov[4][4] = { };
+	for (int i = 0; i < 16; i++) {
+		float t[4];
+		_mm_storeu_ps(t, _mm_sub_ps(pTexels[i], mean));
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) cov[r][c] += t[r] * t[c] * useChannel[r] * useChannel[c];
+		}
+	}
+
+	if (!principalAxis) {
+		int widest = 0;
+		for (int c = 1; c < 4; c++) {
+			if ((h[c] - l[c]) * useChannel[c] > (h[widest] - l[widest]) * useChannel[widest]) widest = c;
+		}
+		float a[4], b[4];
+		for (int c = 0; c < 4; c++) {
+			// Inset by 1/16 of the range, the extremes are rarely hit exactly after quantizing
+			float inset = (h[c] - l[c]) / 16.0f;
+			bool flip = c != widest && cov[widest][c] < 0.0f;
+			a[c] = flip ? l[c] + inset : h[c] - inset;
+			b[c] = flip ? h[c] - inset : l[c] + inset;
+		}
+		e0 = _mm_loadu_ps(a);
+		e1 = _mm_loadu_ps(b);
+		return;
+	}
+
+	// Power iteration for the dominant eigenvector, seeded with the bounding box diagonal
+	float axis[4];
+	for (int c = 0; c < 4; c++) axis[c] = (h[c] - l[c]) * useChannel[c];
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = { };
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) next[r] += cov[r][c] * axis[c];
+		}
+		float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+		if (length < 1e-6f) break;
+		for (int c = 0; c < 4; c++) axis[c] = next[c] / length;
+	}
+
+	__m128 axisV = _mm_loadu_ps(axis);
+	float minProj = FLT_MAX, maxProj = -FLT_MAX;
+	for (int i = 0; i < 16; i++) {
+		float proj = HorizontalSum(_mm_mul_ps(_mm_sub_ps(pTexels[i], mean), axisV));
+		if (proj < minProj) minProj = proj;
+		if (proj > maxProj) maxProj = proj;
+	}
+
+	// A flat block has no axis to speak of, fall back to the mean for both ends
+	if (maxProj - minProj < 1e-4f) {
+		e0 = e1 = mean;
+		return;
+	}
+	e0 = _mm_add_ps(mean, _mm_mul_ps(axisV, _mm_set1_ps(maxProj)));
+	e1 = _mm_add_ps(mean, _mm_mul_ps(axisV, _mm_set1_ps(minProj)));
+}
+
+
+//// BC1 color block
+
+struct Color565 {
+	int r, g, b;
+
+	static Color565 FromFloat(__m128 v) {
+		float c[4];
+		_mm_storeu_ps(c, v);
+		Color565 out;
+		out.r = (int)(Clamp(c[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+		out.g = (int)(Clamp(c[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+		out.b = (int)(Clamp(c[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+		return out;
+	}
+
+	unsigned short Pack() const {
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	// Expands the way the hardware does: replicate the top bits into the bottom
+	__m128 ToFloat() const {
+		return _mm_setr_ps((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)),
+			(float)((b << 3) | (b >> 2)), 0.0f);
+	}
+};
+
+static const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+static float EvaluateBC1(const __m128* pTexels, const Color565& c0, const Color565& c1, unsigned char* pIndices) {
+	__m128 palette[4];
+	palette[0] = c0.ToFloat();
+	palette[1] = c1.ToFloat();
+	palette[2] = _mm_mul_ps(_mm_add_ps(_mm_add_ps(palette[0], palette[0]), palette[1]), _mm_set1_ps(1.0f / 3.0f));
+	palette[3] = _mm_mul_ps(_mm_add_ps(_mm_add_ps(palette[1], palette[1]), palette[0]), _mm_set1_ps(1.0f / 3.0f));
+	__m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	return FitIndices(pTexels, palette, 4, mask, pIndices);
+}
+
+static void EncodeColorBlock(const __m128* pTexels, bool highQuality, unsigned char* pOut) {
+	__m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	__m128 e0, e1;
+	FindEndpoints(pTexels, mask, highQuality, e0, e1);
+
+	Color565 best0 = Color565::FromFloat(e0), best1 = Color565::FromFloat(e1);
+	unsigned char bestIndices[16], indices[16];
+	float bestError = EvaluateBC1(pTexels, best0, best1, bestIndices);
+
+	if (highQuality) {
+		// Refit the endpoints to the indices we got, then nudge each 565 component by one
+		// step at a time for as long as that keeps lowering the error.
+		if (LeastSquaresEndpoints(pTexels, bestIndices, BC1_WEIGHTS, e0, e1)) {
+			Color565 c0 = Color565::FromFloat(e0), c1 = Color565::FromFloat(e1);
+			float error = EvaluateBC1(pTexels, c0, c1, indices);
+			if (error < bestError) {
+				bestError = error;
+				best0 = c0;
+				best1 = c1;
+				memcpy(bestIndices, indices, 16);
+			}
+		}
+
+		static const int limits[3] = { 31, 63, 31 };
+		for (int round = 0; round < BC1_SEARCH_ROUNDS; round++) {
+			bool improved = false;
+			for (int component = 0; component < 6; component++) {
+				for (int step = -1; step <= 1; step += 2) {
+					Color565 c0 = best0, c1 = best1;
+					Color565& target = component < 3 ? c0 : c1;
+					int* pValue = component % 3 == 0 ? &target.r : (component % 3 == 1 ? &target.g : &target.b);
+					*pValue += step;
+					if (*pValue < 0 || *pValue > limits[component % 3]) continue;
+
+					float error = EvaluateBC1(pTexels, c0, c1, indices);
+					if (error < bestError) {
+						bestError = error;
+						best0 = c0;
+						best1 = c1;
+						memcpy(bestIndices, indices, 16);
+						improved = true;
+					}
+				}
+			}
+			if (!improved) break;
+		}
+	}
+
+	// Four-color mode needs color0 > color1, swapping them swaps the index meanings too
+	unsigned short packed0 = best0.Pack(), packed1 = best1.Pack();
+	if (packed0 < packed1) {
+		unsigned short tmp = packed0;
+		packed0 = packed1;
+		packed1 = tmp;
+		static const unsigned char swapped[4] = { 1, 0, 3, 2 };
+		for (int i = 0; i < 16; i++) bestIndices[i] = swapped[bestIndices[i]];
+	}
+	else if (packed0 == packed1) {
+		// Equal endpoints would select three-color mode where index 3 is black
+		memset(bestIndices, 0, 16);
+	}
+
+	unsigned int indexBits = 0;
+	for (int i = 0; i < 16; i++) indexBits |= (unsigned int)bestIndices[i] << (i * 2);
+
+	pOut[0] = (unsigned char)(packed0 & 0xFF);
+	pOut[1] = (unsigned char)(packed0 >> 8);
+	pOut[2] = (unsigned char)(packed1 & 0xFF);
+	pOut[3] = (unsigned char)(packed1 >> 8);
+	memcpy(pOut + 4, &indexBits, 4);
+}
+
+static void DecodeColorBlock(const unsigned char* pIn, bool forceFourColor, unsigned char* pRgba) {
+	unsigned short packed0 = (unsigned short)(pIn[0] | (pIn[1] << 8));
+	unsigned short packed1 = (unsigned short)(pIn[2] | (pIn[3] << 8));
+	unsigned int indexBits;
+	memcpy(&indexBits, pIn + 4, 4);
+
+	int palette[4][4];
+	int ends[2][3];
+	unsigned short packed[2] = { packed0, packed1 };
+	for (int e = 0; e < 2; e++) {
+		int r = (packed[e] >> 11) & 31, g = (packed[e] >> 5) & 63, b = packed[e] & 31;
+		ends[e][0] = (r << 3) | (r >> 2);
+		ends[e][1] = (g << 2) | (g >> 4);
+		ends[e][2] = (b << 3) | (b >> 2);
+	}
+	for (int c = 0; c < 3; c++) {
+		palette[0][c] = ends[0][c];
+		palette[1][c] = ends[1][c];
+		if (forceFourColor || packed0 > packed1) {
+			palette[2][c] = (2 * ends[0][c] + ends[1][c]) / 3;
+			palette[3][c] = (ends[0][c] + 2 * ends[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (ends[0][c] + ends[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = (forceFourColor || packed0 > packed1) ? 255 : 0;
+
+	for (int i = 0; i < 16; i++) {
+		int index = (indexBits >> (i * 2)) & 3;
+		for (int c = 0; c < 4; c++) pRgba[i * 4 + c] = (unsigned char)palette[index][c];
+	}
+}
+
+
+//// BC3 alpha block (same layout as BC4)
+
+static void BuildAlphaPalette(int a0, int a1, int* pPalette) {
+	pPalette[0] = a0;
+	pPalette[1] = a1;
+	if (a0 > a1) {
+		for (int k = 1; k <= 6; k++) pPalette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+	}
+	else {
+		for (int k = 1; k <= 4; k++) pPalette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+		pPalette[6] = 0;
+		pPalette[7] = 255;
+	}
+}
+
+static float FitAlpha(const float* pAlpha, int a0, int a1, unsigned char* pIndices) {
+	int palette[8];
+	BuildAlphaPalette(a0, a1, palette);
+	float total = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float best = FLT_MAX;
+		for (int k = 0; k < 8; k++) {
+			float diff = pAlpha[i] - (float)palette[k];
+			if (diff * diff < best) {
+				best = diff * diff;
+				pIndices[i] = (unsigned char)k;
+			}
+		}
+		total += best;
+	}
+	return total;
+}
+
+static void EncodeAlphaBlock(const __m128* pTexels, bool highQuality, unsigned char* pOut) {
+	float alpha[16];
+	float lo = 255.0f, hi = 0.0f;
+	float innerLo = 255.0f, innerHi = 0.0f; // ignoring exact 0 and 255
+	for (int i = 0; i < 16; i++) {
+		float t[4];
+		_mm_storeu_ps(t, pTexels[i]);
+		alpha[i] = t[3];
+		lo = fminf(lo, alpha[i]);
+		hi = fmaxf(hi, alpha[i]);
+		if (alpha[i] > 0.0f && alpha[i] < 255.0f) {
+			innerLo = fminf(innerLo, alpha[i]);
+			innerHi = fmaxf(innerHi, alpha[i]);
+		}
+	}
+
+	// Eight-value mode (a0 > a1) spans the whole range
+	int a0 = (int)(hi + 0.5f), a1 = (int)(lo + 0.5f);
+	unsigned char indices[16], bestIndices[16];
+	float bestError = FitAlpha(alpha, a0, a1, bestIndices);
+
+	// Six-value mode (a0 <= a1) gets exact 0 and 255 for free, which wins on cut-out alpha
+	if (highQuality && innerLo <= innerHi) {
+		int b0 = (int)(innerLo + 0.5f), b1 = (int)(innerHi + 0.5f);
+		float error = FitAlpha(alpha, b0, b1, indices);
+		if (error < bestError) {
+			bestError = error;
+			a0 = b0;
+			a1 = b1;
+			memcpy(bestIndices, indices, 16);
+		}
+	}
+
+	pOut[0] = (unsigned char)a0;
+	pOut[1] = (unsigned char)a1;
+	unsigned long long bits = 0;
+	for (int i = 0; i < 16; i++) bits |= (unsigned long long)bestIndices[i] << (i * 3);
+	for (int i = 0; i < 6; i++) pOut[2 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+static void DecodeAlphaBlock(const unsigned char* pIn, unsigned char* pRgba) {
+	int palette[8];
+	BuildAlphaPalette(pIn[0], pIn[1], palette);
+	unsigned long long bits = 0;
+	for (int i = 0; i < 6; i++) bits |= (unsigned long long)pIn[2 + i] << (i * 8);
+	for (int i = 0; i < 16; i++) pRgba[i * 4 + 3] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+}
+
+
+//// BC7 mode 6: one subset, RGBA 7-bit endpoints plus a p-bit each, 4-bit indices
+
+struct Bc7Endpoint {
+	int q[4]; // 7-bit channel values
+	int pBit;
+
+	static Bc7Endpoint FromFloat(__m128 v, int pBit) {
+		float c[4];
+		_mm_storeu_ps(c, v);
+		Bc7Endpoint out;
+		out.pBit = pBit;
+		for (int i = 0; i < 4; i++) {
+			int q = (int)floorf((Clamp(c[i], 0.0f, 255.0f) - pBit) / 2.0f + 0.5f);
+			out.q[i] = q < 0 ? 0 : (q > 127 ? 127 : q);
+		}
+		return out;
+	}
+
+	int Channel(int i) const {
+		return (q[i] << 1) | pBit;
+	}
+};
+
+static float EvaluateBC7(const __m128* pTexels, const Bc7Endpoint& e0, const Bc7Endpoint& e1, unsigned char* pIndices) {
+	__m128 palette[16];
+	for (int k = 0; k < 16; k++) {
+		int w = BC7_WEIGHTS4[k];
+		float c[4];
+		for (int i = 0; i < 4; i++) c[i] = (float)(((64 - w) * e0.Channel(i) + w * e1.Channel(i) + 32) >> 6);
+		palette[k] = _mm_loadu_ps(c);
+	}
+	__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	return FitIndices(pTexels, palette, 16, mask, pIndices);
+}
+
+// Tries every p-bit combination for a pair of float endpoints and keeps the best
+static float QuantizeBC7(const __m128* pTexels, __m128 e0, __m128 e1, bool allPBits,
+	Bc7Endpoint& out0, Bc7Endpoint& out1, unsigned char* pIndices)
+{
+	float bestError = FLT_MAX;
+	unsigned char indices[16];
+	for (int p0 = 0; p0 < 2; p0++) {
+		for (int p1 = 0; p1 < 2; p1++) {
+			// Fast mode only tries the matching pair, which is right most of the time
+			if (!allPBits && p0 != p1) continue;
+			Bc7Endpoint q0 = Bc7Endpoint::FromFloat(e0, p0), q1 = Bc7Endpoint::FromFloat(e1, p1);
+			float error = EvaluateBC7(pTexels, q0, q1, indices);
+			if (error < bestError) {
+				bestError = error;
+				out0 = q0;
+				out1 = q1;
+				memcpy(pIndices, indices, 16);
+			}
+		}
+	}
+	return bestError;
+}
+
+static void WriteBits(unsigned char* pOut, int& bitPos, unsigned int value, int count) {
+	for (int i = 0; i < count; i++, bitPos++) {
+		if (value & (1u << i)) pOut[bitPos >> 3] |= (unsigned char)(1 << (bitPos & 7));
+	}
+}
+
+static unsigned int ReadBits(const unsigned char* pIn, int& bitPos, int count) {
+	unsigned int value = 0;
+	for (int i = 0; i < count; i++, bitPos++) {
+		if (pIn[bitPos >> 3] & (1 << (bitPos & 7))) value |= 1u << i;
+	}
+	return value;
+}
+
+static void EncodeBC7Block(const __m128* pTexels, bool highQuality, unsigned char* pOut) {
+	__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	__m128 e0, e1;
+	FindEndpoints(pTexels, mask, highQuality, e0, e1);
+
+	Bc7Endpoint best0, best1;
+	unsigned char bestIndices[16];
+	float bestError = QuantizeBC7(pTexels, e0, e1, highQuality, best0, best1, bestIndices);
+
+	if (highQuality) {
+		float weights[16];
+		for (int k = 0; k < 16; k++) weights[k] = BC7_WEIGHTS4[k] / 64.0f;
+
+		for (int iteration = 0; iteration < 2; iteration++) {
+			if (!LeastSquaresEndpoints(pTexels, bestIndices, weights, e0, e1)) break;
+
+			Bc7Endpoint q0, q1;
+			unsigned char indices[16];
+			float error = QuantizeBC7(pTexels, e0, e1, true, q0, q1, indices);
+			if (error >= bestError) break;
+			bestError = error;
+			best0 = q0;
+			best1 = q1;
+			memcpy(bestIndices, indices, 16);
+		}
+	}
+
+	// The first index is stored with its top bit implied zero, so flip the block if needed
+	if (bestIndices[0] & 8) {
+		Bc7Endpoint tmp = best0;
+		best0 = best1;
+		best1 = tmp;
+		for (int i = 0; i < 16; i++) bestIndices[i] = (unsigned char)(15 - bestIndices[i]);
+	}
+
+	memset(pOut, 0, 16);
+	int bitPos = 0;
+	WriteBits(pOut, bitPos, 1 << 6, 7); // mode 6
+	for (int c = 0; c < 4; c++) {
+		WriteBits(pOut, bitPos, best0.q[c], 7);
+		WriteBits(pOut, bitPos, best1.q[c], 7);
+	}
+	WriteBits(pOut, bitPos, best0.pBit, 1);
+	WriteBits(pOut, bitPos, best1.pBit, 1);
+	WriteBits(pOut, bitPos, bestIndices[0], 3);
+	for (int i = 1; i < 16; i++) WriteBits(pOut, bitPos, bestIndices[i], 4);
+}
+
+static void DecodeBC7Block(const unsigned char* pIn, unsigned char* pRgba) {
+	int bitPos = 0;
+	if (ReadBits(pIn, bitPos, 7) != (1 << 6)) {
+		// We only ever write mode 6; anything else decodes to black so it shows up in PSNR
+		memset(pRgba, 0, 64);
+		return;
+	}
+
+	int ends[2][4];
+	for (int c = 0; c < 4; c++) {
+		ends[0][c] = ReadBits(pIn, bitPos, 7) << 1;
+		ends[1][c] = ReadBits(pIn, bitPos, 7) << 1;
+	}
+	int p0 = ReadBits(pIn, bitPos, 1), p1 = ReadBits(pIn, bitPos, 1);
+	for (int c = 0; c < 4; c++) {
+		ends[0][c] |= p0;
+		ends[1][c] |= p1;
+	}
+
+	for (int i = 0; i < 16; i++) {
+		int w = BC7_WEIGHTS4[ReadBits(pIn, bitPos, i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; c++) {
+			pRgba[i * 4 + c] = (unsigned char)(((64 - w) * ends[0][c] + w * ends[1][c] + 32) >> 6);
+		}
+	}
+}
+
+
+//// BlockCompressor
+
+BlockCompressor::BlockCompressor() {
+}
+
+int BlockCompressor::GetBlockBytes(Format format) {
+	return format == FORMAT_BC1 ? 8 : 16;
+}
+
+const char* BlockCompressor::GetFormatName(Format format) {
+	switch (format) {
+	case FORMAT_BC1: return "BC1";
+	case FORMAT_BC3: return "BC3";
+	default: return "BC7";
+	}
+}
+
+// Copies out the 4x4 block at (blockX, blockY), repeating edge texels past the image bounds
+static void GatherBlock(const unsigned char* pRgba, int width, int height, int blockX, int blockY, unsigned char* pBlock) {
+	for (int y = 0; y < 4; y++) {
+		int srcY = blockY * 4 + y;
+		if (srcY >= height) srcY = height - 1;
+		for (int x = 0; x < 4; x++) {
+			int srcX = blockX * 4 + x;
+			if (srcX >= width) srcX = width - 1;
+			memcpy(pBlock + (y * 4 + x) * 4, pRgba + ((size_t)srcY * width + srcX) * 4, 4);
+		}
+	}
+}
+
+bool BlockCompressor::Compress(const unsigned char* pRgba, int width, int height,
+	Format format, Quality quality, int threadCount, std::vector<unsigned char>& blocks)
+{
+	if (!pRgba || width <= 0 || height <= 0) {
+		printf("ERROR: BlockCompressor::Compress given an empty image (%dx%d)\n", width, height);
+		return false;
+	}
+
+	int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+	int blockBytes = GetBlockBytes(format);
+	blocks.resize((size_t)blocksWide * blocksHigh * blockBytes);
+
+	ParallelRows(blocksHigh, threadCount, [&](int begin, int end) {
+		unsigned char texels[64];
+		for (int by = begin; by < end; by++) {
+			for (int bx = 0; bx < blocksWide; bx++) {
+				GatherBlock(pRgba, width, height, bx, by, texels);
+				EncodeBlock(texels, format, quality,
+					blocks.data() + ((size_t)by * blocksWide + bx) * blockBytes);
+			}
+		}
+	});
+
+	return true;
+}
+
+void BlockCompressor::EncodeBlock(const unsigned char* pTexels, Format format, Quality quality, unsigned char* pOut) {
+	__m128 texels[16];
+	for (int i = 0; i < 16; i++) {
+		texels[i] = _mm_setr_ps(pTexels[i * 4 + 0], pTexels[i * 4 + 1], pTexels[i * 4 + 2], pTexels[i * 4 + 3]);
+	}
+
+	bool highQuality = quality == QUALITY_HIGH;
+	switch (format) {
+	case FORMAT_BC1:
+		EncodeColorBlock(texels, highQuality, pOut);
+		break;
+	case FORMAT_BC3:
+		EncodeAlphaBlock(texels, highQuality, pOut);
+		EncodeColorBlock(texels, highQuality, pOut + 8);
+		break;
+	case FORMAT_BC7:
+		EncodeBC7Block(texels, highQuality, pOut);
+		break;
+	}
+}
+
+void BlockCompressor::DecodeBlock(const unsigned char* pIn, Format format, unsigned char* pRgba) {
+	switch (format) {
+	case FORMAT_BC1:
+		DecodeColorBlock(pIn, false, pRgba);
+		break;
+	case FORMAT_BC3:
+		// BC3's color half always decodes as four colors, whatever the endpoint order
+		DecodeColorBlock(pIn + 8, true, pRgba);
+		DecodeAlphaBlock(pIn, pRgba);
+		break;
+	case FORMAT_BC7:
+		DecodeBC7Block(pIn, pRgba);
+		break;
+	}
+}
+
+double BlockCompressor::ComputePsnr(const unsigned char* pRgba, int width, int height, Format format,
+	const std::vector<unsigned char>& blocks, double* pSquaredError, double* pSampleCount)
+{
+	int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+	int blockBytes = GetBlockBytes(format);
+	int channels = format == FORMAT_BC1 ? 3 : 4;
+
+	double squaredError = 0.0;
+	unsigned char decoded[64];
+	for (int by = 0; by < blocksHigh; by++) {
+		for (int bx = 0; bx < blocksWide; bx++) {
+			DecodeBlock(blocks.data() + ((size_t)by * blocksWide + bx) * blockBytes, format, decoded);
+			for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+				for (int x = 0; x < 4 && bx * 4 + x < width; x++) {
+					const unsigned char* pSrc = pRgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4;
+					const unsigned char* pDec = decoded + (y * 4 + x) * 4;
+					for (int c = 0; c < channels; c++) {
+						double diff = (double)pSrc[c] - (double)pDec[c];
+						squaredError += diff * diff;
+					}
+				}
+			}
+		}
+	}
+
+	double samples = (double)width * height * channels;
+	if (pSquaredError) *pSquaredError = squaredError;
+	if (pSampleCount) *pSampleCount = samples;
+
+	double mse = squaredError / samples;
+	if (mse <= 0.0) return INFINITY;
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
\ No newline at end of file
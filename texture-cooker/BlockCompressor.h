@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+/* CPU encoder for the BC block-compressed texture formats. Each 4x4 texel block is encoded on
+ * its own, so the image is split into bands of block rows that are encoded on separate
+ * threads. Endpoint fitting and the per-texel palette search use SSE.
+ *   BC1 - opaque RGB, 8 bytes per block (alpha is dropped)
+ *   BC3 - RGB like BC1 plus an interpolated alpha block, 16 bytes per block
+ *   BC7 - RGBA with 7-bit endpoints and 4-bit indices (mode 6 only), 16 bytes per block */
+class BlockCompressor {
+public:
+	enum Format {
+		FORMAT_BC1,
+		FORMAT_BC3,
+		FORMAT_BC7,
+	};
+
+	enum Quality {
+		QUALITY_FAST, // bounding-box endpoints, one palette pass
+		QUALITY_HIGH, // principal-axis endpoints, least-squares refit and a local search
+	};
+
+	BlockCompressor();
+
+	// pRgba is width * height tightly packed RGBA8 texels. Partial blocks at the right and
+	// bottom edges are padded by repeating the edge texels. Blocks are written row by row.
+	bool Compress(const unsigned char*, int, int, Format, Quality, int, std::vector<unsigned char>&);
+
+	// Decodes the blocks again and compares against the source: RGB for BC1, RGBA otherwise.
+	// Returns the PSNR in dB, and fills in the squared error sum and channel count if asked.
+	double ComputePsnr(const unsigned char*, int, int, Format, const std::vector<unsigned char>&,
+		double* = nullptr, double* = nullptr);
+
+	static int GetBlockBytes(Format);
+	static const char* GetFormatName(Format);
+
+private:
+	void EncodeBlock(const unsigned char*, Format, Quality, unsigned char*);
+	void DecodeBlock(const unsigned char*, Format, unsigned char*);
+};
\ No newline at end of file
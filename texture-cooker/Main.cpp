@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include "../directx-sandbox/TargaDecoder.h"
+#include "../directx-sandbox/CookedTexture.h"
+#include "MipChain.h"
+#include "BlockCompressor.h"
+
+struct CookOptions {
+	std::string inputFilename;
+	std::string outputFilename;
+	MipChain::Filter filter;
+	bool srgb;
+	bool compress;
+	BlockCompressor::Format format;
+	BlockCompressor::Quality quality;
+	int threadCount;
+
+	CookOptions() {
+		filter = MipChain::FILTER_BOX;
+		srgb = false;
+		compress = false;
+		format = BlockCompressor::FORMAT_BC1;
+		quality = BlockCompressor::QUALITY_HIGH;
+		threadCount = (int)std::thread::hardware_concurrency();
+		if (threadCount < 1) threadCount = 1;
+	}
+};
+
+void printUsage() {
+	printf("Usage: texture-cooker <input.tga> <output.ctex> [options]\n");
+	printf("  --filter box|kaiser   mip downsampling filter (default box)\n");
+	printf("  --srgb                treat color channels as sRGB and filter in linear space\n");
+	printf("  --format rgba8|bc1|bc3|bc7  stored texel format (default rgba8)\n");
+	printf("  --quality fast|high   block compression effort (default high)\n");
+	printf("  --threads N           worker threads per level (default: hardware threads)\n");
+}
+
+int parseArgs(int argc, char* argv[], CookOptions& options) {
+	if (argc < 3) {
+		printf("ERROR: missing input or output filename parameter\n");
+		return -1;
+	}
+	options.inputFilename = argv[1];
+	options.outputFilename = argv[2];
+
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--filter" && i + 1 < argc) {
+			std::string name = argv[++i];
+			if (name == "box") options.filter = MipChain::FILTER_BOX;
+			else if (name == "kaiser") options.filter = MipChain::FILTER_KAISER;
+			else {
+				printf("ERROR: unknown filter '%s'\n", name.c_str());
+				return -1;
+			}
+		}
+		else if (arg == "--srgb") {
+			options.srgb = true;
+		}
+		else if (arg == "--format" && i + 1 < argc) {
+			std::string name = argv[++i];
+			options.compress = name != "rgba8";
+			if (name == "bc1") options.format = BlockCompressor::FORMAT_BC1;
+			else if (name == "bc3") options.format = BlockCompressor::FORMAT_BC3;
+			else if (name == "bc7") options.format = BlockCompressor::FORMAT_BC7;
+			else if (name != "rgba8") {
+				printf("ERROR: unknown format '%s'\n", name.c_str());
+				return -1;
+			}
+		}
+		else if (arg == "--quality" && i + 1 < argc) {
+			std::string name = argv[++i];
+			if (name == "fast") options.quality = BlockCompressor::QUALITY_FAST;
+			else if (name == "high") options.quality = BlockCompressor::QUALITY_HIGH;
+			else {
+				printf("ERROR: unknown quality '%s'\n", name.c_str());
+				return -1;
+			}
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			options.threadCount = atoi(argv[++i]);
+			if (options.threadCount < 1) options.threadCount = 1;
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	return 0;
+}
+
+unsigned long long alignUp(unsigned long long value, unsigned long long alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// One level as it will be stored: raw RGBA8 rows or rows of compressed blocks
+struct CookedLevel {
+	int width, height;
+	unsigned int rowPitch;
+	std::vector<unsigned char> data;
+};
+
+unsigned int getCookedFormat(const CookOptions& options) {
+	if (!options.compress) return COOKED_FORMAT_R8G8B8A8_UNORM;
+	switch (options.format) {
+	case BlockCompressor::FORMAT_BC1: return COOKED_FORMAT_BC1_UNORM;
+	case BlockCompressor::FORMAT_BC3: return COOKED_FORMAT_BC3_UNORM;
+	default: return COOKED_FORMAT_BC7_UNORM;
+	}
+}
+
+// Turns every mip into its stored form, block compressing it if asked. PSNR is reported for
+// the top level and for the whole chain.
+int prepareLevels(MipChain& mips, const CookOptions& options, std::vector<CookedLevel>& levels) {
+	int levelCount = mips.GetLevelCount();
+	levels.resize(levelCount);
+
+	BlockCompressor compressor;
+	double totalError = 0.0, totalSamples = 0.0;
+	for (int i = 0; i < levelCount; i++) {
+		CookedLevel& level = levels[i];
+		level.width = mips.GetLevelWidth(i);
+		level.height = mips.GetLevelHeight(i);
+		const unsigned char* pTexels = mips.GetLevelData(i);
+
+		if (!options.compress) {
+			level.rowPitch = level.width * 4;
+			level.data.assign(pTexels, pTexels + (size_t)level.rowPitch * level.height);
+			continue;
+		}
+
+		if (!compressor.Compress(pTexels, level.width, level.height, options.format,
+			options.quality, options.threadCount, level.data))
+		{
+			printf("ERROR: block compressing mip %d failed\n", i);
+			return -1;
+		}
+		level.rowPitch = ((level.width + 3) / 4) * BlockCompressor::GetBlockBytes(options.format);
+
+		double squaredError, samples;
+		double psnr = compressor.ComputePsnr(pTexels, level.width, level.height, options.format,
+			level.data, &squaredError, &samples);
+		totalError += squaredError;
+		totalSamples += samples;
+		if (i == 0) printf("  %s top level PSNR: %.2f dB\n", BlockCompressor::GetFormatName(options.format), psnr);
+	}
+
+	if (options.compress) {
+		double mse = totalError / totalSamples;
+		printf("  %s whole chain PSNR: %.2f dB\n", BlockCompressor::GetFormatName(options.format),
+			mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY);
+	}
+	return 0;
+}
+
+int writeCookedTexture(const std::string& filename, const std::vector<CookedLevel>& levels,
+	unsigned int format, bool srgb)
+{
+	int levelCount = (int)levels.size();
+
+	CookedTextureHeader header;
+	header.magic = COOKED_TEXTURE_MAGIC;
+	header.version = COOKED_TEXTURE_VERSION;
+	header.width = levels[0].width;
+	header.height = levels[0].height;
+	header.mipCount = levelCount;
+	header.format = format;
+	// The format stays UNORM (not _SRGB) on purpose so sampling matches the plain .tga path;
+	// the flag only records that the mips were filtered gamma-correctly.
+	header.flags = srgb ? COOKED_FLAG_SRGB_FILTERED : 0;
+	header.reserved = 0;
+
+	std::vector<CookedMipEntry> entries(levelCount);
+	unsigned long long offset = sizeof(CookedTextureHeader) + sizeof(CookedMipEntry) * levelCount;
+	for (int i = 0; i < levelCount; i++) {
+		offset = alignUp(offset, COOKED_TEXTURE_DATA_ALIGNMENT);
+		entries[i].width = levels[i].width;
+		entries[i].height = levels[i].height;
+		entries[i].rowPitch = levels[i].rowPitch;
+		entries[i].dataSize = (unsigned int)levels[i].data.size();
+		entries[i].offset = offset;
+		offset += entries[i].dataSize;
+	}
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (!pFile) {
+		printf("ERROR: could not open '%s' for writing\n", filename.c_str());
+		return -1;
+	}
+
+	fwrite(&header, sizeof(header), 1, pFile);
+	fwrite(entries.data(), sizeof(CookedMipEntry), levelCount, pFile);
+	for (int i = 0; i < levelCount; i++) {
+		// Pad up to the level's aligned offset
+		static const unsigned char zeros[COOKED_TEXTURE_DATA_ALIGNMENT] = { };
+		long padding = (long)(entries[i].offset - (unsigned long long)ftell(pFile));
+		if (padding > 0) fwrite(zeros, 1, padding, pFile);
+		fwrite(levels[i].data.data(), 1, entries[i].dataSize, pFile);
+	}
+
+	bool ok = ferror(pFile) == 0;
+	fclose(pFile);
+	if (!ok) {
+		printf("ERROR: failed while writing '%s'\n", filename.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	printf("Texture cooker started.  argc=%d\n", argc);
+
+	CookOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	TargaDecoder decoder;
+	if (!decoder.Open(options.inputFilename.c_str())) {
+		printf("ERROR: could not open '%s' as a targa\n", options.inputFilename.c_str());
+		return -10;
+	}
+	int width = decoder.GetWidth(), height = decoder.GetHeight();
+	if (options.compress && (width % 4 != 0 || height % 4 != 0)) {
+		// D3D11 wants the top level of a block-compressed texture in whole blocks
+		printf("ERROR: %s needs width and height to be multiples of 4, '%s' is %dx%d\n",
+			BlockCompressor::GetFormatName(options.format), options.inputFilename.c_str(), width, height);
+		return -10;
+	}
+	std::vector<unsigned char> pixels((size_t)width * height * 4);
+	if (!decoder.Decode(pixels.data(), width * 4)) {
+		printf("ERROR: could not decode '%s'\n", options.inputFilename.c_str());
+		return -10;
+	}
+	decoder.Close();
+	auto decodedTime = std::chrono::steady_clock::now();
+
+	MipChain mips;
+	if (!mips.Build(pixels.data(), width, height, options.filter, options.srgb, options.threadCount)) {
+		printf("ERROR: building the mip chain failed, aborting.\n");
+		return -15;
+	}
+	auto builtTime = std::chrono::steady_clock::now();
+
+	std::vector<CookedLevel> levels;
+	if (prepareLevels(mips, options, levels) < 0) {
+		printf("ERROR: preparing levels failed, aborting.\n");
+		return -15;
+	}
+	auto encodedTime = std::chrono::steady_clock::now();
+
+	if (writeCookedTexture(options.outputFilename, levels, getCookedFormat(options), options.srgb) < 0) {
+		return -20;
+	}
+	auto writtenTime = std::chrono::steady_clock::now();
+
+	auto ms = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+		return std::chrono::duration<double, std::milli>(b - a).count();
+	};
+	printf("Cooked %dx%d into %d mips (%s, %s, %s, %d threads)\n", width, height, mips.GetLevelCount(),
+		options.filter == MipChain::FILTER_BOX ? "box" : "kaiser", options.srgb ? "sRGB" : "linear",
+		options.compress ? BlockCompressor::GetFormatName(options.format) : "RGBA8", options.threadCount);
+	printf("  decode %.2f ms, mips %.2f ms, encode %.2f ms, write %.2f ms\n",
+		ms(startTime, decodedTime), ms(decodedTime, builtTime), ms(builtTime, encodedTime),
+		ms(encodedTime, writtenTime));
+	printf("Output written to: %s\n", options.outputFilename.c_str());
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "MipChain.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#include "ParallelRows.h"
+
+// Kaiser window parameters. The support is in units of destination texels on each side.
+static const float KAISER_ALPHA = 4.0f;
+static const float KAISER_SUPPORT = 3.0f;
+static const float PI = 3.14159265358979f;
+
+static float SrgbToLinear(float c) {
+	return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float c) {
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Zeroth-order modified Bessel function of the first kind, the series converges quickly
+static float BesselI0(float x) {
+	float sum = 1.0f, term = 1.0f, halfX = x * 0.5f;
+	for (int k = 1; k < 32; k++) {
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+		if (term < sum * 1e-8f) break;
+	}
+	return sum;
+}
+
+static float KaiserSinc(float t) {
+	if (fabsf(t) >= KAISER_SUPPORT) return 0.0f;
+	float sinc = t == 0.0f ? 1.0f : sinf(PI * t) / (PI * t);
+	float r = t / KAISER_SUPPORT;
+	return sinc * BesselI0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / BesselI0(KAISER_ALPHA);
+}
+
+MipChain::MipChain() {
+	this->filter = FILTER_BOX;
+	this->srgb = false;
+	this->threadCount = 1;
+}
+
+bool MipChain::Build(const unsigned char* pRgba, int width, int height,
+	Filter filter, bool srgb, int threadCount)
+{
+	if (!pRgba || width <= 0 || height <= 0) {
+		printf("ERROR: MipChain::Build given an empty image (%dx%d)\n", width, height);
+		return false;
+	}
+
+	this->filter = filter;
+	this->srgb = srgb;
+	this->threadCount = threadCount < 1 ? 1 : threadCount;
+
+	int levelCount = 1;
+	for (int w = width, h = height; w > 1 || h > 1; levelCount++) {
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	this->levels.clear();
+	this->levels.resize(levelCount);
+
+	// Level 0 keeps the source bytes as-is; the float copy is only there to filter from
+	float toFloat[256];
+	for (int i = 0; i < 256; i++) {
+		toFloat[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+	}
+
+	Level& top = this->levels[0];
+	top.width = width;
+	top.height = height;
+	top.rgba8.assign(pRgba, pRgba + (size_t)width * height * 4);
+	top.texels.resize((size_t)width * height * 4);
+	for (size_t i = 0; i < top.rgba8.size(); i += 4) {
+		top.texels[i + 0] = toFloat[top.rgba8[i + 0]];
+		top.texels[i + 1] = toFloat[top.rgba8[i + 1]];
+		top.texels[i + 2] = toFloat[top.rgba8[i + 2]];
+		top.texels[i + 3] = top.rgba8[i + 3] / 255.0f; // alpha is never sRGB
+	}
+
+	for (int i = 1; i < levelCount; i++) {
+		Level& src = this->levels[i - 1];
+		Level& dst = this->levels[i];
+		dst.width = src.width > 1 ? src.width / 2 : 1;
+		dst.height = src.height > 1 ? src.height / 2 : 1;
+		dst.texels.resize((size_t)dst.width * dst.height * 4);
+
+		bool exactHalf = src.width == dst.width * 2 && src.height == dst.height * 2;
+		if (filter == FILTER_BOX && exactHalf) DownsampleBox2x2(src, dst);
+		else Downsample(src, dst);
+
+		Quantize(dst);
+
+		// Only the level right above is needed to build the next one
+		std::vector<float>().swap(src.texels);
+	}
+	std::vector<float>().swap(this->levels[levelCount - 1].texels);
+
+	return true;
+}
+
+void MipChain::Shutdown() {
+	this->levels.clear();
+}
+
+int MipChain::GetLevelCount() {
+	return (int)this->levels.size();
+}
+
+int MipChain::GetLevelWidth(int level) {
+	return this->levels[level].width;
+}
+
+int MipChain::GetLevelHeight(int level) {
+	return this->levels[level].height;
+}
+
+const unsigned char* MipChain::GetLevelData(int level) {
+	return this->levels[level].rgba8.data();
+}
+
+void MipChain::BuildTaps(int srcSize, int dstSize, std::vector<Taps>& taps) {
+	taps.resize(dstSize);
+	float scale = (float)srcSize / (float)dstSize;
+
+	for (int x = 0; x < dstSize; x++) {
+		Taps& t = taps[x];
+		t.indices.clear();
+		t.weights.clear();
+
+		float center = (x + 0.5f) * scale;
+		float reach = this->filter == FILTER_BOX ? scale * 0.5f : scale * KAISER_SUPPORT;
+		int first = (int)floorf(center - reach);
+		int last = (int)ceilf(center + reach);
+
+		float total = 0.0f;
+		for (int i = first; i <= last; i++) {
+			float weight;
+			if (this->filter == FILTER_BOX) {
+				// Area of the source texel [i, i + 1] covered by the footprint
+				float lo = fmaxf((float)i, center - reach);
+				float hi = fminf((float)(i + 1), center + reach);
+				weight = hi > lo ? hi - lo : 0.0f;
+			}
+			else {
+				weight = KaiserSinc((i + 0.5f - center) / scale);
+			}
+			if (weight == 0.0f) continue;
+
+			int clamped = i < 0 ? 0 : (i >= srcSize ? srcSize - 1 : i);
+			t.indices.push_back(clamped);
+			t.weights.push_back(weight);
+			total += weight;
+		}
+
+		for (size_t k = 0; k < t.weights.size(); k++) t.weights[k] /= total;
+	}
+}
+
+// General separable resample: a horizontal pass into a scratch image that is already the
+// destination width, then a vertical pass into the destination.
+void MipChain::Downsample(const Level& src, Level& dst) {
+	std::vector<Taps> tapsX, tapsY;
+	BuildTaps(src.width, dst.width, tapsX);
+	BuildTaps(src.height, dst.height, tapsY);
+
+	std::vector<float> scratch((size_t)dst.width * src.height * 4);
+
+	ParallelRows(src.height, this->threadCount, [&](int begin, int end) {
+		for (int y = begin; y < end; y++) {
+			const float* pSrcRow = src.texels.data() + (size_t)y * src.width * 4;
+			float* pOutRow = scratch.data() + (size_t)y * dst.width * 4;
+			for (int x = 0; x < dst.width; x++) {
+				const Taps& t = tapsX[x];
+				__m128 sum = _mm_setzero_ps();
+				for (size_t k = 0; k < t.weights.size(); k++) {
+					__m128 texel = _mm_loadu_ps(pSrcRow + t.indices[k] * 4);
+					sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(t.weights[k])));
+				}
+				_mm_storeu_ps(pOutRow + x * 4, sum);
+			}
+		}
+	});
+
+	ParallelRows(dst.height, this->threadCount, [&](int begin, int end) {
+		for (int y = begin; y < end; y++) {
+			const Taps& t = tapsY[y];
+			float* pOutRow = dst.texels.data() + (size_t)y * dst.width * 4;
+			for (int x = 0; x < dst.width; x++) {
+				__m128 sum = _mm_setzero_ps();
+				for (size_t k = 0; k < t.weights.size(); k++) {
+					const float* pTexel = scratch.data() + ((size_t)t.indices[k] * dst.width + x) * 4;
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pTexel), _mm_set1_ps(t.weights[k])));
+				}
+				_mm_storeu_ps(pOutRow + x * 4, sum);
+			}
+		}
+	});
+}
+
+// The common case: both sides are even so each output texel is the mean of a 2x2 block
+void MipChain::DownsampleBox2x2(const Level& src, Level& dst) {
+	const __m128 quarter = _mm_set1_ps(0.25f);
+
+	ParallelRows(dst.height, this->threadCount, [&](int begin, int end) {
+		for (int y = begin; y < end; y++) {
+			const float* pRow0 = src.texels.data() + (size_t)(y * 2) * src.width * 4;
+			const float* pRow1 = pRow0 + (size_t)src.width * 4;
+			float* pOutRow = dst.texels.data() + (size_t)y * dst.width * 4;
+			for (int x = 0; x < dst.width; x++) {
+				__m128 sum = _mm_add_ps(
+					_mm_add_ps(_mm_loadu_ps(pRow0 + x * 8), _mm_loadu_ps(pRow0 + x * 8 + 4)),
+					_mm_add_ps(_mm_loadu_ps(pRow1 + x * 8), _mm_loadu_ps(pRow1 + x * 8 + 4)));
+				_mm_storeu_ps(pOutRow + x * 4, _mm_mul_ps(sum, quarter));
+			}
+		}
+	});
+}
+
+void MipChain::Quantize(Level& level) {
+	size_t texelCount = (size_t)level.width * level.height;
+	level.rgba8.resize(texelCount * 4);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	for (size_t i = 0; i < texelCount; i++) {
+		float* pTexel = level.texels.data() + i * 4;
+		__m128 texel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pTexel), zero), one);
+
+		if (this->srgb) {
+			// pow doesn't vectorize nicely and this is offline, so re-encode per channel
+			float c[4];
+			_mm_storeu_ps(c, texel);
+			c[0] = LinearToSrgb(c[0]);
+			c[1] = LinearToSrgb(c[1]);
+			c[2] = LinearToSrgb(c[2]);
+			texel = _mm_loadu_ps(c);
+		}
+
+		__m128i ints = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, scale), half));
+		ints = _mm_packs_epi32(ints, ints);
+		ints = _mm_packus_epi16(ints, ints);
+		*(int*)(level.rgba8.data() + i * 4) = _mm_cvtsi128_si32(ints);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+/* Builds a full mip chain on the CPU from an RGBA8 image. Filtering is done on float RGBA
+ * texels with SSE, and each level is split into row bands that are filtered on separate
+ * threads. Every level is resampled from the one above it, down to 1x1. */
+class MipChain {
+public:
+	enum Filter {
+		FILTER_BOX,    // exact-area box; the 2x2 average for even sizes
+		FILTER_KAISER, // Kaiser-windowed sinc, sharper but costs a few more taps
+	};
+
+	MipChain();
+
+	// pRgba is width * height tightly packed RGBA8 texels, top row first. With srgb set the
+	// color channels are converted to linear before filtering and back again afterwards.
+	bool Build(const unsigned char*, int, int, Filter, bool, int);
+	void Shutdown();
+
+	int GetLevelCount();
+	int GetLevelWidth(int);
+	int GetLevelHeight(int);
+	const unsigned char* GetLevelData(int);
+
+private:
+	struct Level {
+		int width, height;
+		std::vector<float> texels;         // RGBA float, linear if srgb was requested
+		std::vector<unsigned char> rgba8;  // final quantized texels
+	};
+
+	// For one output texel along an axis: the first source texel and the weight of each one
+	// from there on. Edge taps are already clamped, so every index is in range.
+	struct Taps {
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	void BuildTaps(int, int, std::vector<Taps>&);
+	void Downsample(const Level&, Level&);
+	void DownsampleBox2x2(const Level&, Level&);
+	void Quantize(Level&);
+
+	std::vector<Level> levels;
+	Filter filter;
+	bool srgb;
+	int threadCount;
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <functional>
+
+// Splits [0, count) into one band per thread and runs fn(begin, end) on each. The calling
+// thread takes the last band so a single-threaded run doesn't spawn anything.
+inline void ParallelRows(int count, int threadCount, const std::function<void(int, int)>& fn) {
+	if (threadCount > count) threadCount = count;
+	if (threadCount <= 1) {
+		fn(0, count);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	int band = (count + threadCount - 1) / threadCount;
+	for (int begin = 0; begin < count; begin += band) {
+		int end = begin + band < count ? begin + band : count;
+		if (end == count) fn(begin, end);
+		else workers.push_back(std::thread(fn, begin, end));
+	}
+	for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
\ No newline at end of file
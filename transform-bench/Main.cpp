@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "../directx-sandbox/TransformSystem.h"
+
+/* Times TransformSystem::Update on a big made-up scene, on one thread and then across a job
+ * system. Each frame some fraction of the transforms get a new rotation (everything, by default),
+ * and whatever's under them comes along. --check recomputes every world matrix the slow way,
+ * straight from the hierarchy, and compares. */
+
+struct BenchOptions {
+	int count;
+	int frames;
+	int threads;
+	int dirtyPercent;
+	int rootPercent;
+	unsigned int seed;
+	bool check;
+
+	BenchOptions() {
+		count = 1000000;
+		frames = 60;
+		threads = 0;
+		dirtyPercent = 100;
+		rootPercent = 25;
+		seed = 1;
+		check = false;
+	}
+};
+
+// The bench's own copy of everything it's set, for --check
+struct SceneTransform {
+	int parent;
+	DirectX::XMFLOAT3 translation;
+	DirectX::XMFLOAT4 rotation;
+	DirectX::XMFLOAT3 scale;
+};
+
+void printUsage() {
+	printf("Usage: transform-bench [options]\n");
+	printf("  --count N      transforms in the scene (default 1000000)\n");
+	printf("  --frames N     frames to time each way (default 60)\n");
+	printf("  --threads N    job system threads, this one included, 0 for one per core (default 0)\n");
+	printf("  --dirty N      percent of transforms changed each frame (default 100)\n");
+	printf("  --roots N      percent of transforms with no parent (default 25)\n");
+	printf("  --seed N       for the random scene (default 1)\n");
+	printf("  --check        compare every world matrix against a straightforward recompute\n");
+}
+
+int parseArgs(int argc, char* argv[], BenchOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--count" && i + 1 < argc) {
+			options.count = atoi(argv[++i]);
+		}
+		else if (arg == "--frames" && i + 1 < argc) {
+			options.frames = atoi(argv[++i]);
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			options.threads = atoi(argv[++i]);
+		}
+		else if (arg == "--dirty" && i + 1 < argc) {
+			options.dirtyPercent = atoi(argv[++i]);
+		}
+		else if (arg == "--roots" && i + 1 < argc) {
+			options.rootPercent = atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			options.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--check") {
+			options.check = true;
+		}
+		else {
+			printf("ERROR: unknown or incomplete option '%s'\n", arg.c_str());
+			return -1;
+		}
+	}
+	if (options.count <= 0 || options.frames <= 0 || options.threads < 0
+		|| options.dirtyPercent < 0 || options.dirtyPercent > 100
+		|| options.rootPercent <= 0 || options.rootPercent > 100)
+	{
+		printf("ERROR: options out of range\n");
+		return -1;
+	}
+	return 0;
+}
+
+// Parents are picked from anything created before, which ends up a dozen or so levels deep.
+// A few get reparented afterwards, onto transforms created after them, so the first Update
+// has some sorting to do.
+void buildScene(const BenchOptions& options, TransformSystem& transforms, std::vector<SceneTransform>& scene) {
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	transforms.Reserve(options.count);
+	scene.resize(options.count);
+	for (int i = 0; i < options.count; i++) {
+		SceneTransform& object = scene[i];
+		bool root = i == 0 || (int)(random() % 100) < options.rootPercent;
+		object.parent = root ? TransformSystem::NO_PARENT : (int)(random() % i);
+		object.translation = DirectX::XMFLOAT3(unit(random) * 10.0f, unit(random) * 10.0f, unit(random) * 10.0f);
+		DirectX::XMStoreFloat4(&object.rotation, DirectX::XMQuaternionRotationRollPitchYaw(
+			unit(random) * DirectX::XM_PI, unit(random) * DirectX::XM_PI, unit(random) * DirectX::XM_PI));
+		float scale = 1.0f + unit(random) * 0.05f;
+		object.scale = DirectX::XMFLOAT3(scale, scale, scale);
+
+		int id = transforms.Create(object.parent);
+		transforms.SetLocal(id, object.translation, object.rotation, object.scale);
+	}
+
+	for (int i = 0; i < options.count / 100; i++) {
+		int id = (int)(random() % options.count);
+		int parent = (int)(random() % options.count);
+		if (transforms.SetParent(id, parent)) scene[id].parent = parent;
+	}
+}
+
+// Spins each changed transform a little about y, a different set of them each frame
+void changeTransforms(const BenchOptions& options, int frame, TransformSystem& transforms, std::vector<SceneTransform>& scene) {
+	DirectX::XMVECTOR spin = DirectX::XMQuaternionRotationNormal(DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), 0.01f);
+	int step = options.dirtyPercent > 0 ? 100 / options.dirtyPercent : 0;
+	if (step == 0) return;
+	for (int id = frame % step; id < options.count; id += step) {
+		SceneTransform& object = scene[id];
+		DirectX::XMStoreFloat4(&object.rotation, DirectX::XMQuaternionMultiply(DirectX::XMLoadFloat4(&object.rotation), spin));
+		transforms.SetRotation(id, object.rotation);
+	}
+}
+
+// Returns the average ms per Update
+double timeFrames(const BenchOptions& options, TransformSystem& transforms, std::vector<SceneTransform>& scene,
+	JobSystem* pJobs, int& updatedPerFrame)
+{
+	double totalMs = 0.0;
+	long long updated = 0;
+	for (int frame = 0; frame < options.frames; frame++) {
+		changeTransforms(options, frame, transforms, scene);
+		auto startTime = std::chrono::steady_clock::now();
+		transforms.Update(pJobs);
+		totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		updated += transforms.GetLastUpdateCount();
+	}
+	updatedPerFrame = (int)(updated / options.frames);
+	return totalMs / options.frames;
+}
+
+DirectX::XMMATRIX localMatrix(const SceneTransform& object) {
+	return DirectX::XMMatrixScaling(object.scale.x, object.scale.y, object.scale.z)
+		* DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&object.rotation))
+		* DirectX::XMMatrixTranslation(object.translation.x, object.translation.y, object.translation.z);
+}
+
+bool checkWorlds(const std::vector<SceneTransform>& scene, TransformSystem& transforms) {
+	// Each world is its local times its parent's world, parents found by walking up and worked
+	// back down, nothing shared with how TransformSystem does it
+	std::vector<DirectX::XMFLOAT4X4A> worlds(scene.size());
+	std::vector<unsigned char> done(scene.size(), 0);
+	std::vector<int> chain;
+	int mismatches = 0;
+	float worstError = 0.0f;
+	for (int id = 0; id < (int)scene.size(); id++) {
+		for (int up = id; up != TransformSystem::NO_PARENT && !done[up]; up = scene[up].parent) chain.push_back(up);
+		while (!chain.empty()) {
+			int at = chain.back();
+			chain.pop_back();
+			DirectX::XMMATRIX world = localMatrix(scene[at]);
+			if (scene[at].parent != TransformSystem::NO_PARENT) {
+				world = world * DirectX::XMLoadFloat4x4A(&worlds[scene[at].parent]);
+			}
+			DirectX::XMStoreFloat4x4A(&worlds[at], world);
+			done[at] = 1;
+		}
+
+		if (transforms.GetParent(id) != scene[id].parent) {
+			printf("ERROR: transform %d has parent %d, expected %d\n", id, transforms.GetParent(id), scene[id].parent);
+			return false;
+		}
+		DirectX::XMFLOAT4X4A actual;
+		DirectX::XMStoreFloat4x4A(&actual, transforms.GetWorld(id));
+		float error = 0.0f;
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 4; column++) {
+				float expected = worlds[id].m[row][column];
+				float difference = fabsf(actual.m[row][column] - expected) / (1.0f + fabsf(expected));
+				if (difference > error) error = difference;
+			}
+		}
+		if (error > worstError) worstError = error;
+		if (error > 1e-3f && mismatches++ < 5) printf("ERROR: transform %d's world matrix is off by %g\n", id, error);
+	}
+	printf("Checked %d world matrices, largest relative difference %g\n", (int)scene.size(), worstError);
+	return mismatches == 0;
+}
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (parseArgs(argc, argv, options) < 0) {
+		printUsage();
+		return -5;
+	}
+
+	TransformSystem transforms;
+	std::vector<SceneTransform> scene;
+	auto buildStart = std::chrono::steady_clock::now();
+	buildScene(options, transforms, scene);
+	transforms.Update(nullptr);
+	double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+	printf("%d transforms, %d deep, built and sorted in %.1f ms\n", transforms.GetCount(), transforms.GetDepthCount(), buildMs);
+	if (options.check && !checkWorlds(scene, transforms)) return -10;
+
+	int updated = 0;
+	double singleMs = timeFrames(options, transforms, scene, nullptr, updated);
+	printf("1 thread:   %8.2f ms/frame, %d recomputed per frame, %.1f M transforms/s\n",
+		singleMs, updated, updated / singleMs / 1000.0);
+
+	JobSystem jobs;
+	jobs.Init(options.threads);
+	double jobsMs = timeFrames(options, transforms, scene, &jobs, updated);
+	printf("%d threads: %8.2f ms/frame, %d recomputed per frame, %.1f M transforms/s\n",
+		jobs.GetThreadCount(), jobsMs, updated, updated / jobsMs / 1000.0);
+	JobSystem::Stats stats = {};
+	for (int i = 0; i < jobs.GetThreadCount(); i++) {
+		JobSystem::Stats thread;
+		jobs.GetStats(i, thread);
+		stats.stolen += thread.stolen;
+		stats.splits += thread.splits;
+	}
+	printf("  %llu ranges split, %llu stolen\n", stats.splits, stats.stolen);
+	jobs.Shutdown();
+	if (jobsMs > 0.0) printf("%.1fx faster across the job system\n", singleMs / jobsMs);
+
+	if (options.check && !checkWorlds(scene, transforms)) return -10;
+	return 0;
+}
\ No newline at end of file